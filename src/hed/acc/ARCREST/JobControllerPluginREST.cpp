@@ -6,6 +6,9 @@
 
 #include <glib.h>
 
+#include <map>
+
+#include <arc/Thread.h>
 #include <arc/StringConv.h>
 #include <arc/UserConfig.h>
 #include <arc/XMLNode.h>
@@ -81,89 +84,113 @@ namespace Arc {
     return pos != std::string::npos && lower(endpoint.substr(0, pos)) != "http" && lower(endpoint.substr(0, pos)) != "https";
   }
 
-  void JobControllerPluginREST::UpdateJobs(std::list<Job*>& jobs, std::list<std::string>& IDsProcessed, std::list<std::string>& IDsNotProcessed, bool isGrouped) const {
-    class JobStateProcessor: public InfoNodeProcessor {
-     public:
-      JobStateProcessor(std::list<Job*>& jobs): jobs(jobs) {}
-
-      virtual void operator()(std::string const& id, XMLNode node, URL const& query_url) {
-        std::string job_id = node["id"];
-        std::string job_state = node["state"];
-        if(!job_state.empty() && !job_id.empty()) {
-          for(std::list<Job*>::iterator itJob = jobs.begin(); itJob != jobs.end(); ++itJob) {
-            std::string id = (*itJob)->JobID;
-            std::string::size_type pos = id.rfind('/');
-            if(pos != std::string::npos) id.erase(0,pos+1);
-            if(job_id == id) {
-              (*itJob)->State = JobStateARCREST(job_state);
-              // (*itJob)->RestartState = ;
-              std::string baseUrl = query_url.ConnectionURL()+query_url.Path()+"/"+job_id;
-              (*itJob)->StageInDir = baseUrl;
-              (*itJob)->StageOutDir = baseUrl;
-              (*itJob)->SessionDir = baseUrl;
-              // (*itJob)->DelegationID.push_back ;
-              break;
-            }
-          }
-        }
+  // Number of jobs sent in single request. Bigger lists are split to limit
+  // size of request and response documents.
+  static const unsigned int MaxJobsPerRequest = 1000;
+  // Number of services queried simultaneously while updating jobs
+  static const unsigned int MaxParallelServices = 10;
+
+  class JobInfoProcessorREST: public JobControllerPluginREST::InfoNodeProcessor {
+   public:
+    JobInfoProcessorREST(std::list<Job*>& jobs) {
+      for(std::list<Job*>::iterator itJob = jobs.begin(); itJob != jobs.end(); ++itJob) {
+        this->jobs.insert(std::pair<std::string, Job*>((*itJob)->JobID, *itJob));
       }
+    }
 
-     private:
-      std::list<Job*>& jobs;
-    };
-
-    class JobInfoProcessor: public InfoNodeProcessor {
-     public:
-      JobInfoProcessor(std::list<Job*>& jobs): jobs(jobs) {}
-
-      virtual void operator()(std::string const& id, XMLNode node, URL const& query_url) {
-        std::string job_id = node["id"];
-        XMLNode job_info = node["info_document"];
-        if(job_info && !job_id.empty()) {
-          for(std::list<Job*>::iterator itJob = jobs.begin(); itJob != jobs.end(); ++itJob) {
-            std::string id = (*itJob)->JobID;
-            std::string::size_type pos = id.rfind('/');
-            if(pos != std::string::npos) id.erase(0,pos+1);
-            if(job_id == id) {
-              (*itJob)->SetFromXML(job_info["ComputingActivity"]);              
-              std::string baseUrl = query_url.ConnectionURL()+query_url.Path()+"/"+job_id;
-              (*itJob)->StageInDir = baseUrl;
-              (*itJob)->StageOutDir = baseUrl;
-              (*itJob)->SessionDir = baseUrl;
-              for(XMLNode state = job_info["ComputingActivity"]["State"]; (bool)state; ++state) {
-                std::string stateStr = state;
-                if(strncmp(stateStr.c_str(), "arcrest:", 8) == 0) {
-                  (*itJob)->State = JobStateARCREST(stateStr.substr(8));
-                  break;
-                }
-              }
+    virtual void operator()(std::string const& id, XMLNode node, URL const& query_url) {
+      std::string job_id = node["id"];
+      XMLNode job_info = node["info_document"];
+      if(job_info && !job_id.empty()) {
+        // id is one of job IDs passed to ProcessJobs
+        std::map<std::string, Job*>::iterator itJob = jobs.find(id);
+        if(itJob != jobs.end()) {
+          Job& job = *(itJob->second);
+          job.SetFromXML(job_info["ComputingActivity"]);
+          std::string baseUrl = query_url.ConnectionURL()+query_url.Path()+"/"+job_id;
+          job.StageInDir = baseUrl;
+          job.StageOutDir = baseUrl;
+          job.SessionDir = baseUrl;
+          for(XMLNode state = job_info["ComputingActivity"]["State"]; (bool)state; ++state) {
+            std::string stateStr = state;
+            if(strncmp(stateStr.c_str(), "arcrest:", 8) == 0) {
+              job.State = JobStateARCREST(stateStr.substr(8));
               break;
             }
           }
         }
       }
+    }
 
-     private:
-      std::list<Job*>& jobs;
-    };
+   private:
+    std::map<std::string, Job*> jobs;
+  };
 
-    JobInfoProcessor infoProcessor(jobs);
-    Arc::URL currentServiceUrl;
-    std::list<std::string> IDs;
-    for (std::list<Job*>::const_iterator it = jobs.begin(); it != jobs.end(); ++it) {
-      if(!currentServiceUrl || (currentServiceUrl != GetAddressOfResource(**it))) {
-        if(!IDs.empty()) {
-          std::list<std::string> fakeIDs = IDs;
-          ProcessJobs(usercfg, currentServiceUrl, "info", 200, IDs, IDsProcessed, IDsNotProcessed, infoProcessor);
-        }
-        currentServiceUrl = GetAddressOfResource(**it);
+  // Jobs belonging to one service and results of updating them
+  struct UpdateJobsService {
+    URL url;
+    std::list<Job*> jobs;
+    std::list<std::string> IDsProcessed;
+    std::list<std::string> IDsNotProcessed;
+  };
+
+  // Services waiting to be processed by UpdateJobsWorker threads
+  struct UpdateJobsQueue {
+    const UserConfig* usercfg;
+    Glib::Mutex lock;
+    std::list<UpdateJobsService*> services;
+    SimpleCounter workers;
+  };
+
+  static void UpdateJobsWorker(void* arg) {
+    UpdateJobsQueue& queue = *reinterpret_cast<UpdateJobsQueue*>(arg);
+    while(true) {
+      UpdateJobsService* service = NULL;
+      {
+        Glib::Mutex::Lock lock(queue.lock);
+        if(queue.services.empty()) break;
+        service = queue.services.front();
+        queue.services.pop_front();
+      }
+      std::list<std::string> IDs;
+      for (std::list<Job*>::const_iterator it = service->jobs.begin(); it != service->jobs.end(); ++it) {
+        IDs.push_back((*it)->JobID);
       }
+      JobInfoProcessorREST infoProcessor(service->jobs);
+      JobControllerPluginREST::ProcessJobs(queue.usercfg, service->url, "info", 200, IDs,
+                                           service->IDsProcessed, service->IDsNotProcessed, infoProcessor);
+    }
+  }
 
-      IDs.push_back((*it)->JobID);
+  void JobControllerPluginREST::UpdateJobs(std::list<Job*>& jobs, std::list<std::string>& IDsProcessed, std::list<std::string>& IDsNotProcessed, bool isGrouped) const {
+    // Jobs are not necessarily ordered by service. Collect all jobs of
+    // each service so that every service is asked only once.
+    std::map<URL, UpdateJobsService> services;
+    for (std::list<Job*>::const_iterator it = jobs.begin(); it != jobs.end(); ++it) {
+      URL serviceUrl = GetAddressOfResource(**it);
+      UpdateJobsService& service = services[serviceUrl];
+      if(service.jobs.empty()) service.url = serviceUrl;
+      service.jobs.push_back(*it);
     }
-    if(!IDs.empty()) {
-      std::list<std::string> fakeIDs = IDs;
-      ProcessJobs(usercfg, currentServiceUrl, "info", 200, IDs, IDsProcessed, IDsNotProcessed, infoProcessor);
+    if(services.empty()) return;
+
+    UpdateJobsQueue queue;
+    queue.usercfg = usercfg;
+    for (std::map<URL, UpdateJobsService>::iterator it = services.begin(); it != services.end(); ++it) {
+      queue.services.push_back(&(it->second));
+    }
+    // Current thread is one of workers. If additional threads can't be
+    // started it processes all services alone.
+    unsigned int threads = (services.size() < MaxParallelServices) ? services.size() : MaxParallelServices;
+    for (unsigned int n = 1; n < threads; ++n) {
+      if(!CreateThreadFunction(&UpdateJobsWorker, &queue, &(queue.workers))) break;
+    }
+    UpdateJobsWorker(&queue);
+    queue.workers.wait();
+
+    for (std::map<URL, UpdateJobsService>::iterator it = services.begin(); it != services.end(); ++it) {
+      IDsProcessed.splice(IDsProcessed.end(), it->second.IDsProcessed);
+      IDsNotProcessed.splice(IDsNotProcessed.end(), it->second.IDsNotProcessed);
     }
   }
 
@@ -283,24 +310,46 @@ namespace Arc {
   bool JobControllerPluginREST::ProcessJobs(const UserConfig* usercfg, Arc::URL const & resourceUrl, std::string const & action, int successCode,
           std::list<std::string>& IDs, std::list<std::string>& IDsProcessed, std::list<std::string>& IDsNotProcessed,
           InfoNodeProcessor& infoNodeProcessor) {
+    bool ok = true;
+    std::list<std::string> leftIDs;
+    while(!IDs.empty()) {
+      std::list<std::string> chunkIDs;
+      std::list<std::string>::iterator chunkEnd = IDs.begin();
+      for(unsigned int n = 0; (n < MaxJobsPerRequest) && (chunkEnd != IDs.end()); ++n) ++chunkEnd;
+      chunkIDs.splice(chunkIDs.end(), IDs, IDs.begin(), chunkEnd);
+      if(!ProcessJobsChunk(usercfg, resourceUrl, action, successCode, chunkIDs, IDsProcessed, IDsNotProcessed, infoNodeProcessor))
+        ok = false;
+      leftIDs.splice(leftIDs.end(), chunkIDs);
+    }
+    IDs.swap(leftIDs);
+    return ok;
+  }
+
+  bool JobControllerPluginREST::ProcessJobsChunk(const UserConfig* usercfg, Arc::URL const & resourceUrl, std::string const & action, int successCode,
+          std::list<std::string>& IDs, std::list<std::string>& IDsProcessed, std::list<std::string>& IDsNotProcessed,
+          InfoNodeProcessor& infoNodeProcessor) {
     Arc::URL statusUrl(resourceUrl);
     statusUrl.ChangePath(statusUrl.Path()+"/rest/1.0/jobs");
     statusUrl.AddHTTPOption("action",action);
 
     Arc::MCCConfig cfg;
     usercfg->ApplyToConfig(cfg);
-    Arc::ClientHTTP client(cfg, statusUrl);
+    bool pooled = false;
+    Arc::AutoPointer<Arc::ClientHTTP> client(Arc::ClientHTTPPool::Acquire(cfg, statusUrl, -1, &pooled));
     Arc::PayloadRaw request;
     Arc::PayloadRawInterface* response(NULL);
     Arc::HTTPClientInfo info;
+    // Identifiers as known to service are used to match returned items
+    std::multimap<std::string, std::list<std::string>::iterator> serviceIDs;
     {
       XMLNode jobs_id_list("<jobs/>");
-      for (std::list<std::string>::const_iterator it = IDs.begin(); it != IDs.end(); ++it) {
+      for (std::list<std::string>::iterator it = IDs.begin(); it != IDs.end(); ++it) {
         std::string id(*it);
         std::string::size_type pos = id.rfind('/');
         if(pos != std::string::npos) id.erase(0,pos+1);
         Arc::XMLNode job = jobs_id_list.NewChild("job");
         job.NewChild("id") = id;
+        serviceIDs.insert(std::pair<std::string, std::list<std::string>::iterator>(id, it));
       }
       std::string jobs_id_str;
       jobs_id_list.GetXML(jobs_id_str);
@@ -308,7 +357,16 @@ namespace Arc {
     }
     std::multimap<std::string,std::string> attributes;
     attributes.insert(std::pair<std::string, std::string>("Accept", "text/xml"));
-    Arc::MCC_Status res = client.process(std::string("POST"), attributes, &request, &info, &response);
+    Arc::MCC_Status res;
+    if(client) {
+      res = client->process(std::string("POST"), statusUrl.FullPathURIEncoded(), attributes, &request, &info, &response);
+      if((!res) && pooled && !client->GetSent()) {
+        // Pooled connection was closed by server before request was sent
+        delete response; response = NULL;
+        client = new Arc::ClientHTTP(cfg, statusUrl);
+        res = client->process(std::string("POST"), statusUrl.FullPathURIEncoded(), attributes, &request, &info, &response);
+      }
+    }
     if((!res) || (info.code != 201)) {
       logger.msg(WARNING, "Failed to process jobs - wrong response: %u", info.code);
       if(response && response->Content()) logger.msg(DEBUG, "Content: %s", response->Content());
@@ -323,6 +381,7 @@ namespace Arc {
     if(response->Content()) logger.msg(DEBUG, "Content: %s", response->Content());
     Arc::XMLNode jobs_list(response->Content()?response->Content():"");
     delete response; response = NULL;
+    Arc::ClientHTTPPool::Release(client.Release(), cfg, statusUrl);
     if(!jobs_list || (jobs_list.Name() != "jobs")) {
       logger.msg(WARNING, "Failed to process jobs - failed to parse response");
       for (std::list<std::string>::const_iterator it = IDs.begin(); it != IDs.end(); ++it) {
@@ -350,16 +409,12 @@ namespace Arc {
       if(jid.empty()) {
         // hmm
       } else {
-        std::list<std::string>::iterator it = IDs.begin();
-        for (; it != IDs.end(); ++it) {
-          std::string id(*it);
-          std::string::size_type pos = id.rfind('/');
-          if(pos != std::string::npos) id.erase(0,pos+1);
-          if (id == jid) break;
-        }
-        if(it == IDs.end()) {
+        std::multimap<std::string, std::list<std::string>::iterator>::iterator sit = serviceIDs.find(jid);
+        if(sit == serviceIDs.end()) {
           // hmm again
         } else {
+          std::list<std::string>::iterator it = sit->second;
+          serviceIDs.erase(sit);
           if(jcode != Arc::tostring(successCode)) {
             logger.msg(WARNING, "Failed to process job: %s - %s %s", jid, jcode, jreason);
             IDsNotProcessed.push_back(*it);
@@ -421,11 +476,21 @@ namespace Arc {
 
     Arc::MCCConfig cfg;
     usercfg->ApplyToConfig(cfg);
-    Arc::ClientHTTP client(cfg, statusUrl);
+    bool pooled = false;
+    Arc::AutoPointer<Arc::ClientHTTP> client(Arc::ClientHTTPPool::Acquire(cfg, statusUrl, -1, &pooled));
     Arc::PayloadRaw request;
     Arc::PayloadRawInterface* response(NULL);
     Arc::HTTPClientInfo info;
-    Arc::MCC_Status res = client.process(std::string("GET"), &request, &info, &response);
+    Arc::MCC_Status res;
+    if(client) {
+      res = client->process(std::string("GET"), statusUrl.FullPathURIEncoded(), &request, &info, &response);
+      if((!res) && pooled && !client->GetSent()) {
+        // Pooled connection was closed by server before request was sent
+        delete response; response = NULL;
+        client = new Arc::ClientHTTP(cfg, statusUrl);
+        res = client->process(std::string("GET"), statusUrl.FullPathURIEncoded(), &request, &info, &response);
+      }
+    }
     if((!res) || (info.code != 200) || (response == NULL) || (response->Buffer(0) == NULL)) {
       delete response;
       logger.msg(ERROR, "Failed retrieving job description for job: %s", job.JobID);
@@ -433,6 +498,7 @@ namespace Arc {
     }
     desc_str.assign(response->Buffer(0),response->BufferSize(0));
     delete response;
+    Arc::ClientHTTPPool::Release(client.Release(), cfg, statusUrl);
     return true;
   }
 
@@ -42,6 +42,9 @@ namespace Arc {
           InfoNodeProcessor& infoNodeProcessor);
 
   private:
+    static bool ProcessJobsChunk(const UserConfig* usercfg, Arc::URL const & resourceUrl, std::string const & action, int successCode,
+          std::list<std::string>& IDs, std::list<std::string>& IDsProcessed, std::list<std::string>& IDsNotProcessed,
+          InfoNodeProcessor& infoNodeProcessor);
     static URL GetAddressOfResource(const Job& job);
     static Logger logger;
 
@@ -4,7 +4,10 @@
 #include <config.h>
 #endif
 
+#include <map>
+
 #include <arc/StringConv.h>
+#include <arc/Utils.h>
 #include <arc/message/MCC.h>
 #include <arc/message/PayloadRaw.h>
 #include <arc/communication/ClientInterface.h>
@@ -30,14 +33,22 @@ namespace Arc {
 
     Arc::MCCConfig cfg;
     usercfg.ApplyToConfig(cfg);
-    Arc::ClientHTTP client(cfg, url);
+    bool pooled = false;
+    Arc::AutoPointer<Arc::ClientHTTP> client(Arc::ClientHTTPPool::Acquire(cfg, url, -1, &pooled));
+    if (!client) return s;
 
     Arc::PayloadRaw request;
     Arc::PayloadRawInterface* response(NULL);
     Arc::HTTPClientInfo info;
     std::multimap<std::string,std::string> attributes;
     attributes.insert(std::pair<std::string, std::string>("Accept", "text/xml"));
-    Arc::MCC_Status res = client.process(std::string("GET"), attributes, &request, &info, &response);
+    Arc::MCC_Status res = client->process(std::string("GET"), url.FullPathURIEncoded(), attributes, &request, &info, &response);
+    if((!res) && pooled && !client->GetSent()) {
+      // Pooled connection was closed by server before request was sent
+      delete response; response = NULL;
+      client = new Arc::ClientHTTP(cfg, url);
+      res = client->process(std::string("GET"), url.FullPathURIEncoded(), attributes, &request, &info, &response);
+    }
     if((!res) || (info.code != 200) || (!response)) {
       delete response;
       return s;
@@ -45,6 +56,7 @@ namespace Arc {
     std::string jobsResponse;
     for(unsigned int n = 0;response->Buffer(n);++n) jobsResponse.append(response->Buffer(n),response->BufferSize(n));
     delete response;
+    Arc::ClientHTTPPool::Release(client.Release(), cfg, url);
     Arc::XMLNode jobs_list(jobsResponse);
     if(!jobs_list)
       return s;
@@ -84,34 +96,36 @@ namespace Arc {
 
     class JobDelegationsProcessor: public JobControllerPluginREST::InfoNodeProcessor {
      public:
-      JobDelegationsProcessor(std::list<Job*>& jobs): jobs(jobs) {}
+      JobDelegationsProcessor(std::list<std::string> const& ids, std::list<Job*>& jobs) {
+        std::list<std::string>::const_iterator itID = ids.begin();
+        std::list<Job*>::iterator itJob = jobs.begin();
+        for(; (itID != ids.end()) && (itJob != jobs.end()); ++itID, ++itJob) {
+          this->jobs.insert(std::pair<std::string, Job*>(*itID, *itJob));
+        }
+      }
 
       virtual void operator()(std::string const& id, XMLNode node) {
         std::string job_id = node["id"];
         XMLNode job_delegation_id = node["delegation_id"];
         if((bool)job_delegation_id && !job_id.empty()) {
-          for(std::list<Job*>::iterator itJob = jobs.begin(); itJob != jobs.end(); ++itJob) {
-            std::string id = (*itJob)->JobID;
-            std::string::size_type pos = id.rfind('/');
-            if(pos != std::string::npos) id.erase(0,pos+1);
-            if(job_id == id) {
-              while(job_delegation_id) {
-                (*itJob)->DelegationID.push_back((std::string)job_delegation_id);
-                ++job_delegation_id;
-              }
-              break;
+          // id is one of IDs passed to ProcessJobs
+          std::map<std::string, Job*>::iterator itJob = jobs.find(id);
+          if(itJob != jobs.end()) {
+            while(job_delegation_id) {
+              itJob->second->DelegationID.push_back((std::string)job_delegation_id);
+              ++job_delegation_id;
             }
           }
         }
       }
 
      private:
-      std::list<Job*>& jobs;
+      std::map<std::string, Job*> jobs;
     };
 
     std::list<std::string> processedIDs;
     std::list<std::string> notProcessedIDs;
-    JobDelegationsProcessor delegationsProcessor(idJobs);
+    JobDelegationsProcessor delegationsProcessor(IDs, idJobs);
     JobControllerPluginREST::ProcessJobs(&usercfg, jobIDsUrl, "delegations", 200, IDs, processedIDs, notProcessedIDs, delegationsProcessor);
 
     // TODO: Because listing/obtaining content is too generic operation
@@ -8,6 +8,7 @@
 #include <arc/StringConv.h>
 #include <arc/URL.h>
 #include <arc/UserConfig.h>
+#include <arc/Utils.h>
 #include <arc/message/MCC.h>
 #include <arc/compute/ExecutionTarget.h>
 #include <arc/compute/EndpointQueryingStatus.h>
@@ -38,13 +39,23 @@ namespace Arc {
     Arc::URL infoUrl(url);
     infoUrl.ChangePath(infoUrl.Path()+"/rest/1.0/info");
     infoUrl.AddOption("schema=glue2",false);
-    Arc::ClientHTTP client(cfg, infoUrl);
+    bool pooled = false;
+    Arc::AutoPointer<Arc::ClientHTTP> client(Arc::ClientHTTPPool::Acquire(cfg, infoUrl, -1, &pooled));
+    if(!client) {
+      return EndpointQueryingStatus(EndpointQueryingStatus::FAILED,"URL "+cie.URLString+" can't be processed");
+    }
     Arc::PayloadRaw request;
     Arc::PayloadRawInterface* response(NULL);
     Arc::HTTPClientInfo info;
     std::multimap<std::string,std::string> attributes;
     attributes.insert(std::pair<std::string, std::string>("Accept", "text/xml"));
-    Arc::MCC_Status res = client.process(std::string("GET"), attributes, &request, &info, &response);
+    Arc::MCC_Status res = client->process(std::string("GET"), infoUrl.FullPathURIEncoded(), attributes, &request, &info, &response);
+    if((!res) && pooled && !client->GetSent()) {
+      // Pooled connection was closed by server before request was sent
+      delete response; response = NULL;
+      client = new Arc::ClientHTTP(cfg, infoUrl);
+      res = client->process(std::string("GET"), infoUrl.FullPathURIEncoded(), attributes, &request, &info, &response);
+    }
     if(!res) {
       delete response;
       return Arc::EndpointQueryingStatus(EndpointQueryingStatus::FAILED,res.getExplanation());
@@ -60,6 +71,7 @@ namespace Arc {
     logger.msg(VERBOSE, "CONTENT %u: %s", response->BufferSize(0), std::string(response->Buffer(0),response->BufferSize(0)));
     Arc::XMLNode servicesQueryResponse(response->Buffer(0),response->BufferSize(0));
     delete response;
+    Arc::ClientHTTPPool::Release(client.Release(), cfg, infoUrl);
     if(!servicesQueryResponse) {
       logger.msg(VERBOSE, "Response is not XML");
       return Arc::EndpointQueryingStatus(EndpointQueryingStatus::FAILED,"Response is not XML");
@@ -281,9 +281,9 @@ using namespace Arc;
     StopReading();
     StopWriting();
     if (chunks) delete chunks;
-    for(std::multimap<std::string,ClientHTTP*>::iterator cl = clients.begin(); cl != clients.end(); ++cl) {
-      delete cl->second;
-    };
+    ClientHTTPPool::Statistics stats = ClientHTTPPool::GetStatistics();
+    logger.msg(DEBUG, "HTTP connections: %llu made, %llu reused, %u idle",
+               stats.created, stats.reused, stats.idle);
   }
 
   Plugin* DataPointHTTP::Instance(PluginArgument *arg) {
@@ -1479,28 +1479,10 @@ using namespace Arc;
   }
 
   ClientHTTP* DataPointHTTP::acquire_client(const URL& curl) {
-    // TODO: lock
-    if(!curl) return NULL;
-    if((curl.Protocol() != "http") &&
-       (curl.Protocol() != "https") &&
-       (curl.Protocol() != "httpg") &&
-       (curl.Protocol() != "dav") &&
-       (curl.Protocol() != "davs")) return NULL;
-    ClientHTTP* client = NULL;
-    std::string key = curl.ConnectionURL();
-    clients_lock.lock();
-    std::multimap<std::string,ClientHTTP*>::iterator cl = clients.find(key);
-    if(cl != clients.end()) {
-      client = cl->second;
-      clients.erase(cl);
-      clients_lock.unlock();
-    } else {
-      clients_lock.unlock();
-      MCCConfig cfg;
-      usercfg.ApplyToConfig(cfg);
-      client = new ClientHTTP(cfg, curl, usercfg.Timeout());
-    };
-    return client;
+    // Connections are shared with other DataPointHTTP objects
+    MCCConfig cfg;
+    usercfg.ApplyToConfig(cfg);
+    return ClientHTTPPool::Acquire(cfg, curl, usercfg.Timeout());
   }
 
   ClientHTTP* DataPointHTTP::acquire_new_client(const URL& curl) {
@@ -1517,12 +1499,9 @@ using namespace Arc;
 
   void DataPointHTTP::release_client(const URL& curl, ClientHTTP* client) {
     if(!client) return;
-    if(client->GetClosed()) { delete client; return; }
-    std::string key = curl.ConnectionURL();
-    //if(!*client) return;
-    clients_lock.lock();
-    clients.insert(std::pair<std::string,ClientHTTP*>(key,client));
-    clients_lock.unlock();
+    MCCConfig cfg;
+    usercfg.ApplyToConfig(cfg);
+    ClientHTTPPool::Release(client, cfg, curl, usercfg.Timeout());
   }
 
   int DataPointHTTP::http2errno(int http_code) const {
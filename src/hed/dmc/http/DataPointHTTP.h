@@ -56,11 +56,9 @@ using namespace Arc;
     bool reading;
     bool writing;
     ChunkControl *chunks;
-    std::multimap<std::string,ClientHTTP*> clients;
     SimpleCounter transfers_started;
     int transfers_tofinish;
     Glib::Mutex transfer_lock;
-    Glib::Mutex clients_lock;
     bool partial_read_allowed;
     bool partial_write_allowed;
   };
@@ -27,6 +27,7 @@ namespace ArcDMCSRM {
 
   DataPointSRM::DataPointSRM(const URL& url, const UserConfig& usercfg, PluginArgument* parg)
     : DataPointDirect(url, usercfg, parg),
+      srm_request_shared(false),
       reading(false),
       writing(false) {}
 
@@ -181,6 +182,15 @@ namespace ArcDMCSRM {
     if (reading && r_handle) return DataStatus(DataStatus::IsReadingError, EARCLOGIC, "Already reading");
     if (reading && !turls.empty()) return DataStatus::Success; // Already prepared
 
+    if (srm_request && srm_request_shared) {
+      // request was made in bulk so only the status of this file is polled
+      std::list<DataPoint*> urls(1, this);
+      std::list<DataStatus> results;
+      DataStatus r = PrepareReading(urls, wait_time, results);
+      if (!r) return r;
+      return results.front();
+    }
+
     reading = true;
     turls.clear();
     std::list<std::string> transport_urls;
@@ -217,6 +227,7 @@ namespace ArcDMCSRM {
 
         // take out options in srm url and encode path
         srm_request = new SRMClientRequest(CanonicSRMURL(url));
+        srm_request_shared = false;
         logger.msg(INFO, "File %s is NEARLINE, will make request to bring online", CanonicSRMURL(url));
         srm_request->request_timeout(stage_timeout);
         res = client->requestBringOnline(*srm_request);
@@ -269,6 +280,7 @@ namespace ArcDMCSRM {
         return DataStatus(DataStatus::ReadPrepareError, EOPNOTSUPP, "None of the requested transfer protocols are supported");
       }
       srm_request = new SRMClientRequest(CanonicSRMURL(url));
+      srm_request_shared = false;
       srm_request->request_timeout(stage_timeout);
       srm_request->transport_protocols(transport_protocols);
       res = client->getTURLs(*srm_request, transport_urls);
@@ -283,22 +295,7 @@ namespace ArcDMCSRM {
     }
     else if (srm_request->status() == SRM_REQUEST_FINISHED_SUCCESS) {
       // request finished - deal with TURLs
-      // Add all valid TURLs to list
-      for (std::list<std::string>::iterator i = transport_urls.begin(); i != transport_urls.end(); ++i) {
-        // Avoid redirection to SRM
-        logger.msg(VERBOSE, "Checking URL returned by SRM: %s", *i);
-        if (strncasecmp(i->c_str(), "srm://", 6) == 0) continue;
-        // Try to use this TURL + old options
-        URL redirected_url(*i);
-        DataHandle redirected_handle(redirected_url, usercfg);
-
-        // check if url can be handled
-        if (!redirected_handle || !(*redirected_handle)) continue;
-        if (redirected_handle->IsIndex()) continue;
-
-        redirected_handle->AddURLOptions(url.Options());
-        turls.push_back(redirected_handle->GetURL());
-      }
+      AddTURLs(transport_urls);
 
       if (turls.empty()) {
         logger.msg(VERBOSE, "SRM returned no useful Transfer URLs: %s", url.str());
@@ -314,6 +311,217 @@ namespace ArcDMCSRM {
     return DataStatus::Success;
   }
 
+  SRMFileLocality DataPointSRM::BulkFileStatus(const SRMClientRequest& req, const std::string& surl) {
+    if (req.status() == SRM_REQUEST_FINISHED_SUCCESS) return SRM_ONLINE;
+    std::map<std::string, SRMFileLocality> statuses(req.surl_statuses());
+    std::map<std::string, SRMFileLocality>::iterator s = statuses.find(surl);
+    SRMFileLocality locality = (s == statuses.end()) ? SRM_UNKNOWN : s->second;
+    if (req.status() == SRM_REQUEST_ONGOING) {
+      // files not reported yet are still waiting
+      return (locality == SRM_UNKNOWN) ? SRM_NEARLINE : locality;
+    }
+    if (req.status() == SRM_REQUEST_FINISHED_PARTIAL_SUCCESS && locality == SRM_ONLINE) {
+      return SRM_ONLINE;
+    }
+    return SRM_STAGE_ERROR;
+  }
+
+  DataStatus DataPointSRM::PrepareReading(const std::list<DataPoint*>& urls,
+                                          unsigned int& wait_time,
+                                          std::list<DataStatus>& results) {
+
+    if (urls.empty()) return DataStatus::Success;
+
+    std::string error;
+    AutoPointer<SRMClient> client(SRMClient::getInstance(usercfg, url.fullstr(), error));
+    if (!client) {
+      return DataStatus(DataStatus::ReadPrepareError, ECONNREFUSED, error);
+    }
+
+    // Files which do not need a bulk request are set to NULL in dps
+    std::vector<DataPointSRM*> dps;
+    std::vector<DataStatus> statuses;
+    for (std::list<DataPoint*>::const_iterator i = urls.begin(); i != urls.end(); ++i) {
+      DataPointSRM* dp = dynamic_cast<DataPointSRM*>(*i);
+      dps.push_back(NULL);
+      statuses.push_back(DataStatus::Success);
+      unsigned int wait = 0;
+      if (!dp) {
+        statuses.back() = (*i)->PrepareReading(0, wait);
+      } else if (dp->writing) {
+        statuses.back() = DataStatus(DataStatus::IsWritingError, EARCLOGIC, "Already writing");
+      } else if (dp->reading && dp->r_handle) {
+        statuses.back() = DataStatus(DataStatus::IsReadingError, EARCLOGIC, "Already reading");
+      } else if (dp->reading && !dp->turls.empty()) {
+        // Already prepared
+      } else if (dp->srm_request && !dp->srm_request_shared) {
+        // request made by non-bulk call
+        statuses.back() = dp->PrepareReading(0, wait);
+      } else if (dp->srm_request && dp->srm_request->status() != SRM_REQUEST_ONGOING) {
+        logger.msg(VERBOSE, "Calling PrepareReading when request was already prepared!");
+        statuses.back() = DataStatus(DataStatus::ReadPrepareError, EARCLOGIC, "File is already prepared");
+      } else {
+        dp->reading = true;
+        dp->turls.clear();
+        dps.back() = dp;
+      }
+    }
+    wait_time = 0;
+
+    // Files on tape are brought online first. Files from the same request
+    // are polled together and new files are requested together.
+    std::map<std::string, std::list<unsigned int> > bring_online;
+    for (unsigned int n = 0; n < dps.size(); ++n) {
+      if (!dps[n] || dps[n]->access_latency != ACCESS_LATENCY_LARGE) continue;
+      bring_online[dps[n]->srm_request ? dps[n]->srm_request->request_token() : ""].push_back(n);
+    }
+    for (std::map<std::string, std::list<unsigned int> >::iterator r = bring_online.begin(); r != bring_online.end(); ++r) {
+      std::list<std::string> surls;
+      for (std::list<unsigned int>::iterator n = r->second.begin(); n != r->second.end(); ++n) {
+        surls.push_back(CanonicSRMURL(dps[*n]->url));
+      }
+      SRMClientRequest req(surls);
+      req.request_timeout(0);
+      DataStatus res;
+      if (r->first.empty()) {
+        logger.msg(INFO, "%u files are NEARLINE, will make request to bring online", surls.size());
+        res = client->requestBringOnline(req);
+      } else {
+        req.request_token(r->first);
+        res = client->requestBringOnlineStatus(req);
+      }
+      std::map<std::string, std::string> failures(req.surl_failures());
+      for (std::list<unsigned int>::iterator n = r->second.begin(); n != r->second.end(); ++n) {
+        DataPointSRM* dp = dps[*n];
+        std::string surl(CanonicSRMURL(dp->url));
+        if (!res) {
+          statuses[*n] = res;
+          dp->srm_request = NULL;
+          dps[*n] = NULL;
+          continue;
+        }
+        SRMFileLocality locality = BulkFileStatus(req, surl);
+        if (locality == SRM_ONLINE) {
+          logger.msg(INFO, "Bring online request %s finished successfully, file %s is now ONLINE", req.request_token(), surl);
+          dp->access_latency = ACCESS_LATENCY_SMALL;
+          dp->srm_request = NULL;
+          continue;
+        }
+        dp->srm_request = new SRMClientRequest(surl, req.request_token());
+        dp->srm_request_shared = true;
+        if (locality == SRM_NEARLINE) {
+          dp->srm_request->wait(req.waiting_time());
+          statuses[*n] = DataStatus::ReadPrepareWait;
+        } else {
+          std::string reason(failures.find(surl) != failures.end() ? failures[surl] : "Bring online request failed");
+          logger.msg(VERBOSE, "Bring online request %s failed for %s: %s", req.request_token(), surl, reason);
+          dp->srm_request->finished_error();
+          statuses[*n] = DataStatus(DataStatus::ReadPrepareError, EARCRESINVAL, reason);
+        }
+        dps[*n] = NULL;
+      }
+      if (res && req.status() == SRM_REQUEST_ONGOING) {
+        logger.msg(INFO, "Bring online request %s is still in queue, should wait", req.request_token());
+        if (wait_time == 0 || (unsigned int)req.waiting_time() < wait_time) wait_time = req.waiting_time();
+      }
+    }
+
+    // Online files are prepared with one get request per request token,
+    // or per set of transfer protocols for new requests
+    std::map<std::string, std::list<unsigned int> > get;
+    std::map<std::string, std::list<std::string> > get_protocols;
+    for (unsigned int n = 0; n < dps.size(); ++n) {
+      if (!dps[n]) continue;
+      if (dps[n]->srm_request) {
+        get["token:" + dps[n]->srm_request->request_token()].push_back(n);
+        continue;
+      }
+      std::list<std::string> transport_protocols;
+      dps[n]->ChooseTransferProtocols(transport_protocols);
+      dps[n]->CheckProtocols(transport_protocols);
+      if (transport_protocols.empty()) {
+        logger.msg(VERBOSE, "None of the requested transfer protocols are supported");
+        statuses[n] = DataStatus(DataStatus::ReadPrepareError, EOPNOTSUPP, "None of the requested transfer protocols are supported");
+        continue;
+      }
+      std::string key("protocols:");
+      for (std::list<std::string>::iterator p = transport_protocols.begin(); p != transport_protocols.end(); ++p) {
+        key += *p + " ";
+      }
+      get[key].push_back(n);
+      get_protocols[key] = transport_protocols;
+    }
+    for (std::map<std::string, std::list<unsigned int> >::iterator r = get.begin(); r != get.end(); ++r) {
+      std::list<std::string> surls;
+      for (std::list<unsigned int>::iterator n = r->second.begin(); n != r->second.end(); ++n) {
+        surls.push_back(CanonicSRMURL(dps[*n]->url));
+      }
+      SRMClientRequest req(surls);
+      req.request_timeout(0);
+      if (get_protocols.find(r->first) != get_protocols.end()) {
+        req.transport_protocols(get_protocols[r->first]);
+      } else {
+        req.request_token(dps[r->second.front()]->srm_request->request_token());
+      }
+      std::map<std::string, std::string> transport_urls;
+      DataStatus res = client->getTURLsBulk(req, transport_urls);
+      std::map<std::string, std::string> failures(req.surl_failures());
+      for (std::list<unsigned int>::iterator n = r->second.begin(); n != r->second.end(); ++n) {
+        DataPointSRM* dp = dps[*n];
+        std::string surl(CanonicSRMURL(dp->url));
+        SRMFileLocality locality = res ? BulkFileStatus(req, surl) : SRM_STAGE_ERROR;
+        dp->srm_request = new SRMClientRequest(surl, req.request_token());
+        dp->srm_request_shared = true;
+        if (locality == SRM_ONLINE && transport_urls.find(surl) != transport_urls.end()) {
+          dp->srm_request->finished_success();
+          dp->AddTURLs(std::list<std::string>(1, transport_urls[surl]));
+          if (dp->turls.empty()) {
+            logger.msg(VERBOSE, "SRM returned no useful Transfer URLs: %s", dp->url.str());
+            dp->srm_request->finished_abort();
+            statuses[*n] = DataStatus(DataStatus::ReadPrepareError, EARCRESINVAL, "No useful transfer URLs returned");
+          }
+        } else if (locality == SRM_NEARLINE) {
+          dp->srm_request->wait(req.waiting_time());
+          statuses[*n] = DataStatus::ReadPrepareWait;
+        } else if (!res) {
+          dp->srm_request->finished_error();
+          statuses[*n] = res;
+        } else {
+          std::string reason(failures.find(surl) != failures.end() ? failures[surl] : "No transfer URL returned");
+          logger.msg(VERBOSE, "Get request %s failed for %s: %s", req.request_token(), surl, reason);
+          dp->srm_request->finished_error();
+          statuses[*n] = DataStatus(DataStatus::ReadPrepareError, EARCRESINVAL, reason);
+        }
+      }
+      if (res && req.status() == SRM_REQUEST_ONGOING) {
+        logger.msg(INFO, "Get request %s is still in queue, should wait %i seconds", req.request_token(), req.waiting_time());
+        if (wait_time == 0 || (unsigned int)req.waiting_time() < wait_time) wait_time = req.waiting_time();
+      }
+    }
+
+    results.insert(results.end(), statuses.begin(), statuses.end());
+    return DataStatus::Success;
+  }
+
+  void DataPointSRM::AddTURLs(const std::list<std::string>& transport_urls) {
+    // Add all valid TURLs to list
+    for (std::list<std::string>::const_iterator i = transport_urls.begin(); i != transport_urls.end(); ++i) {
+      // Avoid redirection to SRM
+      logger.msg(VERBOSE, "Checking URL returned by SRM: %s", *i);
+      if (strncasecmp(i->c_str(), "srm://", 6) == 0) continue;
+      // Try to use this TURL + old options
+      URL redirected_url(*i);
+      DataHandle redirected_handle(redirected_url, usercfg);
+
+      // check if url can be handled
+      if (!redirected_handle || !(*redirected_handle)) continue;
+      if (redirected_handle->IsIndex()) continue;
+
+      redirected_handle->AddURLOptions(url.Options());
+      turls.push_back(redirected_handle->GetURL());
+    }
+  }
+
   DataStatus DataPointSRM::StartReading(DataBuffer& buf) {
 
     logger.msg(VERBOSE, "StartReading");
@@ -357,18 +565,70 @@ namespace ArcDMCSRM {
       // if the request finished with an error there is no need to abort or release request
       if (client && (srm_request->status() != SRM_REQUEST_FINISHED_ERROR)) {
         if (error || srm_request->status() == SRM_REQUEST_SHOULD_ABORT) {
-          client->abort(*srm_request, true);
+          // request shared with other files must not be aborted as a whole
+          if (srm_request_shared) client->releaseFiles(*srm_request, true);
+          else client->abort(*srm_request, true);
         } else if (srm_request->status() == SRM_REQUEST_FINISHED_SUCCESS) {
-          client->releaseGet(*srm_request);
+          if (srm_request_shared) client->releaseFiles(*srm_request, false);
+          else client->releaseGet(*srm_request);
         }
       }
       srm_request = NULL;
+      srm_request_shared = false;
     }
     turls.clear();
 
     return DataStatus::Success;
   }
 
+  DataStatus DataPointSRM::FinishReading(const std::list<DataPoint*>& urls,
+                                         bool error,
+                                         std::list<DataStatus>& results) {
+
+    if (urls.empty()) return DataStatus::Success;
+
+    std::string err;
+    AutoPointer<SRMClient> client(SRMClient::getInstance(usercfg, url.fullstr(), err));
+
+    // files prepared in bulk are released or aborted together per request token
+    std::map<std::string, std::list<std::string> > release;
+    std::map<std::string, std::list<std::string> > abort;
+    for (std::list<DataPoint*>::const_iterator i = urls.begin(); i != urls.end(); ++i) {
+      DataPointSRM* dp = dynamic_cast<DataPointSRM*>(*i);
+      if (!dp || !dp->srm_request || !dp->srm_request_shared || !dp->reading) {
+        results.push_back((*i)->FinishReading(error));
+        continue;
+      }
+      results.push_back(DataStatus::Success);
+      dp->StopReading();
+      dp->reading = false;
+      // if the request finished with an error there is no need to abort or release request
+      if (dp->srm_request->status() != SRM_REQUEST_FINISHED_ERROR) {
+        if (error || dp->srm_request->status() == SRM_REQUEST_SHOULD_ABORT) {
+          abort[dp->srm_request->request_token()].push_back(dp->srm_request->surl());
+        } else if (dp->srm_request->status() == SRM_REQUEST_FINISHED_SUCCESS) {
+          release[dp->srm_request->request_token()].push_back(dp->srm_request->surl());
+        }
+      }
+      dp->srm_request = NULL;
+      dp->srm_request_shared = false;
+      dp->turls.clear();
+    }
+
+    if (!client) return DataStatus::Success;
+    for (std::map<std::string, std::list<std::string> >::iterator r = abort.begin(); r != abort.end(); ++r) {
+      SRMClientRequest req(r->second);
+      req.request_token(r->first);
+      client->releaseFiles(req, true);
+    }
+    for (std::map<std::string, std::list<std::string> >::iterator r = release.begin(); r != release.end(); ++r) {
+      SRMClientRequest req(r->second);
+      req.request_token(r->first);
+      client->releaseFiles(req, false);
+    }
+    return DataStatus::Success;
+  }
+
   DataStatus DataPointSRM::PrepareWriting(unsigned int stage_timeout,
                                           unsigned int& wait_time) {
     if (reading) return DataStatus(DataStatus::IsReadingError, EARCLOGIC, "Already reading");
@@ -462,22 +722,7 @@ namespace ArcDMCSRM {
     }
     else if (srm_request->status() == SRM_REQUEST_FINISHED_SUCCESS) {
       // request finished - deal with TURLs
-      // Add all valid TURLs to list
-      for (std::list<std::string>::iterator i = transport_urls.begin(); i != transport_urls.end(); ++i) {
-        // Avoid redirection to SRM
-        logger.msg(VERBOSE, "Checking URL returned by SRM: %s", *i);
-        if (strncasecmp(i->c_str(), "srm://", 6) == 0) continue;
-        // Try to use this TURL + old options
-        URL redirected_url(*i);
-        DataHandle redirected_handle(redirected_url, usercfg);
-
-        // check if url can be handled
-        if (!redirected_handle || !(*redirected_handle)) continue;
-        if (redirected_handle->IsIndex()) continue;
-
-        redirected_handle->AddURLOptions(url.Options());
-        turls.push_back(redirected_handle->GetURL());
-      }
+      AddTURLs(transport_urls);
 
       if (turls.empty()) {
         logger.msg(VERBOSE, "SRM returned no useful Transfer URLs: %s", url.str());
@@ -32,6 +32,9 @@ namespace ArcDMCSRM {
     static Plugin* Instance(PluginArgument *arg);
     virtual DataStatus PrepareReading(unsigned int timeout,
                                       unsigned int& wait_time);
+    virtual DataStatus PrepareReading(const std::list<DataPoint*>& urls,
+                                      unsigned int& wait_time,
+                                      std::list<DataStatus>& results);
     virtual DataStatus PrepareWriting(unsigned int timeout,
                                       unsigned int& wait_time);
     virtual DataStatus StartReading(DataBuffer& buffer);
@@ -40,6 +43,9 @@ namespace ArcDMCSRM {
     virtual DataStatus StopWriting();
     virtual DataStatus StopReading();
     virtual DataStatus FinishReading(bool error);
+    virtual DataStatus FinishReading(const std::list<DataPoint*>& urls,
+                                     bool error,
+                                     std::list<DataStatus>& results);
     virtual DataStatus FinishWriting(bool error);
     virtual DataStatus Check(bool check_meta);
     virtual DataStatus Remove();
@@ -65,12 +71,17 @@ namespace ArcDMCSRM {
 
   private:
     AutoPointer<SRMClientRequest> srm_request; /* holds SRM request ID between Prepare* and Finish* */
+    bool srm_request_shared; /* srm_request token is shared with other files prepared in bulk */
     static Logger logger;
     std::vector<URL> turls; /* TURLs returned from prepare methods */
     mutable AutoPointer<DataHandle> r_handle;  /* handle used for redirected operations in Start/Stop Reading/Writing */
     bool reading;
     bool writing;
     DataStatus SetupHandler(DataStatus::DataStatusType base_error) const;
+    /// Add usable TURLs returned by SRM to turls
+    void AddTURLs(const std::list<std::string>& transport_urls);
+    /// Locality of surl after a bulk bring online or get request
+    static SRMFileLocality BulkFileStatus(const SRMClientRequest& req, const std::string& surl);
     DataStatus ListFiles(std::list<FileInfo>& files, DataPointInfoType verb, int recursion);
     /** Check protocols given in list can be used, and if not remove them */
     void CheckProtocols(std::list<std::string>& transport_protocols);
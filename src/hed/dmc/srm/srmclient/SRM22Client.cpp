@@ -332,6 +332,82 @@ namespace ArcDMCSRM {
     return DataStatus::Success;
   }
 
+  DataStatus SRM22Client::getTURLsBulk(SRMClientRequest& creq,
+                                       std::map<std::string, std::string>& turls) {
+
+    PayloadSOAP request(ns);
+    std::list<std::string> surls = creq.surls();
+    std::string response_name;
+    if (creq.request_token().empty()) {
+      XMLNode req = request.NewChild("SRMv2:srmPrepareToGet")
+                    .NewChild("srmPrepareToGetRequest");
+      XMLNode files = req.NewChild("arrayOfFileRequests");
+      for (std::list<std::string>::iterator it = surls.begin();
+           it != surls.end(); ++it) {
+        files.NewChild("requestArray").NewChild("sourceSURL") = *it;
+      }
+      XMLNode protocols = req.NewChild("transferParameters")
+                          .NewChild("arrayOfTransferProtocols");
+      std::list<std::string> transport_protocols(creq.transport_protocols());
+      for (std::list<std::string>::iterator prot = transport_protocols.begin();
+           prot != transport_protocols.end(); ++prot) {
+        protocols.NewChild("stringArray") = *prot;
+      }
+      response_name = "srmPrepareToGetResponse";
+    }
+    else {
+      XMLNode req = request.NewChild("SRMv2:srmStatusOfGetRequest")
+                    .NewChild("srmStatusOfGetRequestRequest");
+      req.NewChild("requestToken") = creq.request_token();
+      XMLNode files = req.NewChild("arrayOfSourceSURLs");
+      for (std::list<std::string>::iterator it = surls.begin();
+           it != surls.end(); ++it) {
+        files.NewChild("urlArray") = *it;
+      }
+      response_name = "srmStatusOfGetRequestResponse";
+    }
+
+    PayloadSOAP *response = NULL;
+    DataStatus status = process("", &request, &response);
+    if (!status) {
+      creq.finished_error();
+      return status;
+    }
+
+    XMLNode res = (*response)[response_name][response_name];
+
+    std::string explanation;
+    SRMStatusCode statuscode = GetStatus(res["returnStatus"], explanation);
+
+    // store the request token in the request object
+    if (res["requestToken"]) creq.request_token(res["requestToken"]);
+
+    if (res["arrayOfFileStatuses"]) getFileStatus(creq, res["arrayOfFileStatuses"], turls);
+
+    if (statuscode == SRM_REQUEST_QUEUED ||
+        statuscode == SRM_REQUEST_INPROGRESS) {
+      // some or all files are still queued
+      creq.wait(creq.waiting_time());
+    }
+    else if (statuscode == SRM_SUCCESS) {
+      logger.msg(VERBOSE, "All files in request %s are ready", creq.request_token());
+      creq.finished_success();
+    }
+    else if (statuscode == SRM_PARTIAL_SUCCESS) {
+      logger.msg(VERBOSE, "Some files in request %s failed: %s", creq.request_token(), explanation);
+      creq.finished_partial_success();
+    }
+    else {
+      // all files failed
+      logger.msg(VERBOSE, explanation);
+      creq.finished_error();
+      delete response;
+      return DataStatus(DataStatus::ReadPrepareError, srm2errno(statuscode), explanation);
+    }
+    delete response;
+    return DataStatus::Success;
+  }
+
   DataStatus SRM22Client::requestBringOnline(SRMClientRequest& creq) {
     PayloadSOAP request(ns);
     XMLNode req = request.NewChild("SRMv2:srmBringOnline")
@@ -579,6 +655,35 @@ namespace ArcDMCSRM {
     creq.waiting_time(waittime);
   }
 
+  void SRM22Client::getFileStatus(SRMClientRequest& creq, XMLNode file_statuses,
+                                  std::map<std::string, std::string>& turls) {
+    int waittime = 0;
+
+    for (XMLNode n = file_statuses["statusArray"]; n; ++n) {
+      std::string surl = (std::string)n["sourceSURL"];
+      if (n["estimatedWaitTime"]) {
+        int estimatedWaitTime = stringtoi(n["estimatedWaitTime"]);
+        if (estimatedWaitTime > waittime) waittime = estimatedWaitTime;
+      }
+
+      std::string explanation;
+      SRMStatusCode filestatus = GetStatus(n["status"], explanation);
+
+      if ((filestatus == SRM_SUCCESS || filestatus == SRM_FILE_PINNED) && n["transferURL"]) {
+        turls[surl] = (std::string)n["transferURL"];
+        logger.msg(VERBOSE, "File %s is ready! TURL is %s", surl, turls[surl]);
+        creq.surl_statuses(surl, SRM_ONLINE);
+      } else if (filestatus == SRM_REQUEST_QUEUED || filestatus == SRM_REQUEST_INPROGRESS) {
+        creq.surl_statuses(surl, SRM_NEARLINE);
+      } else {
+        creq.surl_statuses(surl, SRM_STAGE_ERROR);
+        creq.surl_failures(surl, explanation);
+      }
+    }
+
+    creq.waiting_time(waittime);
+  }
+
   DataStatus SRM22Client::putTURLs(SRMClientRequest& creq,
                                    std::list<std::string>& urls) {
     // only one file requested at a time
@@ -1256,6 +1361,47 @@ namespace ArcDMCSRM {
     return DataStatus::Success;
   }
 
+  DataStatus SRM22Client::releaseFiles(SRMClientRequest& creq,
+                                       bool abort) {
+    if (creq.request_token().empty()) {
+      logger.msg(VERBOSE, "No request token specified!");
+      return DataStatus(DataStatus::ReadFinishError, EINVAL, "No request token specified");
+    }
+
+    std::string action(abort ? "srmAbortFiles" : "srmReleaseFiles");
+    PayloadSOAP request(ns);
+    XMLNode req = request.NewChild("SRMv2:" + action).NewChild(action + "Request");
+    req.NewChild("requestToken") = creq.request_token();
+    XMLNode files = req.NewChild("arrayOfSURLs");
+    std::list<std::string> surls = creq.surls();
+    for (std::list<std::string>::iterator it = surls.begin();
+         it != surls.end(); ++it) {
+      files.NewChild("urlArray") = *it;
+    }
+
+    PayloadSOAP *response = NULL;
+    DataStatus status = process("", &request, &response);
+    if (!status) return status;
+
+    XMLNode res = (*response)[action + "Response"][action + "Response"];
+
+    std::string explanation;
+    SRMStatusCode statuscode = GetStatus(res["returnStatus"], explanation);
+
+    if (statuscode != SRM_SUCCESS) {
+      logger.msg(VERBOSE, "%s", explanation);
+      delete response;
+      return DataStatus(DataStatus::ReadFinishError, srm2errno(statuscode), explanation);
+    }
+
+    if (abort) logger.msg(VERBOSE, "%u files associated with request token %s aborted successfully",
+                          surls.size(), creq.request_token());
+    else logger.msg(VERBOSE, "%u files associated with request token %s released successfully",
+                    surls.size(), creq.request_token());
+    delete response;
+    return DataStatus::Success;
+  }
+
   DataStatus SRM22Client::remove(SRMClientRequest& creq) {
     // TODO: bulk remove
 
@@ -76,6 +76,12 @@ namespace ArcDMCSRM {
      */
     void fileStatus(SRMClientRequest& req, XMLNode file_statuses);
 
+    /**
+     * Fill out status of files in a get request and their TURLs if ready
+     */
+    void getFileStatus(SRMClientRequest& req, XMLNode file_statuses,
+                       std::map<std::string, std::string>& turls);
+
     /**
      * Convert SRM error code to errno. If file-level status is defined that
      * will be used over request-level status.
@@ -125,6 +131,13 @@ namespace ArcDMCSRM {
     DataStatus getTURLsStatus(SRMClientRequest& req,
                               std::list<std::string>& urls);
 
+    /**
+     * Bulk get using srmPrepareToGet for all SURLs in req, or
+     * srmStatusOfGetRequest if req already has a request token.
+     */
+    DataStatus getTURLsBulk(SRMClientRequest& req,
+                            std::map<std::string, std::string>& turls);
+
     /**
      * Retrieve TURLs which a file can be written to. Uses srmPrepareToPut and
      * waits until a suitable TURL has been assigned if the request is
@@ -192,6 +205,13 @@ namespace ArcDMCSRM {
     DataStatus abort(SRMClientRequest& req,
                      bool source);
 
+    /**
+     * Release or abort the SURLs in req by srmReleaseFiles or
+     * srmAbortFiles with the request token.
+     */
+    DataStatus releaseFiles(SRMClientRequest& req,
+                            bool abort);
+
     /**
      * Delete by srmRm or srmRmDir
      */
@@ -5,6 +5,7 @@
 
 #include <string>
 #include <list>
+#include <map>
 #include <exception>
 
 #include <arc/DateTime.h>
@@ -181,6 +182,22 @@ namespace ArcDMCSRM {
     virtual DataStatus getTURLsStatus(SRMClientRequest& req,
                                       std::list<std::string>& urls) = 0;
 
+    /**
+     * Bulk version of getTURLs() and getTURLsStatus(), which is always
+     * asynchronous. If req has no request token a new request is made for
+     * all SURLs in req, otherwise the status of the request is queried.
+     * The status of each SURL is set in req: SRM_ONLINE if its TURL is
+     * ready, SRM_NEARLINE if it is still queued and SRM_STAGE_ERROR if it
+     * failed. The default implementation returns an unimplemented error.
+     * @param req The request object
+     * @param turls Map of SURL to TURL filled for files which are ready
+     * @returns DataStatus specifying outcome of operation
+     */
+    virtual DataStatus getTURLsBulk(SRMClientRequest& /* req */,
+                                    std::map<std::string, std::string>& /* turls */) {
+      return DataStatus(DataStatus::UnimplementedError, EOPNOTSUPP);
+    }
+
     /**
      * Submit a request to bring online files. If the synchronous property
      * of the request object is false, this operation is asynchronous and
@@ -265,6 +282,20 @@ namespace ArcDMCSRM {
     virtual DataStatus abort(SRMClientRequest& req,
                              bool source) = 0;
 
+    /**
+     * Release or abort only the SURLs given in req which belong to the
+     * request token of req, leaving other files in the same request
+     * untouched. Used when several files were prepared by one bulk get
+     * request. The default implementation returns an unimplemented error.
+     * @param req The request object
+     * @param abort If true the files are aborted, otherwise released
+     * @returns DataStatus specifying outcome of operation
+     */
+    virtual DataStatus releaseFiles(SRMClientRequest& /* req */,
+                                    bool /* abort */) {
+      return DataStatus(DataStatus::UnimplementedError, EOPNOTSUPP);
+    }
+
     /**
      * Returns information on a file or files (v2.2 and higher) stored in SRM,
      * such as file size, checksum and estimated access latency. If a directory
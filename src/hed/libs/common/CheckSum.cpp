@@ -87,6 +87,44 @@ static uint32_t gtable[256] = {
   0xBCB4666D, 0xB8757BDA, 0xB5365D03, 0xB1F740B4
 };
 
+// Tables for processing 8 bytes at once ("slicing-by-8"). Table k holds
+// CRC of byte followed by k zero bytes.
+class CRC32Tables {
+ public:
+  uint32_t t[8][256];
+  CRC32Tables(void) {
+    for (int i = 0; i < 256; i++) t[0][i] = gtable[i];
+    for (int k = 1; k < 8; k++) {
+      for (int i = 0; i < 256; i++) {
+        t[k][i] = (t[k-1][i] << 8) ^ gtable[t[k-1][i] >> 24];
+      }
+    }
+  }
+};
+
+static CRC32Tables gtables;
+
+// Multiplication of polynomials modulo generator
+static uint32_t crc32_multmodp(uint32_t a, uint32_t b) {
+  uint32_t p = 0;
+  for (int i = 31; i >= 0; i--) {
+    p = (p & 0x80000000) ? ((p << 1) ^ 0x04C11DB7) : (p << 1);
+    if (a & (((uint32_t)1) << i)) p ^= b;
+  }
+  return p;
+}
+
+// x^(8*n) modulo generator
+static uint32_t crc32_x8nmodp(unsigned long long int n) {
+  uint32_t p = 1;
+  uint32_t x = 0x100; // x^8
+  for (; n; n >>= 1) {
+    if (n & 1) p = crc32_multmodp(p, x);
+    x = crc32_multmodp(x, x);
+  }
+  return p;
+}
+
 namespace Arc {
 
   CRC32Sum::CRC32Sum(void) {
@@ -99,12 +137,23 @@ namespace Arc {
     computed = false;
   }
 
+  // Register holds remainder of data already multiplied by x^32. That
+  // is same as feeding 4 zero bytes at end like 'cksum' does and allows
+  // to process data in bigger pieces.
   void CRC32Sum::add(void *buf, unsigned long long int len) {
-    for (unsigned long long int i = 0; i < len; i++) {
-      unsigned char c = (r >> 24);
-      r = ((r << 8) | ((unsigned char*)buf)[i]) ^ gtable[c];
-    }
+    const unsigned char *p = (const unsigned char*)buf;
+    const uint32_t (*t)[256] = gtables.t;
     count += len;
+    for (; len >= 8; len -= 8, p += 8) {
+      uint32_t a = r ^ ((((uint32_t)p[0]) << 24) | (((uint32_t)p[1]) << 16) |
+                        (((uint32_t)p[2]) << 8) | ((uint32_t)p[3]));
+      r = t[7][a >> 24] ^ t[6][(a >> 16) & 0xFF] ^
+          t[5][(a >> 8) & 0xFF] ^ t[4][a & 0xFF] ^
+          t[3][p[4]] ^ t[2][p[5]] ^ t[1][p[6]] ^ t[0][p[7]];
+    }
+    for (; len; len--, p++) {
+      r = (r << 8) ^ t[0][(r >> 24) ^ *p];
+    }
   }
 
   void CRC32Sum::end(void) {
@@ -116,12 +165,21 @@ namespace Arc {
       ((CheckSum*)this)->add(&c, 1);
       l >>= 8;
     }
-    uint32_t u = 0;
-    ((CheckSum*)this)->add(&u, 4);
     r = ((~r) & 0xFFFFFFFF);
     computed = true;
   }
 
+  bool CRC32Sum::combine(const CheckSum& part) {
+    const CRC32Sum* crc_part = dynamic_cast<const CRC32Sum*>(&part);
+    if (!crc_part) return false;
+    if (computed || crc_part->computed) return false;
+    // CRC is linear and starts from 0, hence checksum of concatenated
+    // data is checksum of first part shifted by length of second one.
+    r = crc32_multmodp(r, crc32_x8nmodp(crc_part->count)) ^ crc_part->r;
+    count += crc_part->count;
+    return true;
+  }
+
   int CRC32Sum::print(char *buf, int len) const {
     if (!computed) {
       if (len > 0)
@@ -238,6 +296,15 @@ namespace Arc {
   void MD5Sum::add(void *buf, unsigned long long int len) {
     u_char *buf_ = (u_char*)buf;
     for (; len;) {
+      if ((Xlen == 0) && (len >= 64)) { // whole block at once
+        for (u_int Xi = 0; Xi < 16; ++Xi, buf_ += 4) {
+          X[Xi] = ((uint32_t)buf_[0]) | (((uint32_t)buf_[1]) << 8) |
+                  (((uint32_t)buf_[2]) << 16) | (((uint32_t)buf_[3]) << 24);
+        }
+        Xlen = 64;
+        count += 64;
+        len -= 64;
+      }
       for(;Xlen < 64;) { // 16 words = 64 bytes
         if(!len) break;
         u_int Xi = Xlen >> 2;
@@ -402,6 +469,19 @@ namespace Arc {
     return;
   }
 
+  // --------------------------------------------------------------------------
+  // Adler32 is computed by zlib, here is only combining of its parts
+  // --------------------------------------------------------------------------
+
+  bool Adler32Sum::combine(const CheckSum& part) {
+    const Adler32Sum* adler_part = dynamic_cast<const Adler32Sum*>(&part);
+    if (!adler_part) return false;
+    if (computed || adler_part->computed) return false;
+    adler = adler32_combine(adler, adler_part->adler, adler_part->count);
+    count += adler_part->count;
+    return true;
+  }
+
   // --------------------------------------------------------------------------
   // This is a wrapper for any supported checksum
   // --------------------------------------------------------------------------
@@ -585,4 +665,27 @@ namespace Arc {
     return tostring(val);
   }
 
+
+  CheckSum* CheckSumAny::clone(void) const {
+    if (!cs)
+      return NULL;
+    CheckSum* c = cs->clone();
+    if (!c)
+      return NULL;
+    CheckSumAny* ca = new CheckSumAny(c);
+    ca->tp = tp;
+    return ca;
+  }
+
+  bool CheckSumAny::combine(const CheckSum& part) {
+    if (!cs)
+      return false;
+    const CheckSumAny* any_part = dynamic_cast<const CheckSumAny*>(&part);
+    if (any_part) {
+      if (!(any_part->cs))
+        return false;
+      return cs->combine(*(any_part->cs));
+    }
+    return cs->combine(part);
+  }
 } // namespace Arc
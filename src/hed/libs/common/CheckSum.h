@@ -99,6 +99,38 @@ namespace Arc {
     virtual bool operator!(void) const {
       return true;
     }
+
+    /// Indicates whether checksums of parts of data can be combined
+    /**
+     * If true checksums of consecutive parts of data can be computed
+     * independently, e.g. in parallel, by objects obtained from clone()
+     * and then appended to this object with combine().
+     * \since Added in 6.9.0.
+     **/
+    virtual bool combinable(void) const {
+      return false;
+    }
+
+    /// Create new object computing checksum of same type
+    /**
+     * Returned object is in started state and must be destroyed by caller.
+     * @return new object or NULL if not supported.
+     * \since Added in 6.9.0.
+     **/
+    virtual CheckSum* clone(void) const {
+      return NULL;
+    }
+
+    /// Append checksum of data following data already added
+    /**
+     * Neither this object nor part may be finalized by end().
+     * @param part object obtained from clone() of object of same type.
+     * @return false if checksums can't be combined.
+     * \since Added in 6.9.0.
+     **/
+    virtual bool combine(const CheckSum& /* part */) {
+      return false;
+    }
   };
 
   /// Implementation of CRC32 checksum
@@ -132,6 +164,13 @@ namespace Arc {
     virtual bool operator!(void) const {
       return !computed;
     }
+    virtual bool combinable(void) const {
+      return true;
+    }
+    virtual CheckSum* clone(void) const {
+      return new CRC32Sum;
+    }
+    virtual bool combine(const CheckSum& part);
     uint32_t crc(void) const {
       return r;
     }
@@ -187,6 +226,7 @@ namespace Arc {
     : public CheckSum {
    private:
     uLong adler;
+    unsigned long long int count;
     bool computed;
    public:
     Adler32Sum(void) : computed(false) {
@@ -194,9 +234,11 @@ namespace Arc {
     }
     virtual void start(void) {
       adler = adler32(0L, Z_NULL, 0);
+      count = 0;
     }
     virtual void add(void* buf,unsigned long long int len) {
       adler = adler32(adler, (const Bytef *)buf, len);
+      count += len;
     }
     virtual void end(void) {
       computed = true;
@@ -221,6 +263,13 @@ namespace Arc {
     virtual bool operator!(void) const {
       return !computed;
     }
+    virtual bool combinable(void) const {
+      return true;
+    }
+    virtual CheckSum* clone(void) const {
+      return new Adler32Sum;
+    }
+    virtual bool combine(const CheckSum& part);
   };
 
   /// Wrapper for CheckSum class
@@ -298,6 +347,13 @@ namespace Arc {
         return true;
       return !(*cs);
     }
+    virtual bool combinable(void) const {
+      if (!cs)
+        return false;
+      return cs->combinable();
+    }
+    virtual CheckSum* clone(void) const;
+    virtual bool combine(const CheckSum& part);
     bool active(void) {
       return (cs != NULL);
     }
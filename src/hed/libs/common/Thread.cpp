@@ -88,14 +88,6 @@ namespace Arc {
   };
 #endif
 
-#ifdef USE_THREAD_POOL
-  class ThreadInc {
-   public:
-    ThreadInc(void);
-    ~ThreadInc(void);
-  };
-#endif
-
   class ThreadArgument {
   public:
     typedef void (*func_t)(void*);
@@ -107,15 +99,17 @@ namespace Arc {
     ThreadData* data;
 #endif
 #ifdef USE_THREAD_POOL
-    ThreadInc* resource;
-    ThreadArgument& acquire(void) {
-      resource = new ThreadInc;
-      return *this;
-    }
-    void release(void) {
-      if(resource) delete resource;
-      resource = NULL;
+    // Time when request was passed to pool
+    struct timeval queued;
+    // Microseconds passed since request was passed to pool
+    unsigned long long int latency(void) const {
+      struct timeval now;
+      gettimeofday(&now, NULL);
+      long long int l = (now.tv_sec - queued.tv_sec)*1000000LL + (now.tv_usec - queued.tv_usec);
+      return (l > 0) ? l : 0;
     }
+    // Entry point of new thread in pool
+    void worker(void);
 #endif
 
     ThreadArgument(
@@ -132,9 +126,6 @@ namespace Arc {
         count(c)
 #ifdef USE_THREAD_DATA
         ,data(d)
-#endif
-#ifdef USE_THREAD_POOL
-        ,resource(NULL)
 #endif
     {}
 
@@ -151,9 +142,6 @@ namespace Arc {
         count(c)
 #ifdef USE_THREAD_DATA
         ,data(d)
-#endif
-#ifdef USE_THREAD_POOL
-        ,resource(NULL)
 #endif
     {}
 
@@ -165,27 +153,47 @@ namespace Arc {
 
 
 #ifdef USE_THREAD_POOL
-  // This is not a real pool. It is just a queue of requests for
-  // new threads. Hopefuly it will be converted to pool later for
-  // better performance.
+  // Pool of threads running requested functions. Thread which finished
+  // its function is kept for a while and runs next request instead of
+  // new thread being created. Because functions are allowed to block
+  // for unlimited time (listening sockets, data transfers, waiting for
+  // other threads) every request gets own thread immediately. Requests
+  // are queued only if maximal number of threads is reached.
   class ThreadPool {
-   public:
-   friend class ThreadInc;
    private:
+    // Thread waiting for new request
+    struct Worker {
+      Glib::Cond cond;
+      ThreadArgument* argument;
+      Worker(void):argument(NULL) {};
+    };
+    // Maximal number of idle threads and time (seconds) they are kept
+    static const int max_idle = 64;
+    static const int idle_timeout = 60;
     int max_count;
     int count;
-    Glib::Mutex count_lock;
-    Glib::Mutex queue_lock;
+    int busy;
+    unsigned long long int created;
+    unsigned long long int requests;
+    unsigned long long int latency;
+    unsigned long long int max_latency;
+    Glib::Mutex pool_lock;
     std::list<ThreadArgument*> queue;
-    int CheckQueue(void);
+    // Most recently used first
+    std::list<Worker*> idle;
+    bool StartThread(ThreadArgument* argument);
     ~ThreadPool(void) { };
    public:
     ThreadPool(void);
     void PushQueue(ThreadArgument* arg);
-    int Num(void) { return count; };
+    // Runs requests starting with argument till thread becomes unneeded
+    void Run(ThreadArgument* argument);
+    // Number of requests being processed or waiting
+    int Num(void);
+    void Statistics(ThreadStatistics& stats);
   };
 
-  ThreadPool::ThreadPool(void):max_count(0),count(0) {
+  ThreadPool::ThreadPool(void):max_count(0),count(0),busy(0),created(0),requests(0),latency(0),max_latency(0) {
     // Estimating amount of available memory 
     uint64_t n_max;
     {
@@ -224,57 +232,110 @@ namespace Arc {
     //threadLogger.msg(DEBUG, "Maximum number of threads is %i",max_count);
   }
 
-  int ThreadPool::CheckQueue(void) {
-    Glib::Mutex::Lock lock(queue_lock, Glib::TRY_LOCK);
-    if(!lock.locked()) return -1;
-    int size = queue.size();
-    while((count < max_count) && (size > 0)) {
-      ThreadArgument* argument = *(queue.begin());
-      argument->acquire();
-      try {
-        ThreadCreate(sigc::mem_fun(*argument,
-                     &ThreadArgument::thread),
-                     thread_stacksize, false, false,
-                     Glib::THREAD_PRIORITY_NORMAL);
-        queue.erase(queue.begin());
-      } catch (Glib::Error& e) {
-        threadLogger.msg(ERROR, "%s", e.what());
-        argument->release();
-      } catch (Glib::Exception& e) {
-        threadLogger.msg(ERROR, "%s", e.what());
-        argument->release();
-      } catch (std::exception& e) {
-        threadLogger.msg(ERROR, "%s", e.what());
-        argument->release();
-      };
-      size = queue.size();
-    }
-    return size;
+  bool ThreadPool::StartThread(ThreadArgument* argument) {
+    try {
+      ThreadCreate(sigc::mem_fun(*argument,
+                   &ThreadArgument::worker),
+                   thread_stacksize, false, false,
+                   Glib::THREAD_PRIORITY_NORMAL);
+      return true;
+    } catch (Glib::Error& e) {
+      threadLogger.msg(ERROR, "%s", e.what());
+    } catch (Glib::Exception& e) {
+      threadLogger.msg(ERROR, "%s", e.what());
+    } catch (std::exception& e) {
+      threadLogger.msg(ERROR, "%s", e.what());
+    };
+    return false;
   }
 
-  void ThreadPool::PushQueue(ThreadArgument* arg) {
-    Glib::Mutex::Lock lock(queue_lock);
-    queue.push_back(arg);
+  void ThreadPool::PushQueue(ThreadArgument* argument) {
+    gettimeofday(&(argument->queued), NULL);
+    Glib::Mutex::Lock lock(pool_lock);
+    if(!idle.empty()) {
+      Worker* worker = idle.front();
+      idle.pop_front();
+      worker->argument = argument;
+      ++busy;
+      worker->cond.signal();
+      return;
+    }
+    if(count < max_count) {
+      ++count;
+      ++busy;
+      lock.release();
+      if(StartThread(argument)) {
+        lock.acquire();
+        ++created;
+        return;
+      }
+      lock.acquire();
+      --count;
+      --busy;
+    }
+    // Request will be picked up by first thread which finishes its work
+    queue.push_back(argument);
     lock.release();
-    if(CheckQueue() > 0)
-      threadLogger.msg(INFO, "Maximum number of threads running - putting new request into queue");
+    threadLogger.msg(INFO, "Maximum number of threads running - putting new request into queue");
+  }
+
+  void ThreadPool::Run(ThreadArgument* argument) {
+    sigset_t allsig; sigfillset(&allsig);
+    pool_lock.lock();
+    while(argument) {
+      unsigned long long int l = argument->latency();
+      latency += l;
+      if(l > max_latency) max_latency = l;
+      ++requests;
+      pool_lock.unlock();
+      argument->thread();
+      // Function could have changed signal mask. Restore state of new thread.
+      pthread_sigmask(SIG_SETMASK,&allsig,NULL);
+      pool_lock.lock();
+      --busy;
+      argument = NULL;
+      if(!queue.empty()) {
+        argument = queue.front();
+        queue.pop_front();
+        ++busy;
+        continue;
+      }
+      if((int)idle.size() >= max_idle) break;
+      Worker worker;
+      idle.push_front(&worker);
+      Glib::TimeVal etime;
+      etime.assign_current_time();
+      etime.add_seconds(idle_timeout);
+      while(!worker.argument) {
+        if(!worker.cond.timed_wait(pool_lock, etime)) break;
+      }
+      if(!worker.argument) idle.remove(&worker);
+      argument = worker.argument;
+    }
+    --count;
+    pool_lock.unlock();
   }
 
-  static ThreadPool* pool = NULL;
+  int ThreadPool::Num(void) {
+    Glib::Mutex::Lock lock(pool_lock);
+    return busy + queue.size();
+  }
 
-  ThreadInc::ThreadInc(void) {
-    if(!pool) return;
-    pool->count_lock.lock();
-    ++(pool->count);
-    pool->count_lock.unlock();
+  void ThreadPool::Statistics(ThreadStatistics& stats) {
+    Glib::Mutex::Lock lock(pool_lock);
+    stats.threads = count;
+    stats.idle = idle.size();
+    stats.queued = queue.size();
+    stats.created = created;
+    stats.requests = requests;
+    stats.latency = latency;
+    stats.max_latency = max_latency;
   }
 
-  ThreadInc::~ThreadInc(void) {
-    if(!pool) return;
-    pool->count_lock.lock();
-    --(pool->count);
-    pool->count_lock.unlock();
-    pool->CheckQueue();
+  static ThreadPool* pool = NULL;
+
+  void ThreadArgument::worker(void) {
+    pool->Run(this);
   }
 #endif
 
@@ -286,10 +347,6 @@ namespace Arc {
       tdata->Inherit(data);
       tdata->Release();
     }
-#endif
-#ifdef USE_THREAD_POOL
-    ThreadInc resource_;
-    release();
 #endif
     func_t f_temp = func;
     void *a_temp = arg;
@@ -878,6 +935,16 @@ namespace Arc {
   }
 
 
+  bool GetThreadStatistics(ThreadStatistics& stats) {
+#ifdef USE_THREAD_POOL
+    if(!pool) return false;
+    pool->Statistics(stats);
+    return true;
+#else
+    return false;
+#endif
+  }
+
   void ThreadInitializer::forceReset(void) {
     // This function is deprecated and its body removed because
     // there is no safe way to reset locks after call to fork().
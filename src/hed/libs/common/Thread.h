@@ -37,6 +37,31 @@ namespace Arc {
       \return true on success. */
   bool CreateThreadFunction(void (*func)(void*), void *arg, SimpleCounter* count = NULL);
 
+  /// Statistics of threads started by CreateThreadFunction and Thread::start.
+  /** Threads are kept for some time after their function exits and are
+      used for next requests. Requests are queued only if maximal number of
+      threads is reached. */
+  struct ThreadStatistics {
+    /// Number of existing threads
+    int threads;
+    /// Number of threads waiting for new request
+    int idle;
+    /// Number of requests waiting for free thread
+    int queued;
+    /// Number of threads created so far
+    unsigned long long int created;
+    /// Number of requests started so far
+    unsigned long long int requests;
+    /// Total time (microseconds) requests waited before being started
+    unsigned long long int latency;
+    /// Longest time (microseconds) request waited before being started
+    unsigned long long int max_latency;
+  };
+
+  /// Collects statistics of threads.
+  /** \return false if statistics are not available. */
+  bool GetThreadStatistics(ThreadStatistics& stats);
+
   /** \cond Internal class used to map glib thread ids (pointer addresses) to
      an incremental counter, for easier debugging. */
   class ThreadId {
@@ -17,6 +17,7 @@ class CheckSumTest
   CPPUNIT_TEST(CRC32SumTest);
   CPPUNIT_TEST(MD5SumTest);
   CPPUNIT_TEST(Adler32SumTest);
+  CPPUNIT_TEST(CombineTest);
   CPPUNIT_TEST_SUITE_END();
 
 public:
@@ -26,6 +27,7 @@ public:
   void CRC32SumTest();
   void MD5SumTest();
   void Adler32SumTest();
+  void CombineTest();
 };
 
 
@@ -77,4 +79,34 @@ void CheckSumTest::Adler32SumTest() {
   //CPPUNIT_ASSERT_EQUAL((std::string)"adler32:471b96e5", (std::string)buf);
 }
 
+void CheckSumTest::CombineTest() {
+  // Checksums of parts combined must be same as of whole data
+  char data[10000];
+  for (unsigned int n = 0; n < sizeof(data); ++n) data[n] = (char)(n * 13);
+  Arc::CheckSumAny::type types[] = { Arc::CheckSumAny::cksum, Arc::CheckSumAny::adler32 };
+  for (int t = 0; t < 2; ++t) {
+    Arc::CheckSumAny whole(types[t]);
+    whole.start();
+    whole.add(data, sizeof(data));
+    whole.end();
+    Arc::CheckSumAny ck(types[t]);
+    CPPUNIT_ASSERT(ck.combinable());
+    ck.start();
+    ck.add(data, 3000);
+    Arc::CheckSum* part = ck.clone();
+    CPPUNIT_ASSERT(part != NULL);
+    part->add(data + 3000, 7000);
+    CPPUNIT_ASSERT(ck.combine(*part));
+    delete part;
+    ck.end();
+    char wbuf[64];
+    char cbuf[64];
+    whole.print(wbuf, sizeof(wbuf));
+    ck.print(cbuf, sizeof(cbuf));
+    CPPUNIT_ASSERT_EQUAL((std::string)wbuf, (std::string)cbuf);
+  }
+  Arc::CheckSumAny md5(Arc::CheckSumAny::md5);
+  CPPUNIT_ASSERT(!md5.combinable());
+}
+
 CPPUNIT_TEST_SUITE_REGISTRATION(CheckSumTest);
@@ -17,6 +17,7 @@ class ThreadTest
   CPPUNIT_TEST_SUITE(ThreadTest);
   CPPUNIT_TEST(TestThread);
   CPPUNIT_TEST(TestBroadcast);
+  CPPUNIT_TEST(TestReuse);
   CPPUNIT_TEST_SUITE_END();
 
 public:
@@ -24,9 +25,11 @@ public:
   void tearDown();
   void TestThread();
   void TestBroadcast();
+  void TestReuse();
 
 private:
   static void func(void*);
+  static void func_quick(void*);
   static void func_wait(void* arg);
   static int counter;
   static Glib::Mutex* lock;
@@ -106,6 +109,31 @@ void ThreadTest::TestBroadcast() {
   CPPUNIT_ASSERT_EQUAL(2, counter);
 }
 
+void ThreadTest::TestReuse() {
+  // Run threads one after another and check finished threads are used again
+  Arc::ThreadStatistics before;
+  CPPUNIT_ASSERT(Arc::GetThreadStatistics(before));
+  Arc::SimpleCounter count;
+  for(int n = 0; n<20; ++n) {
+    CPPUNIT_ASSERT(Arc::CreateThreadFunction(&func_quick, NULL, &count));
+    count.wait();
+    // Let thread return to pool
+    usleep(100000);
+  }
+  CPPUNIT_ASSERT_EQUAL(20, counter);
+  Arc::ThreadStatistics after;
+  CPPUNIT_ASSERT(Arc::GetThreadStatistics(after));
+  CPPUNIT_ASSERT_EQUAL(before.requests+20, after.requests);
+  CPPUNIT_ASSERT(after.created < before.created+20);
+  CPPUNIT_ASSERT_EQUAL(0, after.queued);
+}
+
+void ThreadTest::func_quick(void*) {
+  lock->lock();
+  ++counter;
+  lock->unlock();
+}
+
 void ThreadTest::func_wait(void* arg) {
   ThreadTest* test = (ThreadTest*)arg;
   test->cond.wait();
@@ -8,8 +8,10 @@
 #define __STDC_LIMIT_MACROS
 #include <stdlib.h>
 #include <map>
+#include <vector>
 
 #include <arc/StringConv.h>
+#include <arc/Thread.h>
 #include <arc/message/MCCLoader.h>
 #include <arc/Utils.h>
 
@@ -407,7 +409,8 @@ namespace Arc {
       relative_uri(url.Option("relativeuri") == "yes"),
       encoded_uri(url.Option("encodeduri") != "no"),
       sec(http_url_to_sec(url,!cfg.otoken.empty())),
-      closed(false) {
+      closed(false),
+      sent(false) {
     XMLNode comp = ConfigMakeComponent(xmlcfg["Chain"], "http.client", "http",
                      (SECURITY_IS_SSL(sec.sec)) ? "tls" :
                      (SECURITY_IS_GSI(sec.sec)) ? "gsi" : "tcp");
@@ -415,10 +418,11 @@ namespace Arc {
     comp.NewChild("Method") = "POST"; // Override using attributes if needed
     comp.NewChild("Endpoint") = url.str(true); // Override using attributes if needed
     if (!cfg.otoken.empty()) comp.NewChild("Authorization") = "Bearer " + cfg.otoken; // TODO: protect and encode
-    // Pass information about protocol and hostname to TLS level
+    // Pass information about protocol and endpoint to TLS level
     XMLNode compTLS = ConfigFindComponent(xmlcfg["Chain"], "tls.client", NULL);
     if(compTLS) {
       compTLS.NewChild("Hostname") = url.Host();
+      compTLS.NewChild("Port") = tostring(url.Port());
       compTLS.NewChild("Protocol") = "http/1.1"; // educated guess
     }
   }
@@ -518,6 +522,7 @@ namespace Arc {
                          HTTPClientInfo *info,
                          MessagePayload **response) {
     *response = NULL;
+    sent = false;
     MCC_Status r;
     if (closed) return r;
     if (!(r=Load())) return r;
@@ -562,6 +567,7 @@ namespace Arc {
     HTTPAttributesToMessage(attributes, reqmsg);
 
     r = http_entry->process(reqmsg, repmsg);
+    sent = (repmsg.Attributes()->get("HTTP:UNSENT") != "TRUE");
     if(!r) {
       if (repmsg.Payload() != NULL) delete repmsg.Payload();
       return r;
@@ -718,6 +724,158 @@ namespace Arc {
 
   // -------------------------------------------------------------------------
 
+  // Connections kept by ClientHTTPPool. List is ordered by time connections
+  // were released, hence oldest ones are at front.
+  struct ClientHTTPPoolEntry {
+    std::string key;
+    ClientHTTP* client;
+    time_t released;
+  };
+
+  static Glib::Mutex pool_lock;
+  static std::list<ClientHTTPPoolEntry> pool_clients;
+  static unsigned int pool_per_endpoint = 8;
+  static unsigned int pool_total = 128;
+  // Should be below keep-alive timeout of most servers
+  static int pool_idle_timeout = 30;
+  static ClientHTTPPool::Statistics pool_stats = { 0, 0, 0, 0, 0 };
+
+  // Removes expired and excessive entries. Must be called with pool_lock held.
+  // Clients are destroyed by caller outside of lock because that involves
+  // closing connection.
+  static void pool_expire(std::vector<ClientHTTP*>& expired) {
+    time_t now = ::time(NULL);
+    while(!pool_clients.empty()) {
+      ClientHTTPPoolEntry& entry = pool_clients.front();
+      if((pool_clients.size() <= pool_total) &&
+         ((now - entry.released) < pool_idle_timeout)) break;
+      expired.push_back(entry.client);
+      pool_clients.pop_front();
+      ++pool_stats.dropped;
+    }
+  }
+
+  static void pool_destroy(std::vector<ClientHTTP*>& clients) {
+    for(std::vector<ClientHTTP*>::iterator c = clients.begin(); c != clients.end(); ++c) delete *c;
+  }
+
+  std::string ClientHTTPPool::MakeKey(const BaseConfig& cfg, const URL& url, int timeout) {
+    // Everything which affects how connection is established or
+    // is attached to every request made through it.
+    std::string overlay;
+    if(cfg.overlay) cfg.overlay.GetXML(overlay);
+    return url.ConnectionURL() + "\n" +
+           url.Option("tcpnodelay") + "\n" +
+           url.Option("relativeuri") + "\n" +
+           url.Option("encodeduri") + "\n" +
+           tostring(timeout) + "\n" +
+           cfg.proxy + "\n" + cfg.cert + "\n" + cfg.key + "\n" +
+           cfg.cafile + "\n" + cfg.cadir + "\n" +
+           cfg.otoken + "\n" + cfg.credential + "\n" + overlay;
+  }
+
+  ClientHTTP* ClientHTTPPool::Acquire(const BaseConfig& cfg, const URL& url, int timeout, bool* pooled) {
+    if(pooled) *pooled = false;
+    if(!url) return NULL;
+    if((url.Protocol() != "http") &&
+       (url.Protocol() != "https") &&
+       (url.Protocol() != "httpg") &&
+       (url.Protocol() != "dav") &&
+       (url.Protocol() != "davs")) return NULL;
+    std::string key = MakeKey(cfg, url, timeout);
+    ClientHTTP* client = NULL;
+    std::vector<ClientHTTP*> expired;
+    {
+      Glib::Mutex::Lock lock(pool_lock);
+      pool_expire(expired);
+      // Most recently used connection is least likely to be closed by server
+      for(std::list<ClientHTTPPoolEntry>::reverse_iterator entry = pool_clients.rbegin();
+                                            entry != pool_clients.rend(); ++entry) {
+        if(entry->key != key) continue;
+        client = entry->client;
+        pool_clients.erase(--(entry.base()));
+        ++pool_stats.reused;
+        break;
+      }
+      if(!client) ++pool_stats.created;
+      pool_stats.idle = pool_clients.size();
+    }
+    pool_destroy(expired);
+    if(pooled) *pooled = (client != NULL);
+    if(!client) client = new ClientHTTP(cfg, url, timeout);
+    return client;
+  }
+
+  void ClientHTTPPool::Release(ClientHTTP* client, const BaseConfig& cfg, const URL& url, int timeout) {
+    if(!client) return;
+    if(client->GetClosed() || (pool_total == 0) || (pool_per_endpoint == 0)) {
+      delete client;
+      return;
+    }
+    ClientHTTPPoolEntry new_entry;
+    new_entry.key = MakeKey(cfg, url, timeout);
+    new_entry.client = client;
+    new_entry.released = ::time(NULL);
+    std::vector<ClientHTTP*> expired;
+    {
+      Glib::Mutex::Lock lock(pool_lock);
+      // Drop oldest connection to same endpoint if there are too many
+      unsigned int count = 0;
+      std::list<ClientHTTPPoolEntry>::iterator oldest = pool_clients.end();
+      for(std::list<ClientHTTPPoolEntry>::iterator entry = pool_clients.begin();
+                                            entry != pool_clients.end(); ++entry) {
+        if(entry->key != new_entry.key) continue;
+        if(oldest == pool_clients.end()) oldest = entry;
+        ++count;
+      }
+      if(count >= pool_per_endpoint) {
+        expired.push_back(oldest->client);
+        pool_clients.erase(oldest);
+        ++pool_stats.dropped;
+      }
+      pool_clients.push_back(new_entry);
+      ++pool_stats.released;
+      pool_expire(expired);
+      pool_stats.idle = pool_clients.size();
+    }
+    pool_destroy(expired);
+  }
+
+  void ClientHTTPPool::SetLimits(unsigned int per_endpoint, unsigned int total, int idle_timeout) {
+    std::vector<ClientHTTP*> expired;
+    {
+      Glib::Mutex::Lock lock(pool_lock);
+      pool_per_endpoint = per_endpoint;
+      pool_total = total;
+      pool_idle_timeout = idle_timeout;
+      pool_expire(expired);
+      pool_stats.idle = pool_clients.size();
+    }
+    pool_destroy(expired);
+  }
+
+  void ClientHTTPPool::Clear() {
+    std::vector<ClientHTTP*> expired;
+    {
+      Glib::Mutex::Lock lock(pool_lock);
+      for(std::list<ClientHTTPPoolEntry>::iterator entry = pool_clients.begin();
+                                            entry != pool_clients.end(); ++entry) {
+        expired.push_back(entry->client);
+        ++pool_stats.dropped;
+      }
+      pool_clients.clear();
+      pool_stats.idle = 0;
+    }
+    pool_destroy(expired);
+  }
+
+  ClientHTTPPool::Statistics ClientHTTPPool::GetStatistics() {
+    Glib::Mutex::Lock lock(pool_lock);
+    return pool_stats;
+  }
+
+  // -------------------------------------------------------------------------
+
   ClientSOAP::ClientSOAP(const BaseConfig& cfg, const URL& url, int timeout)
     : ClientHTTP(cfg, url, timeout),
       soap_entry(NULL) {
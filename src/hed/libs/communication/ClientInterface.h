@@ -180,7 +180,7 @@ namespace Arc {
     : public ClientTCP {
   public:
     ClientHTTP()
-      : http_entry(NULL), relative_uri(false), encoded_uri(true), sec(NoSec), closed(false) {}
+      : http_entry(NULL), relative_uri(false), encoded_uri(true), sec(NoSec), closed(false), sent(false) {}
     ClientHTTP(const BaseConfig& cfg, const URL& url, int timeout = -1, const std::string& proxy_host = "", int proxy_port = 0);
     virtual ~ClientHTTP();
     MCC_Status process(const std::string& method, PayloadRawInterface *request,
@@ -227,6 +227,9 @@ namespace Arc {
     void RelativeURI(bool val) { relative_uri=val; };
     const URL& GetURL() const { return default_url; };
     bool GetClosed() const { return closed; }
+    /** Returns false if last request failed before it was passed to server.
+       Only such request is safe to repeat regardless of its method. */
+    bool GetSent() const { return sent; }
   protected:
     MCC *http_entry;
     URL default_url;
@@ -234,6 +237,7 @@ namespace Arc {
     bool encoded_uri;
     TCPSec sec;
     bool closed;
+    bool sent;
     MCC_Status process(const std::string& method, const std::string& path,
                        std::multimap<std::string, std::string> const& attributes,
                        uint64_t range_start, uint64_t range_end,
@@ -241,6 +245,48 @@ namespace Arc {
                        HTTPClientInfo *info, MessagePayload **response);
   };
 
+  //! Process-wide pool of idle HTTP connections
+  /** Connections returned to the pool are handed out again to requests
+   * going to the same endpoint with the same credentials, so that they
+   * do not pay for a new TCP and TLS/GSI handshake. The pool keeps
+   * limited number of idle connections per endpoint and in total and
+   * closes connections which stayed idle for too long.
+   * Because connection may be shared by requests to different paths
+   * of same service, clients obtained from the pool must always be
+   * given path explicitly in process() call.
+   **/
+  class ClientHTTPPool {
+  public:
+    /// Counters of pool activity since start of the process
+    struct Statistics {
+      unsigned long long int created;  /// New connections made (each means handshake)
+      unsigned long long int reused;   /// Requests served by pooled connection
+      unsigned long long int released; /// Connections returned to pool
+      unsigned long long int dropped;  /// Idle connections closed by pool
+      unsigned int idle;               /// Connections currently kept in pool
+    };
+    /// Get idle connection to url or make new one if none is available.
+    /** cfg and timeout have same meaning as for ClientHTTP constructor.
+       If pooled is not NULL it is set to true when idle connection is
+       returned. Such connection may have been closed by server meanwhile.
+       Returns NULL if url is not HTTP(S/G). */
+    static ClientHTTP* Acquire(const BaseConfig& cfg, const URL& url, int timeout = -1, bool* pooled = NULL);
+    /// Return connection obtained from Acquire() to the pool.
+    /** cfg, url and timeout must be same as passed to Acquire(). Closed
+       connection is destroyed. Response payload of last request must be
+       read or destroyed before calling this method. */
+    static void Release(ClientHTTP* client, const BaseConfig& cfg, const URL& url, int timeout = -1);
+    /// Set maximal number of idle connections per endpoint and in total
+    /// and number of seconds connection may stay idle in the pool.
+    static void SetLimits(unsigned int per_endpoint, unsigned int total, int idle_timeout);
+    /// Close all idle connections
+    static void Clear();
+    static Statistics GetStatistics();
+  private:
+    ClientHTTPPool();
+    static std::string MakeKey(const BaseConfig& cfg, const URL& url, int timeout);
+  };
+
   /** Class with easy interface for sending/receiving SOAP messages
       over HTTP(S/G).
       It takes care of configuring MCC chain and making an entry point. */
@@ -6,6 +6,7 @@
 
 #include <algorithm>
 #include <iostream>
+#include <set>
 
 #include <unistd.h>
 
@@ -136,11 +137,12 @@ namespace Arc {
       return;
     }
 
+    const std::set<std::string> idSet(ids.begin(), ids.end());
     for (JobSelectionMap::iterator it = jcJobMap.begin();
          it != jcJobMap.end(); ++it) {
       for (std::list<Job*>::iterator itJ = it->second.first.begin();
            itJ != it->second.first.end();) {
-        if (std::find(ids.begin(), ids.end(), (*itJ)->JobID) == ids.end()) {
+        if (idSet.find((*itJ)->JobID) == idSet.end()) {
           notprocessed.push_back((*itJ)->JobID);
           it->second.second.push_back(*itJ);
           itJ = it->second.first.erase(itJ);
@@ -0,0 +1,508 @@
+// -*- indent-tabs-mode: nil -*-
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <algorithm>
+#include <vector>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/statvfs.h>
+#include <unistd.h>
+
+#include <arc/ArcConfigIni.h>
+#include <arc/DateTime.h>
+#include <arc/FileUtils.h>
+#include <arc/IString.h>
+#include <arc/Logger.h>
+#include <arc/OptionParser.h>
+#include <arc/Run.h>
+#include <arc/StringConv.h>
+#include <arc/Utils.h>
+
+#include "FileCacheIndex.h"
+
+// Cleans A-REX caches using index maintained by FileCache instead of
+// walking whole cache on every run. Options are same as of former
+// cache-clean script.
+
+// Lock on cache file which was not updated for this time is stale
+#define CACHE_CLEAN_LOCK_TIMEOUT (86400)
+// Timeout for external commands reporting used space
+#define CACHE_CLEAN_SPACE_TIMEOUT (300)
+
+static Arc::Logger logger(Arc::Logger::getRootLogger(), "cache-clean");
+
+static std::string printsize(unsigned long long int size) {
+  const unsigned long long int kB = 1024;
+  if (size > kB*kB*kB*kB) return Arc::tostring(size/(kB*kB*kB*kB)) + " TB";
+  if (size > kB*kB*kB) return Arc::tostring(size/(kB*kB*kB)) + " GB";
+  if (size > kB*kB) return Arc::tostring(size/(kB*kB)) + " MB";
+  if (size > kB) return Arc::tostring(size/kB) + " kB";
+  return Arc::tostring(size);
+}
+
+static std::string printpercent(unsigned long long int part, unsigned long long int total) {
+  char buf[32];
+  snprintf(buf, sizeof(buf), "%.2f", (total > 0) ? (100.0 * part / total) : 0.0);
+  return buf;
+}
+
+// Parses expiry time given as N, Ns, Nm, Nh or Nd
+static bool parse_expiry(const std::string& str, time_t& expiry) {
+  if (str.empty()) return false;
+  std::string num(str);
+  time_t mult = 1;
+  switch (str[str.length()-1]) {
+    case 's': mult = 1; break;
+    case 'm': mult = 60; break;
+    case 'h': mult = 3600; break;
+    case 'd': mult = 86400; break;
+    default: mult = 0; break;
+  }
+  if (mult) num.resize(num.length()-1);
+  else mult = 1;
+  unsigned int n = 0;
+  if (num.empty() || (num.find_first_not_of("0123456789") != std::string::npos)) return false;
+  if (!Arc::stringto(num, n)) return false;
+  expiry = n * mult;
+  return true;
+}
+
+static bool run_space_command(const std::string& cmd, unsigned long long int& total,
+                              unsigned long long int& used) {
+  std::string out;
+  Arc::Run run(cmd);
+  run.AssignStdout(out);
+  if (!run.Start() || !run.Wait(CACHE_CLEAN_SPACE_TIMEOUT) || (run.Result() != 0)) {
+    logger.msg(Arc::WARNING, "Failed running %s", cmd);
+    return false;
+  }
+  std::vector<std::string> lines;
+  Arc::tokenize(out, lines, "\n");
+  if (lines.empty()) {
+    logger.msg(Arc::WARNING, "Bad output from %s: %s", cmd, out);
+    return false;
+  }
+  std::vector<std::string> fields;
+  Arc::tokenize(lines.back(), fields, " \t");
+  if (fields.size() < 2) {
+    logger.msg(Arc::WARNING, "Bad output from %s: %s", cmd, out);
+    return false;
+  }
+  if (!Arc::stringto(fields[0], total) || !Arc::stringto(fields[1], used)) {
+    logger.msg(Arc::WARNING, "Bad output from %s: %s", cmd, out);
+    return false;
+  }
+  return true;
+}
+
+// Total and used space of file system holding cache
+static bool diskspace(const std::string& path, const std::string& spacecmd,
+                      unsigned long long int& total, unsigned long long int& used) {
+  if (!spacecmd.empty()) {
+    return run_space_command(spacecmd + " " + path, total, used);
+  }
+  if (path.find("/afs/") != std::string::npos) {
+    std::string out;
+    std::list<std::string> argv;
+    argv.push_back("fs");
+    argv.push_back("listquota");
+    argv.push_back(path);
+    Arc::Run run(argv);
+    run.AssignStdout(out);
+    if (!run.Start() || !run.Wait(CACHE_CLEAN_SPACE_TIMEOUT) || (run.Result() != 0)) {
+      logger.msg(Arc::WARNING, "Failed running: fs listquota %s", path);
+      return false;
+    }
+    std::vector<std::string> lines;
+    Arc::tokenize(out, lines, "\n");
+    std::vector<std::string> fields;
+    if (!lines.empty()) Arc::tokenize(lines.back(), fields, " \t");
+    if ((fields.size() < 3) || !Arc::stringto(fields[1], total) || !Arc::stringto(fields[2], used)) {
+      logger.msg(Arc::WARNING, "Failed interpreting output of: fs listquota %s", path);
+      return false;
+    }
+    total *= 1024;
+    used *= 1024;
+    return true;
+  }
+  struct statvfs info;
+  if (statvfs(path.c_str(), &info) != 0) {
+    logger.msg(Arc::WARNING, "Unable to stat %s: %s", path, Arc::StrError(errno));
+    return false;
+  }
+  total = (unsigned long long int)info.f_blocks * info.f_frsize;
+  used = (unsigned long long int)(info.f_blocks - info.f_bfree) * info.f_frsize;
+  return true;
+}
+
+// Keys of index are referred to save memory on large caches
+struct CacheFile {
+  time_t atime;
+  unsigned long long int size;
+  const std::string* hash;
+  bool operator<(const CacheFile& f) const { return atime < f.atime; };
+};
+
+class CacheCleaner {
+ public:
+  CacheCleaner(const std::string& cache_path, Arc::FileCacheIndex& index,
+               const std::set<ino_t>& in_use, unsigned long long int& used):
+    cache_path(cache_path), index(index), in_use(in_use), used(used), now(time(NULL)) {};
+  // Delete cache file if it is not used. Returns true if file was deleted.
+  bool Remove(const std::string& hash, bool expired);
+ private:
+  std::string cache_path;
+  Arc::FileCacheIndex& index;
+  const std::set<ino_t>& in_use;
+  unsigned long long int& used;
+  time_t now;
+};
+
+bool CacheCleaner::Remove(const std::string& hash_ref, bool expired) {
+  // reference may point to key which is erased here
+  std::string hash(hash_ref);
+  std::map<std::string, Arc::FileCacheIndex::Entry>::const_iterator e = index.Entries().find(hash);
+  if (e == index.Entries().end()) return false;
+  Arc::FileCacheIndex::Entry entry(e->second);
+  if (in_use.find(entry.inode) != in_use.end()) return false;
+  std::string fil = cache_path + "/data/" + hash;
+  // Index may be outdated, hence file itself is checked before deleting
+  struct stat st;
+  if (::lstat(fil.c_str(), &st) != 0) {
+    if (errno == ENOENT) index.Erase(hash);
+    return false;
+  }
+  if (S_ISDIR(st.st_mode)) return false;
+  if (st.st_nlink != 1) return false;
+  entry.inode = st.st_ino;
+  entry.size = (unsigned long long int)st.st_blocks * 512;
+  // File accessed without going through FileCache must stay
+  if (st.st_atime > entry.atime) {
+    entry.atime = st.st_atime;
+    index.Update(hash, entry);
+    return false;
+  }
+  struct stat lst;
+  std::string lock = fil + ".lock";
+  if (::stat(lock.c_str(), &lst) == 0) {
+    if ((now - lst.st_atime) <= CACHE_CLEAN_LOCK_TIMEOUT) return false;
+    ::unlink(lock.c_str());
+  }
+  if (::unlink(fil.c_str()) != 0) {
+    logger.msg(Arc::WARNING, "Error deleting file '%s': %s", fil, Arc::StrError(errno));
+    return false;
+  }
+  if (used > entry.size) used -= entry.size; else used = 0;
+  index.Erase(hash);
+  if (expired) {
+    logger.msg(Arc::VERBOSE, "Deleting expired file: %s  atime: %s  size: %llu",
+               fil, Arc::Time(entry.atime).str(), entry.size);
+  } else {
+    logger.msg(Arc::VERBOSE, "Deleting file: %s  atime: %s  size: %llu",
+               fil, Arc::Time(entry.atime).str(), entry.size);
+  }
+  // not critical if this fails
+  std::string meta = fil + ".meta";
+  if (::unlink(meta.c_str()) == 0) {
+    std::string dir = fil.substr(0, fil.rfind('/'));
+    if (::rmdir(dir.c_str()) == 0) logger.msg(Arc::VERBOSE, "Deleting directory %s", dir);
+  } else if (errno != ENOENT) {
+    logger.msg(Arc::WARNING, "Error deleting file '%s': %s", meta, Arc::StrError(errno));
+  }
+  return true;
+}
+
+static void statistics(const std::string& cache_path, const Arc::FileCacheIndex& index,
+                       const std::set<ino_t>& in_use,
+                       unsigned long long int fsused, unsigned long long int fssize) {
+  std::vector<CacheFile> files;
+  unsigned long long int totsize = 0;
+  unsigned long long int totlocksize = 0;
+  unsigned int totlockfiles = 0;
+  files.reserve(index.Entries().size());
+  for (std::map<std::string, Arc::FileCacheIndex::Entry>::const_iterator e = index.Entries().begin();
+       e != index.Entries().end(); ++e) {
+    if (in_use.find(e->second.inode) != in_use.end()) {
+      totlocksize += e->second.size;
+      ++totlockfiles;
+      continue;
+    }
+    CacheFile f;
+    f.atime = e->second.atime;
+    f.size = e->second.size;
+    f.hash = &(e->first);
+    files.push_back(f);
+    totsize += e->second.size;
+  }
+  std::cout << std::endl << "Usage statistics: " << cache_path << std::endl;
+  std::cout << "Total deletable files found: " << files.size()
+            << " (" << totlockfiles << " files locked or in use)" << std::endl;
+  std::cout << "Total size of deletable files found: " << printsize(totsize)
+            << " (" << printsize(totlocksize) << " locked or in use)" << std::endl;
+  std::cout << "Used space on file system: " << printsize(fsused) << " / " << printsize(fssize)
+            << " (" << printpercent(fsused, fssize) << "%)" << std::endl;
+  unsigned long long int increment = totsize / 10;
+  if (increment < 1) {
+    std::cout << "Total size too small to show usage histogram" << std::endl;
+    return;
+  }
+  // newest first
+  std::sort(files.begin(), files.end());
+  std::reverse(files.begin(), files.end());
+  char line[256];
+  snprintf(line, sizeof(line), "%-21s %-25s %s", "At size (% of total)", "Newest file", "Oldest file");
+  std::cout << line << std::endl;
+  unsigned long long int nextinc = increment;
+  unsigned long long int accumulated = 0;
+  time_t newatime = 0;
+  time_t lastatime = 0;
+  for (std::vector<CacheFile>::iterator f = files.begin(); f != files.end(); ++f) {
+    accumulated += f->size;
+    if (!newatime) newatime = f->atime;
+    if (accumulated > nextinc) {
+      std::string at = printsize(accumulated) + " (" +
+                       Arc::tostring((int)(100.0 * accumulated / totsize)) + "%)";
+      snprintf(line, sizeof(line), "%-21s %-25s %s", at.c_str(),
+               Arc::Time(newatime).str().c_str(), Arc::Time(f->atime).str().c_str());
+      std::cout << line << std::endl;
+      while (nextinc < accumulated) nextinc += increment;
+      newatime = 0;
+      lastatime = 0;
+    } else {
+      lastatime = f->atime;
+    }
+  }
+  if (lastatime) {
+    std::string at = printsize(accumulated) + " (100%)";
+    snprintf(line, sizeof(line), "%-21s %-25s %s", at.c_str(), "-", Arc::Time(lastatime).str().c_str());
+    std::cout << line << std::endl;
+  }
+}
+
+static bool config_caches(const std::string& configfile, std::list<std::string>& caches) {
+  Arc::ConfigIni cf(configfile.c_str());
+  if (!cf) {
+    logger.msg(Arc::ERROR, "No such configuration file %s", configfile);
+    return false;
+  }
+  cf.AddSection("arex/cache");
+  for (;;) {
+    std::string rest;
+    std::string command;
+    cf.ReadNext(command, rest);
+    if (command.empty()) break; // EOF
+    if (cf.SubSection()[0] != '\0') continue;
+    if (command != "cachedir") continue;
+    std::string cache_dir = Arc::ConfigIni::NextArg(rest);
+    if (!cache_dir.empty()) caches.push_back(cache_dir);
+  }
+  return true;
+}
+
+int main(int argc, char** argv) {
+
+  Arc::LogStream logcerr(std::cerr);
+  logcerr.setFormat(Arc::ShortFormat);
+  Arc::Logger::getRootLogger().addDestination(logcerr);
+  Arc::Logger::getRootLogger().setThreshold(Arc::INFO);
+
+  Arc::OptionParser options(istring("[dir1 [dir2 [...]]]"),
+                            istring("Administration tool for the A-REX cache. Caches are given by "
+                                    "dir1, dir2.. or taken from the config file specified by -c, "
+                                    "ARC_CONFIG or the default /etc/arc.conf."));
+
+  bool stats = false;
+  options.AddOption('s', "stats",
+                    istring("Statistics mode, show cache usage stats, dont delete anything"),
+                    stats);
+  bool calcsize = false;
+  options.AddOption('S', "size",
+                    istring("Calculate cache size rather than using used file system space"),
+                    calcsize);
+  bool rebuild = false;
+  options.AddOption('R', "rebuild",
+                    istring("Rebuild cache index by scanning whole cache"),
+                    rebuild);
+  std::string configfile;
+  options.AddOption('c', "config",
+                    istring("path to an A-REX config file"),
+                    istring("path"), configfile);
+  int maxusedpercent = -1;
+  options.AddOption('M', "max",
+                    istring("Maximum usage of file system. When to start cleaning the cache (percent)"),
+                    istring("NN"), maxusedpercent);
+  int minusedpercent = -1;
+  options.AddOption('m', "min",
+                    istring("Minimum usage of file system. When to stop cleaning cache (percent)"),
+                    istring("NN"), minusedpercent);
+  std::string expiry_str;
+  options.AddOption('E', "expiry",
+                    istring("Delete all files whose access time is older than N. Examples "
+                            "of N are 1800, 90s, 24h, 30d (default is seconds)"),
+                    istring("N"), expiry_str);
+  std::string spacecmd;
+  options.AddOption('f', "space-command",
+                    istring("Path and optionally arguments to a command which outputs "
+                            "\"total_bytes used_bytes\" of the file system the cache is on. "
+                            "The cache dir is passed as an argument to this command."),
+                    istring("command"), spacecmd);
+  std::string debug;
+  options.AddOption('D', "debug",
+                    istring("FATAL, ERROR, WARNING, INFO, VERBOSE or DEBUG"),
+                    istring("debuglevel"), debug);
+
+  std::list<std::string> caches = options.Parse(argc, argv);
+
+  if (stats) Arc::Logger::getRootLogger().setThreshold(Arc::ERROR);
+  if (!debug.empty()) {
+    Arc::LogLevel level;
+    if (!Arc::string_to_level(debug, level)) {
+      std::cerr << "Bad debug level " << debug << std::endl;
+      return 1;
+    }
+    Arc::Logger::getRootLogger().setThreshold(level);
+  }
+  if (((maxusedpercent < 0) || (minusedpercent < 0)) && expiry_str.empty() && !stats) {
+    std::cerr << Arc::IString("Use --help option for detailed usage information") << std::endl;
+    return 1;
+  }
+  if (maxusedpercent > 100) {
+    std::cerr << "Bad value for -M: " << maxusedpercent << std::endl;
+    return 1;
+  }
+  if (minusedpercent > 100) {
+    std::cerr << "Bad value for -m: " << minusedpercent << std::endl;
+    return 1;
+  }
+  if ((maxusedpercent >= 0) && (minusedpercent > maxusedpercent)) {
+    std::cerr << "-M can't be smaller than -m (now " << maxusedpercent << "/" << minusedpercent << ")" << std::endl;
+    return 1;
+  }
+  time_t expirytime = 0;
+  if (!expiry_str.empty() && !parse_expiry(expiry_str, expirytime)) {
+    std::cerr << "Bad format in -E option value" << std::endl;
+    return 1;
+  }
+
+  logger.msg(Arc::INFO, "Cache cleaning started");
+
+  if (caches.empty()) {
+    if (configfile.empty()) configfile = Arc::GetEnv("ARC_CONFIG");
+    if (configfile.empty()) configfile = "/etc/arc.conf";
+    if (!config_caches(configfile, caches)) return 1;
+    if (caches.empty()) {
+      logger.msg(Arc::ERROR, "No caches found in config file '%s'", configfile);
+      return 1;
+    }
+  }
+
+  for (std::list<std::string>::iterator c = caches.begin(); c != caches.end(); ++c) {
+    std::string cache_path(*c);
+    while ((cache_path.length() > 1) && (cache_path[cache_path.length()-1] == '/')) cache_path.resize(cache_path.length()-1);
+    if (cache_path.empty()) continue;
+    if (cache_path.find('%') != std::string::npos) {
+      logger.msg(Arc::WARNING, "%s: Warning: cache-clean cannot deal with substitutions", cache_path);
+      continue;
+    }
+    struct stat st;
+    if (!Arc::FileStat(cache_path + "/data", &st, true) || !S_ISDIR(st.st_mode)) {
+      logger.msg(Arc::INFO, "%s: Cache is empty", cache_path);
+      continue;
+    }
+    // follow sym links to real filesystem
+    char* real_path = ::realpath(cache_path.c_str(), NULL);
+    if (real_path) {
+      cache_path = real_path;
+      ::free(real_path);
+    }
+
+    unsigned long long int fssize = 0;
+    unsigned long long int fsused = 0;
+    if (!diskspace(cache_path, spacecmd, fssize, fsused) || (fssize == 0)) {
+      logger.msg(Arc::WARNING, "Unable to stat %s", cache_path);
+      continue;
+    }
+
+    Arc::FileCacheIndex index(cache_path);
+    bool loaded = false;
+    if (!rebuild && index.Exists()) loaded = index.Load();
+    if (!loaded) {
+      if (!rebuild) logger.msg(Arc::INFO, "%s: No usable cache index, scanning cache", cache_path);
+      if (!index.Rebuild()) {
+        logger.msg(Arc::WARNING, "%s: Failed to scan cache", cache_path);
+        continue;
+      }
+      // Store at once so that scan is not repeated if cleaning fails
+      index.Store();
+    }
+    // get actual used disk for caches on shared partitions if configured
+    if (calcsize) fsused = index.Size();
+
+    unsigned long long int maxfbytes = (maxusedpercent < 0) ? fssize : fssize / 100 * maxusedpercent;
+    unsigned long long int minfbytes = (minusedpercent < 0) ? fssize : fssize / 100 * minusedpercent;
+    logger.msg(Arc::INFO, "%s: used space %s / %s (%s%%)", cache_path,
+               printsize(fsused), printsize(fssize), printpercent(fsused, fssize));
+    if ((expirytime == 0) && (fsused < maxfbytes) && !stats) {
+      logger.msg(Arc::INFO, "Used space is lower than upper limit (%i%%)", maxusedpercent);
+      if (index.NeedsCompact()) index.Store();
+      continue;
+    }
+
+    std::set<ino_t> in_use;
+    if (!index.InUse(in_use)) {
+      logger.msg(Arc::WARNING, "%s: Failed to find files used by jobs", cache_path);
+      continue;
+    }
+
+    if (stats) {
+      statistics(cache_path, index, in_use, fsused, fssize);
+      continue;
+    }
+
+    // Order of access is taken from index only
+    std::vector<CacheFile> files;
+    files.reserve(index.Entries().size());
+    for (std::map<std::string, Arc::FileCacheIndex::Entry>::const_iterator e = index.Entries().begin();
+         e != index.Entries().end(); ++e) {
+      CacheFile f;
+      f.atime = e->second.atime;
+      f.size = e->second.size;
+      f.hash = &(e->first);
+      files.push_back(f);
+    }
+    std::sort(files.begin(), files.end());
+
+    CacheCleaner cleaner(cache_path, index, in_use, fsused);
+    time_t now = time(NULL);
+    std::vector<CacheFile>::iterator f = files.begin();
+    // remove expired files
+    if (expirytime > 0) {
+      for (; f != files.end(); ++f) {
+        if ((now - f->atime) < expirytime) break;
+        cleaner.Remove(*(f->hash), true);
+      }
+    }
+    // are we still exceeding limit after deleting expired files
+    if ((maxusedpercent >= 0) && (fsused > maxfbytes)) {
+      // delete in order of access
+      for (; f != files.end(); ++f) {
+        if (fsused < minfbytes) break;
+        cleaner.Remove(*(f->hash), false);
+      }
+    }
+    if (!index.Store()) {
+      logger.msg(Arc::WARNING, "%s: Failed to store cache index", cache_path);
+    }
+    logger.msg(Arc::INFO, "Cleaning finished, used space now %s / %s (%s%%)",
+               printsize(fsused), printsize(fssize), printpercent(fsused, fssize));
+  }
+  return 0;
+}
@@ -6,27 +6,75 @@
 
 #include <cstdlib>
 
+#include <sys/mman.h>
+#include <glib.h>
+
 #include <arc/CheckSum.h>
 #include <arc/data/DataBuffer.h>
 
+// Buffers are aligned to cache line to avoid sharing lines between them
+#define DATABUFFER_CACHE_LINE (64)
+// Size of huge page used for rounding mapped memory
+#define DATABUFFER_HUGE_PAGE (2*1024*1024)
+// How many times to yield before sleeping while waiting for ring
+#define DATABUFFER_RING_SPIN (64)
+// Maximal number of threads computing combinable checksums
+#define DATABUFFER_CHECKSUM_THREADS (4)
+
 namespace Arc {
 
+  static unsigned long long int align_size(unsigned long long int size,
+                                           unsigned long long int align) {
+    return ((size + align - 1) / align) * align;
+  }
+
+  void DataBuffer::release() {
+    if (bufs != NULL) {
+      if (region == NULL) {
+        for (int i = 0; i < bufs_n; i++) {
+          if (bufs[i].start) free(bufs[i].start);
+        }
+      }
+      free(bufs);
+      bufs_n = 0;
+      bufs = NULL;
+    }
+    if (region != NULL) {
+#ifdef MAP_HUGETLB
+      if (region_mapped) munmap(region, region_size);
+      else
+#endif
+      free(region);
+      region = NULL;
+      region_size = 0;
+      region_mapped = false;
+    }
+  }
+
   bool DataBuffer::set(CheckSum *cksum, unsigned int size, int blocks) {
+    return set(cksum, size, blocks, false, false);
+  }
+
+  bool DataBuffer::set(CheckSum *cksum, unsigned int size, int blocks,
+                       bool ring, bool hugepages) {
     lock.lock();
     if (blocks < 0) {
       lock.unlock();
       return false;
     }
+    checksum_stop();
+    checksum_clear();
     if (bufs != NULL) {
-      for (int i = 0; i < bufs_n; i++) {
-        if (bufs[i].start) free(bufs[i].start);
-      }
-      free(bufs);
-      bufs_n = 0;
-      bufs = NULL;
+      release();
       set_counter++;
       cond.broadcast(); /* make all waiting loops to exit */
+      ring_cond.broadcast();
     }
+    ring_mode = false;
+    ring_read_handle = -1;
+    ring_write_handle = -1;
+    g_atomic_int_set(&ring_head, 0);
+    g_atomic_int_set(&ring_tail, 0);
     if ((size == 0) || (blocks == 0)) {
       lock.unlock();
       return true;
@@ -44,11 +92,54 @@ namespace Arc {
       bufs[i].size = size;
       bufs[i].used = 0;
       bufs[i].offset = 0;
+      bufs[i].cksum_len = 0;
+      bufs[i].cksum_offset = 0;
+    }
+    if (ring) {
+      /* ring must not allocate while transferring - take all memory now */
+      unsigned long long int stride = align_size(size, DATABUFFER_CACHE_LINE);
+      region_size = stride * blocks;
+#ifdef MAP_HUGETLB
+      if (hugepages) {
+        region_size = align_size(region_size, DATABUFFER_HUGE_PAGE);
+        void *addr = mmap(NULL, region_size, PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (addr != MAP_FAILED) {
+          region = (char*)addr;
+          region_mapped = true;
+        }
+      }
+#endif
+      if (region == NULL) {
+        void *addr = NULL;
+        if (posix_memalign(&addr, DATABUFFER_CACHE_LINE, region_size) != 0) {
+          release();
+          lock.unlock();
+          return false;
+        }
+        region = (char*)addr;
+#ifdef MADV_HUGEPAGE
+        /* let kernel use transparent huge pages if possible */
+        if (hugepages) madvise(region, region_size, MADV_HUGEPAGE);
+#endif
+      }
+      for (int i = 0; i < blocks; i++) {
+        bufs[i].start = region + stride * i;
+      }
+      ring_mode = true;
     }
     //checksum = cksum;
     checksums.clear();
     checksums.push_back(checksum_desc(cksum));
     if (cksum) cksum->start();
+    if (cksum && !ring_mode) {
+      int threads = 1;
+      if (checksums.back().combinable) {
+        threads = (blocks < DATABUFFER_CHECKSUM_THREADS) ?
+                  blocks : DATABUFFER_CHECKSUM_THREADS;
+      }
+      checksum_start(threads);
+    }
     lock.unlock();
     return true;
   }
@@ -58,6 +149,14 @@ namespace Arc {
     lock.lock();
     checksum_desc cs = cksum;
     cs.sum->start();
+    if (checksum_threads > 0) {
+      /* buffers still holding data will be passed by checksum threads */
+      checksums.push_back(cs);
+      int res = checksums.size() - 1;
+      checksum_cond.broadcast();
+      lock.unlock();
+      return res;
+    }
     for (int i = 0; i < bufs_n; i++) {
       if (bufs[i].used != 0) {
         if (bufs[i].offset == cs.offset) {
@@ -80,6 +179,17 @@ namespace Arc {
   DataBuffer::DataBuffer(unsigned int size, int blocks) {
     bufs_n = 0;
     bufs = NULL;
+    region = NULL;
+    region_size = 0;
+    region_mapped = false;
+    ring_mode = false;
+    ring_read_handle = -1;
+    ring_write_handle = -1;
+    ring_head = 0;
+    ring_tail = 0;
+    ring_waiters = 0;
+    checksum_threads = 0;
+    checksum_exit = false;
     set_counter = 0;
     eof_read_flag = false;
     eof_write_flag = false;
@@ -94,6 +204,17 @@ namespace Arc {
                          int blocks) {
     bufs_n = 0;
     bufs = NULL;
+    region = NULL;
+    region_size = 0;
+    region_mapped = false;
+    ring_mode = false;
+    ring_read_handle = -1;
+    ring_write_handle = -1;
+    ring_head = 0;
+    ring_tail = 0;
+    ring_waiters = 0;
+    checksum_threads = 0;
+    checksum_exit = false;
     set_counter = 0;
     eof_read_flag = false;
     eof_write_flag = false;
@@ -131,6 +252,7 @@ namespace Arc {
   void DataBuffer::eof_read(bool eof_) {
     lock.lock();
     if (eof_) {
+      checksum_drain();
       for (std::list<checksum_desc>::iterator itCheckSum = checksums.begin();
            itCheckSum != checksums.end(); itCheckSum++) {
         if (itCheckSum->sum) itCheckSum->sum->end();
@@ -138,6 +260,7 @@ namespace Arc {
     }
     eof_read_flag = eof_;
     cond.broadcast();
+    ring_cond.broadcast();
     lock.unlock();
   }
 
@@ -145,6 +268,7 @@ namespace Arc {
     lock.lock();
     eof_write_flag = eof_;
     cond.broadcast();
+    ring_cond.broadcast();
     lock.unlock();
   }
 
@@ -157,6 +281,7 @@ namespace Arc {
     // error_read_flag=error_;
     if (error_) {
       if (!(error_write_flag || error_transfer_flag)) error_read_flag = true;
+      checksum_abort();
       for (std::list<checksum_desc>::iterator itCheckSum = checksums.begin();
            itCheckSum != checksums.end(); itCheckSum++) {
         if (itCheckSum->sum) itCheckSum->sum->end();
@@ -166,6 +291,7 @@ namespace Arc {
       error_read_flag = false;
     }
     cond.broadcast();
+    ring_cond.broadcast();
     lock.unlock();
   }
 
@@ -179,6 +305,7 @@ namespace Arc {
       error_write_flag = false;
     }
     cond.broadcast();
+    ring_cond.broadcast();
     lock.unlock();
   }
 
@@ -235,6 +362,10 @@ namespace Arc {
   }
 
   bool DataBuffer::cond_wait() {
+    return cond_wait(cond);
+  }
+
+  bool DataBuffer::cond_wait(Glib::Cond& c) {
     // Wait for any event
     int tmp = set_counter;
     bool eof_read_flag_tmp = eof_read_flag;
@@ -245,6 +376,10 @@ namespace Arc {
       if (!speed.transfer()) {
         if ((!(error_read_flag || error_write_flag)) &&
             (!(eof_read_flag && eof_write_flag))) {
+          if (!error_transfer_flag) {
+            cond.broadcast();
+            ring_cond.broadcast();
+          }
           error_transfer_flag = true;
         }
       }
@@ -263,17 +398,18 @@ namespace Arc {
       Glib::TimeVal stime;
       stime.assign_current_time();
       // Using timeout to workaround lost signal
-      err = cond.timed_wait(lock, stime + t);
+      err = c.timed_wait(lock, stime + t);
     }
     return true;
   }
 
   bool DataBuffer::for_read() {
     if (bufs == NULL) return false;
+    if (ring_mode) return ring_can_read();
     lock.lock();
     for (int i = 0; i < bufs_n; i++) {
       if ((!bufs[i].taken_for_read) && (!bufs[i].taken_for_write) &&
-          (bufs[i].used == 0)) {
+          (bufs[i].used == 0) && (!checksum_wanted(i))) {
         lock.unlock();
         return true;
       }
@@ -283,6 +419,7 @@ namespace Arc {
   }
 
   bool DataBuffer::for_read(int& handle, unsigned int& length, bool wait) {
+    if (ring_mode) return ring_for_read(handle, length, wait);
     lock.lock();
     if (bufs == NULL) {
       lock.unlock();
@@ -295,13 +432,16 @@ namespace Arc {
       }
       for (int i = 0; i < bufs_n; i++) {
         if ((!bufs[i].taken_for_read) && (!bufs[i].taken_for_write) &&
-            (bufs[i].used == 0)) {
+            (bufs[i].used == 0) && (!checksum_wanted(i))) {
           if (bufs[i].start == NULL) {
-            bufs[i].start = (char*)malloc(bufs[i].size);
-            if (bufs[i].start == NULL) continue;
+            void *addr = NULL;
+            if (posix_memalign(&addr, DATABUFFER_CACHE_LINE,
+                               bufs[i].size) != 0) continue;
+            bufs[i].start = (char*)addr;
           }
           handle = i;
           bufs[i].taken_for_read = true;
+          bufs[i].cksum_len = 0;
           length = bufs[i].size;
           cond.broadcast();
           lock.unlock();
@@ -309,6 +449,11 @@ namespace Arc {
         }
       }
       /* suitable block not found - wait for changes or quit */
+      if (checksum_stalled()) {
+        /* all buffers wait for data which can't arrive */
+        checksum_giveup();
+        continue;
+      }
       if (eof_write_flag) { /* writing side quited, no need to wait */
         lock.unlock();
         return false;
@@ -341,6 +486,7 @@ namespace Arc {
 
   bool DataBuffer::is_read(int handle, unsigned int length,
                            unsigned long long int offset) {
+    if (ring_mode) return ring_is_read(handle, length, offset);
     lock.lock();
     if (bufs == NULL) {
       lock.unlock();
@@ -363,19 +509,26 @@ namespace Arc {
     bufs[handle].offset = offset;
     if ((offset + length) > eof_pos)
       eof_pos = offset + length;
-    /* checksum on the fly */
-    for (std::list<checksum_desc>::iterator itCheckSum = checksums.begin();
-         itCheckSum != checksums.end(); itCheckSum++) {
-      if ((itCheckSum->sum != NULL) && (offset == itCheckSum->offset)) {
-        for (int i = handle; i < bufs_n; i++) {
-          if (bufs[i].used != 0) {
-            if (bufs[i].offset == itCheckSum->offset) {
-              itCheckSum->sum->add(bufs[i].start, bufs[i].used);
-              itCheckSum->offset += bufs[i].used;
-              i = -1;
-              itCheckSum->ready = true;
-            } else if (itCheckSum->offset < bufs[i].offset) {
-              itCheckSum->ready = false;
+    if (checksum_threads > 0) {
+      /* checksums are computed by own threads */
+      bufs[handle].cksum_len = length;
+      bufs[handle].cksum_offset = offset;
+      if (length != 0) checksum_cond.broadcast();
+    } else {
+      /* checksum on the fly */
+      for (std::list<checksum_desc>::iterator itCheckSum = checksums.begin();
+           itCheckSum != checksums.end(); itCheckSum++) {
+        if ((itCheckSum->sum != NULL) && (offset == itCheckSum->offset)) {
+          for (int i = handle; i < bufs_n; i++) {
+            if (bufs[i].used != 0) {
+              if (bufs[i].offset == itCheckSum->offset) {
+                itCheckSum->sum->add(bufs[i].start, bufs[i].used);
+                itCheckSum->offset += bufs[i].used;
+                i = -1;
+                itCheckSum->ready = true;
+              } else if (itCheckSum->offset < bufs[i].offset) {
+                itCheckSum->ready = false;
+              }
             }
           }
         }
@@ -389,6 +542,7 @@ namespace Arc {
   bool DataBuffer::for_write() {
     if (bufs == NULL)
       return false;
+    if (ring_mode) return ring_can_write();
     lock.lock();
     for (int i = 0; i < bufs_n; i++) {
       if ((!bufs[i].taken_for_read) && (!bufs[i].taken_for_write) &&
@@ -405,6 +559,7 @@ namespace Arc {
      return false in case of failure, or eof + no buffers claimed for read */
   bool DataBuffer::for_write(int& handle, unsigned int& length,
                              unsigned long long int& offset, bool wait) {
+    if (ring_mode) return ring_for_write(handle, length, offset, wait);
     lock.lock();
     if (bufs == NULL) {
       lock.unlock();
@@ -432,11 +587,14 @@ namespace Arc {
       }
       if (handle != -1) {
         bool keep_buffers = false;
-        for (std::list<checksum_desc>::iterator itCheckSum = checksums.begin();
-             itCheckSum != checksums.end(); itCheckSum++) {
-          if ((!itCheckSum->ready) && (bufs[handle].offset >= itCheckSum->offset)) {
-            keep_buffers = true;
-            break;
+        /* checksum threads keep buffers by themselves */
+        if (checksum_threads == 0) {
+          for (std::list<checksum_desc>::iterator itCheckSum = checksums.begin();
+               itCheckSum != checksums.end(); itCheckSum++) {
+            if ((!itCheckSum->ready) && (bufs[handle].offset >= itCheckSum->offset)) {
+              keep_buffers = true;
+              break;
+            }
           }
         }
 
@@ -506,6 +664,7 @@ namespace Arc {
   }
 
   bool DataBuffer::is_written(int handle) {
+    if (ring_mode) return ring_is_written(handle);
     lock.lock();
     if (bufs == NULL) {
       lock.unlock();
@@ -534,6 +693,7 @@ namespace Arc {
   }
 
   bool DataBuffer::is_notwritten(int handle) {
+    if (ring_mode) return ring_is_notwritten(handle);
     lock.lock();
     if (bufs == NULL) {
       lock.unlock();
@@ -554,6 +714,11 @@ namespace Arc {
   }
 
   char* DataBuffer::operator[](int block) {
+    if (ring_mode) {
+      /* buffers do not move while ring is in use */
+      if ((block < 0) || (block >= bufs_n)) return NULL;
+      return bufs[block].start;
+    }
     lock.lock();
     if ((block < 0) || (block >= bufs_n)) {
       lock.unlock();
@@ -566,16 +731,30 @@ namespace Arc {
 
   bool DataBuffer::wait_any() {
     lock.lock();
+    /* Ring progress is reported only to registered waiters */
+    bool ring = ring_mode;
+    if (ring) g_atomic_int_inc(&ring_waiters);
     bool res = cond_wait();
+    if (ring) g_atomic_int_add(&ring_waiters, -1);
     lock.unlock();
     return res;
   }
 
   bool DataBuffer::wait_used() {
     lock.lock();
+    if (ring_mode) {
+      while (!ring_idle()) {
+        if (!ring_wait(&DataBuffer::ring_idle)) {
+          lock.unlock();
+          return false;
+        }
+      }
+      lock.unlock();
+      return true;
+    }
     for (int i = 0; i < bufs_n; i++) {
       if ((bufs[i].taken_for_read) || (bufs[i].taken_for_write) ||
-          (bufs[i].used != 0)) {
+          (bufs[i].used != 0) || checksum_wanted(i)) {
         if (!cond_wait()) {
           lock.unlock();
           return false;
@@ -589,6 +768,16 @@ namespace Arc {
 
   bool DataBuffer::wait_for_read() {
     lock.lock();
+    if (ring_mode) {
+      while (!ring_read_free()) {
+        if (!ring_wait(&DataBuffer::ring_read_free)) {
+          lock.unlock();
+          return false;
+        }
+      }
+      lock.unlock();
+      return true;
+    }
     for (int i = 0; i < bufs_n; i++) {
       if (bufs[i].taken_for_read) {
         if (!cond_wait()) {
@@ -604,6 +793,16 @@ namespace Arc {
 
   bool DataBuffer::wait_for_write() {
     lock.lock();
+    if (ring_mode) {
+      while (!ring_write_free()) {
+        if (!ring_wait(&DataBuffer::ring_write_free)) {
+          lock.unlock();
+          return false;
+        }
+      }
+      lock.unlock();
+      return true;
+    }
     for (int i = 0; i < bufs_n; i++) {
       if (bufs[i].taken_for_write) {
         if (!cond_wait()) {
@@ -668,4 +867,395 @@ namespace Arc {
     return size;
   }
 
+  DataBuffer::checksum_desc::checksum_desc(CheckSum *sum)
+    : sum(sum),
+      offset(0),
+      ready(true),
+      combinable(sum ? sum->combinable() : false),
+      busy(false) {}
+
+  void DataBuffer::checksum_thread(void *arg) {
+    ((DataBuffer*)arg)->checksum_worker();
+  }
+
+  void DataBuffer::checksum_start(int threads) {
+    checksum_exit = false;
+    for (int n = 0; n < threads; n++) {
+      ++checksum_threads;
+      if (!CreateThreadFunction(&checksum_thread, this)) {
+        /* remaining checksums computed on the fly if none started */
+        --checksum_threads;
+        break;
+      }
+    }
+  }
+
+  void DataBuffer::checksum_stop() {
+    if (checksum_threads <= 0) return;
+    checksum_exit = true;
+    checksum_cond.broadcast();
+    while (checksum_threads > 0) cond.wait(lock);
+    checksum_exit = false;
+  }
+
+  void DataBuffer::checksum_clear() {
+    for (std::list<checksum_desc>::iterator itCheckSum = checksums.begin();
+         itCheckSum != checksums.end(); itCheckSum++) {
+      for (std::map<unsigned long long int, checksum_part>::iterator part =
+             itCheckSum->parts.begin(); part != itCheckSum->parts.end(); ++part) {
+        if (part->second.sum) delete part->second.sum;
+      }
+      itCheckSum->parts.clear();
+    }
+  }
+
+  bool DataBuffer::checksum_wanted(int n) const {
+    if (checksum_threads <= 0) return false;
+    if (bufs[n].cksum_len == 0) return false;
+    unsigned long long int offset = bufs[n].cksum_offset;
+    for (std::list<checksum_desc>::const_iterator itCheckSum = checksums.begin();
+         itCheckSum != checksums.end(); itCheckSum++) {
+      if ((itCheckSum->sum == NULL) || (!itCheckSum->ready)) continue;
+      if (offset < itCheckSum->offset) continue; /* already passed */
+      if (itCheckSum->combinable) {
+        std::map<unsigned long long int, checksum_part>::const_iterator part =
+          itCheckSum->parts.find(offset);
+        if ((part != itCheckSum->parts.end()) && (part->second.sum != NULL))
+          continue; /* computed, waiting to be combined */
+      }
+      return true;
+    }
+    return false;
+  }
+
+  bool DataBuffer::checksum_pick(int& n, std::list<checksum_desc*>& work) {
+    for (n = 0; n < bufs_n; n++) {
+      if (bufs[n].cksum_len == 0) continue;
+      unsigned long long int offset = bufs[n].cksum_offset;
+      for (std::list<checksum_desc>::iterator itCheckSum = checksums.begin();
+           itCheckSum != checksums.end(); itCheckSum++) {
+        if ((itCheckSum->sum == NULL) || (!itCheckSum->ready)) continue;
+        if (itCheckSum->combinable) {
+          if (offset < itCheckSum->offset) continue;
+          if (itCheckSum->parts.find(offset) != itCheckSum->parts.end()) continue;
+        } else {
+          if (itCheckSum->busy) continue;
+          if (offset != itCheckSum->offset) continue;
+        }
+        work.push_back(&(*itCheckSum));
+      }
+      if (!work.empty()) return true;
+    }
+    return false;
+  }
+
+  bool DataBuffer::checksum_progress() {
+    for (std::list<checksum_desc>::iterator itCheckSum = checksums.begin();
+         itCheckSum != checksums.end(); itCheckSum++) {
+      if (itCheckSum->busy) return true;
+      for (std::map<unsigned long long int, checksum_part>::iterator part =
+             itCheckSum->parts.begin(); part != itCheckSum->parts.end(); ++part) {
+        if (part->second.sum == NULL) return true;
+      }
+    }
+    int n;
+    std::list<checksum_desc*> work;
+    return checksum_pick(n, work);
+  }
+
+  bool DataBuffer::checksum_stalled() {
+    if (checksum_threads <= 0) return false;
+    for (int i = 0; i < bufs_n; i++) {
+      /* taken buffer may bring missing data */
+      if (bufs[i].taken_for_read) return false;
+      /* buffer not needed by checksums will be released */
+      if (!checksum_wanted(i)) return false;
+    }
+    return !checksum_progress();
+  }
+
+  void DataBuffer::checksum_giveup() {
+    for (std::list<checksum_desc>::iterator itCheckSum = checksums.begin();
+         itCheckSum != checksums.end(); itCheckSum++) {
+      if (itCheckSum->combinable) continue;
+      itCheckSum->ready = false;
+    }
+    cond.broadcast();
+  }
+
+  void DataBuffer::checksum_abort() {
+    if (checksum_threads <= 0) return;
+    for (std::list<checksum_desc>::iterator itCheckSum = checksums.begin();
+         itCheckSum != checksums.end(); itCheckSum++) {
+      itCheckSum->ready = false;
+    }
+    cond.broadcast();
+    /* threads may still be adding to checksum objects */
+    while (checksum_progress()) cond.wait(lock);
+  }
+
+  void DataBuffer::checksum_drain() {
+    for (;;) {
+      bool wanted = false;
+      for (int i = 0; i < bufs_n; i++) {
+        if (checksum_wanted(i)) {
+          wanted = true;
+          break;
+        }
+      }
+      if (!wanted) break;
+      if (!checksum_progress()) {
+        /* data missing and won't arrive anymore */
+        checksum_giveup();
+        break;
+      }
+      cond.wait(lock);
+    }
+  }
+
+  void DataBuffer::checksum_worker() {
+    lock.lock();
+    for (;;) {
+      if (checksum_exit) break;
+      int n;
+      std::list<checksum_desc*> work;
+      if (!checksum_pick(n, work)) {
+        checksum_cond.wait(lock);
+        continue;
+      }
+      char *start = bufs[n].start;
+      unsigned int length = bufs[n].cksum_len;
+      unsigned long long int offset = bufs[n].cksum_offset;
+      /* claim work so that buffer is kept and nobody else takes it */
+      for (std::list<checksum_desc*>::iterator w = work.begin();
+           w != work.end(); ++w) {
+        if ((*w)->combinable) {
+          (*w)->parts[offset] = checksum_part(length);
+        } else {
+          (*w)->busy = true;
+        }
+      }
+      lock.unlock();
+      std::list<CheckSum*> sums;
+      for (std::list<checksum_desc*>::iterator w = work.begin();
+           w != work.end(); ++w) {
+        if ((*w)->combinable) {
+          CheckSum *part = (*w)->sum->clone();
+          if (part) part->add(start, length);
+          sums.push_back(part);
+        } else {
+          (*w)->sum->add(start, length);
+          sums.push_back(NULL);
+        }
+      }
+      lock.lock();
+      std::list<CheckSum*>::iterator sum = sums.begin();
+      for (std::list<checksum_desc*>::iterator w = work.begin();
+           w != work.end(); ++w, ++sum) {
+        checksum_desc& cs = **w;
+        if (!cs.combinable) {
+          cs.offset += length;
+          cs.busy = false;
+          continue;
+        }
+        if ((!cs.ready) || (*sum == NULL)) {
+          cs.ready = false;
+          if (*sum) delete *sum;
+          cs.parts.erase(offset);
+          continue;
+        }
+        cs.parts[offset].sum = *sum;
+        /* append parts which follow already combined data */
+        while (!cs.parts.empty()) {
+          std::map<unsigned long long int, checksum_part>::iterator part =
+            cs.parts.begin();
+          if (part->first < cs.offset) {
+            /* overlapping data can't be combined */
+            cs.ready = false;
+            break;
+          }
+          if ((part->first != cs.offset) || (part->second.sum == NULL)) break;
+          if (!cs.sum->combine(*(part->second.sum))) cs.ready = false;
+          cs.offset += part->second.length;
+          delete part->second.sum;
+          cs.parts.erase(part);
+        }
+      }
+      /* buffers may be released and next data may be processed */
+      cond.broadcast();
+      checksum_cond.broadcast();
+    }
+    --checksum_threads;
+    cond.broadcast();
+    lock.unlock();
+  }
+
+  bool DataBuffer::ring_can_read() const {
+    /* counters may wrap - only their difference matters */
+    unsigned int filled = (unsigned int)g_atomic_int_get(&ring_head) -
+                          (unsigned int)g_atomic_int_get(&ring_tail);
+    return (filled < (unsigned int)bufs_n);
+  }
+
+  bool DataBuffer::ring_can_write() const {
+    return (g_atomic_int_get(&ring_head) != g_atomic_int_get(&ring_tail));
+  }
+
+  bool DataBuffer::ring_read_free() const {
+    return (g_atomic_int_get(&ring_read_handle) == -1);
+  }
+
+  bool DataBuffer::ring_write_free() const {
+    return (g_atomic_int_get(&ring_write_handle) == -1);
+  }
+
+  bool DataBuffer::ring_idle() const {
+    return ring_read_free() && ring_write_free() && (!ring_can_write());
+  }
+
+  void DataBuffer::ring_notify() {
+    /* Waiters register before checking state of ring under lock. So
+       either they see the change made before this call or they are
+       already registered and will get signal. */
+    if (g_atomic_int_get(&ring_waiters) == 0) return;
+    lock.lock();
+    ring_cond.broadcast();
+    cond.broadcast(); /* for wait_any() */
+    lock.unlock();
+  }
+
+  bool DataBuffer::ring_wait(bool (DataBuffer::*ready)() const) {
+    g_atomic_int_inc(&ring_waiters);
+    bool res = true;
+    if (!(this->*ready)()) res = cond_wait(ring_cond);
+    g_atomic_int_add(&ring_waiters, -1);
+    return res;
+  }
+
+  bool DataBuffer::ring_for_read(int& handle, unsigned int& length,
+                                 bool wait) {
+    if (bufs == NULL) return false;
+    if (!ring_read_free()) return false; /* one buffer per side */
+    for (int spin = 0;; ++spin) {
+      if (error()) return false;
+      if (ring_can_read()) {
+        /* head is modified only by this side */
+        handle = (unsigned int)g_atomic_int_get(&ring_head) % bufs_n;
+        length = bufs[handle].size;
+        g_atomic_int_set(&ring_read_handle, handle);
+        return true;
+      }
+      if (eof_write_flag) return false; /* writing side quited */
+      if (!wait) return false;
+      if (spin < DATABUFFER_RING_SPIN) {
+        /* other side is probably just about to release buffer */
+        Glib::Thread::yield();
+        continue;
+      }
+      lock.lock();
+      bool res = true;
+      if (!eof_write_flag) res = ring_wait(&DataBuffer::ring_can_read);
+      lock.unlock();
+      if (!res) return false;
+    }
+    return false;
+  }
+
+  bool DataBuffer::ring_is_read(int handle, unsigned int length,
+                                unsigned long long int offset) {
+    if (bufs == NULL) return false;
+    if ((handle < 0) || (handle != g_atomic_int_get(&ring_read_handle)))
+      return false;
+    if (length > bufs[handle].size) return false;
+    if (length != 0) {
+      bufs[handle].used = length;
+      bufs[handle].offset = offset;
+      if ((offset + length) > eof_pos)
+        eof_pos = offset + length;
+      /* checksum on the fly - data pass ring in order, so checksum
+         can't be computed if anything is missing */
+      for (std::list<checksum_desc>::iterator itCheckSum = checksums.begin();
+           itCheckSum != checksums.end(); itCheckSum++) {
+        if (itCheckSum->sum == NULL) continue;
+        if (itCheckSum->ready && (offset == itCheckSum->offset)) {
+          itCheckSum->sum->add(bufs[handle].start, length);
+          itCheckSum->offset += length;
+        } else {
+          itCheckSum->ready = false;
+        }
+      }
+    }
+    g_atomic_int_set(&ring_read_handle, -1);
+    /* publish buffer only after its content and description are stored */
+    if (length != 0) g_atomic_int_inc(&ring_head);
+    ring_notify();
+    return true;
+  }
+
+  bool DataBuffer::ring_for_write(int& handle, unsigned int& length,
+                                  unsigned long long int& offset,
+                                  bool wait) {
+    if (bufs == NULL) return false;
+    if (!ring_write_free()) return false; /* one buffer per side */
+    for (int spin = 0;; ++spin) {
+      if (error()) return false;
+      if (ring_can_write()) {
+        /* tail is modified only by this side */
+        handle = (unsigned int)g_atomic_int_get(&ring_tail) % bufs_n;
+        length = bufs[handle].used;
+        offset = bufs[handle].offset;
+        g_atomic_int_set(&ring_write_handle, handle);
+        return true;
+      }
+      if (eof_read_flag) {
+        /* last buffer may be published just before eof is set */
+        if (ring_can_write()) continue;
+        return false;
+      }
+      if (!wait) return false;
+      if (spin < DATABUFFER_RING_SPIN) {
+        Glib::Thread::yield();
+        continue;
+      }
+      lock.lock();
+      bool res = true;
+      if (!eof_read_flag) res = ring_wait(&DataBuffer::ring_can_write);
+      lock.unlock();
+      if (!res) return false;
+    }
+    return false;
+  }
+
+  bool DataBuffer::ring_is_written(int handle) {
+    if (bufs == NULL) return false;
+    if ((handle < 0) || (handle != g_atomic_int_get(&ring_write_handle)))
+      return false;
+    /* speed control - shared with waiting loops hence under lock */
+    lock.lock();
+    if (!speed.transfer(bufs[handle].used))
+      if ((!(error_read_flag || error_write_flag)) &&
+          (!(eof_read_flag && eof_write_flag))) {
+        error_transfer_flag = true;
+        cond.broadcast();
+        ring_cond.broadcast();
+    }
+    lock.unlock();
+    bufs[handle].used = 0;
+    bufs[handle].offset = 0;
+    g_atomic_int_set(&ring_write_handle, -1);
+    g_atomic_int_inc(&ring_tail);
+    ring_notify();
+    return true;
+  }
+
+  bool DataBuffer::ring_is_notwritten(int handle) {
+    if (bufs == NULL) return false;
+    if ((handle < 0) || (handle != g_atomic_int_get(&ring_write_handle)))
+      return false;
+    /* buffer stays in ring and will be given out again */
+    g_atomic_int_set(&ring_write_handle, -1);
+    ring_notify();
+    return true;
+  }
+
 } // namespace Arc
@@ -3,6 +3,9 @@
 #ifndef __ARC_DATABUFFER_H__
 #define __ARC_DATABUFFER_H__
 
+#include <list>
+#include <map>
+
 #include <arc/Thread.h>
 #include <arc/data/DataSpeed.h>
 
@@ -13,6 +16,14 @@ namespace Arc {
   /// Represents set of buffers.
   /**
    * This class is used during data transfer using DataPoint classes.
+   *
+   * Checksums are computed by separate threads while buffers wait to be
+   * emptied. Checksums which can be combined (see CheckSum::combinable())
+   * are computed for every buffer independently and in parallel, hence
+   * data may arrive in any order. Other checksums need data in order and
+   * buffers are kept till missing data arrive. If that would block
+   * transfer such checksum is abandoned and checksum_valid() reports false.
+   * In ring mode checksums are computed by reading side.
    * \ingroup data
    * \headerfile DataBuffer.h arc/data/DataBuffer.h
    */
@@ -37,6 +48,10 @@ namespace Arc {
       unsigned int used;
       /// offset in file or similar, has meaning only for application
       unsigned long long int offset;
+      /// amount of information to be passed to checksum computation
+      unsigned int cksum_len;
+      /// offset of that information
+      unsigned long long int cksum_offset;
     } buf_desc;
     /// amount of data passed through buffer (including current stored).
     /// computed using offset and size. gaps are ignored.
@@ -57,19 +72,109 @@ namespace Arc {
     bool error_transfer_flag;
     /// wait for any change of buffers' status
     bool cond_wait();
+    /// same for specified condition
+    bool cond_wait(Glib::Cond& c);
+    /// true if buffers are handed over as single producer/single consumer ring
+    bool ring_mode;
+    /// memory holding all buffers if allocated at once
+    char *region;
+    /// size of region
+    unsigned long long int region_size;
+    /// true if region is mapped with huge pages
+    bool region_mapped;
+    /// buffer taken by reading side in ring mode, -1 if none
+    volatile int ring_read_handle;
+    /// buffer taken by writing side in ring mode, -1 if none
+    volatile int ring_write_handle;
+    /// Number of buffers filled and emptied in ring mode. Counters are
+    /// modified only by reading and writing side respectively and are
+    /// placed in separate cache lines to avoid false sharing.
+    char ring_pad_head[64];
+    volatile int ring_head;
+    char ring_pad_tail[64];
+    volatile int ring_tail;
+    char ring_pad_end[64];
+    /// number of threads waiting for progress of ring
+    volatile int ring_waiters;
+    /// condition used for waiting for progress of ring
+    Glib::Cond ring_cond;
+    /// ring mode counterparts of public methods
+    bool ring_for_read(int& handle, unsigned int& length, bool wait);
+    bool ring_is_read(int handle, unsigned int length,
+                      unsigned long long int offset);
+    bool ring_for_write(int& handle, unsigned int& length,
+                        unsigned long long int& offset, bool wait);
+    bool ring_is_written(int handle);
+    bool ring_is_notwritten(int handle);
+    /// ring has buffer which can be filled or emptied
+    bool ring_can_read() const;
+    bool ring_can_write() const;
+    /// no buffer is taken by reading or writing side respectively
+    bool ring_read_free() const;
+    bool ring_write_free() const;
+    /// no buffer is taken or filled
+    bool ring_idle() const;
+    /// wake up threads waiting for progress of ring
+    void ring_notify();
+    /// wait for progress of ring unless ready already, must be called
+    /// with lock held
+    bool ring_wait(bool (DataBuffer::*ready)() const);
+    /// release all buffers
+    void release();
+    /// checksum of part of data computed independently
+    class checksum_part {
+     public:
+      checksum_part(unsigned long long int length = 0)
+        : length(length),
+          sum(NULL) {}
+      unsigned long long int length;
+      /// NULL while being computed
+      CheckSum *sum;
+    };
     /// internal class with pointer to object to compute checksum
     class checksum_desc {
      public:
-      checksum_desc(CheckSum *sum)
-        : sum(sum),
-          offset(0),
-          ready(true) {}
+      checksum_desc(CheckSum *sum);
       CheckSum *sum;
       unsigned long long int offset;
       bool ready;
+      /// parts can be computed independently and combined
+      bool combinable;
+      /// sum is being updated outside of lock
+      bool busy;
+      /// parts following offset, indexed by their offset
+      std::map<unsigned long long int, checksum_part> parts;
     };
     /// checksums to be computed in this buffer
     std::list<checksum_desc> checksums;
+    /// number of running threads computing checksums
+    int checksum_threads;
+    /// request for checksum threads to exit
+    bool checksum_exit;
+    /// signals checksum threads about new data
+    Glib::Cond checksum_cond;
+    /// checksum thread entry point
+    static void checksum_thread(void *arg);
+    void checksum_worker();
+    /// start and stop checksum threads, must be called with lock held
+    void checksum_start(int threads);
+    void checksum_stop();
+    /// buffer holds data not yet passed to some checksum
+    bool checksum_wanted(int n) const;
+    /// find buffer and checksums which can process it now
+    bool checksum_pick(int& n, std::list<checksum_desc*>& work);
+    /// some checksum is being computed or can be computed now
+    bool checksum_progress();
+    /// computation can't proceed without releasing buffers
+    bool checksum_stalled();
+    /// stop computing checksums which need data in order
+    void checksum_giveup();
+    /// stop computing all checksums and wait for threads to leave them
+    void checksum_abort();
+    /// wait till all filled buffers are passed to checksums
+    void checksum_drain();
+    /// drop computed parts
+    void checksum_clear();
 
   public:
     /// This object controls transfer speed
@@ -104,6 +209,34 @@ namespace Arc {
      */
     bool set(CheckSum *cksum = NULL, unsigned int size = 1048576,
              int blocks = 3);
+    /// Reinitialize buffers with different parameters and handling mode.
+    /**
+     * In ring mode buffers are handed from reading to writing side in
+     * order through lock-free ring. Ring mode may be used only if there
+     * is a single thread filling buffers and a single thread emptying
+     * them, each side holds at most one buffer at a time and data is
+     * read in order of offsets. Checksum objects must be added before
+     * transfer starts. All buffers are allocated at once and are aligned
+     * to cache line.
+     * \param cksum object which will compute checksum. Should not be
+     * destroyed until DataBuffer itself.
+     * \param size size of every buffer in bytes.
+     * \param blocks number of buffers.
+     * \param ring true to use ring mode.
+     * \param hugepages true to try to back buffers with huge pages. If
+     * huge pages are not available ordinary memory is used.
+     * \return true if buffers were successfully initialized
+     * \since Added in 6.9.0.
+     */
+    bool set(CheckSum *cksum, unsigned int size, int blocks,
+             bool ring, bool hugepages = false);
+    /// Returns true if buffers are handled in ring mode.
+    /**
+     * \since Added in 6.9.0.
+     */
+    bool ring() const {
+      return ring_mode;
+    }
     /// Add a checksum object which will compute checksum of buffer.
     /**
      * \param cksum object which will compute checksum. Should not be
@@ -35,6 +35,10 @@
 
 namespace Arc {
 
+  // Ring buffer hands blocks over cheaply, so having more of them smooths
+  // out jitter of storage on both sides.
+  static const int ring_buffer_min_num = 8;
+
   static void transfer_cb(unsigned long long int bytes_transferred) {
     fprintf (stderr, "\r%llu kB                  \r", bytes_transferred / 1024);
   }
@@ -53,6 +57,10 @@ namespace Arc {
       default_min_average_speed(0),
       default_max_inactivity_time(300),
       show_progress(NULL),
+      default_buffer_size(1048576),
+      default_buffer_num(1),
+      ring_buffer(true),
+      ring_buffer_hugepages(false),
       cancelled(false) {}
 
   DataMover::~DataMover() {
@@ -460,10 +468,12 @@ namespace Arc {
       long long int bufsize;
       int bufnum;
       /* tune buffers */
-      bufsize = 1048576; /* have reasonable buffer size */
+      bufsize = default_buffer_size; /* have reasonable buffer size */
       bool seekable = destination.WriteOutOfOrder();
       source.ReadOutOfOrder(seekable);
-      bufnum = 1;
+      bufnum = default_buffer_num;
+      if (bufnum < 1)
+        bufnum = 1;
       if (source.BufSize() > bufsize)
         bufsize = source.BufSize();
       if (destination.BufSize() > bufsize)
@@ -475,6 +485,13 @@ namespace Arc {
           bufnum = destination.BufNum();
       }
       bufnum = bufnum * 2;
+      /* local files are read and written sequentially by single thread
+         each, which is what ring buffer needs */
+      bool ring = ring_buffer &&
+                  (source.CurrentLocation().Protocol() == "file") &&
+                  (destination.CurrentLocation().Protocol() == "file");
+      if (ring && (bufnum < ring_buffer_min_num))
+        bufnum = ring_buffer_min_num;
       logger.msg(VERBOSE, "Creating buffer: %lli x %i", bufsize, bufnum);
 
       // Checksum logic:
@@ -524,7 +541,8 @@ namespace Arc {
       }
 
       /* create buffer and tune speed control */
-      buffer.set(&crc, bufsize, bufnum);
+      buffer.set(&crc, bufsize, bufnum, ring, ring_buffer_hugepages);
+      if (buffer.ring()) logger.msg(VERBOSE, "Using ring buffer");
       if (!buffer) logger.msg(WARNING, "Buffer creation failed !");
       buffer.speed.set_min_speed(min_speed, min_speed_time);
       buffer.speed.set_min_average_speed(min_average_speed);
@@ -37,6 +37,10 @@ namespace Arc {
     time_t default_max_inactivity_time;
     DataSpeed::show_progress_t show_progress;
     std::string preferred_pattern;
+    unsigned long long int default_buffer_size;
+    int default_buffer_num;
+    bool ring_buffer;
+    bool ring_buffer_hugepages;
     bool cancelled;
     /// For safe destruction of object, Transfer() holds this lock and
     /// destructor waits until the lock can be obtained
@@ -181,6 +185,32 @@ namespace Arc {
     void set_default_max_inactivity_time(time_t max_inactivity_time) {
       default_max_inactivity_time = max_inactivity_time;
     }
+    /// Set size and number of blocks in buffer used for transfer.
+    /**
+     * Source and destination may request bigger buffer. Number of blocks
+     * is doubled if source and destination support transfer out of order.
+     * Defaults are 1 MiB and 1 block.
+     * \param size minimal size of every block in bytes
+     * \param num minimal number of blocks
+     * \since Added in 6.9.0.
+     */
+    void set_default_buffer(unsigned long long int size, int num) {
+      default_buffer_size = size;
+      default_buffer_num = num;
+    }
+    /// Use lock-free ring buffer for transfers between local files.
+    /**
+     * Ring buffer is used only if both source and destination are files
+     * because their data points fill and empty buffer sequentially in
+     * single thread. Enabled by default. See DataBuffer::set().
+     * \param ring true to use ring buffer
+     * \param hugepages true to back ring buffer with huge pages if possible
+     * \since Added in 6.9.0.
+     */
+    void set_ring_buffer(bool ring, bool hugepages = false) {
+      ring_buffer = ring;
+      ring_buffer_hugepages = hugepages;
+    }
     /// Set function which is called every second during the transfer
     void set_progress_indicator(DataSpeed::show_progress_t func = NULL) {
       show_progress = func;
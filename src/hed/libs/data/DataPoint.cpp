@@ -104,10 +104,34 @@ namespace Arc {
     return DataStatus::Success;
   }
 
+  DataStatus DataPoint::PrepareReading(const std::list<DataPoint*>& urls,
+                                       unsigned int& wait_time,
+                                       std::list<DataStatus>& results) {
+    return DataStatus(DataStatus::UnimplementedError, EOPNOTSUPP);
+  }
+
   DataStatus DataPoint::FinishReading(bool error) {
     return DataStatus::Success;
   }
 
+  DataStatus DataPoint::FinishReading(const std::list<DataPoint*>& urls,
+                                      bool error,
+                                      std::list<DataStatus>& results) {
+    return DataStatus(DataStatus::UnimplementedError, EOPNOTSUPP);
+  }
+
+  DataStatus DataPoint::PostRegister(const std::list<DataPoint*>& urls,
+                                     bool replication,
+                                     std::list<DataStatus>& results) {
+    return DataStatus(DataStatus::UnimplementedError, EOPNOTSUPP);
+  }
+
+  DataStatus DataPoint::PreUnregister(const std::list<DataPoint*>& urls,
+                                      bool replication,
+                                      std::list<DataStatus>& results) {
+    return DataStatus(DataStatus::UnimplementedError, EOPNOTSUPP);
+  }
+
   DataStatus DataPoint::FinishWriting(bool error) {
     return DataStatus::Success;
   }
@@ -249,6 +249,31 @@ namespace Arc {
     virtual DataStatus PrepareReading(unsigned int timeout,
                                       unsigned int& wait_time);
 
+    /// Prepare several DataPoints for reading.
+    /**
+     * Bulk version of PrepareReading() for protocols which can prepare
+     * many files with one request. The protocols and hosts of all the
+     * DataPoints in urls must be the same and the same as this DataPoint's
+     * protocol and host, and this method can be called on any of the urls,
+     * for example urls.front()->PrepareReading(urls, wait_time, results).
+     * Bulk preparation is always asynchronous: DataPoints which are not yet
+     * prepared get ReadPrepareWait in results and this method should be
+     * called again later with those DataPoints to poll for status. Calling
+     * this method with an empty list can be used to check whether the
+     * protocol supports bulk preparation. The default implementation
+     * returns UnimplementedError.
+     * \param urls List of DataPoints to prepare
+     * \param wait_time If any DataPoint is still being prepared, a hint for
+     * how long to wait before a subsequent call may be given in wait_time.
+     * \param results Status of preparation of each DataPoint in urls, in
+     * the same order as urls
+     * \return success if the request for preparation could be made. The
+     * status of each DataPoint must be checked in results.
+     */
+    virtual DataStatus PrepareReading(const std::list<DataPoint*>& urls,
+                                      unsigned int& wait_time,
+                                      std::list<DataStatus>& results);
+
     /// Prepare DataPoint for writing.
     /**
      * This method should be implemented by protocols which require
@@ -335,6 +360,22 @@ namespace Arc {
      */
     virtual DataStatus FinishReading(bool error = false);
 
+    /// Finish reading from several URLs.
+    /**
+     * Bulk version of FinishReading(). The same restrictions on urls apply
+     * as for bulk PrepareReading(), and calling with an empty list can be
+     * used to check whether the protocol supports bulk release. The default
+     * implementation returns UnimplementedError.
+     * \param urls List of DataPoints to finish reading from
+     * \param error If true then action is taken depending on the error.
+     * \param results Status of each DataPoint in urls, in the same order
+     * as urls
+     * \return success if the DataPoints could be processed
+     */
+    virtual DataStatus FinishReading(const std::list<DataPoint*>& urls,
+                                     bool error,
+                                     std::list<DataStatus>& results);
+
     /// Finish writing to the URL.
     /**
      * Must be called after transfer of physical file has completed if
@@ -553,6 +594,25 @@ namespace Arc {
      */
     virtual DataStatus PostRegister(bool replication) = 0;
 
+    /// Index service post-registration of several files.
+    /**
+     * Bulk version of PostRegister() for index services which can register
+     * many files with one call. The protocols and hosts of all the
+     * DataPoints in urls must be the same and the same as this DataPoint's
+     * protocol and host. Calling with an empty list can be used to check
+     * whether the index service supports bulk registration. The default
+     * implementation returns UnimplementedError.
+     * \param urls List of DataPoints to register
+     * \param replication if true, the files are being replicated between
+     * two locations registered in Indexing Service under the same name.
+     * \param results Status of registration of each DataPoint in urls, in
+     * the same order as urls
+     * \return success if the registration request could be made
+     */
+    virtual DataStatus PostRegister(const std::list<DataPoint*>& urls,
+                                    bool replication,
+                                    std::list<DataStatus>& results);
+
     /// Index service pre-unregistration.
     /**
      * Should be called if file transfer failed. It removes changes made
@@ -563,6 +623,22 @@ namespace Arc {
      */
     virtual DataStatus PreUnregister(bool replication) = 0;
 
+    /// Index service pre-unregistration of several files.
+    /**
+     * Bulk version of PreUnregister(). The same restrictions on urls apply
+     * as for bulk PostRegister(). The default implementation returns
+     * UnimplementedError.
+     * \param urls List of DataPoints to unregister
+     * \param replication if true, the files are being replicated between
+     * two locations registered in Indexing Service under the same name.
+     * \param results Status of each DataPoint in urls, in the same order
+     * as urls
+     * \return success if the unregistration request could be made
+     */
+    virtual DataStatus PreUnregister(const std::list<DataPoint*>& urls,
+                                     bool replication,
+                                     std::list<DataStatus>& results);
+
     /// Index service unregistration.
     /**
      * Remove information about file registered in indexing service.
@@ -24,6 +24,7 @@
 #include <arc/Utils.h>
 
 #include "FileCache.h"
+#include "FileCacheIndex.h"
 
 namespace Arc {
 
@@ -228,6 +229,7 @@ namespace Arc {
     struct stat fileStat;
     if (FileStat(filename, &fileStat, true)) {
       available = true;
+      if (!delete_first) _indexAccess(url, fileStat);
     }
     else if (errno != ENOENT) {
       // this is ok, we will download again
@@ -275,6 +277,9 @@ namespace Arc {
     if (_urls_unlocked.find(url) == _urls_unlocked.end()) {
 
       std::string filename(File(url));
+      // record new file before releasing it to others
+      struct stat fileStat;
+      if (FileStat(filename, &fileStat, false)) _indexAccess(url, fileStat);
       // delete the lock
       FileLock lock(filename);
       if (!lock.release()) {
@@ -309,6 +314,7 @@ namespace Arc {
       logger.msg(ERROR, "Error removing cache file %s: %s", filename, StrError(errno));
       return false;
     }
+    _indexRemoval(url);
 
     // delete the lock file last
     if (!lock.release()) {
@@ -446,6 +452,8 @@ namespace Arc {
 
     // Hard link is created so release any locks on the cache file
     if (holding_lock) {
+      // Stop() will not be called for this file
+      _indexAccess(url, fileStat);
       FileLock lock(cache_file, CACHE_LOCK_TIMEOUT);
       if (!lock.release()) {
         logger.msg(WARNING, "Failed to release lock on cache file %s", cache_file);
@@ -472,6 +480,7 @@ namespace Arc {
         logger.msg(WARNING, "Cache file %s was modified while linking, must start again", cache_file);
         return _cleanFilesAndReturnFalse(hard_link_file, try_again);
       }
+      _indexAccess(url, fileStat);
     }
 
     // make necessary dirs for the soft link
@@ -851,6 +860,25 @@ namespace Arc {
     return space;
   }
 
+  void FileCache::_indexAccess(const std::string& url, const struct stat& fileStat) {
+    std::map <std::string, struct CacheParameters>::iterator iter = _cache_map.find(url);
+    if (iter == _cache_map.end()) return;
+    // nothing is written to read-only caches
+    for (std::vector<struct CacheParameters>::const_iterator i = _readonly_caches.begin(); i != _readonly_caches.end(); ++i) {
+      if (i->cache_path == iter->second.cache_path) return;
+    }
+    // index is only a hint for cache cleaning, so failure is not critical
+    if (!FileCacheIndex::Accessed(iter->second.cache_path, _getHash(url), fileStat))
+      logger.msg(VERBOSE, "Failed to record access to cache file %s in index", File(url));
+  }
+
+  void FileCache::_indexRemoval(const std::string& url) {
+    std::map <std::string, struct CacheParameters>::iterator iter = _cache_map.find(url);
+    if (iter == _cache_map.end()) return;
+    if (!FileCacheIndex::Removed(iter->second.cache_path, _getHash(url)))
+      logger.msg(VERBOSE, "Failed to record removal of cache file %s in index", File(url));
+  }
+
   bool FileCache::_cleanFilesAndReturnFalse(const std::string& hard_link_file,
                                             bool& locked) {
     if (!FileDelete(hard_link_file)) logger.msg(ERROR, "Failed to clean up file %s: %s", hard_link_file, StrError(errno));
@@ -7,6 +7,7 @@
 #include <vector>
 #include <map>
 #include <set>
+#include <sys/stat.h>
 #include <arc/DateTime.h>
 #include <arc/Logger.h>
 
@@ -123,6 +124,10 @@ namespace Arc {
     float _getCacheInfo(const std::string& path) const;
     /// For cleaning up after a cache file was locked during Link()
     bool _cleanFilesAndReturnFalse(const std::string& hard_link_file, bool& locked);
+    /// Record in cache index that cache file for url was created or used.
+    void _indexAccess(const std::string& url, const struct stat& fileStat);
+    /// Record in cache index that cache file for url was deleted.
+    void _indexRemoval(const std::string& url);
 
     /// Logger for messages
     static Logger logger;
@@ -0,0 +1,356 @@
+// -*- indent-tabs-mode: nil -*-
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <list>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+
+#include <arc/StringConv.h>
+#include <arc/Utils.h>
+
+#include "FileCacheIndex.h"
+
+namespace Arc {
+
+  const std::string FileCacheIndex::INDEX_FILE = "cache.index";
+
+  // How many times to retry if journal is being replaced
+  #define INDEX_APPEND_ATTEMPTS (10)
+  // Size of journal which is never compacted
+  #define INDEX_COMPACT_MIN (1024*1024)
+  // Estimated size of one record
+  #define INDEX_RECORD_SIZE (80)
+
+  Logger FileCacheIndex::logger(Logger::getRootLogger(), "FileCacheIndex");
+
+  static bool same_file(int h, const std::string& fname, struct stat& hst) {
+    struct stat fst;
+    if (::fstat(h, &hst) != 0) return false;
+    if (::stat(fname.c_str(), &fst) != 0) return false;
+    return (hst.st_dev == fst.st_dev) && (hst.st_ino == fst.st_ino);
+  }
+
+  static bool has_suffix(const std::string& name, const std::string& suffix) {
+    if (name.length() < suffix.length()) return false;
+    return (name.compare(name.length() - suffix.length(), suffix.length(), suffix) == 0);
+  }
+
+  FileCacheIndex::FileCacheIndex(const std::string& path)
+    : cache_path(path), size(0), offset(0), file_dev(0), file_ino(0) {
+    fname = cache_path + "/" + INDEX_FILE;
+  }
+
+  FileCacheIndex::~FileCacheIndex() {
+  }
+
+  bool FileCacheIndex::Append(const std::string& cache_path, const std::string& rec) {
+    std::string fname = cache_path + "/" + INDEX_FILE;
+    for (int attempt = 0; attempt < INDEX_APPEND_ATTEMPTS; ++attempt) {
+      int h = ::open(fname.c_str(), O_WRONLY | O_CREAT | O_APPEND, S_IRUSR | S_IWUSR);
+      if (h == -1) {
+        logger.msg(VERBOSE, "Failed to open cache index %s: %s", fname, StrError(errno));
+        return false;
+      }
+      // Appending records is shared operation. Exclusive lock is only
+      // taken while index is compacted and replaced.
+      if (::flock(h, LOCK_SH) != 0) {
+        ::close(h);
+        return false;
+      }
+      struct stat hst;
+      if (same_file(h, fname, hst)) {
+        ssize_t l = ::write(h, rec.c_str(), rec.length());
+        ::close(h);
+        return (l == (ssize_t)rec.length());
+      }
+      // Index was replaced while waiting for lock
+      ::close(h);
+    }
+    return false;
+  }
+
+  bool FileCacheIndex::Accessed(const std::string& cache_path, const std::string& hash,
+                                const struct stat& st) {
+    std::string rec("A ");
+    rec += hash + " " + tostring(time(NULL)) + " " +
+           tostring((unsigned long long int)st.st_blocks * 512) + " " +
+           tostring((unsigned long long int)st.st_ino) + "\n";
+    return Append(cache_path, rec);
+  }
+
+  bool FileCacheIndex::Removed(const std::string& cache_path, const std::string& hash) {
+    return Append(cache_path, "D " + hash + "\n");
+  }
+
+  bool FileCacheIndex::Exists() const {
+    struct stat st;
+    return (::stat(fname.c_str(), &st) == 0);
+  }
+
+  void FileCacheIndex::Erase(const std::string& hash) {
+    std::map<std::string, Entry>::iterator e = entries.find(hash);
+    if (e == entries.end()) return;
+    size -= e->second.size;
+    entries.erase(e);
+  }
+
+  void FileCacheIndex::Update(const std::string& hash, const Entry& entry) {
+    std::map<std::string, Entry>::iterator e = entries.find(hash);
+    if (e == entries.end()) {
+      entries[hash] = entry;
+    } else {
+      size -= e->second.size;
+      e->second = entry;
+    }
+    size += entry.size;
+  }
+
+  void FileCacheIndex::Apply(const Record& rec) {
+    if (rec.type == 'D') {
+      Erase(rec.hash);
+      return;
+    }
+    Entry entry(rec.entry);
+    std::map<std::string, Entry>::iterator e = entries.find(rec.hash);
+    // Records from scan and from journal may come in any order
+    if ((e != entries.end()) && (e->second.atime > entry.atime)) entry.atime = e->second.atime;
+    Update(rec.hash, entry);
+  }
+
+  bool FileCacheIndex::ReadRecords(int h) {
+    if (::lseek(h, offset, SEEK_SET) != offset) return false;
+    std::string buf;
+    char chunk[65536];
+    for (;;) {
+      ssize_t l = ::read(h, chunk, sizeof(chunk));
+      if (l < 0) {
+        if (errno == EINTR) continue;
+        return false;
+      }
+      if (l == 0) break;
+      buf.append(chunk, l);
+      std::string::size_type start = 0;
+      for (;;) {
+        std::string::size_type end = buf.find('\n', start);
+        // Incomplete record is left for next reading
+        if (end == std::string::npos) break;
+        std::string line = buf.substr(start, end - start);
+        offset += (end - start) + 1;
+        start = end + 1;
+        std::list<std::string> fields;
+        tokenize(line, fields, " ");
+        Record rec;
+        bool good = false;
+        if ((fields.size() == 5) && (fields.front() == "A")) {
+          std::list<std::string>::iterator f = fields.begin();
+          rec.type = 'A';
+          rec.hash = *(++f);
+          unsigned long long int atime = 0;
+          unsigned long long int inode = 0;
+          good = stringto(*(++f), atime) &&
+                 stringto(*(++f), rec.entry.size) &&
+                 stringto(*(++f), inode);
+          rec.entry.atime = (time_t)atime;
+          rec.entry.inode = (ino_t)inode;
+        } else if ((fields.size() == 2) && (fields.front() == "D")) {
+          rec.type = 'D';
+          rec.hash = fields.back();
+          good = true;
+        }
+        if (!good) {
+          logger.msg(WARNING, "Skipping malformed record in cache index: %s", line);
+          continue;
+        }
+        Apply(rec);
+      }
+      buf.erase(0, start);
+    }
+    return true;
+  }
+
+  bool FileCacheIndex::Load() {
+    entries.clear();
+    size = 0;
+    offset = 0;
+    int h = ::open(fname.c_str(), O_RDONLY);
+    if (h == -1) {
+      if (errno != ENOENT) logger.msg(ERROR, "Failed to open cache index %s: %s", fname, StrError(errno));
+      return false;
+    }
+    struct stat st;
+    if (::fstat(h, &st) != 0) {
+      ::close(h);
+      return false;
+    }
+    file_dev = st.st_dev;
+    file_ino = st.st_ino;
+    bool r = ReadRecords(h);
+    ::close(h);
+    if (!r) {
+      logger.msg(ERROR, "Failed reading cache index %s", fname);
+      return false;
+    }
+    logger.msg(VERBOSE, "Cache index %s: %u files, %llu bytes", fname, (unsigned int)entries.size(), size);
+    return true;
+  }
+
+  bool FileCacheIndex::NeedsCompact() const {
+    if (offset < INDEX_COMPACT_MIN) return false;
+    return (offset > (off_t)(entries.size() * INDEX_RECORD_SIZE * 2));
+  }
+
+  bool FileCacheIndex::Scan(const std::string& dir, const std::string& prefix) {
+    DIR* d = ::opendir(dir.c_str());
+    if (!d) {
+      logger.msg(ERROR, "Failed to read directory %s: %s", dir, StrError(errno));
+      return false;
+    }
+    bool r = true;
+    for (;;) {
+      struct dirent* de = ::readdir(d);
+      if (!de) break;
+      std::string name(de->d_name);
+      if ((name == ".") || (name == "..")) continue;
+      if (has_suffix(name, ".lock") || has_suffix(name, ".meta")) continue;
+      std::string path = dir + "/" + name;
+      struct stat st;
+      if (::lstat(path.c_str(), &st) != 0) continue;
+      if (S_ISDIR(st.st_mode)) {
+        if (!Scan(path, prefix + name + "/")) r = false;
+        continue;
+      }
+      if (!S_ISREG(st.st_mode)) continue;
+      Record rec;
+      rec.type = 'A';
+      rec.hash = prefix + name;
+      rec.entry.atime = st.st_atime;
+      rec.entry.size = (unsigned long long int)st.st_blocks * 512;
+      rec.entry.inode = st.st_ino;
+      Apply(rec);
+    }
+    ::closedir(d);
+    return r;
+  }
+
+  bool FileCacheIndex::Rebuild() {
+    entries.clear();
+    size = 0;
+    // Existing journal is merged when storing result
+    offset = 0;
+    file_dev = 0;
+    file_ino = 0;
+    logger.msg(INFO, "Scanning cache %s to build index", cache_path);
+    return Scan(cache_path + "/data", "");
+  }
+
+  bool FileCacheIndex::Store() {
+    int h = ::open(fname.c_str(), O_RDWR | O_CREAT, S_IRUSR | S_IWUSR);
+    if (h == -1) {
+      logger.msg(ERROR, "Failed to open cache index %s: %s", fname, StrError(errno));
+      return false;
+    }
+    if (::flock(h, LOCK_EX) != 0) {
+      ::close(h);
+      return false;
+    }
+    struct stat st;
+    if (!same_file(h, fname, st)) {
+      // Replaced while waiting for lock. Other cleaner is running.
+      ::close(h);
+      return false;
+    }
+    // Pick up records written since index was read
+    if ((st.st_dev != file_dev) || (st.st_ino != file_ino)) offset = 0;
+    if (!ReadRecords(h)) {
+      ::close(h);
+      return false;
+    }
+    std::string tmpname = fname + ".tmp";
+    int th = ::open(tmpname.c_str(), O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+    if (th == -1) {
+      logger.msg(ERROR, "Failed to create cache index %s: %s", tmpname, StrError(errno));
+      ::close(h);
+      return false;
+    }
+    std::string buf;
+    off_t written = 0;
+    bool r = true;
+    for (std::map<std::string, Entry>::iterator e = entries.begin(); ; ++e) {
+      if (e != entries.end()) {
+        buf += "A " + e->first + " " + tostring((unsigned long long int)e->second.atime) + " " +
+               tostring(e->second.size) + " " + tostring((unsigned long long int)e->second.inode) + "\n";
+      }
+      if ((buf.length() >= 65536) || ((e == entries.end()) && !buf.empty())) {
+        ssize_t l = ::write(th, buf.c_str(), buf.length());
+        if (l != (ssize_t)buf.length()) {
+          r = false;
+          break;
+        }
+        written += l;
+        buf.clear();
+      }
+      if (e == entries.end()) break;
+    }
+    if (r && (::fsync(th) != 0)) r = false;
+    if (r) {
+      struct stat tst;
+      if (::fstat(th, &tst) != 0) r = false;
+      if (r && (::rename(tmpname.c_str(), fname.c_str()) != 0)) r = false;
+      if (r) {
+        file_dev = tst.st_dev;
+        file_ino = tst.st_ino;
+        offset = written;
+      }
+    }
+    ::close(th);
+    if (!r) {
+      logger.msg(ERROR, "Failed to write cache index %s: %s", tmpname, StrError(errno));
+      ::unlink(tmpname.c_str());
+    }
+    // Releasing lock on old file lets appenders detect replacement
+    ::close(h);
+    return r;
+  }
+
+  bool FileCacheIndex::InUse(std::set<ino_t>& inodes) const {
+    std::string job_dir = cache_path + "/joblinks";
+    DIR* d = ::opendir(job_dir.c_str());
+    if (!d) {
+      // No jobs have used this cache yet
+      if (errno == ENOENT) return true;
+      logger.msg(ERROR, "Failed to read directory %s: %s", job_dir, StrError(errno));
+      return false;
+    }
+    for (;;) {
+      struct dirent* de = ::readdir(d);
+      if (!de) break;
+      std::string name(de->d_name);
+      if ((name == ".") || (name == "..")) continue;
+      std::string path = job_dir + "/" + name;
+      DIR* jd = ::opendir(path.c_str());
+      if (!jd) continue;
+      for (;;) {
+        struct dirent* jde = ::readdir(jd);
+        if (!jde) break;
+        struct stat st;
+        if (::lstat((path + "/" + jde->d_name).c_str(), &st) != 0) continue;
+        if (S_ISREG(st.st_mode)) inodes.insert(st.st_ino);
+      }
+      ::closedir(jd);
+    }
+    ::closedir(d);
+    return true;
+  }
+
+} // namespace Arc
@@ -0,0 +1,137 @@
+// -*- indent-tabs-mode: nil -*-
+
+#ifndef FILE_CACHE_INDEX_H_
+#define FILE_CACHE_INDEX_H_
+
+#include <string>
+#include <map>
+#include <set>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <arc/Logger.h>
+
+namespace Arc {
+
+  /// Incremental index of files stored in a cache directory.
+  /**
+   * Every cache has a journal file in its top directory. FileCache appends
+   * a record to it whenever a cache file is created or accessed and when it
+   * is deleted. Appending is cheap and does not need to read the journal.
+   * The cache cleaner loads the journal into memory, which gives size and
+   * last access time of all cache files without walking the data directory,
+   * and after cleaning rewrites it in compact form.
+   *
+   * Records are lines of form
+   *   A <hash> <access time> <size> <inode>
+   *   D <hash>
+   * where hash is the path of the cache file relative to the data directory.
+   * Because records are never verified when written, the index may contain
+   * files which do not exist anymore. Users of the index must check the
+   * file before acting upon it.
+   */
+  class FileCacheIndex {
+   public:
+    /// Information about one cache file
+    struct Entry {
+      /// Time of last access recorded by FileCache
+      time_t atime;
+      /// Space occupied by file
+      unsigned long long int size;
+      /// Inode of file, used to find if it is linked by jobs
+      ino_t inode;
+    };
+
+    /// Name of journal file in cache directory
+    static const std::string INDEX_FILE;
+
+    /// Create index of cache at cache_path. Nothing is read until Load().
+    FileCacheIndex(const std::string& cache_path);
+    ~FileCacheIndex();
+
+    /// Append record about cache file being created or accessed.
+    /**
+     * To be called by processes using the cache. Failures are not critical
+     * and are only logged.
+     */
+    static bool Accessed(const std::string& cache_path, const std::string& hash,
+                         const struct stat& st);
+
+    /// Append record about cache file being deleted.
+    static bool Removed(const std::string& cache_path, const std::string& hash);
+
+    /// Returns true if journal exists for this cache.
+    bool Exists() const;
+
+    /// Read journal into memory. Returns false if it can't be read.
+    bool Load();
+
+    /// Build index by scanning whole data directory of cache.
+    /**
+     * This is expensive and is only needed if journal does not exist yet
+     * or is believed to be out of sync. The result is kept in memory and
+     * written out by Store().
+     */
+    bool Rebuild();
+
+    /// Write index in compact form replacing journal.
+    /**
+     * Records appended by other processes since Load() are merged in
+     * before writing.
+     */
+    bool Store();
+
+    /// Returns true if journal holds much more records than files.
+    bool NeedsCompact() const;
+
+    /// Remove file from index in memory.
+    void Erase(const std::string& hash);
+
+    /// Update information about file in memory.
+    void Update(const std::string& hash, const Entry& entry);
+
+    /// All indexed files.
+    const std::map<std::string, Entry>& Entries() const { return entries; };
+
+    /// Total size of indexed files.
+    unsigned long long int Size() const { return size; };
+
+    /// Collect inodes of files linked into per-job directories.
+    /**
+     * Such files are in use by jobs and must not be deleted. The per-job
+     * directories only hold files of active jobs, hence collecting them is
+     * much cheaper than checking every file in the cache.
+     */
+    bool InUse(std::set<ino_t>& inodes) const;
+
+   private:
+    struct Record {
+      char type;
+      std::string hash;
+      Entry entry;
+    };
+
+    std::string cache_path;
+    std::string fname;
+    std::map<std::string, Entry> entries;
+    unsigned long long int size;
+    /// Amount of journal processed so far
+    off_t offset;
+    dev_t file_dev;
+    ino_t file_ino;
+
+    static bool Append(const std::string& cache_path, const std::string& rec);
+    void Apply(const Record& rec);
+    bool ReadRecords(int h);
+    bool Scan(const std::string& dir, const std::string& prefix);
+
+    FileCacheIndex(FileCacheIndex const&);
+    FileCacheIndex& operator=(FileCacheIndex const&);
+
+    static Logger logger;
+  };
+
+} // namespace Arc
+
+#endif /*FILE_CACHE_INDEX_H_*/
@@ -0,0 +1,82 @@
+#include <iostream>
+#include <cstdlib>
+
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <arc/Logger.h>
+#include <arc/URL.h>
+#include <arc/UserConfig.h>
+#include <arc/DateTime.h>
+#include <arc/data/DataHandle.h>
+#include <arc/data/DataMover.h>
+
+// Compares speed of local file copies done by DataMover with ordinary
+// and ring buffer.
+
+static double copy(Arc::DataMover& mover, const Arc::URL& src_url,
+                   const Arc::URL& dest_url) {
+  Arc::UserConfig usercfg;
+  Arc::DataHandle src_handle(src_url, usercfg);
+  Arc::DataHandle dest_handle(dest_url, usercfg);
+  Arc::FileCache cache;
+  Arc::URLMap map;
+  ::unlink(dest_url.Path().c_str());
+  Arc::Time start;
+  Arc::DataStatus result = mover.Transfer(*src_handle, *dest_handle, cache, map);
+  Arc::Period duration = Arc::Time() - start;
+  if (!result.Passed()) {
+    std::cerr << "Copy failed: " << std::string(result) << std::endl;
+    return -1;
+  }
+  return duration.GetPeriod() + duration.GetPeriodNanoseconds() / 1000000000.0;
+}
+
+int main(int argc, char** argv) {
+
+  Arc::LogStream logcerr(std::cerr);
+  logcerr.setFormat(Arc::ShortFormat);
+  Arc::Logger::getRootLogger().addDestination(logcerr);
+  Arc::Logger::getRootLogger().setThreshold(Arc::WARNING);
+
+  if ((argc < 3) || (argc > 6)) {
+    std::cerr << "Usage: copy_benchmark source_file destination_file [repetitions [block_size [blocks]]]" << std::endl;
+    return 1;
+  }
+
+  Arc::URL src_url(argv[1]);
+  Arc::URL dest_url(argv[2]);
+  if ((src_url.Protocol() != "file") || (dest_url.Protocol() != "file")) {
+    std::cerr << "Source and destination must be local files" << std::endl;
+    return 1;
+  }
+  struct stat st;
+  if (::stat(src_url.Path().c_str(), &st) != 0) {
+    std::cerr << "Can't stat source file" << std::endl;
+    return 1;
+  }
+  int repetitions = (argc > 3) ? atoi(argv[3]) : 3;
+  unsigned long long int block_size = (argc > 4) ? strtoull(argv[4], NULL, 10) : 1048576;
+  int blocks = (argc > 5) ? atoi(argv[5]) : 1;
+
+  const char* modes[] = { "default", "ring", "ring+hugepages" };
+  for (int mode = 0; mode < 3; ++mode) {
+    Arc::DataMover mover;
+    mover.retry(false);
+    mover.set_default_buffer(block_size, blocks);
+    mover.set_ring_buffer(mode > 0, mode > 1);
+    double total_time = 0;
+    unsigned long long int total_size = 0;
+    for (int n = 0; n < repetitions; ++n) {
+      double t = copy(mover, src_url, dest_url);
+      if (t < 0) return 1;
+      total_time += t;
+      total_size += st.st_size;
+    }
+    if (total_time <= 0) total_time = 0.000001;
+    std::cout << modes[mode] << ": " << (total_size / total_time / 1000000000.0)
+              << " GB/s" << std::endl;
+  }
+  ::unlink(dest_url.Path().c_str());
+  return 0;
+}
@@ -0,0 +1,317 @@
+// -*- indent-tabs-mode: nil -*-
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <arc/CheckSum.h>
+#include <arc/Thread.h>
+
+#include "../DataBuffer.h"
+
+class DataBufferTest
+  : public CppUnit::TestFixture {
+
+  CPPUNIT_TEST_SUITE(DataBufferTest);
+  CPPUNIT_TEST(testTransfer);
+  CPPUNIT_TEST(testRingTransfer);
+  CPPUNIT_TEST(testRingHugePages);
+  CPPUNIT_TEST(testRingOneSide);
+  CPPUNIT_TEST(testRingError);
+  CPPUNIT_TEST(testParallelChecksum);
+  CPPUNIT_TEST_SUITE_END();
+
+public:
+  void testTransfer();
+  void testRingTransfer();
+  void testRingHugePages();
+  void testRingOneSide();
+  void testRingError();
+  void testParallelChecksum();
+
+private:
+  void transfer(bool ring, bool hugepages);
+  void parallel(Arc::CheckSumAny::type type);
+};
+
+// Size of blocks and amount of data passed through buffer. Last block is
+// intentionally incomplete.
+static const unsigned int block_size = 4096;
+static const unsigned long long int data_size = 1000 * 4096 + 123;
+
+static char data_byte(unsigned long long int offset) {
+  return (char)((offset * 7) % 251);
+}
+
+struct Side {
+  Arc::DataBuffer* buffer;
+  unsigned long long int transferred;
+  bool corrupted;
+};
+
+static void reader(void* arg) {
+  Side& side = *(Side*)arg;
+  unsigned long long int offset = 0;
+  while (offset < data_size) {
+    int h;
+    unsigned int l;
+    if (!side.buffer->for_read(h, l, true)) {
+      side.buffer->error_read(true);
+      break;
+    }
+    if (l > (data_size - offset)) l = data_size - offset;
+    char* buf = (*side.buffer)[h];
+    for (unsigned int n = 0; n < l; ++n) buf[n] = data_byte(offset + n);
+    side.buffer->is_read(h, l, offset);
+    offset += l;
+  }
+  side.transferred = offset;
+  side.buffer->eof_read(true);
+}
+
+static void writer(void* arg) {
+  Side& side = *(Side*)arg;
+  side.corrupted = false;
+  unsigned long long int expected = 0;
+  for (;;) {
+    int h;
+    unsigned int l;
+    unsigned long long int p;
+    if (!side.buffer->for_write(h, l, p, true)) {
+      if (!side.buffer->eof_read()) side.buffer->error_write(true);
+      break;
+    }
+    char* buf = (*side.buffer)[h];
+    if (p != expected) side.corrupted = true;
+    for (unsigned int n = 0; n < l; ++n) {
+      if (buf[n] != data_byte(p + n)) side.corrupted = true;
+    }
+    expected = p + l;
+    side.buffer->is_written(h);
+  }
+  side.transferred = expected;
+  side.buffer->eof_write(true);
+}
+
+// Several readers filling buffers in arbitrary order like multi-stream
+// protocols do.
+struct Streams {
+  Arc::DataBuffer* buffer;
+  Glib::Mutex lock;
+  unsigned long long int offset;
+  unsigned long long int written;
+  bool corrupted;
+};
+
+static void stream_reader(void* arg) {
+  Streams& streams = *(Streams*)arg;
+  for (;;) {
+    int h;
+    unsigned int l;
+    if (!streams.buffer->for_read(h, l, true)) {
+      streams.buffer->error_read(true);
+      break;
+    }
+    streams.lock.lock();
+    unsigned long long int offset = streams.offset;
+    if (l > (data_size - offset)) l = data_size - offset;
+    streams.offset += l;
+    streams.lock.unlock();
+    if (l == 0) {
+      streams.buffer->is_read(h, 0, 0);
+      break;
+    }
+    char* buf = (*streams.buffer)[h];
+    for (unsigned int n = 0; n < l; ++n) buf[n] = data_byte(offset + n);
+    // Delay some blocks so that later ones overtake them
+    if ((offset / block_size) % 3 == 0) Glib::Thread::yield();
+    streams.buffer->is_read(h, l, offset);
+  }
+}
+
+static void stream_writer(void* arg) {
+  Streams& streams = *(Streams*)arg;
+  for (;;) {
+    int h;
+    unsigned int l;
+    unsigned long long int p;
+    if (!streams.buffer->for_write(h, l, p, true)) {
+      if (!streams.buffer->eof_read()) streams.buffer->error_write(true);
+      break;
+    }
+    char* buf = (*streams.buffer)[h];
+    for (unsigned int n = 0; n < l; ++n) {
+      if (buf[n] != data_byte(p + n)) streams.corrupted = true;
+    }
+    streams.written += l;
+    streams.buffer->is_written(h);
+  }
+  streams.buffer->eof_write(true);
+}
+
+void DataBufferTest::transfer(bool ring, bool hugepages) {
+  Arc::Adler32Sum sum;
+  Arc::DataBuffer buffer;
+  CPPUNIT_ASSERT(buffer.set(&sum, block_size, 3, ring, hugepages));
+  CPPUNIT_ASSERT(buffer);
+  CPPUNIT_ASSERT_EQUAL(ring, buffer.ring());
+  CPPUNIT_ASSERT_EQUAL(block_size, buffer.buffer_size());
+
+  Arc::SimpleCounter counter;
+  Side rside = { &buffer, 0, false };
+  Side wside = { &buffer, 0, false };
+  CPPUNIT_ASSERT(Arc::CreateThreadFunction(&reader, &rside, &counter));
+  CPPUNIT_ASSERT(Arc::CreateThreadFunction(&writer, &wside, &counter));
+  counter.wait();
+
+  CPPUNIT_ASSERT(!buffer.error());
+  CPPUNIT_ASSERT(!wside.corrupted);
+  CPPUNIT_ASSERT_EQUAL(data_size, rside.transferred);
+  CPPUNIT_ASSERT_EQUAL(data_size, wside.transferred);
+  CPPUNIT_ASSERT_EQUAL(data_size, buffer.eof_position());
+  CPPUNIT_ASSERT(buffer.checksum_valid());
+
+  // Compare with checksum computed directly
+  Arc::Adler32Sum direct;
+  direct.start();
+  char buf[block_size];
+  for (unsigned long long int offset = 0; offset < data_size;) {
+    unsigned int l = block_size;
+    if (l > (data_size - offset)) l = data_size - offset;
+    for (unsigned int n = 0; n < l; ++n) buf[n] = data_byte(offset + n);
+    direct.add(buf, l);
+    offset += l;
+  }
+  direct.end();
+  char expected_sum[256];
+  char computed_sum[256];
+  direct.print(expected_sum, sizeof(expected_sum));
+  sum.print(computed_sum, sizeof(computed_sum));
+  CPPUNIT_ASSERT_EQUAL(std::string(expected_sum), std::string(computed_sum));
+}
+
+void DataBufferTest::testTransfer() {
+  transfer(false, false);
+}
+
+void DataBufferTest::testRingTransfer() {
+  transfer(true, false);
+}
+
+void DataBufferTest::testRingHugePages() {
+  // Falls back to ordinary memory if huge pages are not configured
+  transfer(true, true);
+}
+
+void DataBufferTest::testRingOneSide() {
+  Arc::DataBuffer buffer;
+  CPPUNIT_ASSERT(buffer.set(NULL, block_size, 2, true));
+  int h1, h2;
+  unsigned int l;
+  unsigned long long int p;
+  // Nothing to write yet
+  CPPUNIT_ASSERT(buffer.for_read());
+  CPPUNIT_ASSERT(!buffer.for_write());
+  CPPUNIT_ASSERT(!buffer.for_write(h1, l, p, false));
+  // Each side holds at most one buffer
+  CPPUNIT_ASSERT(buffer.for_read(h1, l, false));
+  CPPUNIT_ASSERT(!buffer.for_read(h2, l, false));
+  // Only taken buffer can be returned
+  CPPUNIT_ASSERT(!buffer.is_read(h1 + 1, 10, 0));
+  CPPUNIT_ASSERT(buffer.is_read(h1, 10, 0));
+  CPPUNIT_ASSERT(buffer.for_read(h2, l, false));
+  CPPUNIT_ASSERT(h1 != h2);
+  CPPUNIT_ASSERT(buffer.is_read(h2, 10, 10));
+  // Ring is full
+  CPPUNIT_ASSERT(!buffer.for_read());
+  CPPUNIT_ASSERT(!buffer.for_read(h2, l, false));
+  // Buffers are given out in order and not written one is given again
+  CPPUNIT_ASSERT(buffer.for_write(h2, l, p, false));
+  CPPUNIT_ASSERT_EQUAL(h1, h2);
+  CPPUNIT_ASSERT_EQUAL(0ULL, p);
+  CPPUNIT_ASSERT(buffer.is_notwritten(h2));
+  CPPUNIT_ASSERT(buffer.for_write(h2, l, p, false));
+  CPPUNIT_ASSERT_EQUAL(h1, h2);
+  CPPUNIT_ASSERT(buffer.is_written(h2));
+  CPPUNIT_ASSERT(buffer.for_write(h2, l, p, false));
+  CPPUNIT_ASSERT_EQUAL(10ULL, p);
+  CPPUNIT_ASSERT_EQUAL(10U, l);
+  CPPUNIT_ASSERT(buffer.is_written(h2));
+  CPPUNIT_ASSERT(buffer.wait_used());
+  // Empty buffer is not passed to writing side
+  CPPUNIT_ASSERT(buffer.for_read(h1, l, false));
+  CPPUNIT_ASSERT(buffer.is_read(h1, 0, 0));
+  CPPUNIT_ASSERT(!buffer.for_write());
+  buffer.eof_read(true);
+  CPPUNIT_ASSERT(!buffer.for_write(h2, l, p, true));
+}
+
+void DataBufferTest::testRingError() {
+  Arc::DataBuffer buffer;
+  CPPUNIT_ASSERT(buffer.set(NULL, block_size, 2, true));
+  Arc::SimpleCounter counter;
+  Side wside = { &buffer, 0, false };
+  CPPUNIT_ASSERT(Arc::CreateThreadFunction(&writer, &wside, &counter));
+  // Writer is blocked waiting for data and must be released by error
+  buffer.error_read(true);
+  CPPUNIT_ASSERT(counter.wait(10000));
+  CPPUNIT_ASSERT(buffer.error());
+  CPPUNIT_ASSERT(buffer.error_read());
+  int h;
+  unsigned int l;
+  CPPUNIT_ASSERT(!buffer.for_read(h, l, true));
+}
+
+void DataBufferTest::parallel(Arc::CheckSumAny::type type) {
+  Arc::CheckSumAny sum(type);
+  Arc::DataBuffer buffer;
+  CPPUNIT_ASSERT(buffer.set(&sum, block_size, 8));
+  Streams streams;
+  streams.buffer = &buffer;
+  streams.offset = 0;
+  streams.written = 0;
+  streams.corrupted = false;
+  Arc::SimpleCounter rcounter;
+  Arc::SimpleCounter wcounter;
+  for (int n = 0; n < 4; ++n) {
+    CPPUNIT_ASSERT(Arc::CreateThreadFunction(&stream_reader, &streams, &rcounter));
+  }
+  CPPUNIT_ASSERT(Arc::CreateThreadFunction(&stream_writer, &streams, &wcounter));
+  rcounter.wait();
+  buffer.eof_read(true);
+  wcounter.wait();
+
+  CPPUNIT_ASSERT(!buffer.error());
+  CPPUNIT_ASSERT(!streams.corrupted);
+  CPPUNIT_ASSERT_EQUAL(data_size, streams.written);
+  // Out of order data must not invalidate checksum
+  CPPUNIT_ASSERT(buffer.checksum_valid());
+
+  Arc::CheckSumAny direct(type);
+  direct.start();
+  char buf[block_size];
+  for (unsigned long long int offset = 0; offset < data_size;) {
+    unsigned int l = block_size;
+    if (l > (data_size - offset)) l = data_size - offset;
+    for (unsigned int n = 0; n < l; ++n) buf[n] = data_byte(offset + n);
+    direct.add(buf, l);
+    offset += l;
+  }
+  direct.end();
+  char expected_sum[256];
+  char computed_sum[256];
+  direct.print(expected_sum, sizeof(expected_sum));
+  sum.print(computed_sum, sizeof(computed_sum));
+  CPPUNIT_ASSERT_EQUAL(std::string(expected_sum), std::string(computed_sum));
+}
+
+void DataBufferTest::testParallelChecksum() {
+  // Combinable checksums
+  parallel(Arc::CheckSumAny::cksum);
+  parallel(Arc::CheckSumAny::adler32);
+  // Checksum which needs data in order
+  parallel(Arc::CheckSumAny::md5);
+}
+
+CPPUNIT_TEST_SUITE_REGISTRATION(DataBufferTest);
@@ -20,6 +20,7 @@
 #include <arc/FileAccess.h>
 
 #include "../FileCache.h"
+#include "../FileCacheIndex.h"
 
 class FileCacheTest
   : public CppUnit::TestFixture {
@@ -39,6 +40,7 @@ class FileCacheTest
   CPPUNIT_TEST(testConstructor);
   CPPUNIT_TEST(testBadConstructor);
   CPPUNIT_TEST(testInternal);
+  CPPUNIT_TEST(testIndex);
   CPPUNIT_TEST_SUITE_END();
 
 public:
@@ -60,6 +62,7 @@ public:
   void testConstructor();
   void testBadConstructor();
   void testInternal();
+  void testIndex();
 
 private:
   std::string _testroot;
@@ -947,6 +950,61 @@ void FileCacheTest::testInternal() {
   CPPUNIT_ASSERT(stat(testfile.c_str(), &fileStat) != 0);
 }
 
+void FileCacheTest::testIndex() {
+
+  // download file into cache
+  bool available = false;
+  bool is_locked = false;
+  CPPUNIT_ASSERT(_fc1->Start(_url, available, is_locked));
+  std::string cache_file(_fc1->File(_url));
+  std::string hash(cache_file.substr(_cache_data_dir.length() + 1));
+  CPPUNIT_ASSERT(_createFile(cache_file));
+  CPPUNIT_ASSERT(_fc1->Stop(_url));
+
+  // file is recorded in index
+  Arc::FileCacheIndex index(_cache_dir);
+  CPPUNIT_ASSERT(index.Exists());
+  CPPUNIT_ASSERT(index.Load());
+  CPPUNIT_ASSERT_EQUAL(1, (int)index.Entries().size());
+  CPPUNIT_ASSERT(index.Entries().find(hash) != index.Entries().end());
+  struct stat fileStat;
+  CPPUNIT_ASSERT_EQUAL(0, stat(cache_file.c_str(), &fileStat));
+  CPPUNIT_ASSERT_EQUAL(fileStat.st_ino, index.Entries().find(hash)->second.inode);
+  CPPUNIT_ASSERT_EQUAL((unsigned long long int)fileStat.st_blocks * 512, index.Size());
+
+  // linked file is in use
+  std::string soft_link = _session_dir + "/" + _jobid + "/file1";
+  bool try_again = false;
+  CPPUNIT_ASSERT(_fc1->Start(_url, available, is_locked));
+  CPPUNIT_ASSERT(available);
+  CPPUNIT_ASSERT(_fc1->Link(soft_link, _url, false, false, false, try_again));
+  std::set<ino_t> in_use;
+  CPPUNIT_ASSERT(index.InUse(in_use));
+  CPPUNIT_ASSERT(in_use.find(fileStat.st_ino) != in_use.end());
+  CPPUNIT_ASSERT(_fc1->Release());
+  in_use.clear();
+  CPPUNIT_ASSERT(index.InUse(in_use));
+  CPPUNIT_ASSERT(in_use.empty());
+
+  // compacted index keeps file
+  CPPUNIT_ASSERT(index.Store());
+  CPPUNIT_ASSERT(index.Load());
+  CPPUNIT_ASSERT_EQUAL(1, (int)index.Entries().size());
+
+  // deleted file is removed from index
+  CPPUNIT_ASSERT(_fc1->Start(_url, available, is_locked, true));
+  CPPUNIT_ASSERT(_fc1->StopAndDelete(_url));
+  CPPUNIT_ASSERT(index.Load());
+  CPPUNIT_ASSERT(index.Entries().empty());
+  CPPUNIT_ASSERT_EQUAL(0ULL, index.Size());
+
+  // index can be recreated from cache content
+  CPPUNIT_ASSERT(_createFile(cache_file));
+  CPPUNIT_ASSERT(index.Rebuild());
+  CPPUNIT_ASSERT_EQUAL(1, (int)index.Entries().size());
+  CPPUNIT_ASSERT(index.Entries().find(hash) != index.Entries().end());
+}
+
 bool FileCacheTest::_createFile(std::string filename, std::string text) {
 
   if (Arc::FileCreate(filename, text))
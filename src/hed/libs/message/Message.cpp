@@ -42,6 +42,14 @@ MessageContextElement* MessageContext::operator[](const std::string& id) {
   return i->second;
 }
 
+bool MessageContext::Buffered(void) const {
+  std::map<std::string,MessageContextElement*>::const_iterator i;
+  for(i=elements_.begin();i!=elements_.end();++i) {
+    if(i->second && i->second->Buffered()) return true;
+  };
+  return false;
+}
+
 Message::Message(long msg_ptr_addr) 
 {
     Message *msg = (Message *)msg_ptr_addr;
@@ -29,6 +29,9 @@ class MessageContextElement {
  public:
   MessageContextElement(void) { };
   virtual ~MessageContextElement(void) { };
+  /** Returns true if element holds input data which was already read
+    from connection but not processed yet. */
+  virtual bool Buffered(void) const { return false; };
 };
 
 /// Handler for content of message context.
@@ -45,6 +48,10 @@ class MessageContext {
     remembered by it and destroyed when this class is destroyed. */
   void Add(const std::string& name,MessageContextElement* element);
   MessageContextElement* operator[](const std::string& id);
+  /** Returns true if any element holds input data which was already
+    read from connection but not processed yet. Such connection must
+    be served again without waiting for more data to arrive. */
+  bool Buffered(void) const;
 };
 
 /// Handler for content of message auth* context.
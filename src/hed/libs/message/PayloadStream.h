@@ -91,6 +91,8 @@ class PayloadStream: virtual public PayloadStreamInterface {
   virtual Size_t Pos(void) const { return 0; };
   virtual Size_t Size(void) const { return 0; };
   virtual Size_t Limit(void) const { return 0; };
+  /** Returns handle this object is attached to. */
+  int GetHandle(void) const { return handle_; };
 };
 }
 #endif /* __ARC_PAYLOADSTREAM_H__ */
@@ -53,6 +53,24 @@ namespace Arc {
     Cleanup();
 
     logger_.msg(DEBUG, "JWSE::Input: token: %s", jwseCompact);
+    {
+      // Same token is usually presented repeatedly. Its validation is done only once.
+      std::string headerStr;
+      std::string contentStr;
+      int keyOrigin(NoKey);
+      if(JWSETokenCache::Instance().Get(jwseCompact, headerStr, contentStr, keyOrigin, signAlg_)) {
+        header_ = cJSON_Parse(headerStr.c_str());
+        content_ = cJSON_Parse(contentStr.c_str());
+        if(header_ && content_) {
+          logger_.msg(DEBUG, "JWSE::Input: token was validated before");
+          keyOrigin_ = static_cast<KeyOrigin>(keyOrigin);
+          valid_ = true;
+          return true;
+        }
+        Cleanup();
+        signAlg_.clear();
+      }
+    }
     char const* pos = jwseCompact.c_str();
     while(std::isspace(*pos) != 0) {
       if(*pos == '\0') return false;
@@ -190,6 +208,10 @@ namespace Arc {
         logger_.msg(DEBUG, "JWSE::Input: JWS: signature verification failed");
         return false;
       }
+      // Only tokens with limited lifetime are remembered
+      if(notAfter)
+        JWSETokenCache::Instance().Put(jwseCompact, joseStr, payload, keyOrigin_, signAlg_,
+                                       static_cast<time_t>(notAfter->valueint));
     } else {
       // JWE - not yet
       header_ = NULL;
@@ -0,0 +1,325 @@
+#include <cstdlib>
+#include <cstring>
+#include <time.h>
+
+#include <openssl/evp.h>
+
+#include <arc/Logger.h>
+#include <arc/Thread.h>
+#include <arc/StringConv.h>
+
+#include "otokens.h"
+#include "jwse_private.h"
+#include "openid_metadata.h"
+
+
+#if OPENSSL_VERSION_NUMBER < 0x10100000L
+static int EVP_PKEY_up_ref(EVP_PKEY *key) {
+  CRYPTO_add(&key->references,1,CRYPTO_LOCK_EVP_PKEY);
+  return 1;
+}
+#endif
+
+namespace Arc {
+
+  static Logger logger(Logger::getRootLogger(), "JWSECache");
+
+  // Time (seconds) before unknown key id may cause keys to be fetched again.
+  static const time_t KeyRefetchInterval = 60;
+
+  // Returns lifetime of fetched content according to Cache-Control header.
+  static time_t ResponseLifetime(HTTPClientInfo const& info) {
+    time_t lifetime = JWSEKeyCache::DefaultLifetime;
+    for(std::multimap<std::string,std::string>::const_iterator header = info.headers.find("HTTP:cache-control");
+                       (header != info.headers.end()) && (header->first == "HTTP:cache-control"); ++header) {
+      std::list<std::string> directives;
+      tokenize(header->second, directives, ",");
+      for(std::list<std::string>::iterator directive = directives.begin(); directive != directives.end(); ++directive) {
+        std::string name = lower(trim(*directive));
+        if((name == "no-cache") || (name == "no-store")) {
+          lifetime = JWSEKeyCache::MinLifetime;
+        } else if(name.compare(0, 8, "max-age=") == 0) {
+          long int maxAge = 0;
+          if(stringto(trim(name.substr(8), " \""), maxAge)) lifetime = maxAge;
+        }
+      }
+    }
+    if(lifetime < JWSEKeyCache::MinLifetime) lifetime = JWSEKeyCache::MinLifetime;
+    if(lifetime > JWSEKeyCache::MaxLifetime) lifetime = JWSEKeyCache::MaxLifetime;
+    return lifetime;
+  }
+
+  // Fetches metadata of issuer and keys referred by it.
+  static bool FetchIssuerKeys(std::string const& issuer, std::string& jwksUri,
+                              std::map<std::string,EVP_PKEY*>& keys, time_t& lifetime) {
+    OpenIDMetadata serviceMetadata;
+    HTTPClientInfo metadataInfo;
+    OpenIDMetadataFetcher metadataFetcher(issuer.c_str());
+    if(!metadataFetcher.Fetch(serviceMetadata, metadataInfo))
+      return false;
+    if(metadataInfo.code != 200)
+      return false;
+    char const * uri = serviceMetadata.JWKSURI();
+    if(!uri)
+      return false;
+    jwksUri = uri;
+
+    logger.msg(DEBUG, "JWSE::ExtractPublicKey: fetching jwl key from %s", jwksUri);
+    JWSEKeyHolderList keyList;
+    HTTPClientInfo keysInfo;
+    JWSEKeyFetcher keyFetcher(jwksUri.c_str());
+    if(!keyFetcher.Fetch(keyList, keysInfo))
+      return false;
+    if(keysInfo.code != 200)
+      return false;
+    for(JWSEKeyHolderList::iterator keyIt = keyList.begin(); keyIt != keyList.end(); ++keyIt) {
+      if(!(*keyIt) || !((*keyIt)->Id()) || !((*keyIt)->PublicKey())) continue;
+      EVP_PKEY* key = const_cast<EVP_PKEY*>((*keyIt)->PublicKey());
+      EVP_PKEY*& stored = keys[(*keyIt)->Id()];
+      if(stored) EVP_PKEY_free(stored);
+      EVP_PKEY_up_ref(key);
+      stored = key;
+    }
+    lifetime = ResponseLifetime(metadataInfo);
+    time_t keysLifetime = ResponseLifetime(keysInfo);
+    if(keysLifetime < lifetime) lifetime = keysLifetime;
+    return true;
+  }
+
+  static void FreeKeys(std::map<std::string,EVP_PKEY*>& keys) {
+    for(std::map<std::string,EVP_PKEY*>::iterator key = keys.begin(); key != keys.end(); ++key) {
+      if(key->second) EVP_PKEY_free(key->second);
+    }
+    keys.clear();
+  }
+
+  // Fetches keys of issuer without storing them.
+  static bool FindIssuerKey(std::string const& issuer, std::string const& kid, JWSEKeyHolder& key, bool& safe) {
+    std::string jwksUri;
+    std::map<std::string,EVP_PKEY*> keys;
+    time_t lifetime = 0;
+    bool result = false;
+    if(FetchIssuerKeys(issuer, jwksUri, keys, lifetime)) {
+      std::map<std::string,EVP_PKEY*>::iterator keyIt = keys.find(kid);
+      if(keyIt != keys.end()) {
+        EVP_PKEY_up_ref(keyIt->second);
+        key.Id(kid.c_str());
+        key.PublicKey(keyIt->second);
+        safe = (strncasecmp("https:", issuer.c_str(), 6) == 0) &&
+               (strncasecmp("https:", jwksUri.c_str(), 6) == 0);
+        result = true;
+      }
+    }
+    FreeKeys(keys);
+    return result;
+  }
+
+
+  JWSEKeyCache& JWSEKeyCache::Instance() {
+    // Never destroyed because refreshing threads may still be running at exit.
+    static JWSEKeyCache* instance = new JWSEKeyCache();
+    return *instance;
+  }
+
+  JWSEKeyCache::JWSEKeyCache() {
+  }
+
+  JWSEKeyCache::~JWSEKeyCache() {
+    for(std::map<std::string,Issuer>::iterator issuer = issuers_.begin(); issuer != issuers_.end(); ++issuer) {
+      FreeKeys(issuer->second.keys);
+    }
+  }
+
+  void JWSEKeyCache::Refresh(std::string const& issuer) {
+    std::string jwksUri;
+    std::map<std::string,EVP_PKEY*> keys;
+    time_t lifetime = 0;
+    bool result = FetchIssuerKeys(issuer, jwksUri, keys, lifetime);
+    Glib::Mutex::Lock lock(lock_);
+    Issuer& entry = issuers_[issuer];
+    time_t now = time(NULL);
+    if(result) {
+      FreeKeys(entry.keys);
+      entry.keys.swap(keys);
+      entry.jwksUri = jwksUri;
+      entry.valid = true;
+      entry.fetched = now;
+      entry.expires = now + lifetime;
+    } else {
+      FreeKeys(keys);
+      // Previously obtained keys are used till they expire.
+      if(!entry.valid || (entry.expires <= now)) {
+        logger.msg(WARNING, "Failed to obtain keys of issuer %s", issuer);
+        FreeKeys(entry.keys);
+        entry.jwksUri.clear();
+        entry.valid = false;
+        entry.fetched = now;
+        entry.expires = now + NegativeLifetime;
+      } else {
+        logger.msg(DEBUG, "Failed to refresh keys of issuer %s, using cached ones", issuer);
+      }
+    }
+    entry.fetching = false;
+    cond_.broadcast();
+  }
+
+  void JWSEKeyCache::Purge(time_t now) {
+    for(std::map<std::string,Issuer>::iterator issuer = issuers_.begin(); issuer != issuers_.end();) {
+      // Entries being fetched are referred by fetching thread
+      if(!issuer->second.fetching && (!issuer->second.valid || (issuer->second.expires <= now))) {
+        FreeKeys(issuer->second.keys);
+        issuers_.erase(issuer++);
+      } else {
+        ++issuer;
+      }
+    }
+  }
+
+  struct JWSEKeyCacheRefreshArg {
+    JWSEKeyCache* cache;
+    std::string issuer;
+  };
+
+  void JWSEKeyCache::RefreshThread(void* arg) {
+    JWSEKeyCacheRefreshArg* refreshArg = reinterpret_cast<JWSEKeyCacheRefreshArg*>(arg);
+    refreshArg->cache->Refresh(refreshArg->issuer);
+    delete refreshArg;
+  }
+
+  bool JWSEKeyCache::Find(std::string const& issuer, std::string const& kid, JWSEKeyHolder& key, bool& safe) {
+    Glib::Mutex::Lock lock(lock_);
+    bool refetched = false;
+    while(true) {
+      time_t now = time(NULL);
+      // Issuer comes from token which is not verified yet. So number of
+      // cached issuers is limited and failures are dropped first.
+      std::map<std::string,Issuer>::iterator entryIt = issuers_.find(issuer);
+      if(entryIt == issuers_.end()) {
+        // Entry was dropped while keys were being fetched
+        if(refetched)
+          return false;
+        if(issuers_.size() >= MaxIssuers) Purge(now);
+        if(issuers_.size() >= MaxIssuers) {
+          logger.msg(DEBUG, "Too many issuers cached, keys of issuer %s are not stored", issuer);
+          lock.release();
+          return FindIssuerKey(issuer, kid, key, safe);
+        }
+        entryIt = issuers_.insert(std::make_pair(issuer, Issuer())).first;
+      }
+      Issuer& entry = entryIt->second;
+      if(entry.expires <= now) {
+        // Nothing usable - wait for ongoing fetch or do it now.
+        if(!entry.fetching) {
+          entry.fetching = true;
+          lock.release();
+          Refresh(issuer);
+          lock.acquire();
+          refetched = true;
+        } else {
+          cond_.wait(lock_);
+        }
+        continue;
+      }
+      if(!entry.valid)
+        return false;
+      std::map<std::string,EVP_PKEY*>::iterator keyIt = entry.keys.find(kid);
+      if(keyIt == entry.keys.end()) {
+        // Issuer may have rotated keys. To protect against flood of tokens
+        // with bogus key ids keys are fetched again only occasionally.
+        if(refetched || entry.fetching || (now < (entry.fetched + KeyRefetchInterval)))
+          return false;
+        logger.msg(DEBUG, "Key %s is not known for issuer %s, fetching keys again", kid, issuer);
+        entry.fetching = true;
+        lock.release();
+        Refresh(issuer);
+        lock.acquire();
+        refetched = true;
+        continue;
+      }
+      // Refresh in background when content is about to expire.
+      if(!entry.fetching && (now >= (entry.fetched + (entry.expires - entry.fetched)*3/4))) {
+        JWSEKeyCacheRefreshArg* arg = new JWSEKeyCacheRefreshArg;
+        arg->cache = this;
+        arg->issuer = issuer;
+        entry.fetching = true;
+        if(!CreateThreadFunction(&RefreshThread, arg)) {
+          entry.fetching = false;
+          delete arg;
+        }
+      }
+      EVP_PKEY_up_ref(keyIt->second);
+      key.Id(kid.c_str());
+      key.PublicKey(keyIt->second);
+      safe = (strncasecmp("https:", issuer.c_str(), 6) == 0) &&
+             (strncasecmp("https:", entry.jwksUri.c_str(), 6) == 0);
+      return true;
+    }
+  }
+
+
+  JWSETokenCache& JWSETokenCache::Instance() {
+    static JWSETokenCache* instance = new JWSETokenCache();
+    return *instance;
+  }
+
+  JWSETokenCache::JWSETokenCache() {
+  }
+
+  JWSETokenCache::~JWSETokenCache() {
+  }
+
+  static std::string TokenDigest(std::string const& token) {
+    unsigned char digest[EVP_MAX_MD_SIZE];
+    unsigned int digestSize = 0;
+    if(EVP_Digest(token.c_str(), token.length(), digest, &digestSize, EVP_sha256(), NULL) != 1)
+      return "";
+    return std::string(reinterpret_cast<char const*>(digest), digestSize);
+  }
+
+  bool JWSETokenCache::Get(std::string const& token, std::string& header, std::string& content,
+                           int& keyOrigin, std::string& signAlg) {
+    std::string digest = TokenDigest(token);
+    if(digest.empty())
+      return false;
+    Glib::Mutex::Lock lock(lock_);
+    std::map<std::string,Token>::iterator item = tokens_.find(digest);
+    if(item == tokens_.end())
+      return false;
+    // Expired entries are left till they are pushed out by new ones
+    if(item->second.expires <= time(NULL))
+      return false;
+    header = item->second.header;
+    content = item->second.content;
+    keyOrigin = item->second.keyOrigin;
+    signAlg = item->second.signAlg;
+    return true;
+  }
+
+  void JWSETokenCache::Put(std::string const& token, std::string const& header, std::string const& content,
+                           int keyOrigin, std::string const& signAlg, time_t expires) {
+    time_t now = time(NULL);
+    if(expires > (now + MaxLifetime)) expires = now + MaxLifetime;
+    if(expires <= now)
+      return;
+    std::string digest = TokenDigest(token);
+    if(digest.empty())
+      return;
+    Glib::Mutex::Lock lock(lock_);
+    std::map<std::string,Token>::iterator item = tokens_.find(digest);
+    if(item == tokens_.end()) {
+      while((!order_.empty()) && (order_.size() >= MaxSize)) {
+        tokens_.erase(order_.front());
+        order_.pop_front();
+      }
+      item = tokens_.insert(std::make_pair(digest, Token())).first;
+      order_.push_back(digest);
+    }
+    item->second.header = header;
+    item->second.content = content;
+    item->second.keyOrigin = keyOrigin;
+    item->second.signAlg = signAlg;
+    item->second.expires = expires;
+  }
+
+}
+
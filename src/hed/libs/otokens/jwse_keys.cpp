@@ -290,27 +290,14 @@ namespace Arc {
       cJSON* issuerObj = cJSON_GetObjectItem(content_.Ptr(), ClaimNameIssuer);
       if(!issuerObj || (issuerObj->type != cJSON_String))
         return false;
-      bool keyProtocolSafe = true;
-      if(strncasecmp("https:", issuerObj->valuestring, 6) != 0) keyProtocolSafe = false;
-
-      OpenIDMetadata serviceMetadata;
-      OpenIDMetadataFetcher metadataFetcher(issuerObj->valuestring);
-      if(!metadataFetcher.Fetch(serviceMetadata))
-        return false;
-      char const * jwksUri = serviceMetadata.JWKSURI();
-      if(strncasecmp("https:", jwksUri, 6) != 0) keyProtocolSafe = false;
-
-      logger_.msg(DEBUG, "JWSE::ExtractPublicKey: fetching jwl key from %s", jwksUri);
-      JWSEKeyFetcher keyFetcher(jwksUri);
-      JWSEKeyHolderList keys;
-      if(!keyFetcher.Fetch(keys))
-        return false;
-      for(JWSEKeyHolderList::iterator keyIt = keys.begin(); keyIt != keys.end(); ++keyIt) {
-        if(strcmp(kidObject->valuestring, (*keyIt)->Id()) == 0) {
-          keyOrigin_ = keyProtocolSafe ? ExternalSafeKey : ExternalUnsafeKey;
-          key_ = *keyIt;
-          return true;
-        }
+      // Issuer metadata and keys are shared by all tokens of same issuer
+      // and are obtained through process-wide cache.
+      bool keyProtocolSafe = false;
+      AutoPointer<JWSEKeyHolder> key(new JWSEKeyHolder());
+      if(JWSEKeyCache::Instance().Find(issuerObj->valuestring, kidObject->valuestring, *key, keyProtocolSafe)) {
+        keyOrigin_ = keyProtocolSafe ? ExternalSafeKey : ExternalUnsafeKey;
+        key_ = key;
+        return true;
       }
     } else {
       logger_.msg(ERROR, "JWSE::ExtractPublicKey: no supported key");
@@ -450,6 +437,10 @@ namespace Arc {
 
   bool JWSEKeyFetcher::Fetch(JWSEKeyHolderList& keys) {
     HTTPClientInfo info;
+    return Fetch(keys, info);
+  }
+
+  bool JWSEKeyFetcher::Fetch(JWSEKeyHolderList& keys, HTTPClientInfo& info) {
     PayloadRaw request;
     PayloadRawInterface* response(NULL);
     MCC_Status status = client_.process("GET", &request, &info, &response);
@@ -1,5 +1,10 @@
 #include <openssl/x509.h>
 
+#include <map>
+#include <list>
+
+#include <glibmm/thread.h>
+
 #include <arc/URL.h>
 #include <arc/communication/ClientInterface.h>
 
@@ -52,10 +57,90 @@ namespace Arc {
    public:
     JWSEKeyFetcher(char const * endpoint_url);
     bool Fetch(JWSEKeyHolderList& keys);
+    bool Fetch(JWSEKeyHolderList& keys, HTTPClientInfo& info);
    private:
     Arc::URL url_;
     ClientHTTP client_;
   };
 
+  //! Process-wide cache of keys published by token issuers.
+  /*! Issuer metadata and set of keys referred by it are fetched once and kept
+      for time specified by Cache-Control of responses. Before they expire they
+      are refreshed in background so token validation does not wait for issuer.
+      Failed fetches are remembered for short time too. */
+  class JWSEKeyCache {
+   public:
+    //! Time (seconds) to keep keys if issuer does not specify it.
+    static const time_t DefaultLifetime = 60*60;
+    //! Keys are kept for at least and at most this time (seconds).
+    static const time_t MinLifetime = 60;
+    static const time_t MaxLifetime = 24*60*60;
+    //! Time (seconds) to remember failure to obtain keys.
+    static const time_t NegativeLifetime = 60;
+    //! Maximal number of issuers kept in cache.
+    static const unsigned int MaxIssuers = 1000;
+
+    static JWSEKeyCache& Instance();
+
+    //! Finds key with specified id published by issuer. If key is found it
+    //! is assigned to key and safe tells if it was obtained over HTTPS.
+    bool Find(std::string const& issuer, std::string const& kid, JWSEKeyHolder& key, bool& safe);
+
+   private:
+    struct Issuer {
+      std::string jwksUri;
+      std::map<std::string,EVP_PKEY*> keys;
+      bool valid;        // last fetch succeeded
+      bool fetching;     // fetch is in progress
+      time_t fetched;    // time of last fetch
+      time_t expires;    // content must not be used after this time
+      Issuer(): valid(false), fetching(false), fetched(0), expires(0) {};
+    };
+    Glib::Mutex lock_;
+    Glib::Cond cond_;
+    std::map<std::string,Issuer> issuers_;
+
+    JWSEKeyCache();
+    ~JWSEKeyCache();
+    // Fetches keys for issuer and stores them. Called without lock held and
+    // with fetching flag of issuer set.
+    void Refresh(std::string const& issuer);
+    static void RefreshThread(void* arg);
+    // Removes expired entries and failed fetches. Called with lock held.
+    void Purge(time_t now);
+  };
+
+  //! Process-wide cache of successfully validated tokens.
+  /*! Tokens are identified by SHA-256 digest of their serialized form and are
+      kept till they expire but not longer than MaxLifetime. */
+  class JWSETokenCache {
+   public:
+    static const time_t MaxLifetime = 60*60;
+    static const unsigned int MaxSize = 10000;
+
+    static JWSETokenCache& Instance();
+
+    bool Get(std::string const& token, std::string& header, std::string& content,
+             int& keyOrigin, std::string& signAlg);
+    void Put(std::string const& token, std::string const& header, std::string const& content,
+             int keyOrigin, std::string const& signAlg, time_t expires);
+
+   private:
+    struct Token {
+      std::string header;
+      std::string content;
+      int keyOrigin;
+      std::string signAlg;
+      time_t expires;
+    };
+    Glib::Mutex lock_;
+    std::map<std::string,Token> tokens_;
+    // Digests in order of insertion
+    std::list<std::string> order_;
+
+    JWSETokenCache();
+    ~JWSETokenCache();
+  };
+
 }
 
@@ -322,6 +322,10 @@ namespace Arc {
 
   bool OpenIDMetadataFetcher::Fetch(OpenIDMetadata& metadata) {
     HTTPClientInfo info;
+    return Fetch(metadata, info);
+  }
+
+  bool OpenIDMetadataFetcher::Fetch(OpenIDMetadata& metadata, HTTPClientInfo& info) {
     PayloadRaw request;
     PayloadRawInterface* response(NULL);
     std::string path = url_.Path();
@@ -161,6 +161,8 @@ namespace Arc {
    public:
     OpenIDMetadataFetcher(char const * issuer_url);
     bool Fetch(OpenIDMetadata& metadata);
+    //! Same as Fetch(metadata) but also provides information about HTTP response.
+    bool Fetch(OpenIDMetadata& metadata, HTTPClientInfo& info);
    private:
     URL url_;
     ClientHTTP client_;
@@ -212,6 +212,14 @@ static void parse_http_range(PayloadHTTP& http,Message& msg) {
   };
 }
 
+// Keeps data of pipelined requests which was read from connection
+// together with previous request.
+class MCC_HTTP_Context: public MessageContextElement {
+ public:
+  std::string unread;
+  virtual bool Buffered(void) const { return !unread.empty(); };
+};
+
 MCC_Status MCC_HTTP_Service::process(Message& inmsg,Message& outmsg) {
   // Extracting payload
   if(!inmsg.Payload()) return MCC_Status();
@@ -220,8 +228,24 @@ MCC_Status MCC_HTTP_Service::process(Message& inmsg,Message& outmsg) {
     inpayload = dynamic_cast<PayloadStreamInterface*>(inmsg.Payload());
   } catch(std::exception& e) { };
   if(!inpayload) return MCC_Status();
+  // Obtaining previously created connection context or creating a new one
+  MCC_HTTP_Context* context = NULL;
+  if(inmsg.Context()) {
+    MessageContextElement* mcontext = (*inmsg.Context())["http.service"];
+    if(mcontext) {
+      try {
+        context = dynamic_cast<MCC_HTTP_Context*>(mcontext);
+      } catch(std::exception& e) { };
+    };
+    if(!context) {
+      context = new MCC_HTTP_Context;
+      inmsg.Context()->Add("http.service",context);
+    };
+  };
+  std::string prefetched;
+  if(context) prefetched.swap(context->unread);
   // Converting stream payload to HTTP which implements raw and stream interfaces
-  PayloadHTTPIn nextpayload(*inpayload);
+  PayloadHTTPIn nextpayload(*inpayload,prefetched);
   if(!nextpayload) {
     logger.msg(WARNING, "Cannot create http payload");
     return make_http_fault(logger,nextpayload,*inpayload,outmsg,HTTP_BAD_REQUEST);
@@ -407,6 +431,8 @@ MCC_Status MCC_HTTP_Service::process(Message& inmsg,Message& outmsg) {
   if(!keep_alive) return MCC_Status(SESSION_CLOSE);
   // Make sure whole body sent to us was fetch from input stream.
   if(!nextpayload.Sync()) return MCC_Status(SESSION_CLOSE);
+  // Keep beginning of next request if it was already read
+  if(context) context->unread = nextpayload.Unread();
   return MCC_Status(STATUS_OK);
 }
 
@@ -523,6 +549,8 @@ MCC_Status MCC_HTTP_Client::process(Message& inmsg,Message& outmsg) {
     ret = next->process(nextinmsg,nextoutmsg);
     if(!ret) {
       delete nextoutmsg.Payload();
+      // Request did not reach server completely, so it was not processed
+      outmsg.Attributes()->set("HTTP:UNSENT","TRUE");
       return make_raw_fault(outmsg,ret);
     };
     ret = extract_http_response(nextoutmsg, outmsg, request_is_head, outpayload);
@@ -536,6 +564,7 @@ MCC_Status MCC_HTTP_Client::process(Message& inmsg,Message& outmsg) {
     ret = next->process(nextinmsg,nextoutmsg);
     if(!ret) {
       delete nextoutmsg.Payload();
+      outmsg.Attributes()->set("HTTP:UNSENT","TRUE");
       return make_raw_fault(outmsg,ret);
     };
     // Parse response and check if it is 100
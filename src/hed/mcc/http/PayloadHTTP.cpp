@@ -579,6 +579,24 @@ PayloadHTTPIn::PayloadHTTPIn(PayloadStreamInterface& stream,bool own,bool head_r
   valid_=true;
 }
 
+PayloadHTTPIn::PayloadHTTPIn(PayloadStreamInterface& stream,const std::string& prefetched,bool own):
+    head_response_(false),chunked_(CHUNKED_NONE),chunk_size_(0),
+    multipart_(MULTIPART_NONE),stream_(&stream),stream_offset_(0),
+    stream_own_(own),fetched_(false),header_read_(false),body_read_(false),
+    body_(NULL),body_size_(0) {
+  // Prefetched data comes from tbuf_ of previous object hence always fits
+  tbuflen_ = prefetched.length();
+  if(tbuflen_ > (int)(sizeof(tbuf_)-1)) tbuflen_ = sizeof(tbuf_)-1;
+  memcpy(tbuf_,prefetched.c_str(),tbuflen_);
+  tbuf_[tbuflen_]=0;
+  if(!parse_header()) {
+    error_ = IString("Failed to parse HTTP header").str();
+    return;
+  }
+  header_read_=true;
+  valid_=true;
+}
+
 PayloadHTTPIn::~PayloadHTTPIn(void) {
   // allign to end of message (maybe not needed with Sync() exposed)
   flush_multipart();
@@ -755,6 +773,12 @@ bool PayloadHTTPIn::Sync(void) {
   return false;
 }
 
+std::string PayloadHTTPIn::Unread(void) {
+  std::string data(tbuf_,tbuflen_);
+  tbuf_[0]=0; tbuflen_=0;
+  return data;
+}
+
 // ------------------- PayloadHTTPOut ---------------------------
 
 void PayloadHTTPOut::Attribute(const std::string& name,const std::string& value) {
@@ -980,7 +1004,15 @@ bool PayloadHTTPOut::FlushHeader(PayloadStreamInterface& stream) {
 bool PayloadHTTPOut::FlushBody(PayloadStreamInterface& stream) {
     // TODO: process 100 request/response
     if((length_ > 0) || (use_chunked_transfer_)) {
-      if(sbody_) {
+      if(sbody_ && !use_chunked_transfer_) {
+        // stream to stream transfer of known size - output stream may
+        // have optimized way to do that (like passing file to socket
+        // directly)
+        if(!stream.Put(*sbody_,length_)) {
+          error_ = IString("Failed to write body to output stream").str();
+          return false;
+        };
+      } else if(sbody_) {
         // stream to stream transfer
         // TODO: choose optimal buffer size
         // TODO: parallel read and write for better performance
@@ -161,6 +161,10 @@ class PayloadHTTPIn: public PayloadHTTP, public PayloadRawInterface, public Payl
     object is deleted. */
   PayloadHTTPIn(PayloadStreamInterface& stream,bool own = false,bool head_response = false);
 
+  /** Constructor - same as above but 'prefetched' holds beginning of HTTP message
+    which was already read from 'stream' (see Unread()). */
+  PayloadHTTPIn(PayloadStreamInterface& stream,const std::string& prefetched,bool own = false);
+
   virtual ~PayloadHTTPIn(void);
 
   virtual operator bool(void) { return valid_; };
@@ -174,6 +178,10 @@ class PayloadHTTPIn: public PayloadHTTP, public PayloadRawInterface, public Payl
   // Fetch anything what is left of current request from input stream 
   // to sync for next request.
   virtual bool Sync(void);
+  // Returns data which was read from input stream beyond end of
+  // current request (like following pipelined request) and removes
+  // it from internal buffer. Should be called after Sync().
+  std::string Unread(void);
 
   // PayloadRawInterface implemented methods
   virtual char operator[](PayloadRawInterface::Size_t pos) const;
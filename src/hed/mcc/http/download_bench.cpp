@@ -0,0 +1,243 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+// Measures throughput of file download from service behind http.service.
+// Size of file is obtained with HEAD request and then file is fetched
+// over specified number of parallel connections, each one requesting
+// its own byte range - same way as parallel download clients do.
+// Received content is discarded.
+
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+#include <cerrno>
+#include <string>
+#include <vector>
+#include <iostream>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <sys/types.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+
+static double now(void) {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+struct Connection {
+  int handle;
+  std::string out;               // unsent part of request
+  std::string header;            // received part of response header
+  bool in_body;
+  long long int expected;        // length of body
+  long long int received;        // received part of body
+};
+
+static void usage(const char* name) {
+  std::cerr << "Usage: " << name << " [-c connections] [-r rounds] host port path" << std::endl;
+  std::cerr << "Service must be accessible over plain HTTP." << std::endl;
+}
+
+static int tcp_connect(const struct addrinfo* info) {
+  int h = ::socket(info->ai_family, info->ai_socktype, info->ai_protocol);
+  if (h == -1) return -1;
+  if (::connect(h, info->ai_addr, info->ai_addrlen) != 0) {
+    ::close(h);
+    return -1;
+  }
+  return h;
+}
+
+// Returns HTTP code and sets length to value of Content-Length.
+static int parse_header(const std::string& header, long long int& length) {
+  length = -1;
+  int code = -1;
+  std::string::size_type p = header.find(' ');
+  if (p != std::string::npos) code = atoi(header.c_str() + p + 1);
+  p = 0;
+  while (p < header.length()) {
+    std::string::size_type e = header.find("\r\n", p);
+    if (e == std::string::npos) e = header.length();
+    std::string line = header.substr(p, e - p);
+    p = e + 2;
+    if (strncasecmp(line.c_str(), "Content-Length:", 15) == 0) length = atoll(line.c_str() + 15);
+  }
+  return code;
+}
+
+// Obtains size of file at path.
+static long long int file_size(const struct addrinfo* info, const std::string& request) {
+  int h = tcp_connect(info);
+  if (h == -1) return -1;
+  std::string header;
+  bool r = (::write(h, request.c_str(), request.length()) == (ssize_t)request.length());
+  while (r && (header.find("\r\n\r\n") == std::string::npos)) {
+    char buf[1024];
+    ssize_t l = ::read(h, buf, sizeof(buf));
+    if (l <= 0) r = false;
+    else header.append(buf, l);
+  }
+  ::close(h);
+  if (!r) return -1;
+  long long int length = -1;
+  if (parse_header(header.substr(0, header.find("\r\n\r\n")), length) != 200) return -1;
+  return length;
+}
+
+// Downloads whole file once. Returns number of failed connections.
+static int download(const struct addrinfo* info, const std::string& host, const std::string& path,
+                    long long int size, int connections, long long int& received) {
+  std::vector<Connection> conns(connections);
+  long long int portion = size / connections;
+  int failed = 0;
+  int active = 0;
+  for (int n = 0; n < connections; ++n) {
+    Connection& c = conns[n];
+    long long int start = portion * n;
+    long long int end = (n == (connections - 1)) ? (size - 1) : (start + portion - 1);
+    c.in_body = false;
+    c.expected = end - start + 1;
+    c.received = 0;
+    c.handle = tcp_connect(info);
+    if (c.handle == -1) {
+      std::cerr << "Failed to connect: " << strerror(errno) << std::endl;
+      ++failed;
+      continue;
+    }
+    ::fcntl(c.handle, F_SETFL, ::fcntl(c.handle, F_GETFL) | O_NONBLOCK);
+    char range[64];
+    snprintf(range, sizeof(range), "%lld-%lld", start, end);
+    c.out = "GET " + path + " HTTP/1.1\r\nHost: " + host + "\r\nRange: bytes=" + range +
+            "\r\nConnection: close\r\n\r\n";
+    ++active;
+  }
+  std::vector<struct pollfd> fds;
+  std::vector<int> idx;
+  // Content is discarded
+  static char buf[1024*1024];
+  while (active > 0) {
+    fds.clear();
+    idx.clear();
+    for (int n = 0; n < connections; ++n) {
+      Connection& c = conns[n];
+      if (c.handle == -1) continue;
+      struct pollfd fd;
+      fd.fd = c.handle;
+      fd.events = POLLIN | (c.out.empty() ? 0 : POLLOUT);
+      fd.revents = 0;
+      fds.push_back(fd);
+      idx.push_back(n);
+    }
+    if (::poll(&(fds[0]), fds.size(), 60000) <= 0) {
+      if (errno == EINTR) continue;
+      std::cerr << "Failed to wait for connections: " << strerror(errno) << std::endl;
+      return failed + active;
+    }
+    for (std::vector<struct pollfd>::size_type i = 0; i < fds.size(); ++i) {
+      if (!fds[i].revents) continue;
+      Connection& c = conns[idx[i]];
+      bool error = false;
+      bool done = false;
+      if (!c.out.empty() && (fds[i].revents & POLLOUT)) {
+        ssize_t l = ::write(c.handle, c.out.c_str(), c.out.length());
+        if (l > 0) c.out.erase(0, l);
+        else if (errno != EAGAIN) error = true;
+      }
+      if (!error && (fds[i].revents & (POLLIN | POLLHUP | POLLERR))) {
+        ssize_t l = ::read(c.handle, buf, sizeof(buf));
+        if (l > 0) {
+          if (c.in_body) {
+            c.received += l;
+          } else {
+            c.header.append(buf, l);
+            std::string::size_type hend = c.header.find("\r\n\r\n");
+            if (hend != std::string::npos) {
+              long long int length = -1;
+              int code = parse_header(c.header.substr(0, hend), length);
+              if (((code != 206) && (code != 200)) || (length != c.expected)) {
+                std::cerr << "Unexpected response: " << c.header.substr(0, c.header.find("\r\n")) << std::endl;
+                error = true;
+              }
+              c.in_body = true;
+              c.received = c.header.length() - (hend + 4);
+              c.header.clear();
+            }
+          }
+          if (c.in_body && (c.received >= c.expected)) done = true;
+        } else if ((l == 0) || (errno != EAGAIN)) {
+          error = true;
+        }
+      }
+      if (!error && !done) continue;
+      if (error) ++failed;
+      received += c.received;
+      ::close(c.handle);
+      c.handle = -1;
+      --active;
+    }
+  }
+  return failed;
+}
+
+int main(int argc, char** argv) {
+  int connections = 1;
+  int rounds = 1;
+  int opt;
+  while ((opt = getopt(argc, argv, "c:r:h")) != -1) {
+    switch (opt) {
+      case 'c': connections = atoi(optarg); break;
+      case 'r': rounds = atoi(optarg); break;
+      default: usage(argv[0]); return 1;
+    }
+  }
+  if ((argc - optind) != 3 || connections <= 0 || rounds <= 0) {
+    usage(argv[0]);
+    return 1;
+  }
+  std::string host = argv[optind];
+  std::string port = argv[optind + 1];
+  std::string path = argv[optind + 2];
+
+  struct addrinfo hint;
+  struct addrinfo* info = NULL;
+  memset(&hint, 0, sizeof(hint));
+  hint.ai_socktype = SOCK_STREAM;
+  hint.ai_protocol = IPPROTO_TCP;
+  int r = getaddrinfo(host.c_str(), port.c_str(), &hint, &info);
+  if (r != 0) {
+    std::cerr << "Failed to resolve " << host << ":" << port << " - " << gai_strerror(r) << std::endl;
+    return 1;
+  }
+  host += ":" + port;
+
+  long long int size = file_size(info, "HEAD " + path + " HTTP/1.1\r\nHost: " + host +
+                                       "\r\nConnection: close\r\n\r\n");
+  if (size <= 0) {
+    std::cerr << "Failed to obtain size of " << path << std::endl;
+    freeaddrinfo(info);
+    return 1;
+  }
+  if (connections > size) connections = (int)size;
+
+  int failed = 0;
+  long long int received = 0;
+  double start = now();
+  for (int n = 0; n < rounds; ++n) {
+    failed += download(info, host, path, size, connections, received);
+  }
+  double elapsed = now() - start;
+  freeaddrinfo(info);
+
+  std::cout << "File size: " << size << " bytes, connections: " << connections << std::endl;
+  std::cout << "Received " << received << " bytes in " << elapsed << " s";
+  if (elapsed > 0) std::cout << " (" << (received / elapsed / (1024*1024)) << " MB/s)";
+  std::cout << std::endl;
+  std::cout << "Failed connections: " << failed << std::endl;
+  return (failed == 0) ? 0 : 2;
+}
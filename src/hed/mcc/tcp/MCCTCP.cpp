@@ -3,7 +3,9 @@
 #endif
 
 #include <cstdlib>
+#include <vector>
 #include <unistd.h>
+#include <fcntl.h>
 
 // NOTE: On Solaris errno is not working properly if cerrno is included first
 #include <cerrno>
@@ -13,6 +15,11 @@
 #include <netinet/in.h>
 #include <netinet/tcp.h>
 #include <netdb.h>
+#ifdef HAVE_SYS_EPOLL_H
+#include <sys/epoll.h>
+#else
+#include <sys/poll.h>
+#endif
 #define ErrNo errno
 
 #include <arc/message/PayloadStream.h>
@@ -26,6 +33,12 @@
 #include "MCCTCP.h"
 
 #define PROTO_NAME(ADDR) ((ADDR->ai_family==AF_INET6)?"IPv6":"IPv4")
+// Default maximal number of worker threads if connections are not limited
+#define DEFAULT_MAX_WORKERS (256)
+// How long idle worker thread waits for work before exiting (seconds)
+#define WORKER_IDLE_TIME (60)
+// How many connections to accept from one listening socket in a row
+#define ACCEPT_BATCH (64)
 Arc::Logger ArcMCCTCP::MCC_TCP::logger(Arc::Logger::getRootLogger(), "MCC.TCP");
 
 ArcMCCTCP::MCC_TCP::MCC_TCP(Arc::Config *cfg, PluginArgument* parg) : Arc::MCC(cfg, parg) {
@@ -66,8 +79,195 @@ namespace ArcMCCTCP {
 
 using namespace Arc;
 
+/* Waits for sockets to become readable.
+  Listening sockets are watched permanently. Connections are watched
+ only once - after being reported connection is not watched till it is
+ added again. That way connection can be handed over to worker thread
+ without racing with next event for same socket. Wakeup() makes Wait()
+ return immediately. */
+class TCPPoller {
+ public:
+  TCPPoller(void);
+  ~TCPPoller(void);
+  operator bool(void) const { return valid_; };
+  bool Listen(int h);
+  bool Add(int h);
+  void Remove(int h);
+  void Wakeup(void);
+  /* Waits up to timeout milliseconds and fills ready with readable
+     sockets. Returns false on unrecoverable error. */
+  bool Wait(int timeout, std::vector<int>& ready);
+ private:
+  bool valid_;
+  int wakeup_[2];
+#ifdef HAVE_SYS_EPOLL_H
+  int epoll_;
+#else
+  Glib::Mutex lock_;
+  std::map<int,bool> handles_; /* handle -> watched permanently */
+#endif
+  void drain(void);
+};
+
+static void set_cloexec(int h) {
+  int flags = ::fcntl(h, F_GETFD);
+  if(flags != -1) ::fcntl(h, F_SETFD, flags | FD_CLOEXEC);
+}
+
+static void set_nonblock(int h, bool nonblock) {
+  int flags = ::fcntl(h, F_GETFL);
+  if(flags == -1) return;
+  ::fcntl(h, F_SETFL, nonblock ? (flags | O_NONBLOCK) : (flags & ~O_NONBLOCK));
+}
+
+TCPPoller::TCPPoller(void):valid_(false) {
+  wakeup_[0] = -1; wakeup_[1] = -1;
+#ifdef HAVE_SYS_EPOLL_H
+  epoll_ = ::epoll_create(1024);
+  if(epoll_ == -1) return;
+  set_cloexec(epoll_);
+#endif
+  if(::pipe(wakeup_) != 0) {
+    wakeup_[0] = -1; wakeup_[1] = -1;
+    return;
+  };
+  for(int n = 0; n < 2; ++n) {
+    set_cloexec(wakeup_[n]);
+    set_nonblock(wakeup_[n], true);
+  };
+#ifdef HAVE_SYS_EPOLL_H
+  struct epoll_event ev;
+  memset(&ev, 0, sizeof(ev));
+  ev.events = EPOLLIN;
+  ev.data.fd = wakeup_[0];
+  if(::epoll_ctl(epoll_, EPOLL_CTL_ADD, wakeup_[0], &ev) != 0) return;
+#endif
+  valid_ = true;
+}
+
+TCPPoller::~TCPPoller(void) {
+#ifdef HAVE_SYS_EPOLL_H
+  if(epoll_ != -1) ::close(epoll_);
+#endif
+  if(wakeup_[0] != -1) ::close(wakeup_[0]);
+  if(wakeup_[1] != -1) ::close(wakeup_[1]);
+}
+
+void TCPPoller::Wakeup(void) {
+  char c = 0;
+  // Pipe is non-blocking. If it is full wakeup is pending anyway.
+  if(::write(wakeup_[1], &c, 1) < 0) { };
+}
+
+void TCPPoller::drain(void) {
+  char buf[64];
+  while(::read(wakeup_[0], buf, sizeof(buf)) > 0) { };
+}
+
+#ifdef HAVE_SYS_EPOLL_H
+
+bool TCPPoller::Listen(int h) {
+  struct epoll_event ev;
+  memset(&ev, 0, sizeof(ev));
+  ev.events = EPOLLIN;
+  ev.data.fd = h;
+  return (::epoll_ctl(epoll_, EPOLL_CTL_ADD, h, &ev) == 0);
+}
+
+bool TCPPoller::Add(int h) {
+  struct epoll_event ev;
+  memset(&ev, 0, sizeof(ev));
+  ev.events = EPOLLIN | EPOLLONESHOT;
+  ev.data.fd = h;
+  if(::epoll_ctl(epoll_, EPOLL_CTL_ADD, h, &ev) == 0) return true;
+  // Connection which was already reported stays registered but disabled
+  if(errno != EEXIST) return false;
+  return (::epoll_ctl(epoll_, EPOLL_CTL_MOD, h, &ev) == 0);
+}
+
+void TCPPoller::Remove(int h) {
+  // Old kernels require non-NULL event even for removal
+  struct epoll_event ev;
+  memset(&ev, 0, sizeof(ev));
+  ::epoll_ctl(epoll_, EPOLL_CTL_DEL, h, &ev);
+}
+
+bool TCPPoller::Wait(int timeout, std::vector<int>& ready) {
+  struct epoll_event evs[64];
+  int n = ::epoll_wait(epoll_, evs, sizeof(evs)/sizeof(evs[0]), timeout);
+  if(n < 0) return (ErrNo == EINTR);
+  for(int i = 0; i < n; ++i) {
+    if(evs[i].data.fd == wakeup_[0]) {
+      drain();
+      continue;
+    };
+    ready.push_back(evs[i].data.fd);
+  };
+  return true;
+}
 
-MCC_TCP_Service::MCC_TCP_Service(Config *cfg, PluginArgument* parg):MCC_TCP(cfg,parg),valid_(false),max_executers_(-1),max_executers_drop_(false) {
+#else // HAVE_SYS_EPOLL_H
+
+bool TCPPoller::Listen(int h) {
+  lock_.lock();
+  handles_[h] = true;
+  lock_.unlock();
+  Wakeup();
+  return true;
+}
+
+bool TCPPoller::Add(int h) {
+  lock_.lock();
+  handles_[h] = false;
+  lock_.unlock();
+  Wakeup();
+  return true;
+}
+
+void TCPPoller::Remove(int h) {
+  lock_.lock();
+  handles_.erase(h);
+  lock_.unlock();
+  Wakeup();
+}
+
+bool TCPPoller::Wait(int timeout, std::vector<int>& ready) {
+  std::vector<struct pollfd> fds;
+  struct pollfd fd;
+  fd.fd = wakeup_[0]; fd.events = POLLIN; fd.revents = 0;
+  fds.push_back(fd);
+  lock_.lock();
+  for(std::map<int,bool>::iterator h = handles_.begin(); h != handles_.end(); ++h) {
+    fd.fd = h->first;
+    fds.push_back(fd);
+  };
+  lock_.unlock();
+  int n = ::poll(&(fds[0]), fds.size(), timeout);
+  if(n < 0) return (ErrNo == EINTR);
+  if(n == 0) return true;
+  if(fds[0].revents) drain();
+  lock_.lock();
+  for(std::vector<struct pollfd>::size_type i = 1; i < fds.size(); ++i) {
+    if(!fds[i].revents) continue;
+    // Skip sockets removed while waiting
+    std::map<int,bool>::iterator h = handles_.find(fds[i].fd);
+    if(h == handles_.end()) continue;
+    if(!h->second) handles_.erase(h);
+    ready.push_back(fds[i].fd);
+  };
+  lock_.unlock();
+  return true;
+}
+
+#endif // HAVE_SYS_EPOLL_H
+
+
+MCC_TCP_Service::MCC_TCP_Service(Config *cfg, PluginArgument* parg):MCC_TCP(cfg,parg),valid_(false),max_executers_(-1),max_executers_drop_(false),max_workers_(DEFAULT_MAX_WORKERS),workers_(0),idle_workers_(0),on_hold_(false),shutdown_(false),poller_(NULL) {
+    poller_ = new TCPPoller;
+    if(!(*poller_)) {
+        logger.msg(ERROR, "Failed to initialize waiting for connections: %s", StrError(errno));
+        return;
+    };
     for(int i = 0;;++i) {
         struct addrinfo hint;
         struct addrinfo *info = NULL;
@@ -175,6 +375,9 @@ MCC_TCP_Service::MCC_TCP_Service(Config *cfg, PluginArgument* parg):MCC_TCP(cfg,
                 std::string v = l["Timeout"];
                 timeout = atoi(v.c_str());
             }
+            // Listening sockets are non-blocking so that accepting
+            // never stalls event loop.
+            set_nonblock(s,true);
             handles_.push_back(mcc_tcp_handle_t(s,timeout,no_delay));
             if(interface_s.empty()) {
               logger.msg(INFO, "Listening on TCP port %s(%s)", port_s, PROTO_NAME(info_));
@@ -208,6 +411,23 @@ MCC_TCP_Service::MCC_TCP_Service(Config *cfg, PluginArgument* parg):MCC_TCP(cfg,
         logger.msg(INFO, "Setting connections limit to %i, connections over limit will be %s",max_executers_,max_executers_drop_?istring("dropped"):istring("put on hold"));
       };
     };
+    // Requests are processed by pool of threads. Previously every
+    // connection had own thread. Hence by default limit of connections
+    // also limits number of threads.
+    if(max_executers_ > 0) max_workers_ = max_executers_;
+    if((*cfg)["Workers"]) {
+      std::string v = (*cfg)["Workers"];
+      int n = atoi(v.c_str());
+      if(n > 0) max_workers_ = n;
+    };
+    logger.msg(VERBOSE, "Setting limit of threads processing requests to %i",max_workers_);
+    for(std::list<mcc_tcp_handle_t>::iterator i = handles_.begin();i!=handles_.end();++i) {
+        if(!poller_->Listen(i->handle)) {
+            logger.msg(ERROR, "Failed to start waiting for connections: %s", StrError(errno));
+            for(std::list<mcc_tcp_handle_t>::iterator h = handles_.begin();h!=handles_.end();h=handles_.erase(h)) ::close(h->handle);
+            return;
+        };
+    };
     if(!CreateThreadFunction(&listener,this)) {
         logger.msg(ERROR, "Failed to start thread for listening");
         for(std::list<mcc_tcp_handle_t>::iterator i = handles_.begin();i!=handles_.end();i=handles_.erase(i)) ::close(i->handle);
@@ -218,110 +438,184 @@ MCC_TCP_Service::MCC_TCP_Service(Config *cfg, PluginArgument* parg):MCC_TCP(cfg,
 MCC_TCP_Service::~MCC_TCP_Service(void) {
     //logger.msg(VERBOSE, "TCP_Service destroy");
     lock_.lock();
-    for(std::list<mcc_tcp_handle_t>::iterator i = handles_.begin();i!=handles_.end();++i) {
-        ::close(i->handle); i->handle=-1;
-    };
+    shutdown_ = true;
+    // Listening thread closes listening sockets and idle connections.
+    // Active connections are interrupted and closed by workers.
     for(std::list<mcc_tcp_exec_t>::iterator e = executers_.begin();e != executers_.end();++e) {
         ::shutdown(e->handle,2);
     };
+    work_cond_.broadcast();
+    if(poller_) poller_->Wakeup();
     if(!valid_) {
-        for(std::list<mcc_tcp_handle_t>::iterator i = handles_.begin();i!=handles_.end();i=handles_.erase(i)) { };
+        for(std::list<mcc_tcp_handle_t>::iterator i = handles_.begin();i!=handles_.end();i=handles_.erase(i)) ::close(i->handle);
     };
     // Wait for threads to exit
-    while(executers_.size() > 0) {
+    while((executers_.size() > 0) || (workers_ > 0)) {
         lock_.unlock(); sleep(1); lock_.lock();
     };
     while(handles_.size() > 0) {
         lock_.unlock(); sleep(1); lock_.lock();
     };
     lock_.unlock();
+    delete poller_;
+}
+
+MCC_TCP_Service::mcc_tcp_exec_t::mcc_tcp_exec_t(MCC_TCP_Service* o,int h,int t,bool nd):obj(o),handle(h),no_delay(nd),timeout(t),last_active(0),stream(NULL),context(NULL),auth_context(NULL) {
 }
 
-MCC_TCP_Service::mcc_tcp_exec_t::mcc_tcp_exec_t(MCC_TCP_Service* o,int h,int t,bool nd):obj(o),handle(h),no_delay(nd),timeout(t) {
-    if(handle == -1) return;
-    // list is locked externally
-    std::list<mcc_tcp_exec_t>::iterator e = o->executers_.insert(o->executers_.end(),*this);
-    if(!CreateThreadFunction(&MCC_TCP_Service::executer,&(*e))) {
-        logger.msg(ERROR, "Failed to start thread for communication");
-        ::shutdown(handle,2);
-        ::close(handle);  handle=-1; o->executers_.erase(e);
+void MCC_TCP_Service::accept_connections(mcc_tcp_handle_t& l) {
+    for(int n = 0; n < ACCEPT_BATCH; ++n) {
+        bool over_limit = (max_executers_ > 0) && (executers_.size() >= (size_t)max_executers_);
+        // Connections over limit are left in backlog of listening socket
+        if(over_limit && !max_executers_drop_) break;
+        struct sockaddr_storage addr;
+        socklen_t addrlen = sizeof(addr);
+        int h = ::accept(l.handle,(struct sockaddr*)&addr,&addrlen);
+        if(h == -1) {
+            if(ErrNo == EINTR) continue;
+            if((ErrNo != EAGAIN) && (ErrNo != EWOULDBLOCK)) {
+                logger.msg(ERROR, "Failed to accept connection request");
+            };
+            break;
+        };
+        if(over_limit) {
+            logger.msg(WARNING, "Too many connections - dropping new one");
+            ::shutdown(h,2);
+            ::close(h);
+            continue;
+        };
+        // Some systems make accepted socket inherit non-blocking mode
+        set_nonblock(h,false);
+        std::list<mcc_tcp_exec_t>::iterator e = executers_.insert(executers_.end(),mcc_tcp_exec_t(this,h,l.timeout,l.no_delay));
+        e->self = e;
+        // Request is processed when it arrives. Till then connection
+        // does not need any thread.
+        park(*e);
     };
 }
 
+void MCC_TCP_Service::park(mcc_tcp_exec_t& e) {
+    e.last_active = time(NULL);
+    parked_[e.handle] = &e;
+    if(!poller_->Add(e.handle)) {
+        logger.msg(ERROR, "Failed to wait for data on connection: %s", StrError(errno));
+        parked_.erase(e.handle);
+        close_connection(e);
+    };
+}
+
+void MCC_TCP_Service::dispatch(mcc_tcp_exec_t& e) {
+    queue_.push_back(&e);
+    if((queue_.size() > (size_t)idle_workers_) && (workers_ < max_workers_)) {
+        if(CreateThreadFunction(&worker,this)) {
+            ++workers_;
+        } else {
+            logger.msg(ERROR, "Failed to start thread for communication");
+            if(workers_ <= 0) {
+                // Nobody is going to process this connection
+                queue_.pop_back();
+                close_connection(e);
+                return;
+            };
+        };
+    };
+    work_cond_.signal();
+}
+
+void MCC_TCP_Service::close_connection(mcc_tcp_exec_t& e) {
+    logger.msg(VERBOSE, "TCP executor is removed");
+    ::shutdown(e.handle,2);
+    ::close(e.handle);
+    delete e.stream;
+    delete e.context;
+    delete e.auth_context;
+    executers_.erase(e.self);
+    cond_.signal();
+    // Listening thread may be waiting for connections to close
+    if(on_hold_) poller_->Wakeup();
+}
+
 void MCC_TCP_Service::listener(void* arg) {
     MCC_TCP_Service& it = *((MCC_TCP_Service*)arg);
+    std::vector<int> ready;
+    time_t last_check = time(NULL);
     for(;;) {
-        int max_s = -1;
-        fd_set readfds;
-        FD_ZERO(&readfds);
+        ready.clear();
+        // Timeout makes sure idle connections are checked regularly
+        if(!it.poller_->Wait(1000,ready)) {
+            logger.msg(ERROR, "Failed while waiting for connection request");
+            break;
+        };
         it.lock_.lock();
-        for(std::list<mcc_tcp_handle_t>::iterator i = it.handles_.begin();i!=it.handles_.end();) {
-            int s = i->handle;
-            if(s == -1) { i=it.handles_.erase(i); continue; };
-            FD_SET(s,&readfds);
-            if(s > max_s) max_s = s;
-            ++i;
+        if(it.shutdown_) {
+            it.lock_.unlock();
+            break;
         };
-        it.lock_.unlock();
-        if(max_s == -1) break;
-        struct timeval tv; tv.tv_sec = 2; tv.tv_usec = 0;
-        int n = select(max_s+1,&readfds,NULL,NULL,&tv);
-        if(n < 0) {
-            if(ErrNo != EINTR) {
-                logger.msg(ERROR, "Failed while waiting for connection request");
-                it.lock_.lock();
-                for(std::list<mcc_tcp_handle_t>::iterator i = it.handles_.begin();i!=it.handles_.end();) {
-                    int s = i->handle;
-                    ::close(s);
-                    i=it.handles_.erase(i);
+        for(std::vector<int>::iterator r = ready.begin();r != ready.end();++r) {
+            std::map<int,mcc_tcp_exec_t*>::iterator p = it.parked_.find(*r);
+            if(p != it.parked_.end()) {
+                mcc_tcp_exec_t& e = *(p->second);
+                it.parked_.erase(p);
+                it.dispatch(e);
+                continue;
+            };
+            for(std::list<mcc_tcp_handle_t>::iterator i = it.handles_.begin();i!=it.handles_.end();++i) {
+                if(i->handle == *r) {
+                    it.accept_connections(*i);
+                    break;
                 };
-                it.lock_.unlock();
-                return;
             };
-            continue;
-        } else if(n == 0) continue;
-        it.lock_.lock();
-        for(std::list<mcc_tcp_handle_t>::iterator i = it.handles_.begin();i!=it.handles_.end();++i) {
-            int s = i->handle;
-            if(s == -1) continue;
-            if(FD_ISSET(s,&readfds)) {
-                it.lock_.unlock();
-                struct sockaddr addr;
-                socklen_t addrlen = sizeof(addr);
-                int h = ::accept(s,&addr,&addrlen);
-                if(h == -1) {
-                    logger.msg(ERROR, "Failed to accept connection request");
-                    it.lock_.lock();
+        };
+        // Stop accepting connections while over limit and resume
+        // when some are closed.
+        bool hold = (!it.max_executers_drop_) && (it.max_executers_ > 0) &&
+                    (it.executers_.size() >= (size_t)it.max_executers_);
+        if(hold != it.on_hold_) {
+            if(hold) logger.msg(WARNING, "Too many connections - waiting for old to close");
+            for(std::list<mcc_tcp_handle_t>::iterator i = it.handles_.begin();i!=it.handles_.end();++i) {
+                if(hold) {
+                    it.poller_->Remove(i->handle);
+                } else {
+                    it.poller_->Listen(i->handle);
+                };
+            };
+            it.on_hold_ = hold;
+        };
+        time_t now = time(NULL);
+        if(now != last_check) {
+            last_check = now;
+            for(std::map<int,mcc_tcp_exec_t*>::iterator p = it.parked_.begin();p != it.parked_.end();) {
+                mcc_tcp_exec_t& e = *(p->second);
+                if((e.timeout > 0) && ((now - e.last_active) > e.timeout)) {
+                    logger.msg(VERBOSE, "Closing idle connection");
+                    it.poller_->Remove(p->first);
+                    it.parked_.erase(p++);
+                    it.close_connection(e);
                 } else {
-                    it.lock_.lock();
-                    bool rejected = false;
-                    bool first_time = true;
-                    while((it.max_executers_ > 0) &&
-                          (it.executers_.size() >= (size_t) it.max_executers_)) {
-                        if(it.max_executers_drop_) {
-                            logger.msg(WARNING, "Too many connections - dropping new one");
-                            ::shutdown(h,2);
-                            ::close(h);
-                            rejected = true;
-                            break;
-                        } else {
-                            if(first_time)
-                                logger.msg(WARNING, "Too many connections - waiting for old to close");
-                            Glib::TimeVal etime;
-                            etime.assign_current_time();
-                            etime.add_milliseconds(10000); // 10 s
-                            it.cond_.timed_wait(it.lock_,etime);
-                            first_time = false;
-                        };
-                    };
-                    if(!rejected) {
-                      mcc_tcp_exec_t t(&it,h,i->timeout,i->no_delay);
-                    };
+                    ++p;
                 };
             };
         };
         it.lock_.unlock();
     };
+    it.lock_.lock();
+    for(std::map<int,mcc_tcp_exec_t*>::iterator p = it.parked_.begin();p != it.parked_.end();p = it.parked_.begin()) {
+        mcc_tcp_exec_t& e = *(p->second);
+        it.poller_->Remove(p->first);
+        it.parked_.erase(p);
+        it.close_connection(e);
+    };
+    for(std::list<mcc_tcp_exec_t*>::iterator q = it.queue_.begin();q != it.queue_.end();q = it.queue_.erase(q)) {
+        it.close_connection(**q);
+    };
+    for(std::list<mcc_tcp_handle_t>::iterator i = it.handles_.begin();i!=it.handles_.end();i=it.handles_.erase(i)) {
+        it.poller_->Remove(i->handle);
+        ::close(i->handle);
+    };
+    // Without listening thread connections can't be returned for waiting
+    it.shutdown_ = true;
+    it.work_cond_.broadcast();
+    it.lock_.unlock();
     return;
 }
 
@@ -471,112 +765,129 @@ static bool get_host_port(struct sockaddr_storage *addr, std::string &host, std:
     return true;
 }
 
-void MCC_TCP_Service::executer(void* arg) {
-    MCC_TCP_Service& it = *(((mcc_tcp_exec_t*)arg)->obj);
-    int s = ((mcc_tcp_exec_t*)arg)->handle;
-    int no_delay = ((mcc_tcp_exec_t*)arg)->no_delay;
-    int timeout = ((mcc_tcp_exec_t*)arg)->timeout;
-    std::string host_attr,port_attr;
-    std::string remotehost_attr,remoteport_attr;
-    std::string endpoint_attr;
-    // Extract useful attributes
-    {
+void MCC_TCP_Service::worker(void* arg) {
+    MCC_TCP_Service& it = *((MCC_TCP_Service*)arg);
+    it.lock_.lock();
+    for(;;) {
+        if(it.queue_.empty()) {
+            if(it.shutdown_) break;
+            Glib::TimeVal etime;
+            etime.assign_current_time();
+            etime.add_seconds(WORKER_IDLE_TIME);
+            ++it.idle_workers_;
+            bool signaled = it.work_cond_.timed_wait(it.lock_,etime);
+            --it.idle_workers_;
+            // Too many threads for current load
+            if((!signaled) && it.queue_.empty()) break;
+            continue;
+        };
+        mcc_tcp_exec_t& e = *(it.queue_.front());
+        it.queue_.pop_front();
+        it.lock_.unlock();
+        bool keep = it.serve(e);
+        it.lock_.lock();
+        if(keep && !it.shutdown_) {
+            // Upper MCCs may already hold next request (decrypted TLS
+            // data, pipelined HTTP) which poller would never report.
+            if(e.context && e.context->Buffered()) {
+                it.dispatch(e);
+            } else {
+                it.park(e);
+            };
+        } else {
+            it.close_connection(e);
+        };
+    };
+    --it.workers_;
+    it.cond_.signal();
+    it.lock_.unlock();
+    return;
+}
+
+bool MCC_TCP_Service::serve(mcc_tcp_exec_t& e) {
+    if(!e.stream) {
+        // Extract useful attributes
         struct sockaddr_storage addr;
         socklen_t addrlen;
         addrlen=sizeof(addr);
-        if(getsockname(s, (struct sockaddr*)(&addr), &addrlen) == 0) {
-            if (get_host_port(&addr, host_attr, port_attr) == true) {
-                endpoint_attr = "://"+host_attr+":"+port_attr;
+        if(getsockname(e.handle, (struct sockaddr*)(&addr), &addrlen) == 0) {
+            if (get_host_port(&addr, e.host_attr, e.port_attr) == true) {
+                e.endpoint_attr = "://"+e.host_attr+":"+e.port_attr;
             }
         }
-        if(getpeername(s, (struct sockaddr*)&addr, &addrlen) == 0) {
-            get_host_port(&addr, remotehost_attr, remoteport_attr);
+        if(getpeername(e.handle, (struct sockaddr*)&addr, &addrlen) == 0) {
+            get_host_port(&addr, e.remotehost_attr, e.remoteport_attr);
         }
         // SESSIONID
+        // Creating stream payload. It and context are kept for whole
+        // lifetime of connection because next MCCs may store their state
+        // in context.
+        e.stream = new PayloadTCPSocket(e.handle, e.timeout, logger);
+        e.stream->NoDelay(e.no_delay);
+        e.context = new MessageContext;
+        e.auth_context = new MessageAuthContext;
     };
-
-    // Creating stream payload
-    PayloadTCPSocket stream(s, timeout, logger);
-    stream.NoDelay(no_delay);
-    MessageContext context;
-    MessageAuthContext auth_context;
-    for(;;) {
-        // TODO: Check state of socket here and leave immediately if not connected anymore.
-        // Preparing Message objects for chain
-        MessageAttributes attributes_in;
-        MessageAttributes attributes_out;
-        MessageAuth auth_in;
-        MessageAuth auth_out;
-        Message nextinmsg;
-        Message nextoutmsg;
-        nextinmsg.Payload(&stream);
-        nextinmsg.Attributes(&attributes_in);
-        nextinmsg.Attributes()->set("TCP:HOST",host_attr);
-        nextinmsg.Attributes()->set("TCP:PORT",port_attr);
-        nextinmsg.Attributes()->set("TCP:REMOTEHOST",remotehost_attr);
-        nextinmsg.Attributes()->set("TCP:REMOTEPORT",remoteport_attr);
-        nextinmsg.Attributes()->set("TCP:ENDPOINT",endpoint_attr);
-        nextinmsg.Attributes()->set("ENDPOINT",endpoint_attr);
-        nextinmsg.Context(&context);
-        nextinmsg.Auth(&auth_in);
-        TCPSecAttr* tattr = new TCPSecAttr(remotehost_attr, remoteport_attr, host_attr, port_attr);
-        nextinmsg.Auth()->set("TCP",tattr);
-        nextinmsg.AuthContext(&auth_context);
-        nextoutmsg.Attributes(&attributes_out);
-        nextoutmsg.Context(&context);
-        nextoutmsg.Auth(&auth_out);
-        nextoutmsg.AuthContext(&auth_context);
-        if(!it.ProcessSecHandlers(nextinmsg,"incoming")) break;
-        // Call next MCC
-        MCCInterface* next = it.Next();
-        if(!next) break;
-        logger.msg(VERBOSE, "next chain element called");
-        MCC_Status ret = next->process(nextinmsg,nextoutmsg);
-        if(!it.ProcessSecHandlers(nextoutmsg,"outgoing")) {
-          if(nextoutmsg.Payload()) delete nextoutmsg.Payload();
-          break;
-        };
-        // If nextoutmsg contains some useful payload send it here.
-        // So far only buffer payload is supported
-        // Extracting payload
-        if(nextoutmsg.Payload()) {
-            PayloadRawInterface* outpayload = NULL;
-            try {
-                outpayload = dynamic_cast<PayloadRawInterface*>(nextoutmsg.Payload());
-            } catch(std::exception& e) { };
-            if(!outpayload) {
-                logger.msg(WARNING, "Only Raw Buffer payload is supported for output");
-            } else {
-                // Sending payload
-                for(int n=0;;++n) {
-                    char* buf = outpayload->Buffer(n);
-                    if(!buf) break;
-                    int bufsize = outpayload->BufferSize(n);
-                    if(!(stream.Put(buf,bufsize))) {
-                        logger.msg(ERROR, "Failed to send content of buffer");
-                        break;
-                    };
+    // TODO: Check state of socket here and leave immediately if not connected anymore.
+    // Preparing Message objects for chain
+    MessageAttributes attributes_in;
+    MessageAttributes attributes_out;
+    MessageAuth auth_in;
+    MessageAuth auth_out;
+    Message nextinmsg;
+    Message nextoutmsg;
+    nextinmsg.Payload(e.stream);
+    nextinmsg.Attributes(&attributes_in);
+    nextinmsg.Attributes()->set("TCP:HOST",e.host_attr);
+    nextinmsg.Attributes()->set("TCP:PORT",e.port_attr);
+    nextinmsg.Attributes()->set("TCP:REMOTEHOST",e.remotehost_attr);
+    nextinmsg.Attributes()->set("TCP:REMOTEPORT",e.remoteport_attr);
+    nextinmsg.Attributes()->set("TCP:ENDPOINT",e.endpoint_attr);
+    nextinmsg.Attributes()->set("ENDPOINT",e.endpoint_attr);
+    nextinmsg.Context(e.context);
+    nextinmsg.Auth(&auth_in);
+    TCPSecAttr* tattr = new TCPSecAttr(e.remotehost_attr, e.remoteport_attr, e.host_attr, e.port_attr);
+    nextinmsg.Auth()->set("TCP",tattr);
+    nextinmsg.AuthContext(e.auth_context);
+    nextoutmsg.Attributes(&attributes_out);
+    nextoutmsg.Context(e.context);
+    nextoutmsg.Auth(&auth_out);
+    nextoutmsg.AuthContext(e.auth_context);
+    if(!ProcessSecHandlers(nextinmsg,"incoming")) return false;
+    // Call next MCC
+    MCCInterface* next = Next();
+    if(!next) return false;
+    logger.msg(VERBOSE, "next chain element called");
+    MCC_Status ret = next->process(nextinmsg,nextoutmsg);
+    if(!ProcessSecHandlers(nextoutmsg,"outgoing")) {
+      if(nextoutmsg.Payload()) delete nextoutmsg.Payload();
+      return false;
+    };
+    // If nextoutmsg contains some useful payload send it here.
+    // So far only buffer payload is supported
+    // Extracting payload
+    if(nextoutmsg.Payload()) {
+        PayloadRawInterface* outpayload = NULL;
+        try {
+            outpayload = dynamic_cast<PayloadRawInterface*>(nextoutmsg.Payload());
+        } catch(std::exception& ex) { };
+        if(!outpayload) {
+            logger.msg(WARNING, "Only Raw Buffer payload is supported for output");
+        } else {
+            // Sending payload
+            for(int n=0;;++n) {
+                char* buf = outpayload->Buffer(n);
+                if(!buf) break;
+                int bufsize = outpayload->BufferSize(n);
+                if(!(e.stream->Put(buf,bufsize))) {
+                    logger.msg(ERROR, "Failed to send content of buffer");
+                    break;
                 };
             };
-            delete nextoutmsg.Payload();
         };
-        if(!ret) break;
+        delete nextoutmsg.Payload();
     };
-    it.lock_.lock();
-    for(std::list<mcc_tcp_exec_t>::iterator e = it.executers_.begin();e != it.executers_.end();++e) {
-        if((mcc_tcp_exec_t*)arg == &(*e)) {
-            logger.msg(VERBOSE, "TCP executor is removed");
-            if(s != e->handle)
-              logger.msg(ERROR, "Sockets do not match on exit %i != %i",s,e->handle);
-            it.executers_.erase(e);
-            break;
-        };
-    };
-    ::shutdown(s,2);
-    ::close(s);
-    it.cond_.signal();
-    it.lock_.unlock();
-    return;
+    if(!ret) return false;
+    return true;
 }
 
 MCC_Status MCC_TCP_Service::process(Message&,Message&) {
@@ -1,6 +1,9 @@
 #ifndef __ARC_MCCTCP_H__
 #define __ARC_MCCTCP_H__
 
+#include <list>
+#include <map>
+
 #include <arc/message/MCC.h>
 #include <arc/message/PayloadStream.h>
 #include "PayloadTCPSocket.h"
@@ -22,15 +25,21 @@ using namespace Arc;
     friend class PayloadTCPSocket;
   };
 
+class TCPPoller;
+
 /** This class is MCC implementing TCP server.
   Upon creation this object binds to specified TCP ports and listens
- for incoming TCP connections on dedicated thread. Each connection is
- accepted and dedicated thread is created. Then that thread is used
- to call process() method of next MCC in chain. That method is passed
+ for incoming TCP connections on dedicated thread. Same thread waits for
+ requests on all accepted connections. Connection which got data is
+ passed to one of worker threads and that thread is used to call
+ process() method of next MCC in chain. That method is passed
  payload implementing PayloadStreamInterface. On response payload
  with PayloadRawInterface is expected. Alternatively called MCC
  may use provided PayloadStreamInterface to send it's response back
- directly.
+ directly. After response is sent connection is returned to listening
+ thread till next request arrives. Hence idle keep-alive connections
+ do not occupy any thread. Worker threads are started on demand up
+ to configured limit and exit after being idle for a while.
   During processing of request this MCC generates following attributes:
    TCP:HOST - IP address of interface to which local TCP socket is bound
    TCP:PORT - port number to which local TCP socket is bound
@@ -49,6 +58,17 @@ class MCC_TCP_Service: public MCC_TCP
                 int handle;
                 bool no_delay;
                 int timeout;
+                time_t last_active; /** when connection was used last time */
+                std::list<mcc_tcp_exec_t>::iterator self; /** position in executers_ */
+                /* State kept between requests. Created when first request arrives. */
+                PayloadTCPSocket* stream;
+                MessageContext* context;
+                MessageAuthContext* auth_context;
+                std::string host_attr;
+                std::string port_attr;
+                std::string remotehost_attr;
+                std::string remoteport_attr;
+                std::string endpoint_attr;
                 mcc_tcp_exec_t(MCC_TCP_Service* o,int h,int t, bool nd = false);
                 operator bool(void) { return (handle != -1); };
         };
@@ -62,14 +82,31 @@ class MCC_TCP_Service: public MCC_TCP
         };
         bool valid_;
         std::list<mcc_tcp_handle_t> handles_; /** listening sockets */
-        std::list<mcc_tcp_exec_t> executers_; /** active connections and associated threads */
+        std::list<mcc_tcp_exec_t> executers_; /** all accepted connections */
+        std::map<int,mcc_tcp_exec_t*> parked_; /** connections waiting for next request */
+        std::list<mcc_tcp_exec_t*> queue_; /** connections with request waiting for worker */
         int max_executers_;
         bool max_executers_drop_;
+        int max_workers_;
+        int workers_; /** number of running worker threads */
+        int idle_workers_; /** number of worker threads waiting for connections */
+        bool on_hold_; /** listening sockets are not watched because of connections limit */
+        bool shutdown_;
+        TCPPoller* poller_;
         /* pthread_t listen_th_; ** thread listening for incoming connections */
         Glib::Mutex lock_; /** lock for safe operations in internal lists */
         Glib::Cond cond_;
+        Glib::Cond work_cond_; /** signaled when connection is queued */
         static void listener(void *); /** executing function for listening thread */
-        static void executer(void *); /** executing function for connection thread */
+        static void worker(void *); /** executing function for worker threads */
+        /* Following methods must be called with lock_ held */
+        void accept_connections(mcc_tcp_handle_t& l);
+        void park(mcc_tcp_exec_t& e);
+        void dispatch(mcc_tcp_exec_t& e);
+        void close_connection(mcc_tcp_exec_t& e);
+        /** Processes one request from connection. Returns true if
+           connection may be used for more requests. */
+        bool serve(mcc_tcp_exec_t& e);
     public:
         MCC_TCP_Service(Config *cfg, PluginArgument* parg);
         virtual ~MCC_TCP_Service(void);
@@ -14,6 +14,9 @@
 #include <sys/poll.h>
 #include <netinet/tcp.h>
 #include <fcntl.h>
+#ifdef HAVE_SYS_SENDFILE_H
+#include <sys/sendfile.h>
+#endif
 
 #include <glibmm.h>
 
@@ -233,6 +236,51 @@ bool PayloadTCPSocket::Put(const char* buf,Size_t size) {
   return true;
 }
 
+bool PayloadTCPSocket::Put(PayloadStreamInterface& source,Size_t size) {
+#ifdef HAVE_SYS_SENDFILE_H
+  PayloadStream* file = dynamic_cast<PayloadStream*>(&source);
+  int h = file ? file->GetHandle() : -1;
+  struct stat st;
+  if((handle_ != -1) && (h != -1) && (::fstat(h,&st) == 0) && S_ISREG(st.st_mode)) {
+    // Stream reads from current position of handle. sendfile() without
+    // offset does same and also moves position.
+    if(file->Limit() > 0) {
+      Size_t left = file->Limit() - file->Pos();
+      if(left < 0) left = 0;
+      if((size == -1) || (size > left)) size = left;
+    };
+    bool started = false;
+    // Timeout applies to every portion separately because transfer of
+    // whole file may take long time.
+    time_t start = time(NULL);
+    while(size != 0) {
+      unsigned int events = POLLOUT | POLLERR;
+      int to = timeout_-(unsigned int)(time(NULL)-start);
+      if(to < 0) to = 0;
+      if(spoll(handle_,to,events) != 1) return false;
+      if(!(events & POLLOUT)) return false;
+      size_t portion = 16*1024*1024;
+      if((size != -1) && (size < (Size_t)portion)) portion = size;
+      ssize_t l = ::sendfile(handle_,h,NULL,portion);
+      if(l == -1) {
+        if((errno == EINTR) || (errno == EAGAIN)) continue;
+        // File system may not support it. Then use ordinary way.
+        if((!started) && ((errno == EINVAL) || (errno == ENOSYS))) break;
+        logger.msg(VERBOSE, "Failed to send file content: %s", StrError(errno));
+        return false;
+      };
+      // Unexpected end of file
+      if(l == 0) return (size == -1);
+      started = true;
+      if(size != -1) size -= l;
+      start = time(NULL);
+    };
+    if(size == 0) return true;
+  };
+#endif
+  return PayloadStreamInterface::Put(source,size);
+}
+
 void PayloadTCPSocket::NoDelay(bool val) {
   if(handle_ == -1) return;
   int flag = val?1:0;
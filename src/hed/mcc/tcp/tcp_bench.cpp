@@ -0,0 +1,233 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+// Measures how service behind tcp.service scales with number of
+// concurrent keep-alive connections. Opens requested number of plain
+// HTTP connections and makes every one of them send series of requests,
+// waiting for response before sending next one. Each connection
+// optionally pauses between requests in order to simulate clients
+// which poll service periodically and hence keep mostly idle
+// connections open.
+
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+#include <cerrno>
+#include <string>
+#include <vector>
+#include <iostream>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <sys/types.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+#include <sys/resource.h>
+
+static double now(void) {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+struct Connection {
+  int handle;
+  int done;            // number of completed requests
+  bool waiting;        // request sent, waiting for response
+  double sent;         // when request was sent
+  double next;         // when next request is to be sent
+  std::string out;     // unsent part of request
+  std::string in;      // received part of response
+};
+
+static void usage(const char* name) {
+  std::cerr << "Usage: " << name
+            << " [-c connections] [-n requests] [-i interval_ms] [-p path] host port" << std::endl;
+  std::cerr << "Service must be accessible over plain HTTP with keep-alive." << std::endl;
+}
+
+// Returns length of complete response at beginning of buffer,
+// 0 if response is not complete yet and -1 if it can't be parsed.
+static int response_length(const std::string& buf) {
+  std::string::size_type hend = buf.find("\r\n\r\n");
+  if (hend == std::string::npos) return 0;
+  std::string::size_type p = 0;
+  long clen = -1;
+  while (p < hend) {
+    std::string::size_type e = buf.find("\r\n", p);
+    std::string line = buf.substr(p, e - p);
+    p = e + 2;
+    if (strncasecmp(line.c_str(), "Content-Length:", 15) == 0) clen = atol(line.c_str() + 15);
+  }
+  if (clen < 0) return -1;
+  if (buf.length() < hend + 4 + clen) return 0;
+  return hend + 4 + clen;
+}
+
+int main(int argc, char** argv) {
+  int connections = 100;
+  int requests = 10;
+  int interval = 0;
+  std::string path = "/";
+  int opt;
+  while ((opt = getopt(argc, argv, "c:n:i:p:h")) != -1) {
+    switch (opt) {
+      case 'c': connections = atoi(optarg); break;
+      case 'n': requests = atoi(optarg); break;
+      case 'i': interval = atoi(optarg); break;
+      case 'p': path = optarg; break;
+      default: usage(argv[0]); return 1;
+    }
+  }
+  if ((argc - optind) != 2 || connections <= 0 || requests <= 0) {
+    usage(argv[0]);
+    return 1;
+  }
+  std::string host = argv[optind];
+  std::string port = argv[optind + 1];
+
+  // Every connection needs descriptor
+  struct rlimit rl;
+  if (getrlimit(RLIMIT_NOFILE, &rl) == 0) {
+    rl.rlim_cur = rl.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &rl);
+    if ((rlim_t)connections + 16 > rl.rlim_cur) {
+      std::cerr << "Too many connections for descriptors limit " << rl.rlim_cur << std::endl;
+      return 1;
+    }
+  }
+
+  struct addrinfo hint;
+  struct addrinfo* info = NULL;
+  memset(&hint, 0, sizeof(hint));
+  hint.ai_socktype = SOCK_STREAM;
+  hint.ai_protocol = IPPROTO_TCP;
+  int r = getaddrinfo(host.c_str(), port.c_str(), &hint, &info);
+  if (r != 0) {
+    std::cerr << "Failed to resolve " << host << ":" << port << " - " << gai_strerror(r) << std::endl;
+    return 1;
+  }
+
+  std::string request = "GET " + path + " HTTP/1.1\r\nHost: " + host + ":" + port +
+                        "\r\nConnection: keep-alive\r\n\r\n";
+
+  std::vector<Connection> conns(connections);
+  double start = now();
+  int failed = 0;
+  for (int n = 0; n < connections; ++n) {
+    Connection& c = conns[n];
+    c.handle = ::socket(info->ai_family, info->ai_socktype, info->ai_protocol);
+    if ((c.handle == -1) || (::connect(c.handle, info->ai_addr, info->ai_addrlen) != 0)) {
+      std::cerr << "Failed to connect: " << strerror(errno) << std::endl;
+      if (c.handle != -1) ::close(c.handle);
+      c.handle = -1;
+      ++failed;
+      continue;
+    }
+    ::fcntl(c.handle, F_SETFL, ::fcntl(c.handle, F_GETFL) | O_NONBLOCK);
+    c.done = 0;
+    c.waiting = false;
+    c.sent = 0;
+    // Spread first requests over interval
+    c.next = start + (interval ? (interval / 1000.0) * n / connections : 0);
+  }
+  freeaddrinfo(info);
+  double connected = now();
+  std::cout << "Connected " << (connections - failed) << " of " << connections
+            << " in " << (connected - start) << " s" << std::endl;
+
+  unsigned long long int completed = 0;
+  double latency_sum = 0;
+  double latency_max = 0;
+  int active = connections - failed;
+  std::vector<struct pollfd> fds;
+  std::vector<int> idx;
+  while (active > 0) {
+    double t = now();
+    double wake = t + 1;
+    fds.clear();
+    idx.clear();
+    for (int n = 0; n < connections; ++n) {
+      Connection& c = conns[n];
+      if (c.handle == -1) continue;
+      if (!c.waiting) {
+        if (c.next > t) {
+          if (c.next < wake) wake = c.next;
+          continue;
+        }
+        c.out = request;
+        c.in.clear();
+        c.waiting = true;
+        c.sent = t;
+      }
+      struct pollfd fd;
+      fd.fd = c.handle;
+      fd.events = POLLIN | (c.out.empty() ? 0 : POLLOUT);
+      fd.revents = 0;
+      fds.push_back(fd);
+      idx.push_back(n);
+    }
+    int to = (int)((wake - t) * 1000);
+    if (to < 0) to = 0;
+    if (fds.empty()) {
+      usleep(to * 1000);
+      continue;
+    }
+    if (::poll(&(fds[0]), fds.size(), to) < 0) {
+      if (errno == EINTR) continue;
+      std::cerr << "Failed to wait for connections: " << strerror(errno) << std::endl;
+      return 1;
+    }
+    t = now();
+    for (std::vector<struct pollfd>::size_type i = 0; i < fds.size(); ++i) {
+      if (!fds[i].revents) continue;
+      Connection& c = conns[idx[i]];
+      bool error = false;
+      if (!c.out.empty() && (fds[i].revents & POLLOUT)) {
+        ssize_t l = ::write(c.handle, c.out.c_str(), c.out.length());
+        if (l > 0) c.out.erase(0, l);
+        else if (errno != EAGAIN) error = true;
+      }
+      if (!error && (fds[i].revents & (POLLIN | POLLHUP | POLLERR))) {
+        char buf[16384];
+        ssize_t l = ::read(c.handle, buf, sizeof(buf));
+        if (l > 0) c.in.append(buf, l);
+        else if ((l == 0) || (errno != EAGAIN)) error = true;
+      }
+      int rlen = error ? -1 : response_length(c.in);
+      if (rlen == 0) continue;
+      if (rlen < 0) {
+        std::cerr << "Connection " << idx[i] << " failed after " << c.done << " requests" << std::endl;
+        ::close(c.handle);
+        c.handle = -1;
+        ++failed;
+        --active;
+        continue;
+      }
+      double latency = t - c.sent;
+      latency_sum += latency;
+      if (latency > latency_max) latency_max = latency;
+      ++completed;
+      c.waiting = false;
+      c.next = t + interval / 1000.0;
+      if (++c.done >= requests) {
+        ::close(c.handle);
+        c.handle = -1;
+        --active;
+      }
+    }
+  }
+  double finished = now();
+  std::cout << "Completed " << completed << " requests in " << (finished - connected) << " s";
+  if (finished > connected) std::cout << " (" << (completed / (finished - connected)) << " requests/s)";
+  std::cout << std::endl;
+  if (completed > 0) {
+    std::cout << "Latency: average " << (latency_sum / completed * 1000) << " ms, maximal "
+              << (latency_max * 1000) << " ms" << std::endl;
+  }
+  std::cout << "Failed connections: " << failed << std::endl;
+  return (failed == 0) ? 0 : 2;
+}
@@ -2,9 +2,13 @@
 #include <config.h>
 #endif
 
+#include <sys/stat.h>
+
 #include <glibmm/miscutils.h>
 #include <openssl/err.h>
+#include <openssl/evp.h>
 
+#include <arc/StringConv.h>
 #include <arc/credential/Credential.h>
 
 #include "PayloadTLSStream.h"
@@ -52,10 +56,27 @@ ConfigTLSMCC::ConfigTLSMCC(XMLNode cfg,bool client) {
   handshake_ = (cfg["Handshake"] == "SSLv3")?ssl3_handshake:tls_handshake;
   proxy_file_ = (std::string)(cfg["ProxyPath"]);
   credential_ = (std::string)(cfg["Credential"]);
+  // Resumption skips exchange of certificates. Hence it is only
+  // enabled by default on client side where it is server which
+  // decides if session can be resumed. GSI is left as it is.
+  session_cache_ = client;
+  if(cfg["SessionCache"] == "true") {
+    session_cache_ = true;
+  } else if(cfg["SessionCache"] == "false") {
+    session_cache_ = false;
+  }
+  if(globus_gsi_ || globusio_gsi_) session_cache_ = false;
+  session_timeout_ = 300;
+  if((bool)(cfg["SessionTimeout"])) {
+    if(!stringto((std::string)(cfg["SessionTimeout"]),session_timeout_) || (session_timeout_ <= 0)) {
+      session_cache_ = false;
+    }
+  }
   if(client) {
     // Client is using safest setup by default
     cipher_list_ = "TLSv1:SSLv3:!eNULL:!aNULL";
     hostname_ = (std::string)(cfg["Hostname"]);
+    port_ = (std::string)(cfg["Port"]);
     XMLNode protocol_node = cfg["Protocol"];
     while((bool)protocol_node) {
       std::string protocol = (std::string)protocol_node;
@@ -229,6 +250,35 @@ bool ConfigTLSMCC::Set(SSL_CTX* sslctx) {
   return true;
 }
 
+static std::string file_stamp(const std::string& path) {
+  struct stat st;
+  if(path.empty() || (::stat(path.c_str(),&st) != 0)) return "";
+  return tostring(st.st_mtime)+":"+tostring(st.st_size);
+}
+
+std::string ConfigTLSMCC::SessionKey(void) const {
+  if(hostname_.empty()) return "";
+  // Renewed credentials must make new session
+  // Different services may run on same host
+  return hostname_+"\n"+port_+"\n"+cert_file_+"\n"+file_stamp(cert_file_)+"\n"+
+         key_file_+"\n"+file_stamp(key_file_)+"\n"+credential_+"\n"+
+         ca_file_+"\n"+ca_dir_+"\n"+tostring((int)handshake_)+"\n"+
+         cipher_list_+"\n"+protocols_;
+}
+
+std::string ConfigTLSMCC::SessionContext(void) const {
+  std::string context = cert_file_+"\n"+key_file_+"\n"+credential_+"\n"+
+         ca_file_+"\n"+ca_dir_+"\n"+(client_authn_?"1":"0")+"\n"+
+         (globus_policy_?"1":"0")+"\n"+tostring((int)handshake_)+"\n"+
+         cipher_list_;
+  // Context passed to OpenSSL is limited in size
+  unsigned char md[EVP_MAX_MD_SIZE];
+  unsigned int md_len = 0;
+  if(!EVP_Digest(context.c_str(),context.length(),md,&md_len,EVP_sha256(),NULL)) return "";
+  if(md_len > SSL_MAX_SID_CTX_LENGTH) md_len = SSL_MAX_SID_CTX_LENGTH;
+  return std::string((char const*)md,md_len);
+}
+
 std::string ConfigTLSMCC::HandleError(int code) {
   std::string errstr;
   unsigned long e = (code==SSL_ERROR_NONE)?ERR_get_error():code;
@@ -25,6 +25,8 @@ class ConfigTLSMCC {
   bool globus_policy_;
   bool globus_gsi_;
   bool globusio_gsi_;
+  bool session_cache_;
+  int session_timeout_;
   enum {
     tls_handshake, // default
     ssl3_handshake,
@@ -44,6 +46,7 @@ class ConfigTLSMCC {
   std::vector<std::string> vomscert_trust_dn_;
   std::string cipher_list_;
   std::string hostname_;
+  std::string port_;
   std::string protocols_;
   std::string protocol_;
   std::string failure_;
@@ -74,6 +77,14 @@ class ConfigTLSMCC {
   bool IfFailOnVOMSParsing(void) const { return (voms_processing_ == noerrors_voms) || (voms_processing_ == strict_voms); };
   bool IfFailOnVOMSInvalid(void) const { return (voms_processing_ == noerrors_voms); };
   const std::string& Hostname() const { return hostname_; };
+  bool SessionCache(void) const { return session_cache_; };
+  int SessionTimeout(void) const { return session_timeout_; };
+  /** Identifies endpoint and credentials for storing client sessions.
+    Empty if there is not enough information. */
+  std::string SessionKey(void) const;
+  /** Identifies service configuration for server sessions. Sessions
+    established with one configuration are not accepted by another. */
+  std::string SessionContext(void) const;
   const std::string& Failure(void) { return failure_; };
   static std::string HandleError(int code = SSL_ERROR_NONE);
   static void ClearError(void);
@@ -30,9 +30,14 @@
 #include "PayloadTLSMCC.h"
 
 #include "DelegationCollector.h"
+#include "TLSAuthCache.h"
 
 #include "MCCTLS.h"
 
+#if (OPENSSL_VERSION_NUMBER < 0x10100000L)
+#define X509_getm_notAfter X509_get_notAfter
+#endif
+
 namespace ArcMCCTLS {
 
 using namespace Arc;
@@ -118,14 +123,25 @@ class TLSSecAttr: public SecAttr {
   std::string x509chainstr_; // Other certificates (in string format). TODO: extract on demand.
   bool processing_failed_;
   virtual bool equal(const SecAttr &b) const;
+  // Extracts information from peer certificates. Returns time till which
+  // it stays valid or -1 if it can't be defined.
+  time_t ProcessPeer(STACK_OF(X509)* peerchain, X509* peercert, ConfigTLSMCC& config, Logger& logger);
 };
 
 #define SELFSIGNED(cert) (X509_NAME_cmp(X509_get_issuer_name(cert),X509_get_subject_name(cert)) == 0)
 
-TLSSecAttr::TLSSecAttr(PayloadTLSStream& payload, ConfigTLSMCC& config, Logger& logger) {
+Time asn1_to_utctime(const ASN1_UTCTIME *s);
+
+// Makes expires earliest of itself and t. Value -1 means undefined.
+static void update_expiration(time_t& expires, const Time& t) {
+  time_t tt = t.GetTime();
+  if(tt == -1) return;
+  if((expires == -1) || (tt < expires)) expires = tt;
+}
+
+time_t TLSSecAttr::ProcessPeer(STACK_OF(X509)* peerchain, X509* peercert, ConfigTLSMCC& config, Logger& logger) {
    std::string subject;
-   processing_failed_ = false;
-   STACK_OF(X509)* peerchain = payload.GetPeerChain();
+   time_t expires = -1;
    voms_attributes_.clear();
    if(peerchain != NULL) {
       for(int idx = 0;;++idx) {
@@ -153,6 +169,7 @@ TLSSecAttr::TLSSecAttr(PayloadTLSStream& payload, ConfigTLSMCC& config, Logger&
          std::string certstr;
          x509_to_string(cert, certstr);
          x509chainstr_=certstr+x509chainstr_;
+         update_expiration(expires, asn1_to_utctime(X509_getm_notAfter(cert)));
          if(X509_get_ext_by_NID(cert,NID_proxyCertInfo,-1) < 0) {
             identity_=subject;
          };
@@ -164,7 +181,6 @@ TLSSecAttr::TLSSecAttr(PayloadTLSStream& payload, ConfigTLSMCC& config, Logger&
          };
       };
    };
-   X509* peercert = payload.GetPeerCert();
    if (peercert != NULL) {
       if(subjects_.size() <= 0) { // Obtain CA subject if not obtained yet
         // Check for CA certificate used for connection - overprotection
@@ -197,9 +213,51 @@ TLSSecAttr::TLSSecAttr(PayloadTLSStream& payload, ConfigTLSMCC& config, Logger&
       };
       // Convert the x509 cert into string format
       x509_to_string(peercert, x509str_);
-      X509_free(peercert);
+      update_expiration(expires, asn1_to_utctime(X509_getm_notAfter(peercert)));
    };
    if(identity_.empty()) identity_=subject;
+   // Attributes which are not valid yet or expire must be processed again.
+   for(std::vector<VOMSACInfo>::iterator v = voms_attributes_.begin();
+                                           v != voms_attributes_.end(); ++v) {
+     if(v->from.GetTime() > ::time(NULL)) update_expiration(expires, v->from);
+     update_expiration(expires, v->till);
+   };
+   return expires;
+}
+
+TLSSecAttr::TLSSecAttr(PayloadTLSStream& payload, ConfigTLSMCC& config, Logger& logger) {
+   processing_failed_ = false;
+   STACK_OF(X509)* peerchain = payload.GetPeerChain();
+   X509* peercert = payload.GetPeerCert();
+   // Same peer usually connects repeatedly. Results of processing its
+   // certificates are shared by connections using same configuration.
+   std::string config_id = config.CADir() + "\n" + config.CAFile() + "\n" + config.VOMSDir();
+   for(std::vector<std::string>::const_iterator dn = config.VOMSCertTrustDN().begin();
+                               dn != config.VOMSCertTrustDN().end(); ++dn) config_id += "\n" + *dn;
+   std::string key = TLSAuthCache::Key(peerchain, peercert, config_id);
+   TLSAuthCache::Result result;
+   if(TLSAuthCache::Instance().Get(key, result)) {
+      identity_ = result.identity;
+      subjects_ = result.subjects;
+      voms_attributes_ = result.voms_attributes;
+      x509str_ = result.x509str;
+      x509chainstr_ = result.x509chainstr;
+   } else {
+      time_t expires = ProcessPeer(peerchain, peercert, config, logger);
+      if((!key.empty()) && (expires != -1)) {
+         result.identity = identity_;
+         result.subjects = subjects_;
+         result.voms_attributes = voms_attributes_;
+         result.x509str = x509str_;
+         result.x509chainstr = x509chainstr_;
+         std::list<std::string> paths;
+         if(!config.CADir().empty()) paths.push_back(config.CADir());
+         if(!config.CAFile().empty()) paths.push_back(config.CAFile());
+         if(!config.VOMSDir().empty()) paths.push_back(config.VOMSDir());
+         TLSAuthCache::Instance().Put(key, result, expires, paths);
+      };
+   };
+   if(peercert) X509_free(peercert);
    X509* hostcert = payload.GetCert();
    if (hostcert != NULL) {
       char* buf = X509_NAME_oneline(X509_get_subject_name(hostcert),NULL,0);
@@ -370,6 +428,7 @@ class MCC_TLS_Context:public MessageContextElement {
   PayloadTLSMCC* stream;
   MCC_TLS_Context(PayloadTLSMCC* s = NULL):stream(s) { };
   virtual ~MCC_TLS_Context(void) { if(stream) delete stream; };
+  virtual bool Buffered(void) const { return stream && (stream->Pending() > 0); };
 };
 
 /* The main functionality of the constructor method is to
@@ -7,6 +7,7 @@
 #include "GlobusSigningPolicy.h"
 
 #include "PayloadTLSMCC.h"
+#include "TLSSessionCache.h"
 #include <openssl/err.h>
 #include <glibmm/miscutils.h>
 #include <arc/DateTime.h>
@@ -170,6 +171,48 @@ bool PayloadTLSMCC::ClearInstance(void) {
   return false;
 }
 
+PayloadTLSMCC* PayloadTLSMCC::RetrieveInstance(SSL* ssl) {
+  if((ex_data_index_ == -1) || (ssl == NULL)) return NULL;
+  SSL_CTX* ssl_ctx = SSL_get_SSL_CTX(ssl);
+  if(ssl_ctx == NULL) return NULL;
+  return (PayloadTLSMCC*)SSL_CTX_get_ex_data(ssl_ctx,ex_data_index_);
+}
+
+// Called by OpenSSL when client receives session which can be resumed.
+// For TLSv1.3 that happens after handshake when ticket arrives.
+int PayloadTLSMCC::client_new_session_callback(SSL* ssl, SSL_SESSION* session) {
+  PayloadTLSMCC* it = RetrieveInstance(ssl);
+  if((it == NULL) || it->session_key_.empty()) return 0;
+  TLSSessionCache::Client().Put(it->session_key_,session);
+  return 1;
+}
+
+int PayloadTLSMCC::server_new_session_callback(SSL*, SSL_SESSION* session) {
+  unsigned int len = 0;
+  const unsigned char* id = SSL_SESSION_get_id(session,&len);
+  if((id == NULL) || (len == 0)) return 0;
+  TLSSessionCache::Server().Put(std::string((char const*)id,len),session);
+  return 1;
+}
+
+#if (OPENSSL_VERSION_NUMBER < 0x10100000L)
+SSL_SESSION* PayloadTLSMCC::server_get_session_callback(SSL*, unsigned char* id, int len, int* copy) {
+#else
+SSL_SESSION* PayloadTLSMCC::server_get_session_callback(SSL*, const unsigned char* id, int len, int* copy) {
+#endif
+  // Reference is already added by cache
+  *copy = 0;
+  if((id == NULL) || (len <= 0)) return NULL;
+  return TLSSessionCache::Server().Get(std::string((char const*)id,len));
+}
+
+void PayloadTLSMCC::server_remove_session_callback(SSL_CTX*, SSL_SESSION* session) {
+  unsigned int len = 0;
+  const unsigned char* id = SSL_SESSION_get_id(session,&len);
+  if((id == NULL) || (len == 0)) return;
+  TLSSessionCache::Server().Remove(std::string((char const*)id,len));
+}
+
 PayloadTLSMCC* PayloadTLSMCC::RetrieveInstance(X509_STORE_CTX* container) {
   PayloadTLSMCC* it = NULL;
   if(ex_data_index_ != -1) {
@@ -258,7 +301,14 @@ PayloadTLSMCC::PayloadTLSMCC(MCCInterface* mcc, const ConfigTLSMCC& cfg, Logger&
       goto error;
    };
    SSL_CTX_set_mode(sslctx_,SSL_MODE_ENABLE_PARTIAL_WRITE);
-   SSL_CTX_set_session_cache_mode(sslctx_,SSL_SESS_CACHE_OFF);
+   if(config_.SessionCache()) session_key_ = config_.SessionKey();
+   if(!session_key_.empty()) {
+     // Sessions are stored by callback in process-wide cache
+     SSL_CTX_set_session_cache_mode(sslctx_,SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+     SSL_CTX_sess_set_new_cb(sslctx_,&client_new_session_callback);
+   } else {
+     SSL_CTX_set_session_cache_mode(sslctx_,SSL_SESS_CACHE_OFF);
+   };
    if(!config_.Set(sslctx_)) {
       SetFailure(config_.Failure());
       goto error;
@@ -273,10 +323,10 @@ PayloadTLSMCC::PayloadTLSMCC(MCCInterface* mcc, const ConfigTLSMCC& cfg, Logger&
       X509_VERIFY_PARAM_set_flags(SSL_CTX_get0_param(sslctx_),X509_V_FLAG_CRL_CHECK | X509_V_FLAG_ALLOW_PROXY_CERTS);
    };
    StoreInstance();
-#ifdef SSL_OP_NO_TICKET
-   ctx_options |= SSL_OP_SINGLE_DH_USE | SSL_OP_NO_SSLv2 | SSL_OP_NO_SSLv3 | SSL_OP_ALL | SSL_OP_NO_TICKET;
-#else
    ctx_options |= SSL_OP_SINGLE_DH_USE | SSL_OP_NO_SSLv2 | SSL_OP_NO_SSLv3 | SSL_OP_ALL;
+#ifdef SSL_OP_NO_TICKET
+   // Tickets are useful only if session is going to be resumed
+   if(session_key_.empty()) ctx_options |= SSL_OP_NO_TICKET;
 #endif
    SSL_CTX_set_options(sslctx_, ctx_options);
 
@@ -299,6 +349,14 @@ PayloadTLSMCC::PayloadTLSMCC(MCCInterface* mcc, const ConfigTLSMCC& cfg, Logger&
          logger.msg(WARNING, "Faile to assign hostname extension");
       };
    };
+   if(!session_key_.empty()) {
+      // Server falls back to full handshake if it does not accept session
+      SSL_SESSION* session = TLSSessionCache::Client().Get(session_key_);
+      if(session) {
+        SSL_set_session(ssl_,session);
+        SSL_SESSION_free(session);
+      };
+   };
    SSL_set_bio(ssl_,bio,bio); bio=NULL;
    //SSL_set_connect_state(ssl_);
    if((err=SSL_connect(ssl_)) != 1) {
@@ -311,9 +369,12 @@ PayloadTLSMCC::PayloadTLSMCC(MCCInterface* mcc, const ConfigTLSMCC& cfg, Logger&
       }
       */
       logger.msg(VERBOSE, "Failed to establish SSL connection");
+      // Do not try same session again
+      if(!session_key_.empty()) TLSSessionCache::Client().Remove(session_key_);
       goto error;
    };
    logger.msg(VERBOSE, "Using cipher: %s",SSL_get_cipher_name(ssl_));
+   if(SSL_session_reused(ssl_)) logger.msg(VERBOSE, "Resumed TLS session");
    // if(SSL_in_init(ssl_)){
    //handle error
    // }
@@ -357,7 +418,22 @@ PayloadTLSMCC::PayloadTLSMCC(PayloadStreamInterface* stream, const ConfigTLSMCC&
       goto error;
    };
    SSL_CTX_set_mode(sslctx_,SSL_MODE_ENABLE_PARTIAL_WRITE);
-   SSL_CTX_set_session_cache_mode(sslctx_,SSL_SESS_CACHE_OFF);
+   if(config_.SessionCache()) {
+     std::string context = config_.SessionContext();
+     SSL_CTX_set_session_cache_mode(sslctx_,SSL_SESS_CACHE_SERVER | SSL_SESS_CACHE_NO_INTERNAL);
+     SSL_CTX_set_timeout(sslctx_,config_.SessionTimeout());
+     SSL_CTX_set_session_id_context(sslctx_,(unsigned char const*)context.c_str(),context.length());
+     SSL_CTX_sess_set_new_cb(sslctx_,&server_new_session_callback);
+     SSL_CTX_sess_set_get_cb(sslctx_,&server_get_session_callback);
+     SSL_CTX_sess_set_remove_cb(sslctx_,&server_remove_session_callback);
+#ifdef SSL_OP_NO_TICKET
+     // Tickets carry serialized session which lacks peer certificate
+     // chain. Keep sessions in memory instead.
+     ctx_options |= SSL_OP_NO_TICKET;
+#endif
+   } else {
+     SSL_CTX_set_session_cache_mode(sslctx_,SSL_SESS_CACHE_OFF);
+   };
    if(config_.IfClientAuthn()) {
      SSL_CTX_set_verify(sslctx_, SSL_VERIFY_PEER |  SSL_VERIFY_FAIL_IF_NO_PEER_CERT | SSL_VERIFY_CLIENT_ONCE, &verify_callback);
    }
@@ -403,6 +479,7 @@ PayloadTLSMCC::PayloadTLSMCC(PayloadStreamInterface* stream, const ConfigTLSMCC&
       goto error;
    };
    logger.msg(VERBOSE, "Using cipher: %s",SSL_get_cipher_name(ssl_));
+   if(SSL_session_reused(ssl_)) logger.msg(VERBOSE, "Resumed TLS session");
    //handle error
    // if(SSL_in_init(ssl_)){
    //handle error
@@ -31,6 +31,16 @@ class PayloadTLSMCC: public PayloadTLSStream {
   bool ClearInstance(void);
   // Generic purpose bit flags
   unsigned long flags_;
+  // Key of client session in TLSSessionCache, empty if not cached
+  std::string session_key_;
+  static int client_new_session_callback(SSL* ssl, SSL_SESSION* session);
+  static int server_new_session_callback(SSL* ssl, SSL_SESSION* session);
+#if (OPENSSL_VERSION_NUMBER < 0x10100000L)
+  static SSL_SESSION* server_get_session_callback(SSL* ssl, unsigned char* id, int len, int* copy);
+#else
+  static SSL_SESSION* server_get_session_callback(SSL* ssl, const unsigned char* id, int len, int* copy);
+#endif
+  static void server_remove_session_callback(SSL_CTX* ctx, SSL_SESSION* session);
  public:
   /** Constructor - creates ssl object which is bound to next MCC.
     This instance must be used on client side. It obtains Stream interface
@@ -47,6 +57,7 @@ class PayloadTLSMCC: public PayloadTLSStream {
   virtual ~PayloadTLSMCC(void);
   const ConfigTLSMCC& Config(void) { return config_; };
   static PayloadTLSMCC* RetrieveInstance(X509_STORE_CTX* container);
+  static PayloadTLSMCC* RetrieveInstance(SSL* ssl);
   unsigned long Flags(void) { return flags_; };
   void Flags(unsigned long flags) { flags_=flags; };
   void SetFailure(const std::string& err);
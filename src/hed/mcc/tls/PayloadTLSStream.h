@@ -42,6 +42,8 @@ public:
   virtual bool operator!(void) { return (ssl_ == NULL); };
   virtual int Timeout(void) const { return timeout_; };
   virtual void Timeout(int to) { timeout_=to; };
+  /** Amount of decrypted data waiting in SSL object to be read */
+  int Pending(void) const { return ssl_?SSL_pending(ssl_):0; };
   virtual Size_t Pos(void) const { return 0; };
   virtual Size_t Size(void) const { return 0; };
   virtual Size_t Limit(void) const { return 0; };
@@ -0,0 +1,114 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <openssl/evp.h>
+
+#include "TLSAuthCache.h"
+
+namespace ArcMCCTLS {
+
+// Maximal number of entries kept
+#define AUTH_ENTRIES_MAX (10000)
+// Maximal lifetime of entry (seconds). Limits time revocation of
+// credentials may stay unnoticed if CRLs are updated in place.
+#define AUTH_LIFETIME_MAX (600)
+
+static time_t path_stamp(const std::string& path) {
+  struct stat st;
+  if(::stat(path.c_str(),&st) != 0) return 0;
+  return st.st_mtime;
+}
+
+static bool der_append(X509* cert, std::string& der) {
+  int l = i2d_X509(cert,NULL);
+  if(l <= 0) return false;
+  std::string::size_type p = der.length();
+  der.resize(p+l);
+  unsigned char* buf = (unsigned char*)(&(der[p]));
+  if(i2d_X509(cert,&buf) != l) return false;
+  return true;
+}
+
+std::string TLSAuthCache::Key(STACK_OF(X509)* chain, X509* cert, const std::string& config) {
+  std::string der;
+  if(chain) {
+    for(int idx = 0; idx < sk_X509_num(chain); ++idx) {
+      if(!der_append(sk_X509_value(chain,idx),der)) return "";
+    }
+  }
+  if(cert) {
+    if(!der_append(cert,der)) return "";
+  }
+  if(der.empty()) return "";
+  unsigned char digest[EVP_MAX_MD_SIZE];
+  unsigned int digest_size = 0;
+  if(EVP_Digest(der.c_str(),der.length(),digest,&digest_size,EVP_sha256(),NULL) != 1) return "";
+  std::string key((const char*)digest,digest_size);
+  key.append(config);
+  return key;
+}
+
+TLSAuthCache::TLSAuthCache(unsigned int max_size):max_size_(max_size) {
+}
+
+TLSAuthCache::~TLSAuthCache(void) {
+}
+
+void TLSAuthCache::Erase(std::map<std::string,Entry>::iterator entry) {
+  order_.erase(entry->second.order);
+  entries_.erase(entry);
+}
+
+void TLSAuthCache::Put(const std::string& key, const Result& result, time_t expires,
+                       const std::list<std::string>& paths) {
+  if(key.empty()) return;
+  time_t now = ::time(NULL);
+  if(expires > (now + AUTH_LIFETIME_MAX)) expires = now + AUTH_LIFETIME_MAX;
+  if(expires <= now) return;
+  Entry new_entry;
+  new_entry.result = result;
+  new_entry.expires = expires;
+  for(std::list<std::string>::const_iterator path = paths.begin(); path != paths.end(); ++path) {
+    new_entry.stamps.push_back(std::pair<std::string,time_t>(*path,path_stamp(*path)));
+  }
+  Glib::Mutex::Lock lock(lock_);
+  std::map<std::string,Entry>::iterator entry = entries_.find(key);
+  if(entry != entries_.end()) Erase(entry);
+  while((!order_.empty()) && (entries_.size() >= max_size_)) {
+    Erase(entries_.find(order_.front()));
+  }
+  new_entry.order = order_.insert(order_.end(),key);
+  entries_[key] = new_entry;
+}
+
+bool TLSAuthCache::Get(const std::string& key, Result& result) {
+  if(key.empty()) return false;
+  Glib::Mutex::Lock lock(lock_);
+  std::map<std::string,Entry>::iterator entry = entries_.find(key);
+  if(entry == entries_.end()) return false;
+  bool valid = (::time(NULL) < entry->second.expires);
+  for(std::list< std::pair<std::string,time_t> >::iterator stamp = entry->second.stamps.begin();
+                 valid && (stamp != entry->second.stamps.end()); ++stamp) {
+    if(path_stamp(stamp->first) != stamp->second) valid = false;
+  }
+  if(!valid) {
+    Erase(entry);
+    return false;
+  }
+  result = entry->second.result;
+  return true;
+}
+
+// Never destroyed because at exit that could happen after OpenSSL
+// is already cleaned up.
+TLSAuthCache& TLSAuthCache::Instance(void) {
+  static TLSAuthCache* cache = new TLSAuthCache(AUTH_ENTRIES_MAX);
+  return *cache;
+}
+
+} // namespace ArcMCCTLS
@@ -0,0 +1,67 @@
+#ifndef __ARC_TLSAUTHCACHE_H__
+#define __ARC_TLSAUTHCACHE_H__
+
+#include <ctime>
+#include <list>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <openssl/x509.h>
+
+#include <arc/Thread.h>
+#include <arc/credential/VOMSUtil.h>
+
+namespace ArcMCCTLS {
+
+// Process-wide storage of information extracted from peer certificate
+// chains. Clients reconnecting with same proxy present same chain, so
+// its subjects and VOMS attributes need to be extracted and validated
+// only once. Entries expire together with first expiring certificate
+// or VOMS attribute certificate and are dropped if content of trusted
+// CA or VOMS locations changes (like when CRLs are refreshed).
+class TLSAuthCache {
+ public:
+  struct Result {
+    std::string identity;
+    std::list<std::string> subjects;
+    std::vector<Arc::VOMSACInfo> voms_attributes;
+    std::string x509str;
+    std::string x509chainstr;
+  };
+ private:
+  typedef std::list<std::string> Order;
+  struct Entry {
+    Result result;
+    time_t expires;
+    // Modification times of locations used for validation
+    std::list< std::pair<std::string,time_t> > stamps;
+    Order::iterator order;
+  };
+  Glib::Mutex lock_;
+  std::map<std::string,Entry> entries_;
+  // Keys in order of insertion for evicting oldest entries
+  Order order_;
+  unsigned int max_size_;
+  void Erase(std::map<std::string,Entry>::iterator entry);
+  TLSAuthCache(const TLSAuthCache&);
+  TLSAuthCache& operator=(const TLSAuthCache&);
+ public:
+  TLSAuthCache(unsigned int max_size);
+  ~TLSAuthCache(void);
+  /** Makes key identifying peer certificates and configuration used to
+    process them. Returns empty string if there are no certificates. */
+  static std::string Key(STACK_OF(X509)* chain, X509* cert, const std::string& config);
+  /** Stores result under key. It is valid till expires but not longer
+    than internal limit and only while locations in paths are not
+    modified. */
+  void Put(const std::string& key, const Result& result, time_t expires,
+           const std::list<std::string>& paths);
+  /** Fetches stored result. Returns false if there is no valid entry. */
+  bool Get(const std::string& key, Result& result);
+  static TLSAuthCache& Instance(void);
+};
+
+} // namespace ArcMCCTLS
+
+#endif /* __ARC_TLSAUTHCACHE_H__ */
@@ -0,0 +1,103 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <ctime>
+
+#include <openssl/x509.h>
+
+#include "TLSSessionCache.h"
+
+namespace ArcMCCTLS {
+
+#if (OPENSSL_VERSION_NUMBER < 0x10100000L)
+
+#define X509_getm_notAfter X509_get_notAfter
+
+static X509* SSL_SESSION_get0_peer(SSL_SESSION *s) {
+  return s->peer;
+}
+
+static int SSL_SESSION_up_ref(SSL_SESSION *s) {
+  CRYPTO_add(&s->references,1,CRYPTO_LOCK_SSL_SESSION);
+  return 1;
+}
+
+#endif
+
+// Maximal number of sessions kept
+#define CLIENT_SESSIONS_MAX (1000)
+#define SERVER_SESSIONS_MAX (20000)
+
+static bool session_valid(SSL_SESSION* session) {
+  if(((long)::time(NULL)) >= (SSL_SESSION_get_time(session)+SSL_SESSION_get_timeout(session))) return false;
+  // Resumed session skips certificate verification. Make sure it does
+  // not outlive credentials it was established with. For proxy it is
+  // the peer certificate which expires first.
+  X509* peer = SSL_SESSION_get0_peer(session);
+  if(peer && (X509_cmp_current_time(X509_getm_notAfter(peer)) <= 0)) return false;
+  return true;
+}
+
+TLSSessionCache::TLSSessionCache(unsigned int max_size):max_size_(max_size) {
+}
+
+TLSSessionCache::~TLSSessionCache(void) {
+  for(std::map<std::string,Entry>::iterator entry = sessions_.begin();
+                                  entry != sessions_.end(); ++entry) {
+    SSL_SESSION_free(entry->second.session);
+  }
+}
+
+void TLSSessionCache::Erase(std::map<std::string,Entry>::iterator entry) {
+  SSL_SESSION_free(entry->second.session);
+  order_.erase(entry->second.order);
+  sessions_.erase(entry);
+}
+
+void TLSSessionCache::Put(const std::string& key, SSL_SESSION* session) {
+  if(!session) return;
+  Glib::Mutex::Lock lock(lock_);
+  std::map<std::string,Entry>::iterator entry = sessions_.find(key);
+  if(entry != sessions_.end()) Erase(entry);
+  while((!order_.empty()) && (sessions_.size() >= max_size_)) {
+    Erase(sessions_.find(order_.front()));
+  }
+  Entry new_entry;
+  new_entry.session = session;
+  new_entry.order = order_.insert(order_.end(),key);
+  sessions_[key] = new_entry;
+}
+
+SSL_SESSION* TLSSessionCache::Get(const std::string& key) {
+  Glib::Mutex::Lock lock(lock_);
+  std::map<std::string,Entry>::iterator entry = sessions_.find(key);
+  if(entry == sessions_.end()) return NULL;
+  SSL_SESSION* session = entry->second.session;
+  if(!session_valid(session)) {
+    Erase(entry);
+    return NULL;
+  }
+  SSL_SESSION_up_ref(session);
+  return session;
+}
+
+void TLSSessionCache::Remove(const std::string& key) {
+  Glib::Mutex::Lock lock(lock_);
+  std::map<std::string,Entry>::iterator entry = sessions_.find(key);
+  if(entry != sessions_.end()) Erase(entry);
+}
+
+// Caches are never destroyed because at exit that could happen after
+// OpenSSL is already cleaned up.
+TLSSessionCache& TLSSessionCache::Client(void) {
+  static TLSSessionCache* cache = new TLSSessionCache(CLIENT_SESSIONS_MAX);
+  return *cache;
+}
+
+TLSSessionCache& TLSSessionCache::Server(void) {
+  static TLSSessionCache* cache = new TLSSessionCache(SERVER_SESSIONS_MAX);
+  return *cache;
+}
+
+} // namespace ArcMCCTLS
@@ -0,0 +1,54 @@
+#ifndef __ARC_TLSSESSIONCACHE_H__
+#define __ARC_TLSSESSIONCACHE_H__
+
+#include <list>
+#include <map>
+#include <string>
+
+#include <openssl/ssl.h>
+
+#include <arc/Thread.h>
+
+namespace ArcMCCTLS {
+
+// Process-wide storage of TLS sessions. New SSL_CTX is created for
+// every connection, hence OpenSSL's own per-context cache can't be used
+// and sessions are kept here instead. Sessions stay in memory and are
+// never serialized, so peer certificate chain needed for proxy and VOMS
+// processing is available for resumed connections too.
+class TLSSessionCache {
+ private:
+  typedef std::list<std::string> Order;
+  struct Entry {
+    SSL_SESSION* session;
+    Order::iterator order;
+  };
+  Glib::Mutex lock_;
+  std::map<std::string,Entry> sessions_;
+  // Keys in order of insertion for evicting oldest sessions
+  Order order_;
+  unsigned int max_size_;
+  void Erase(std::map<std::string,Entry>::iterator entry);
+  TLSSessionCache(const TLSSessionCache&);
+  TLSSessionCache& operator=(const TLSSessionCache&);
+ public:
+  TLSSessionCache(unsigned int max_size);
+  ~TLSSessionCache(void);
+  /** Stores session under key replacing previous one. Takes over
+    reference held by caller. */
+  void Put(const std::string& key, SSL_SESSION* session);
+  /** Returns session with reference added for caller or NULL.
+    Sessions which expired or whose peer certificate expired are
+    removed instead. */
+  SSL_SESSION* Get(const std::string& key);
+  void Remove(const std::string& key);
+  /** Sessions established by clients. Key identifies endpoint and
+    credentials. */
+  static TLSSessionCache& Client(void);
+  /** Sessions accepted by services. Key is session id. */
+  static TLSSessionCache& Server(void);
+};
+
+} // namespace ArcMCCTLS
+
+#endif /* __ARC_TLSSESSIONCACHE_H__ */
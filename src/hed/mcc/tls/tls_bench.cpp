@@ -0,0 +1,179 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+// Measures rate of TLS handshakes against service behind tls.service.
+// Makes series of connections doing full handshake and then series of
+// connections offering session obtained from previous connection. Service
+// must have SessionCache enabled for resumption to happen. Credentials
+// are passed same way as to client tools so that proxy certificates and
+// client authentication are exercised as well.
+
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <string>
+#include <iostream>
+
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/types.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+
+#include <openssl/ssl.h>
+#include <openssl/err.h>
+
+static double now(void) {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+static void usage(const char* name) {
+  std::cerr << "Usage: " << name
+            << " [-n connections] [-c certificate] [-k key] [-C CA directory] host port" << std::endl;
+  std::cerr << "Proxy may be passed as both certificate and key." << std::endl;
+}
+
+static int tcp_connect(const struct addrinfo* info) {
+  int h = ::socket(info->ai_family, info->ai_socktype, info->ai_protocol);
+  if (h == -1) return -1;
+  struct timeval to;
+  to.tv_sec = 10;
+  to.tv_usec = 0;
+  ::setsockopt(h, SOL_SOCKET, SO_RCVTIMEO, &to, sizeof(to));
+  if (::connect(h, info->ai_addr, info->ai_addrlen) != 0) {
+    ::close(h);
+    return -1;
+  }
+  return h;
+}
+
+// Makes one connection. If session is not NULL it is offered to server
+// and replaced with session obtained from this connection.
+static bool handshake(SSL_CTX* ctx, const struct addrinfo* info, const std::string& host,
+                      SSL_SESSION** session, bool& resumed) {
+  int h = tcp_connect(info);
+  if (h == -1) {
+    std::cerr << "Failed to connect: " << strerror(errno) << std::endl;
+    return false;
+  }
+  SSL* ssl = SSL_new(ctx);
+  SSL_set_fd(ssl, h);
+  SSL_set_tlsext_host_name(ssl, host.c_str());
+  if (session && *session) SSL_set_session(ssl, *session);
+  bool r = (SSL_connect(ssl) == 1);
+  if (r) {
+    resumed = SSL_session_reused(ssl);
+    // With TLSv1.3 session ticket arrives after handshake. Waiting for
+    // server to close connection makes sure it is processed.
+    if (SSL_shutdown(ssl) == 0) {
+      char buf[256];
+      while (SSL_read(ssl, buf, sizeof(buf)) > 0) {}
+    }
+    if (session) {
+      SSL_SESSION* new_session = SSL_get1_session(ssl);
+      if (new_session) {
+        if (*session) SSL_SESSION_free(*session);
+        *session = new_session;
+      }
+    }
+  } else {
+    ERR_print_errors_fp(stderr);
+  }
+  SSL_free(ssl);
+  ::close(h);
+  return r;
+}
+
+int main(int argc, char** argv) {
+  int connections = 100;
+  std::string cert;
+  std::string key;
+  std::string cadir = "/etc/grid-security/certificates";
+  int opt;
+  while ((opt = getopt(argc, argv, "n:c:k:C:h")) != -1) {
+    switch (opt) {
+      case 'n': connections = atoi(optarg); break;
+      case 'c': cert = optarg; break;
+      case 'k': key = optarg; break;
+      case 'C': cadir = optarg; break;
+      default: usage(argv[0]); return 1;
+    }
+  }
+  if ((argc - optind) != 2 || connections <= 0) {
+    usage(argv[0]);
+    return 1;
+  }
+  std::string host = argv[optind];
+  std::string port = argv[optind + 1];
+  if (key.empty()) key = cert;
+
+  SSL_library_init();
+  SSL_load_error_strings();
+  SSL_CTX* ctx = SSL_CTX_new(SSLv23_client_method());
+  if (!ctx) {
+    ERR_print_errors_fp(stderr);
+    return 1;
+  }
+  SSL_CTX_set_options(ctx, SSL_OP_NO_SSLv2 | SSL_OP_NO_SSLv3 | SSL_OP_ALL);
+  // Session is managed explicitly
+  SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL);
+  if (SSL_CTX_load_verify_locations(ctx, NULL, cadir.c_str()) != 1) {
+    std::cerr << "Failed to use CA directory " << cadir << std::endl;
+    return 1;
+  }
+  SSL_CTX_set_verify(ctx, SSL_VERIFY_PEER, NULL);
+  if (!cert.empty()) {
+    if ((SSL_CTX_use_certificate_chain_file(ctx, cert.c_str()) != 1) ||
+        (SSL_CTX_use_PrivateKey_file(ctx, key.c_str(), SSL_FILETYPE_PEM) != 1)) {
+      ERR_print_errors_fp(stderr);
+      return 1;
+    }
+  }
+
+  struct addrinfo hint;
+  struct addrinfo* info = NULL;
+  memset(&hint, 0, sizeof(hint));
+  hint.ai_socktype = SOCK_STREAM;
+  hint.ai_protocol = IPPROTO_TCP;
+  int r = getaddrinfo(host.c_str(), port.c_str(), &hint, &info);
+  if (r != 0) {
+    std::cerr << "Failed to resolve " << host << ":" << port << " - " << gai_strerror(r) << std::endl;
+    return 1;
+  }
+
+  // Full handshakes
+  int failed = 0;
+  bool resumed = false;
+  double start = now();
+  for (int n = 0; n < connections; ++n) {
+    if (!handshake(ctx, info, host, NULL, resumed)) ++failed;
+  }
+  double full_time = now() - start;
+
+  // Resumed handshakes, first one obtains session
+  SSL_SESSION* session = NULL;
+  if (!handshake(ctx, info, host, &session, resumed)) ++failed;
+  int resumptions = 0;
+  start = now();
+  for (int n = 0; n < connections; ++n) {
+    resumed = false;
+    if (!handshake(ctx, info, host, &session, resumed)) ++failed;
+    if (resumed) ++resumptions;
+  }
+  double resumed_time = now() - start;
+  if (session) SSL_SESSION_free(session);
+  freeaddrinfo(info);
+  SSL_CTX_free(ctx);
+
+  std::cout << "Full handshakes: " << connections << " in " << full_time << " s";
+  if (full_time > 0) std::cout << " (" << (connections / full_time) << " per second)";
+  std::cout << std::endl;
+  std::cout << "Session reuse: " << connections << " in " << resumed_time << " s";
+  if (resumed_time > 0) std::cout << " (" << (connections / resumed_time) << " per second)";
+  std::cout << ", " << resumptions << " resumed" << std::endl;
+  std::cout << "Failed connections: " << failed << std::endl;
+  return (failed == 0) ? 0 : 2;
+}
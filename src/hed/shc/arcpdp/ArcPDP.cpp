@@ -5,11 +5,14 @@
 #include <iostream>
 #include <fstream>
 
+#include <sys/stat.h>
+
 #include <arc/XMLNode.h>
 #include <arc/Thread.h>
 #include <arc/ArcConfig.h>
 #include <arc/ArcLocation.h>
 #include <arc/Logger.h>
+#include <arc/StringConv.h>
 #include <arc/security/ArcPDP/Response.h>
 #include <arc/security/ArcPDP/attr/AttributeValue.h>
 #include <arc/security/ArcPDP/EvaluatorLoader.h>
@@ -18,6 +21,14 @@
 
 Arc::Logger ArcSec::ArcPDP::logger(Arc::Logger::getRootLogger(), "ArcSec.ArcPDP");
 
+// Default number of remembered decisions and their lifetime (seconds)
+#define DEFAULT_DECISIONS_MAX (1000)
+#define DEFAULT_DECISIONS_LIFETIME (60)
+
+// Attribute made by TCP MCC. It includes port of client which is
+// different for every connection.
+#define TCP_SECATTR_REMOTE_NS "http://www.nordugrid.org/schemas/policy-arc/types/tcp/remoteendpoint"
+
 /*
 static ArcSec::PDP* get_pdp(Arc::Config *cfg,Arc::ChainContext *ctx) {
     return new ArcSec::ArcPDP(cfg);
@@ -45,6 +56,8 @@ class ArcPDPContext:public Arc::MessageContextElement {
  friend class ArcPDP;
  private:
   Evaluator* eval;
+  // State of policy files when evaluator was created
+  std::string policies_stamp;
  public:
   ArcPDPContext(Evaluator* e);
   ArcPDPContext(void);
@@ -64,7 +77,7 @@ ArcPDPContext::ArcPDPContext(void):eval(NULL) {
   eval = eval_loader.getEvaluator(evaluator);
 }
 
-ArcPDP::ArcPDP(Config* cfg,Arc::PluginArgument* parg):PDP(cfg,parg) /*, eval(NULL)*/ {
+ArcPDP::ArcPDP(Config* cfg,Arc::PluginArgument* parg):PDP(cfg,parg), policies_use_endpoint_(false), decisions_use_endpoint_(false) /*, eval(NULL)*/ {
   XMLNode pdp_node(*cfg);
 
   XMLNode filter = (*cfg)["Filter"];
@@ -80,8 +93,30 @@ ArcPDP::ArcPDP(Config* cfg,Arc::PluginArgument* parg):PDP(cfg,parg) /*, eval(NUL
     policy_locations.push_back((std::string)policy_location);
   };
   XMLNode policy = (*cfg)["Policy"];
-  for(;(bool)policy;++policy) policies.AddNew(policy);
+  for(;(bool)policy;++policy) {
+    policies.AddNew(policy);
+    std::string policy_str;
+    policy.GetXML(policy_str);
+    if(policy_str.find(TCP_SECATTR_REMOTE_NS) != std::string::npos) policies_use_endpoint_ = true;
+  };
+  decisions_use_endpoint_ = policies_use_endpoint_;
   policy_combining_alg = (std::string)((*cfg)["PolicyCombiningAlg"]);
+  decisions_max_ = DEFAULT_DECISIONS_MAX;
+  decisions_lifetime_ = DEFAULT_DECISIONS_LIFETIME;
+  XMLNode decisions_max = (*cfg)["DecisionCacheSize"];
+  if((bool)decisions_max) {
+    if(!Arc::stringto((std::string)decisions_max,decisions_max_)) {
+      logger.msg(ERROR, "Wrong value of DecisionCacheSize - %s", (std::string)decisions_max);
+      decisions_max_ = DEFAULT_DECISIONS_MAX;
+    };
+  };
+  XMLNode decisions_lifetime = (*cfg)["DecisionCacheLifetime"];
+  if((bool)decisions_lifetime) {
+    if(!Arc::stringto((std::string)decisions_lifetime,decisions_lifetime_)) {
+      logger.msg(ERROR, "Wrong value of DecisionCacheLifetime - %s", (std::string)decisions_lifetime);
+      decisions_lifetime_ = DEFAULT_DECISIONS_LIFETIME;
+    };
+  };
 }
 
 PDPStatus ArcPDP::isPermitted(Message *msg) const {
@@ -97,7 +132,55 @@ PDPStatus ArcPDP::isPermitted(Message *msg) const {
     </RequestItem>
   </Request>
   */
+  MessageAuth* mauth = msg->Auth()->Filter(select_attrs,reject_attrs);
+  MessageAuth* cauth = msg->AuthContext()->Filter(select_attrs,reject_attrs);
+  if((!mauth) && (!cauth)) {
+    logger.msg(ERROR,"Missing security object in message");
+    return false;
+  };
+  NS ns;
+  XMLNode requestxml(ns,"");
+  if(mauth) {
+    if(!mauth->Export(SecAttr::ARCAuth,requestxml)) {
+      delete mauth;
+      logger.msg(ERROR,"Failed to convert security information to ARC request");
+      return false;
+    };
+    delete mauth;
+  };
+  if(cauth) {
+    if(!cauth->Export(SecAttr::ARCAuth,requestxml)) {
+      delete mauth;
+      logger.msg(ERROR,"Failed to convert security information to ARC request");
+      return false;
+    };
+    delete cauth;
+  };
+  std::string request;
+  requestxml.GetXML(request);
+  logger.msg(DEBUG,"ARC Auth. request: %s",request);
+  if(requestxml.Size() <= 0) {
+    logger.msg(ERROR,"No requested security information was collected");
+    return false;
+  };
+
+  // Clients repeat same requests. Processing policies is avoided for
+  // those recently evaluated with same policies.
+  std::string stamp;
+  std::string key;
+  if(decisions_max_ > 0) {
+    stamp = policiesStamp();
+    key = decisionKey(requestxml,stamp);
+  };
+  bool cached_result = false;
+  if((!key.empty()) && getDecision(key,cached_result)) {
+    if(cached_result) logger.msg(VERBOSE, "Authorized by arc.pdp");
+    else logger.msg(INFO, "Not authorized by arc.pdp - some of the RequestItem elements do not satisfy Policy");
+    return cached_result;
+  };
+
   Evaluator* eval = NULL;
+  std::string eval_stamp;
 
   std::string ctxid = "arcsec.arcpdp";
   try {
@@ -106,6 +189,7 @@ PDPStatus ArcPDP::isPermitted(Message *msg) const {
       ArcPDPContext* pdpctx = dynamic_cast<ArcPDPContext*>(mctx);
       if(pdpctx) {
         eval=pdpctx->eval;
+        eval_stamp=pdpctx->policies_stamp;
       }
       else { logger.msg(INFO, "Can not find ArcPDPContext"); }
     };
@@ -115,6 +199,10 @@ PDPStatus ArcPDP::isPermitted(Message *msg) const {
     if(pdpctx) {
       eval=pdpctx->eval;
       if(eval) {
+        // Files are checked before they are loaded, so loaded
+        // policies are never older than stamp
+        if(decisions_max_ > 0) pdpctx->policies_stamp = stamp;
+        eval_stamp=pdpctx->policies_stamp;
         //for(Arc::AttributeIterator it = (msg->Attributes())->getAll("PDP:POLICYLOCATION"); it.hasMore(); it++) {
         //  eval->addPolicy(SourceFile(*it));
         //}
@@ -159,40 +247,6 @@ PDPStatus ArcPDP::isPermitted(Message *msg) const {
     return false;
   };
 
-  MessageAuth* mauth = msg->Auth()->Filter(select_attrs,reject_attrs);
-  MessageAuth* cauth = msg->AuthContext()->Filter(select_attrs,reject_attrs);
-  if((!mauth) && (!cauth)) {
-    logger.msg(ERROR,"Missing security object in message");
-    return false;
-  };
-  NS ns;
-  XMLNode requestxml(ns,"");
-  if(mauth) {
-    if(!mauth->Export(SecAttr::ARCAuth,requestxml)) {
-      delete mauth;
-      logger.msg(ERROR,"Failed to convert security information to ARC request");
-      return false;
-    };
-    delete mauth;
-  };
-  if(cauth) {
-    if(!cauth->Export(SecAttr::ARCAuth,requestxml)) {
-      delete mauth;
-      logger.msg(ERROR,"Failed to convert security information to ARC request");
-      return false;
-    };
-    delete cauth;
-  };
-  {
-    std::string s;
-    requestxml.GetXML(s);
-    logger.msg(DEBUG,"ARC Auth. request: %s",s);
-  };
-  if(requestxml.Size() <= 0) {
-    logger.msg(ERROR,"No requested security information was collected");
-    return false;
-  };
-
   //Call the evaluation functionality inside Evaluator
   Response *resp = eval->evaluate(requestxml);
   if(!resp) {
@@ -246,10 +300,110 @@ PDPStatus ArcPDP::isPermitted(Message *msg) const {
   else logger.msg(INFO, "Not authorized by arc.pdp - some of the RequestItem elements do not satisfy Policy");
   
   if(resp) delete resp;
+
+  // Evaluator of connection keeps policies it was created with.
+  // Its decisions must not be used after policy files changed.
+  if((!key.empty()) && (eval_stamp == stamp)) putDecision(key,result);
     
   return result;
 }
 
+std::string ArcPDP::policiesStamp(void) const {
+  std::string stamp;
+  for(std::list<std::string>::const_iterator it = policy_locations.begin(); it!= policy_locations.end(); it++) {
+    struct stat st;
+    if(::stat(it->c_str(),&st) == 0) {
+      stamp += Arc::tostring(st.st_mtime)+":"+Arc::tostring(st.st_size)+"\n";
+    } else {
+      stamp += "-\n";
+    };
+  };
+  return stamp;
+}
+
+bool ArcPDP::policiesUseEndpoint(const std::string& stamp) const {
+  Glib::Mutex::Lock lock(decisions_lock_);
+  if(stamp != decisions_stamp_) {
+    // Policy files changed. Check if any of them refers to client endpoint.
+    decisions_use_endpoint_ = policies_use_endpoint_;
+    for(std::list<std::string>::const_iterator it = policy_locations.begin(); it!= policy_locations.end(); it++) {
+      std::ifstream f(it->c_str());
+      std::string line;
+      while(std::getline(f,line)) {
+        if(line.find(TCP_SECATTR_REMOTE_NS) != std::string::npos) {
+          decisions_use_endpoint_ = true;
+          break;
+        };
+      };
+      if(decisions_use_endpoint_) break;
+    };
+    decisions_stamp_ = stamp;
+  };
+  return decisions_use_endpoint_;
+}
+
+std::string ArcPDP::decisionKey(XMLNode request, const std::string& stamp) const {
+  // Made of attributes only. Client endpoint is different for every
+  // connection and is included only if some policy refers to it.
+  bool use_endpoint = policiesUseEndpoint(stamp);
+  std::string key = stamp;
+  for(int i = 0;;++i) {
+    XMLNode item = request.Child(i);
+    if(!item) break;
+    key += "\n";
+    for(int e = 0;;++e) {
+      // Subject, Resource, Action, Context
+      XMLNode element = item.Child(e);
+      if(!element) break;
+      for(int a = 0;;++a) {
+        // Subject and Context hold attributes, others are attributes themselves
+        XMLNode attr = (element.Size() > 0) ? element.Child(a) : element;
+        if(!attr) break;
+        std::string id = attr.Attribute("AttributeId");
+        if(use_endpoint || (id != TCP_SECATTR_REMOTE_NS)) {
+          key += element.Name()+"\t"+id+"\t"+(std::string)(attr.Attribute("Type"))+"\t"+(std::string)attr+"\n";
+        };
+        if(element.Size() <= 0) break;
+      };
+    };
+  };
+  return key;
+}
+
+bool ArcPDP::getDecision(const std::string& key, bool& result) const {
+  if(decisions_max_ <= 0) return false;
+  Glib::Mutex::Lock lock(decisions_lock_);
+  std::map<std::string,Decision>::iterator decision = decisions_.find(key);
+  if(decision == decisions_.end()) return false;
+  if(decision->second.expires <= ::time(NULL)) {
+    decisions_order_.erase(decision->second.order);
+    decisions_.erase(decision);
+    return false;
+  };
+  // Most recently used go first
+  decisions_order_.splice(decisions_order_.begin(),decisions_order_,decision->second.order);
+  result = decision->second.result;
+  return true;
+}
+
+void ArcPDP::putDecision(const std::string& key, bool result) const {
+  if(decisions_max_ <= 0) return;
+  Glib::Mutex::Lock lock(decisions_lock_);
+  std::map<std::string,Decision>::iterator decision = decisions_.find(key);
+  if(decision == decisions_.end()) {
+    while((!decisions_order_.empty()) && (decisions_.size() >= (unsigned int)decisions_max_)) {
+      decisions_.erase(decisions_order_.back());
+      decisions_order_.pop_back();
+    };
+    decision = decisions_.insert(std::pair<std::string,Decision>(key,Decision())).first;
+    decision->second.order = decisions_order_.insert(decisions_order_.begin(),key);
+  } else {
+    decisions_order_.splice(decisions_order_.begin(),decisions_order_,decision->second.order);
+  };
+  decision->second.result = result;
+  decision->second.expires = ::time(NULL) + decisions_lifetime_;
+}
+
 ArcPDP::~ArcPDP(){
   //if(eval)
   //  delete eval;
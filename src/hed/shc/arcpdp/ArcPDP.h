@@ -2,6 +2,12 @@
 #define __ARC_SEC_ARCPDP_H__
 
 #include <stdlib.h>
+#include <ctime>
+#include <list>
+#include <map>
+#include <string>
+
+#include <arc/Thread.h>
 
 //#include <arc/loader/ClassLoader.h>
 #include <arc/ArcConfig.h>
@@ -27,6 +33,29 @@ class ArcPDP : public PDP {
   std::list<std::string> policy_locations;
   Arc::XMLNodeContainer policies;
   std::string policy_combining_alg;
+  // Some of policies in configuration refer to client endpoint
+  bool policies_use_endpoint_;
+  // Recently made decisions. Key is made of attributes of request
+  // and state of policy files.
+  struct Decision {
+    bool result;
+    time_t expires;
+    std::list<std::string>::iterator order;
+  };
+  int decisions_max_;
+  int decisions_lifetime_;
+  mutable Glib::Mutex decisions_lock_;
+  mutable std::map<std::string,Decision> decisions_;
+  // Keys of decisions, most recently used first
+  mutable std::list<std::string> decisions_order_;
+  // State of policy files last checked for references to client endpoint
+  mutable std::string decisions_stamp_;
+  mutable bool decisions_use_endpoint_;
+  std::string policiesStamp(void) const;
+  bool policiesUseEndpoint(const std::string& stamp) const;
+  std::string decisionKey(Arc::XMLNode request, const std::string& stamp) const;
+  bool getDecision(const std::string& key, bool& result) const;
+  void putDecision(const std::string& key, bool result) const;
  protected:
   static Arc::Logger logger;
 };
@@ -9,6 +9,7 @@
 
 #include <arc/security/ArcPDP/attr/AttributeValue.h>
 #include <arc/security/ArcPDP/attr/BooleanAttribute.h>
+#include <arc/security/ArcPDP/attr/StringAttribute.h>
 #include <arc/security/ArcPDP/fn/EqualFunction.h>
 #include <arc/security/ArcPDP/fn/MatchFunction.h>
 #include <arc/security/ArcPDP/fn/InRangeFunction.h>
@@ -132,6 +133,24 @@ void ArcRule::getItemlist(XMLNode& nd, OrList& items, const std::string& itemtyp
   return;
 }
 
+// Separates items consisting of one string attribute compared by equality.
+// For those matching is same as comparing attribute id and value.
+static void indexItems(const ArcSec::OrList& items, ArcSec::ItemIndex& index) {
+  for(ArcSec::OrList::const_iterator orit = items.begin(); orit != items.end(); ++orit) {
+    if(orit->size() == 1) {
+      const ArcSec::Match& match = orit->front();
+      StringAttribute* value = dynamic_cast<StringAttribute*>(match.first);
+      if(value && match.second && dynamic_cast<EqualFunction*>(match.second)) {
+        std::string id = value->getId();
+        index.ids.insert(id);
+        index.values.insert(id + '\0' + value->getValue());
+        continue;
+      }
+    }
+    index.rest.push_back(*orit);
+  }
+}
+
 ArcRule::ArcRule(const XMLNode node, EvaluatorContext* ctx) : Policy(node,NULL) {
   rulenode = node;
   evalres.node = rulenode;
@@ -182,6 +201,11 @@ ArcRule::ArcRule(const XMLNode node, EvaluatorContext* ctx) : Policy(node,NULL)
   if(type.empty()) type=DEFAULT_ATTRIBUTE_TYPE;
   getItemlist(nd, conditions, "Condition", type, funcname);
 
+  indexItems(subjects, subjects_index);
+  indexItems(resources, resources_index);
+  indexItems(actions, actions_index);
+  indexItems(conditions, conditions_index);
+
   //Set the initial value for id matching 
   sub_idmatched = ID_NO_MATCH;
   res_idmatched = ID_NO_MATCH;
@@ -190,16 +214,31 @@ ArcRule::ArcRule(const XMLNode node, EvaluatorContext* ctx) : Policy(node,NULL)
  
 }
 
-static ArcSec::MatchResult itemMatch(ArcSec::OrList items, std::list<ArcSec::RequestAttribute*> req, Id_MatchResult& idmatched){
+static ArcSec::MatchResult itemMatch(const ArcSec::ItemIndex& index, const std::list<ArcSec::RequestAttribute*>& req, Id_MatchResult& idmatched){
 
-  ArcSec::OrList::iterator orit;
-  ArcSec::AndList::iterator andit;
-  std::list<ArcSec::RequestAttribute*>::iterator reqit;
+  ArcSec::OrList::const_iterator orit;
+  ArcSec::AndList::const_iterator andit;
+  std::list<ArcSec::RequestAttribute*>::const_iterator reqit;
+  const ArcSec::OrList& items = index.rest;
 
   bool indeterminate = true;
 
   idmatched = ID_NO_MATCH;
 
+  //Indexed items are matched if any <Attribute> in request has same id and value
+  if(!index.ids.empty()) {
+    for(reqit = req.begin(); reqit != req.end(); reqit++){
+      AttributeValue* value = (*reqit)->getAttributeValue();
+      std::string id = value->getId();
+      if(index.ids.find(id) == index.ids.end()) continue;
+      idmatched = ID_MATCH;
+      indeterminate = false;
+      StringAttribute* svalue = dynamic_cast<StringAttribute*>(value);
+      if(svalue && (index.values.find(id + '\0' + svalue->getValue()) != index.values.end()))
+        return MATCH;
+    }
+  }
+
   //Go through each <Subject> <Resource> <Action> or <Context> under 
   //<Subjects> <Resources> <Actions> or<Contexts>
   //For example, go through each <Subject> element under <Subjects> in a rule, 
@@ -269,10 +308,10 @@ MatchResult ArcRule::match(EvaluationCtx* eval_ctx){
   ctx_idmatched = ID_NO_MATCH;
 
   MatchResult sub_matched, res_matched, act_matched, ctx_matched;
-  sub_matched = itemMatch(subjects, evaltuple->sub, sub_idmatched);
-  res_matched = itemMatch(resources, evaltuple->res, res_idmatched);
-  act_matched = itemMatch(actions, evaltuple->act, act_idmatched);
-  ctx_matched = itemMatch(conditions, evaltuple->ctx, ctx_idmatched);
+  sub_matched = itemMatch(subjects_index, evaltuple->sub, sub_idmatched);
+  res_matched = itemMatch(resources_index, evaltuple->res, res_idmatched);
+  act_matched = itemMatch(actions_index, evaltuple->act, act_idmatched);
+  ctx_matched = itemMatch(conditions_index, evaltuple->ctx, ctx_idmatched);
 
   if(
       ( subjects.empty() || sub_matched==MATCH) &&
@@ -3,6 +3,7 @@
 
 #include <arc/XMLNode.h>
 #include <list>
+#include <set>
 
 #include <arc/security/ArcPDP/policy/Policy.h>
 #include <arc/security/ArcPDP/fn/Function.h>
@@ -53,6 +54,18 @@ typedef std::list<Match> AndList;
 ///OrList  - include items inside one <Subjects> (or <Resources> <Actions> <Conditions>)
 typedef std::list<AndList> OrList;
 
+///ItemIndex - items of OrList made of single string compared for equality are
+///looked up by attribute id and value instead of being compared one by one.
+///This makes evaluation of rules with long lists of subjects fast.
+struct ItemIndex {
+  ///Attribute id and value separated by '\0' of indexed items
+  std::set<std::string> values;
+  ///Attribute ids of indexed items
+  std::set<std::string> ids;
+  ///Items which can't be indexed
+  OrList rest;
+};
+
 
 enum Id_MatchResult {
   //The "id" of all the <Attribute>s under a <Subject> (or other type) is matched
@@ -106,6 +119,11 @@ private:
   OrList actions;
   OrList conditions;
 
+  ItemIndex subjects_index;
+  ItemIndex resources_index;
+  ItemIndex actions_index;
+  ItemIndex conditions_index;
+
   AttributeFactory* attrfactory;
   FnFactory* fnfactory;
 
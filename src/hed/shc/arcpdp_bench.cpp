@@ -0,0 +1,128 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+// Measures rate of evaluating requests by ArcPDP evaluator against policy
+// with long list of subjects - like one generated from list of authorized
+// users. Half of requests come from subject at the end of the list and
+// half from unknown subject, so both permitted and not applicable cases
+// are exercised.
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include <unistd.h>
+#include <sys/time.h>
+
+#include <arc/Logger.h>
+#include <arc/StringConv.h>
+#include <arc/XMLNode.h>
+#include <arc/security/ArcPDP/Evaluator.h>
+#include <arc/security/ArcPDP/EvaluatorLoader.h>
+#include <arc/security/ArcPDP/Response.h>
+
+static double now(void) {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+static void usage(const char* name) {
+  std::cerr << "Usage: " << name << " [-s subjects] [-n requests]" << std::endl;
+}
+
+static std::string subject_dn(int n) {
+  return "/DC=org/DC=example/CN=User " + Arc::tostring(n);
+}
+
+static std::string make_request(const std::string& subject) {
+  return
+    "<ra:Request xmlns:ra=\"http://www.nordugrid.org/schemas/request-arc\">"
+     "<ra:RequestItem>"
+      "<ra:Subject>"
+       "<ra:SubjectAttribute AttributeId=\"http://www.nordugrid.org/schemas/policy-arc/types/tls/identity\""
+                          " Type=\"string\">" + subject + "</ra:SubjectAttribute>"
+      "</ra:Subject>"
+      "<ra:Action AttributeId=\"http://www.nordugrid.org/schemas/policy-arc/types/http/method\""
+                " Type=\"string\">GET</ra:Action>"
+     "</ra:RequestItem>"
+    "</ra:Request>";
+}
+
+int main(int argc, char** argv) {
+  int subjects = 10000;
+  int requests = 1000;
+  int opt;
+  while ((opt = getopt(argc, argv, "s:n:h")) != -1) {
+    switch (opt) {
+      case 's': subjects = atoi(optarg); break;
+      case 'n': requests = atoi(optarg); break;
+      default: usage(argv[0]); return 1;
+    }
+  }
+  if ((argc - optind) != 0 || subjects <= 0 || requests <= 0) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  Arc::LogStream logcerr(std::cerr);
+  Arc::Logger::getRootLogger().addDestination(logcerr);
+  Arc::Logger::getRootLogger().setThreshold(Arc::ERROR);
+
+  std::string policy =
+    "<Policy xmlns=\"http://www.nordugrid.org/schemas/policy-arc\" PolicyId=\"bench\" CombiningAlg=\"Deny-Overrides\">"
+     "<Rule RuleId=\"users\" Effect=\"Permit\">"
+      "<Subjects>";
+  for (int n = 0; n < subjects; ++n) {
+    policy += "<Subject Type=\"string\" AttributeId=\"http://www.nordugrid.org/schemas/policy-arc/types/tls/identity\">" +
+              subject_dn(n) + "</Subject>";
+  }
+  policy +=
+      "</Subjects>"
+      "<Actions>"
+       "<Action Type=\"string\" AttributeId=\"http://www.nordugrid.org/schemas/policy-arc/types/http/method\">GET</Action>"
+      "</Actions>"
+     "</Rule>"
+    "</Policy>";
+
+  ArcSec::EvaluatorLoader eval_loader;
+  double start = now();
+  ArcSec::Evaluator* eval = eval_loader.getEvaluator(std::string("arc.evaluator"));
+  if (!eval) {
+    std::cerr << "Failed to load arc.evaluator" << std::endl;
+    return 1;
+  }
+  Arc::XMLNode policy_node(policy);
+  eval->addPolicy(ArcSec::Source(policy_node));
+  double load_time = now() - start;
+
+  Arc::XMLNode known_node(make_request(subject_dn(subjects - 1)));
+  Arc::XMLNode unknown_node(make_request(subject_dn(subjects)));
+  ArcSec::Source known(known_node);
+  ArcSec::Source unknown(unknown_node);
+  int permitted = 0;
+  start = now();
+  for (int n = 0; n < requests; ++n) {
+    ArcSec::Response* resp = eval->evaluate((n % 2) ? unknown : known);
+    if (!resp) continue;
+    ArcSec::ResponseList rlist = resp->getResponseItems();
+    int size = rlist.size();
+    for (int i = 0; i < size; ++i) {
+      if (rlist[i]->res == ArcSec::DECISION_PERMIT) {
+        ++permitted;
+        break;
+      }
+    }
+    delete resp;
+  }
+  double eval_time = now() - start;
+  delete eval;
+
+  std::cout << "Subjects in policy: " << subjects << ", policy loaded in " << load_time << " s" << std::endl;
+  std::cout << "Requests: " << requests << " in " << eval_time << " s";
+  if (eval_time > 0) std::cout << " (" << (requests / eval_time) << " per second)";
+  std::cout << std::endl;
+  std::cout << "Permitted requests: " << permitted << " (expected " << ((requests + 1) / 2) << ")" << std::endl;
+  return (permitted == ((requests + 1) / 2)) ? 0 : 2;
+}
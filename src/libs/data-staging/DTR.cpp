@@ -13,6 +13,7 @@
 #include "DataDelivery.h"
 #include "Scheduler.h"
 
+#include "DTRList.h"
 #include "DTR.h"
 
 namespace DataStaging {
@@ -72,7 +73,10 @@ namespace DataStaging {
        use_host_cert_for_remote_delivery(false),
        current_owner(GENERATOR),
        log_destinations(logs),
-       perf_record(perf_log)
+       perf_record(perf_log),
+       index_list(NULL),
+       indexed_status(DTRStatus::NEW),
+       indexed_owner(GENERATOR)
   {
     logger = new Arc::Logger(Arc::Logger::getRootLogger(), logname.c_str());
     logger->addDestinations(get_log_destinations());
@@ -212,8 +216,10 @@ namespace DataStaging {
     logger->msg(Arc::VERBOSE, "%s->%s", status.str(), stat.str());
     lock.lock();
     status = stat;
+    DTRList* list = index_list;
     lock.unlock();
     mark_modification();
+    if (list) list->update_dtr(this);
   }
   
   DTRStatus DTR::get_status() {
@@ -289,6 +295,26 @@ namespace DataStaging {
       std::list<Arc::DataPoint*> datapoints;
       if (source_endpoint->CurrentLocationHandle()->Stat(files, datapoints) == Arc::DataStatus::Success) return true;
     }
+    // Only sources can be prepared and released in bulk
+    if (status == DTRStatus::STAGE_PREPARE &&
+        source_endpoint->IsStageable() && source_endpoint->TransferLocations().empty() &&
+        !destination_endpoint->IsStageable()) {
+      std::list<Arc::DataStatus> results;
+      std::list<Arc::DataPoint*> datapoints;
+      unsigned int wait_time = 0;
+      if (source_endpoint->CurrentLocationHandle()->PrepareReading(datapoints, wait_time, results) == Arc::DataStatus::Success) return true;
+    }
+    if (status == DTRStatus::RELEASE_REQUEST &&
+        source_endpoint->IsStageable() && !destination_endpoint->IsStageable()) {
+      std::list<Arc::DataStatus> results;
+      std::list<Arc::DataPoint*> datapoints;
+      if (source_endpoint->CurrentLocationHandle()->FinishReading(datapoints, false, results) == Arc::DataStatus::Success) return true;
+    }
+    if (status == DTRStatus::REGISTER_REPLICA && destination_endpoint->IsIndex()) {
+      std::list<Arc::DataStatus> results;
+      std::list<Arc::DataPoint*> datapoints;
+      if (destination_endpoint->PostRegister(datapoints, false, results) == Arc::DataStatus::Success) return true;
+    }
     return false;
   }
 
@@ -313,7 +339,9 @@ namespace DataStaging {
   	 */
     dtr->lock.lock();
     dtr->current_owner = new_owner;
+    DTRList* list = dtr->index_list;
     dtr->lock.unlock();
+    if (list) list->update_dtr(dtr.Ptr());
 
     std::list<DTRCallback*> callbacks = dtr->get_callbacks(dtr->proc_callback,dtr->current_owner);
     if (callbacks.empty())
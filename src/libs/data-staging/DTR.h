@@ -54,6 +54,7 @@ namespace DataStaging {
 namespace DataStaging {
 
   class DTR;
+  class DTRList;
 
   /// Provides automatic memory management of DTRs and thread-safe destruction.
   /** \ingroup datastaging */
@@ -377,6 +378,21 @@ namespace DataStaging {
     /// Lock to avoid collisions while changing DTR properties
     Arc::SimpleCondition lock;
 
+    /// List which keeps this DTR in its indexes or NULL. Protected by lock.
+    DTRList* index_list;
+
+    /// Positions of this DTR in indexes of DTRList.
+    /** These are only used by DTRList and are protected by its lock. */
+    std::list<DTR_ptr>::iterator list_pos;
+    std::list<DTR_ptr>::iterator status_pos;
+    std::list<DTR_ptr>::iterator owner_pos;
+    std::list<DTR_ptr>::iterator job_pos;
+    /// Status and owner under which DTR is currently indexed in DTRList
+    DTRStatus::DTRStatusType indexed_status;
+    StagingProcesses indexed_owner;
+
+    friend class DTRList;
+
     /** Possible fields  (types, names and so on are subject to change) **
 
     /// DTRs that are grouped must have the same number here
@@ -8,51 +8,144 @@
 #include "DTRList.h"
 
 namespace DataStaging {
-  
+
+  // Lists of statuses used for virtual queues, terminated by NULL_STATE.
+  // They must be kept in sync with DTR::is_destined_for_*() and
+  // DTR::came_from_*().
+  static const DTRStatus::DTRStatusType pre_processor_states[] = {
+    DTRStatus::PRE_CLEAN, DTRStatus::CHECK_CACHE, DTRStatus::RESOLVE,
+    DTRStatus::QUERY_REPLICA, DTRStatus::STAGE_PREPARE, DTRStatus::NULL_STATE
+  };
+
+  static const DTRStatus::DTRStatusType post_processor_states[] = {
+    DTRStatus::RELEASE_REQUEST, DTRStatus::REGISTER_REPLICA,
+    DTRStatus::PROCESS_CACHE, DTRStatus::NULL_STATE
+  };
+
+  static const DTRStatus::DTRStatusType delivery_states[] = {
+    DTRStatus::TRANSFER, DTRStatus::NULL_STATE
+  };
+
+  static const DTRStatus::DTRStatusType pending_states[] = {
+    // from pre-processor
+    DTRStatus::PRE_CLEANED, DTRStatus::CACHE_WAIT, DTRStatus::CACHE_CHECKED,
+    DTRStatus::RESOLVED, DTRStatus::REPLICA_QUERIED,
+    DTRStatus::STAGING_PREPARING_WAIT, DTRStatus::STAGED_PREPARED,
+    // from post-processor
+    DTRStatus::REQUEST_RELEASED, DTRStatus::REPLICA_REGISTERED,
+    DTRStatus::CACHE_PROCESSED,
+    // from delivery
+    DTRStatus::TRANSFERRED,
+    // from generator
+    DTRStatus::NEW,
+    DTRStatus::NULL_STATE
+  };
+
   bool DTRList::add_dtr(DTR_ptr DTRToAdd) {
-  	Lock.lock();
-  	DTRs.push_back(DTRToAdd);
-  	Lock.unlock();
-  	
-  	// Added successfully
-  	return true;
+    Lock.lock();
+    DTRToAdd->lock.lock();
+    if (DTRToAdd->index_list) {
+      // Already in some list
+      DTRToAdd->lock.unlock();
+      Lock.unlock();
+      return false;
+    }
+    DTRToAdd->index_list = this;
+    DTRToAdd->indexed_status = DTRToAdd->status.GetStatus();
+    DTRToAdd->indexed_owner = DTRToAdd->current_owner;
+    DTRToAdd->lock.unlock();
+    DTRToAdd->list_pos = DTRs.insert(DTRs.end(), DTRToAdd);
+    std::list<DTR_ptr>& status_list = DTRsByStatus[DTRToAdd->indexed_status];
+    DTRToAdd->status_pos = status_list.insert(status_list.end(), DTRToAdd);
+    std::list<DTR_ptr>& owner_list = DTRsByOwner[DTRToAdd->indexed_owner];
+    DTRToAdd->owner_pos = owner_list.insert(owner_list.end(), DTRToAdd);
+    std::list<DTR_ptr>& job_list = DTRsByJob[DTRToAdd->get_parent_job_id()];
+    DTRToAdd->job_pos = job_list.insert(job_list.end(), DTRToAdd);
+    Lock.unlock();
+
+    // Added successfully
+    return true;
   }
   
   bool DTRList::delete_dtr(DTR_ptr DTRToDelete) {
-  	
-  	Lock.lock();
-  	DTRs.remove(DTRToDelete);
-  	Lock.unlock();
-  	
-  	// Deleted successfully
-  	return true;
+    Lock.lock();
+    DTRToDelete->lock.lock();
+    if (DTRToDelete->index_list != this) {
+      DTRToDelete->lock.unlock();
+      Lock.unlock();
+      return false;
+    }
+    DTRToDelete->index_list = NULL;
+    DTRToDelete->lock.unlock();
+    DTRsByStatus[DTRToDelete->indexed_status].erase(DTRToDelete->status_pos);
+    DTRsByOwner[DTRToDelete->indexed_owner].erase(DTRToDelete->owner_pos);
+    std::map<std::string, std::list<DTR_ptr> >::iterator job = DTRsByJob.find(DTRToDelete->get_parent_job_id());
+    if (job != DTRsByJob.end()) {
+      job->second.erase(DTRToDelete->job_pos);
+      if (job->second.empty()) DTRsByJob.erase(job);
+    }
+    // Last reference held by list is released here
+    DTRs.erase(DTRToDelete->list_pos);
+    Lock.unlock();
+
+    // Deleted successfully
+    return true;
+  }
+
+  void DTRList::update_dtr(DTR* dtr) {
+    Lock.lock();
+    dtr->lock.lock();
+    if (dtr->index_list != this) {
+      // Removed while status was being changed
+      dtr->lock.unlock();
+      Lock.unlock();
+      return;
+    }
+    // Current values are taken so that concurrent updates always
+    // leave DTR indexed by its latest status and owner
+    DTRStatus::DTRStatusType status = dtr->status.GetStatus();
+    StagingProcesses owner = dtr->current_owner;
+    dtr->lock.unlock();
+    if (status != dtr->indexed_status) {
+      std::list<DTR_ptr>& status_list = DTRsByStatus[status];
+      status_list.splice(status_list.end(), DTRsByStatus[dtr->indexed_status], dtr->status_pos);
+      dtr->indexed_status = status;
+    }
+    if (owner != dtr->indexed_owner) {
+      std::list<DTR_ptr>& owner_list = DTRsByOwner[owner];
+      owner_list.splice(owner_list.end(), DTRsByOwner[dtr->indexed_owner], dtr->owner_pos);
+      dtr->indexed_owner = owner;
+    }
+    Lock.unlock();
+  }
+
+  void DTRList::collect_dtrs(const DTRStatus::DTRStatusType* statuses, std::list<DTR_ptr>& FilteredList) {
+    for (; *statuses != DTRStatus::NULL_STATE; ++statuses) {
+      std::list<DTR_ptr>& status_list = DTRsByStatus[*statuses];
+      FilteredList.insert(FilteredList.end(), status_list.begin(), status_list.end());
+    }
   }
   
   bool DTRList::filter_dtrs_by_owner(StagingProcesses OwnerToFilter, std::list<DTR_ptr>& FilteredList){
-  	std::list<DTR_ptr>::iterator it;
-     
+    if (OwnerToFilter < GENERATOR || OwnerToFilter > POST_PROCESSOR) return false;
+
     Lock.lock();
-  	for(it = DTRs.begin();it != DTRs.end(); ++it)
-  	  if((*it)->get_owner() == OwnerToFilter)
-  	    FilteredList.push_back(*it);
+    std::list<DTR_ptr>& owner_list = DTRsByOwner[OwnerToFilter];
+    FilteredList.insert(FilteredList.end(), owner_list.begin(), owner_list.end());
     Lock.unlock();
 
-  	// Filtered successfully
-  	return true;
+    // Filtered successfully
+    return true;
   }
   
   int DTRList::number_of_dtrs_by_owner(StagingProcesses OwnerToFilter){
-  	std::list<DTR_ptr>::iterator it;
-    int counter = 0;
-    
+    if (OwnerToFilter < GENERATOR || OwnerToFilter > POST_PROCESSOR) return 0;
+
     Lock.lock();
-  	for(it = DTRs.begin();it != DTRs.end(); ++it)
-  	  if((*it)->get_owner() == OwnerToFilter)
-  	    counter++;
+    int counter = DTRsByOwner[OwnerToFilter].size();
     Lock.unlock();
 
-  	// Filtered successfully
-  	return counter;
+    return counter;
   }
   
   bool DTRList::filter_dtrs_by_status(DTRStatus::DTRStatusType StatusToFilter, std::list<DTR_ptr>& FilteredList){
@@ -62,16 +155,11 @@ namespace DataStaging {
 
   bool DTRList::filter_dtrs_by_statuses(const std::vector<DTRStatus::DTRStatusType>& StatusesToFilter,
                                         std::list<DTR_ptr>& FilteredList){
-    std::list<DTR_ptr>::iterator it;
-
     Lock.lock();
-    for(it = DTRs.begin();it != DTRs.end(); ++it) {
-      for (std::vector<DTRStatus::DTRStatusType>::const_iterator i = StatusesToFilter.begin(); i != StatusesToFilter.end(); ++i) {
-        if((*it)->get_status().GetStatus() == *i) {
-          FilteredList.push_back(*it);
-          break;
-        }
-      }
+    for (std::vector<DTRStatus::DTRStatusType>::const_iterator i = StatusesToFilter.begin(); i != StatusesToFilter.end(); ++i) {
+      if (*i < DTRStatus::NEW || *i > DTRStatus::NULL_STATE) continue;
+      std::list<DTR_ptr>& status_list = DTRsByStatus[*i];
+      FilteredList.insert(FilteredList.end(), status_list.begin(), status_list.end());
     }
     Lock.unlock();
 
@@ -81,16 +169,13 @@ namespace DataStaging {
 
   bool DTRList::filter_dtrs_by_statuses(const std::vector<DTRStatus::DTRStatusType>& StatusesToFilter,
                                         std::map<DTRStatus::DTRStatusType, std::list<DTR_ptr> >& FilteredList) {
-    std::list<DTR_ptr>::iterator it;
-
     Lock.lock();
-    for(it = DTRs.begin();it != DTRs.end(); ++it) {
-      for (std::vector<DTRStatus::DTRStatusType>::const_iterator i = StatusesToFilter.begin(); i != StatusesToFilter.end(); ++i) {
-        if((*it)->get_status().GetStatus() == *i) {
-          FilteredList[*i].push_back(*it);
-          break;
-        }
-      }
+    for (std::vector<DTRStatus::DTRStatusType>::const_iterator i = StatusesToFilter.begin(); i != StatusesToFilter.end(); ++i) {
+      if (*i < DTRStatus::NEW || *i > DTRStatus::NULL_STATE) continue;
+      std::list<DTR_ptr>& status_list = DTRsByStatus[*i];
+      if (status_list.empty()) continue;
+      std::list<DTR_ptr>& filtered = FilteredList[*i];
+      filtered.insert(filtered.end(), status_list.begin(), status_list.end());
     }
     Lock.unlock();
 
@@ -99,62 +184,47 @@ namespace DataStaging {
   }
 
   bool DTRList::filter_dtrs_by_next_receiver(StagingProcesses NextReceiver, std::list<DTR_ptr>& FilteredList) {
-  	std::list<DTR_ptr>::iterator it;
-  	
-  	switch(NextReceiver){
-  	  case PRE_PROCESSOR: {
-        Lock.lock();
-        for(it = DTRs.begin();it != DTRs.end(); ++it)
-  	      if((*it)->is_destined_for_pre_processor())
-  	        FilteredList.push_back(*it);
-  	    Lock.unlock();
-  	    return true;  	  	
-  	  }
-  	  case POST_PROCESSOR: {
-  	  	Lock.lock();
-  	  	for(it = DTRs.begin();it != DTRs.end(); ++it)
-  	      if((*it)->is_destined_for_post_processor())
-  	        FilteredList.push_back(*it);
-  	    Lock.unlock();
-  	    return true;
-  	  }
-  	  case DELIVERY: {
-  	  	Lock.lock();
-  	  	for(it = DTRs.begin();it != DTRs.end(); ++it)
-  	      if((*it)->is_destined_for_delivery())
-  	        FilteredList.push_back(*it);
-  	    Lock.unlock();
-  	    return true;
-  	  }
-  	  default: // A strange receiver requested
-  	    return false;
-  	}
+    const DTRStatus::DTRStatusType* statuses = NULL;
+    switch(NextReceiver){
+      case PRE_PROCESSOR:
+        statuses = pre_processor_states;
+        break;
+      case POST_PROCESSOR:
+        statuses = post_processor_states;
+        break;
+      case DELIVERY:
+        statuses = delivery_states;
+        break;
+      default: // A strange receiver requested
+        return false;
+    }
+    Lock.lock();
+    collect_dtrs(statuses, FilteredList);
+    Lock.unlock();
+    return true;
   }
   
   bool DTRList::filter_pending_dtrs(std::list<DTR_ptr>& FilteredList){
-  	std::list<DTR_ptr>::iterator it;
-  	Arc::Time now;
-  	
-  	Lock.lock(); 	
-  	for(it = DTRs.begin();it != DTRs.end(); ++it){
-  	  if( ((*it)->came_from_pre_processor() || (*it)->came_from_post_processor() ||
-  	       (*it)->came_from_delivery() || (*it)->came_from_generator()) &&
-  	      ((*it)->get_process_time() <= now) )
-  	    FilteredList.push_back(*it);
-  	}  	    
-  	Lock.unlock();
-  	
-  	// Filtered successfully
-  	return true;
+    Arc::Time now;
+    std::list<DTR_ptr> candidates;
+
+    Lock.lock();
+    collect_dtrs(pending_states, candidates);
+    Lock.unlock();
+
+    for (std::list<DTR_ptr>::iterator it = candidates.begin(); it != candidates.end(); ++it) {
+      if ((*it)->get_process_time() <= now) FilteredList.push_back(*it);
+    }
+
+    // Filtered successfully
+    return true;
   }
   
   bool DTRList::filter_dtrs_by_job(const std::string& jobid, std::list<DTR_ptr>& FilteredList) {
-    std::list<DTR_ptr>::iterator it;
-
     Lock.lock();
-    for(it = DTRs.begin();it != DTRs.end(); ++it)
-      if((*it)->get_parent_job_id() == jobid)
-        FilteredList.push_back(*it);
+    std::map<std::string, std::list<DTR_ptr> >::iterator job = DTRsByJob.find(jobid);
+    if (job != DTRsByJob.end())
+      FilteredList.insert(FilteredList.end(), job->second.begin(), job->second.end());
     Lock.unlock();
 
     // Filtered successfully
@@ -241,18 +311,10 @@ namespace DataStaging {
 
   std::list<std::string> DTRList::all_jobs() {
     std::list<std::string> alljobs;
-    std::list<DTR_ptr>::iterator it;
 
     Lock.lock();
-    for(it = DTRs.begin();it != DTRs.end(); ++it) {
-      std::list<std::string>::iterator i = alljobs.begin();
-      for (; i != alljobs.end(); ++i) {
-        if (*i == (*it)->get_parent_job_id())
-          break;
-      }
-      if (i == alljobs.end())
-        alljobs.push_back((*it)->get_parent_job_id());
-    }
+    for (std::map<std::string, std::list<DTR_ptr> >::iterator job = DTRsByJob.begin(); job != DTRsByJob.end(); ++job)
+      alljobs.push_back(job->first);
     Lock.unlock();
 
     return alljobs;
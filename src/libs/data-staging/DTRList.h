@@ -10,7 +10,9 @@ namespace DataStaging {
   /// Global list of all active DTRs in the system.
   /**
    * This class contains several methods for filtering the list by owner, state
-   * etc.
+   * etc. DTRs are indexed by status, owner and job ID and indexes are updated
+   * whenever a DTR changes status or owner, so filtering takes time
+   * proportional to the number of selected DTRs rather than size of the list.
    * \ingroup datastaging
    * \headerfile DTRList.h arc/data-staging/DTRList.h
    */
@@ -20,8 +22,21 @@ namespace DataStaging {
 
       /// Internal list of DTRs
       std::list<DTR_ptr> DTRs;
+
+      /// Index of DTRs by status, one list per status.
+      /**
+       * DTRs keep their positions in indexes so that moving them between
+       * lists on change of status or owner is done in constant time.
+       */
+      std::list<DTR_ptr> DTRsByStatus[DTRStatus::NULL_STATE+1];
+
+      /// Index of DTRs by owner, one list per process.
+      std::list<DTR_ptr> DTRsByOwner[POST_PROCESSOR+1];
+
+      /// Index of DTRs by parent job ID.
+      std::map<std::string, std::list<DTR_ptr> > DTRsByJob;
   
-      /// Lock to protect list during modification
+      /// Lock to protect list and indexes during modification
       Arc::SimpleCondition Lock;
 
       /// Internal set of sources that are currently being cached.
@@ -34,6 +49,15 @@ namespace DataStaging {
       /// Lock to protect caching sources set during modification
       Arc::SimpleCondition CachingLock;
 
+      /// Move DTR to indexes corresponding to its current status and owner.
+      /** Called by DTR every time its status or owner is changed. */
+      void update_dtr(DTR* dtr);
+
+      /// Collect DTRs with any of given statuses. Must be called with Lock held.
+      void collect_dtrs(const DTRStatus::DTRStatusType* statuses, std::list<DTR_ptr>& FilteredList);
+
+      friend class DTR;
+
     public:
 
       /// Put a new DTR into the list.
@@ -2,11 +2,11 @@
 #include <config.h>
 #endif
 
-#include <arc/ArcLocation.h>
 #include <arc/FileAccess.h>
 #include <arc/FileUtils.h>
 
 #include "DataDeliveryLocalComm.h"
+#include "DataDeliveryLocalWorker.h"
 
 namespace DataStaging {
 
@@ -36,9 +36,12 @@ namespace DataStaging {
   }
 
   DataDeliveryLocalComm::DataDeliveryLocalComm(DTR_ptr dtr, const TransferParameters& params)
-    : DataDeliveryComm(dtr, params),child_(NULL),last_comm(Arc::Time()) {
+    : DataDeliveryComm(dtr, params),worker_(NULL),last_comm(Arc::Time()) {
     if(!dtr->get_source()) return;
     if(!dtr->get_destination()) return;
+    std::list<std::string> args;
+    int child_uid = 0;
+    int child_gid = 0;
     {
       Glib::Mutex::Lock lock(lock_);
       // Initial empty status
@@ -46,10 +49,6 @@ namespace DataStaging {
       status_.commstatus = CommInit;
       status_pos_ = 0;
       // Generate options for child
-      std::list<std::string> args;
-      std::string execpath = Arc::ArcLocation::GetLibDir()+G_DIR_SEPARATOR_S+"DataStagingDelivery";
-      args.push_back(execpath);
-
       // check for alternative source or destination eg cache, mapped URL, TURL
       std::string surl;
       if (!dtr->get_mapped_source().empty()) {
@@ -73,8 +72,6 @@ namespace DataStaging {
         durl = dtr->get_cache_file();
         caching = true;
       }
-      int child_uid = 0;
-      int child_gid = 0;
       if(!caching) {
         child_uid = dtr->get_local_user().get_uid();
         child_gid = dtr->get_local_user().get_gid();
@@ -151,94 +148,28 @@ namespace DataStaging {
         args.push_back("--cstype");
         args.push_back(dtr->get_destination()->DefaultCheckSum());
       }
-      child_ = new Arc::Run(args);
-      // Set up pipes
-      child_->KeepStdout(false);
-      child_->KeepStderr(false);
-      child_->KeepStdin(false);
-      child_->AssignUserId(child_uid);
-      child_->AssignGroupId(child_gid);
-      child_->AssignStdin(stdin_);
-      // Start child
       std::string cmd;
       for(std::list<std::string>::iterator arg = args.begin();arg!=args.end();++arg) {
         cmd += *arg;
         cmd += " ";
       }
-      logger_->msg(Arc::DEBUG, "Running command: %s", cmd);
-      if(!child_->Start()) {
-        delete child_;
-        child_=NULL;
-        return;
-      }
+      logger_->msg(Arc::DEBUG, "Passing transfer to delivery process: %s", cmd);
     }
-    handler_->Add(this);
+    // Worker takes own lock and then lock_, so lock_ must not be held here
+    DataDeliveryLocalWorker* worker = DataDeliveryLocalWorker::Acquire(child_uid, child_gid);
+    if(!worker) return;
+    worker->Start(this, stdin_, args);
   }
 
   DataDeliveryLocalComm::~DataDeliveryLocalComm(void) {
-    {
-      Glib::Mutex::Lock lock(lock_);
-      if(child_) {
-        child_->Kill(10); // Give it a chance
-        delete child_; child_=NULL;  // And then kill for sure
-      }
-    }
+    // Kills delivery process if transfer is still going on
+    DataDeliveryLocalWorker::Release(this);
     if(!tmp_proxy_.empty()) Arc::FileDelete(tmp_proxy_);
     if(handler_) handler_->Remove(this);
   }
 
   void DataDeliveryLocalComm::PullStatus(void) {
-    Glib::Mutex::Lock lock(lock_);
-    if(!child_) return;
-    for(;;) {
-      if(status_pos_ < sizeof(status_buf_)) {
-        int l;
-        // TODO: direct redirect
-        for(;;) {
-          char buf[1024+1];
-          l = child_->ReadStderr(0,buf,sizeof(buf)-1);
-          if(l <= 0) break;
-          buf[l] = 0;
-          char* start = buf;
-          for(;*start;) {
-            char* end = strchr(start,'\n');
-            if(end) *end = 0;
-            logger_->msg(Arc::INFO, "DataDelivery: %s", start);
-            if(!end) break;
-            start = end + 1;
-          }
-        }
-        l = child_->ReadStdout(0,((char*)&status_buf_)+status_pos_,sizeof(status_buf_)-status_pos_);
-        if(l == -1) { // child error or closed comm
-          if(child_->Running()) {
-            status_.commstatus = CommClosed;
-          } else {
-            status_.commstatus = CommExited;
-            if(child_->Result() != 0) {
-              logger_->msg(Arc::ERROR, "DataStagingDelivery exited with code %i", child_->Result());
-              status_.commstatus = CommFailed;
-            }
-          }
-          delete child_; child_=NULL; return;
-        }
-        if(l == 0) break;
-        status_pos_+=l;
-        last_comm = Arc::Time();
-      }
-      if(status_pos_ >= sizeof(status_buf_)) {
-        status_buf_.error_desc[sizeof(status_buf_.error_desc)-1] = 0;
-        status_=status_buf_;
-        status_pos_-=sizeof(status_buf_);
-      }
-    }
-    // check for stuck child process (no report through comm channel)
-    Arc::Period t = Arc::Time() - last_comm;
-    if (transfer_params.max_inactivity_time > 0 && t >= transfer_params.max_inactivity_time*2) {
-      logger_->msg(Arc::ERROR, "Transfer killed after %i seconds without communication", t.GetPeriod());
-      child_->Kill(1);
-      delete child_;
-      child_ = NULL;
-    }
+    // Status is updated by DataDeliveryLocalWorker as soon as it arrives
   }
 
   bool DataDeliveryLocalComm::CheckComm(DTR_ptr dtr, std::vector<std::string>& allowed_dirs, std::string& load_avg) {
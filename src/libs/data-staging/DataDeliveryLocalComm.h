@@ -1,40 +1,46 @@
 #ifndef DATADELIVERYLOCALCOMM_H_
 #define DATADELIVERYLOCALCOMM_H_
 
-#include <arc/Run.h>
-
 #include "DataDeliveryComm.h"
 
 namespace DataStaging {
 
+  class DataDeliveryLocalWorker;
+
   /// This class starts, monitors and controls a local Delivery process.
   /**
+   * Transfers are passed to long-lived DataStagingDelivery processes which
+   * are reused for many transfers. Status of transfer is pushed by process
+   * as soon as it changes and is not polled.
    * \ingroup datastaging
    * \headerfile DataDeliveryLocalComm.h arc/data-staging/DataDeliveryLocalComm.h
    */
   class DataDeliveryLocalComm : public DataDeliveryComm {
+
+    friend class DataDeliveryLocalWorker;
+
   public:
 
-    /// Starts child process
+    /// Passes transfer to delivery process
     DataDeliveryLocalComm(DTR_ptr dtr, const TransferParameters& params);
-    /// This stops the child process
+    /// This stops the transfer by killing delivery process if transfer is still going on
     virtual ~DataDeliveryLocalComm();
 
-    /// Read from stdout of child to get status
+    /// Does nothing since status is updated when it arrives from delivery process
     virtual void PullStatus();
 
     /// Returns "/" since local Delivery can access everywhere
     static bool CheckComm(DTR_ptr dtr, std::vector<std::string>& allowed_dirs, std::string& load_avg);
 
-    /// Returns true if child process exists
-    virtual operator bool() const { return (child_ != NULL); };
-    /// Returns true if child process does not exist
-    virtual bool operator!() const { return (child_ == NULL); };
+    /// Returns true if transfer is being performed by delivery process
+    virtual operator bool() const { return (worker_ != NULL); };
+    /// Returns true if transfer is not being performed by delivery process
+    virtual bool operator!() const { return (worker_ == NULL); };
 
   private:
-    /// Child process
-    Arc::Run* child_;
-    /// Stdin of child, used to pass credentials
+    /// Delivery process performing transfer. Set and reset by worker itself.
+    DataDeliveryLocalWorker* worker_;
+    /// Credentials passed to delivery process
     std::string stdin_;
     /// Temporary credentails location
     std::string tmp_proxy_;
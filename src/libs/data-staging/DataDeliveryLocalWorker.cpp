@@ -0,0 +1,282 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <cstring>
+
+#include <arc/ArcLocation.h>
+
+#include "DataDeliveryLocalComm.h"
+#include "DataDeliveryLocalWorker.h"
+
+namespace DataStaging {
+
+  // Worker without transfers exits after this time (seconds)
+  #define WORKER_IDLE_TIMEOUT (60)
+
+  Glib::Mutex DataDeliveryLocalWorker::lock_;
+  std::list<DataDeliveryLocalWorker*> DataDeliveryLocalWorker::workers_;
+  Arc::Logger DataDeliveryLocalWorker::logger(Arc::Logger::getRootLogger(), "DataStaging.DataDeliveryLocalWorker");
+
+  DataDeliveryLocalWorker::DataDeliveryLocalWorker(int uid, int gid)
+    : child_(NULL), uid_(uid), gid_(gid), owner_(NULL), reserved_(true),
+      closing_(false), kill_(false), exited_(false), starting_(false), idle_since_(0) {
+  }
+
+  DataDeliveryLocalWorker::~DataDeliveryLocalWorker() {
+    delete child_;
+  }
+
+  DataDeliveryLocalWorker* DataDeliveryLocalWorker::Acquire(int uid, int gid) {
+    {
+      Glib::Mutex::Lock lock(lock_);
+      for (std::list<DataDeliveryLocalWorker*>::iterator w = workers_.begin(); w != workers_.end(); ++w) {
+        if ((*w)->reserved_ || (*w)->closing_ || (*w)->kill_) continue;
+        if (((*w)->uid_ != uid) || ((*w)->gid_ != gid)) continue;
+        (*w)->reserved_ = true;
+        return *w;
+      }
+    }
+    std::list<std::string> args;
+    args.push_back(Arc::ArcLocation::GetLibDir()+G_DIR_SEPARATOR_S+"DataStagingDelivery");
+    args.push_back("--worker");
+    DataDeliveryLocalWorker* worker = new DataDeliveryLocalWorker(uid, gid);
+    worker->child_ = new Arc::Run(args);
+    worker->child_->KeepStdout(false);
+    worker->child_->KeepStderr(false);
+    worker->child_->KeepStdin(false);
+    worker->child_->AssignUserId(uid);
+    worker->child_->AssignGroupId(gid);
+    if (!worker->child_->Start()) {
+      logger.msg(Arc::ERROR, "Failed to start delivery process %s", args.front());
+      delete worker;
+      return NULL;
+    }
+    Glib::Mutex::Lock lock(lock_);
+    workers_.push_back(worker);
+    if (!Arc::CreateThreadFunction(&reader, worker)) {
+      logger.msg(Arc::ERROR, "Failed to start thread for communication with delivery process");
+      workers_.remove(worker);
+      worker->child_->Kill(1);
+      delete worker;
+      return NULL;
+    }
+    logger.msg(Arc::VERBOSE, "Started delivery process for uid %i", uid);
+    return worker;
+  }
+
+  bool DataDeliveryLocalWorker::Start(DataDeliveryLocalComm* owner, const std::string& credentials,
+                                      const std::list<std::string>& args) {
+    // Frame content is sequence of strings each preceded by its length
+    std::string content;
+    std::list<std::string> strs(args);
+    strs.push_front(credentials);
+    for (std::list<std::string>::iterator s = strs.begin(); s != strs.end(); ++s) {
+      uint32_t l = s->length();
+      content.append((const char*)&l, sizeof(l));
+      content.append(*s);
+    }
+    DataDeliveryFrame frame;
+    frame.type = FrameTransfer;
+    frame.size = content.length();
+    content.insert(0, (const char*)&frame, sizeof(frame));
+    bool written = false;
+    {
+      Glib::Mutex::Lock lock(lock_);
+      Glib::Mutex::Lock olock(owner->lock_);
+      owner_ = owner;
+      owner->worker_ = this;
+      owner->last_comm = Arc::Time();
+      written = !exited_;
+      // Owner may be detached as soon as lock is released, either by
+      // process exiting or by Release(). Worker stays alive till end
+      // of this method anyway.
+      starting_ = true;
+    }
+    // Worker is reserved for this transfer, so nobody else writes to it
+    std::string::size_type pos = 0;
+    while (written && (pos < content.length())) {
+      int l = child_->WriteStdin(10000, content.c_str()+pos, content.length()-pos);
+      if (l <= 0) written = false;
+      pos += l;
+    }
+    if (!written) logger.msg(Arc::ERROR, "Failed to pass transfer to delivery process");
+    Glib::Mutex::Lock lock(lock_);
+    starting_ = false;
+    if (!written) {
+      if (owner_ == owner) {
+        Glib::Mutex::Lock olock(owner->lock_);
+        Detach();
+      }
+      kill_ = true;
+    }
+    // Nobody refers to worker which exited meanwhile
+    if (exited_ && !reserved_) {
+      lock_.unlock();
+      delete this;
+      lock_.lock();
+    }
+    return written;
+  }
+
+  void DataDeliveryLocalWorker::Release(DataDeliveryLocalComm* owner) {
+    Glib::Mutex::Lock lock(lock_);
+    DataDeliveryLocalWorker* worker = NULL;
+    {
+      Glib::Mutex::Lock olock(owner->lock_);
+      worker = owner->worker_;
+      if (!worker) return;
+      // Transfer is cancelled. Killing is done by reader thread
+      // in order not to block here.
+      worker->Detach();
+    }
+    worker->kill_ = true;
+    // Otherwise deleted by Start() when it finishes
+    if (worker->exited_ && !worker->starting_) {
+      lock_.unlock();
+      delete worker;
+      lock_.lock();
+    }
+  }
+
+  void DataDeliveryLocalWorker::Detach() {
+    if (owner_) owner_->worker_ = NULL;
+    owner_ = NULL;
+    reserved_ = false;
+    idle_since_ = ::time(NULL);
+  }
+
+  void DataDeliveryLocalWorker::ProcessFrame(uint32_t type, const std::string& content) {
+    if (!owner_) return;
+    Glib::Mutex::Lock lock(owner_->lock_);
+    switch (type) {
+      case FrameStatus: {
+        if (content.length() != sizeof(DataDeliveryComm::Status)) {
+          owner_->logger_->msg(Arc::WARNING, "Unexpected status size %u from delivery process", (unsigned int)content.length());
+          break;
+        }
+        DataDeliveryComm::Status status;
+        memcpy(&status, content.c_str(), sizeof(status));
+        status.error_desc[sizeof(status.error_desc)-1] = 0;
+        status.checksum[sizeof(status.checksum)-1] = 0;
+        owner_->status_ = status;
+        owner_->last_comm = Arc::Time();
+      } break;
+      case FrameLog: {
+        owner_->logger_->msg(Arc::INFO, "DataDelivery: %s", content);
+      } break;
+      case FrameDone: {
+        int32_t result = 0;
+        if (content.length() == sizeof(result)) memcpy(&result, content.c_str(), sizeof(result));
+        owner_->status_.commstatus = DataDeliveryComm::CommExited;
+        if (result != 0) {
+          owner_->logger_->msg(Arc::ERROR, "DataStagingDelivery exited with code %i", result);
+          owner_->status_.commstatus = DataDeliveryComm::CommFailed;
+        }
+        // Worker is free for next transfer
+        Detach();
+      } break;
+      default: {
+        owner_->logger_->msg(Arc::WARNING, "Unexpected message type %u from delivery process", type);
+      } break;
+    }
+  }
+
+  void DataDeliveryLocalWorker::ProcessExit() {
+    closing_ = true;
+    if (!owner_) return;
+    Glib::Mutex::Lock lock(owner_->lock_);
+    // Same reporting as when process was started for single transfer
+    owner_->status_.commstatus = DataDeliveryComm::CommExited;
+    if (child_->Result() != 0) {
+      owner_->logger_->msg(Arc::ERROR, "DataStagingDelivery exited with code %i", child_->Result());
+      owner_->status_.commstatus = DataDeliveryComm::CommFailed;
+    }
+    Detach();
+  }
+
+  bool DataDeliveryLocalWorker::Read() {
+    // Messages written directly to stderr, for example by 3rd party libraries
+    for (;;) {
+      char buf[1024+1];
+      int l = child_->ReadStderr(0, buf, sizeof(buf)-1);
+      if (l <= 0) break;
+      buf[l] = 0;
+      Glib::Mutex::Lock lock(lock_);
+      if (owner_) {
+        Glib::Mutex::Lock olock(owner_->lock_);
+        owner_->logger_->msg(Arc::INFO, "DataDelivery: %s", buf);
+      }
+    }
+    char buf[16384];
+    int l = child_->ReadStdout(1000, buf, sizeof(buf));
+    if (l == -1) return false;
+    if (l == 0) return child_->Running();
+    buf_.append(buf, l);
+    Glib::Mutex::Lock lock(lock_);
+    while (buf_.length() >= sizeof(DataDeliveryFrame)) {
+      DataDeliveryFrame frame;
+      memcpy(&frame, buf_.c_str(), sizeof(frame));
+      if (frame.size > MaxFrameSize) {
+        logger.msg(Arc::ERROR, "Delivery process sent malformed message");
+        return false;
+      }
+      if (buf_.length() < sizeof(frame) + frame.size) break;
+      ProcessFrame(frame.type, buf_.substr(sizeof(frame), frame.size));
+      buf_.erase(0, sizeof(frame) + frame.size);
+    }
+    return true;
+  }
+
+  void DataDeliveryLocalWorker::reader(void* arg) {
+    DataDeliveryLocalWorker* it = (DataDeliveryLocalWorker*)arg;
+    // disconnect from root logger since messages are logged to per-DTR Logger
+    Arc::Logger::getRootLogger().setThreadContext();
+    Arc::Logger::getRootLogger().removeDestinations();
+
+    bool killed = false;
+    while (it->Read()) {
+      Glib::Mutex::Lock lock(lock_);
+      if (it->kill_) {
+        if (!killed) {
+          it->closing_ = true;
+          killed = true;
+          lock_.unlock();
+          it->child_->Kill(10);
+          lock_.lock();
+        }
+        continue;
+      }
+      if (!it->owner_) {
+        if (!it->reserved_ && !it->closing_ && ((::time(NULL) - it->idle_since_) > WORKER_IDLE_TIMEOUT)) {
+          // Not needed anymore. Worker exits after reading end of input.
+          it->closing_ = true;
+          it->child_->CloseStdin();
+        }
+        continue;
+      }
+      // Check for stuck transfer (no report through comm channel)
+      DataDeliveryLocalComm* owner = it->owner_;
+      Glib::Mutex::Lock olock(owner->lock_);
+      Arc::Period t = Arc::Time() - owner->last_comm;
+      if ((owner->transfer_params.max_inactivity_time > 0) &&
+          (t >= owner->transfer_params.max_inactivity_time*2)) {
+        owner->logger_->msg(Arc::ERROR, "Transfer killed after %i seconds without communication", t.GetPeriod());
+        it->Detach();
+        it->kill_ = true;
+      }
+    }
+    it->child_->Kill(1);
+    it->child_->Wait();
+    Glib::Mutex::Lock lock(lock_);
+    it->ProcessExit();
+    workers_.remove(it);
+    it->exited_ = true;
+    // Acquire() caller or Start() still refers to worker and will delete it
+    if (it->reserved_ || it->starting_) return;
+    lock_.unlock();
+    delete it;
+    lock_.lock();
+  }
+
+} // namespace DataStaging
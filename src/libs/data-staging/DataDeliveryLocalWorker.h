@@ -0,0 +1,126 @@
+#ifndef DATADELIVERYLOCALWORKER_H_
+#define DATADELIVERYLOCALWORKER_H_
+
+#include <list>
+#include <string>
+
+#include <stdint.h>
+
+#include <arc/Run.h>
+#include <arc/Thread.h>
+
+namespace DataStaging {
+
+  class DataDeliveryLocalComm;
+
+  /// Long-lived DataStagingDelivery process performing transfers one after another.
+  /**
+   * Worker is started with --worker option and communicates with parent
+   * through framed messages. Each frame starts with DataDeliveryFrame header
+   * followed by size bytes of content. Parent sends FrameTransfer holding
+   * credentials and command line options of one transfer. Worker responds
+   * with any number of FrameStatus (DataDeliveryComm::Status) and FrameLog
+   * (one line of text) frames followed by FrameDone holding int32_t result
+   * of transfer. After that worker waits for next transfer. Worker exits
+   * when its stdin is closed.
+   *
+   * All frames coming from worker are processed by dedicated thread which
+   * passes them to DataDeliveryLocalComm currently using the worker. Hence
+   * status of transfer is updated as soon as it is reported.
+   *
+   * Workers are shared by all DataDeliveryLocalComm objects and are kept
+   * separately for every user identity they run under.
+   */
+  class DataDeliveryLocalWorker {
+
+   public:
+    /// Types of frames
+    enum FrameType {
+      FrameTransfer = 1, ///< Parent to worker: start transfer
+      FrameStatus = 2,   ///< Worker to parent: status of transfer
+      FrameLog = 3,      ///< Worker to parent: log message
+      FrameDone = 4      ///< Worker to parent: transfer finished
+    };
+
+    /// Header of every frame
+    struct DataDeliveryFrame {
+      uint32_t type;
+      uint32_t size;
+    };
+
+    /// Maximal accepted size of frame content
+    static const uint32_t MaxFrameSize = 1024*1024;
+
+    /// Find idle worker running under uid:gid or start new one.
+    /**
+     * Returned worker is reserved for caller and must be passed transfer
+     * through Start().
+     */
+    static DataDeliveryLocalWorker* Acquire(int uid, int gid);
+
+    /// Pass transfer to worker.
+    /**
+     * On success owner's worker_ is set to this worker and owner receives
+     * status of transfer from now on. When transfer ends worker resets
+     * owner's worker_ and becomes available for other transfers. On failure
+     * worker must not be referred to anymore.
+     */
+    bool Start(DataDeliveryLocalComm* owner, const std::string& credentials,
+               const std::list<std::string>& args);
+
+    /// Detach owner from its worker.
+    /**
+     * If transfer is still going on worker process is killed. Must be
+     * called without holding owner's lock.
+     */
+    static void Release(DataDeliveryLocalComm* owner);
+
+   private:
+    DataDeliveryLocalWorker(int uid, int gid);
+    ~DataDeliveryLocalWorker();
+    DataDeliveryLocalWorker(const DataDeliveryLocalWorker&);
+    DataDeliveryLocalWorker& operator=(const DataDeliveryLocalWorker&);
+
+    /// Worker process
+    Arc::Run* child_;
+    int uid_;
+    int gid_;
+    /// Object owning current transfer, NULL if there is no transfer
+    DataDeliveryLocalComm* owner_;
+    /// Referred to by Acquire() caller or owner
+    bool reserved_;
+    /// Not going to accept any more transfers
+    bool closing_;
+    /// Process must be killed
+    bool kill_;
+    /// Reader thread exited
+    bool exited_;
+    /// Start() is passing transfer, worker must not be deleted
+    bool starting_;
+    /// Time when worker became idle
+    time_t idle_since_;
+    /// Data received from worker and not processed yet
+    std::string buf_;
+
+    /// Handle one complete frame. Called with pool lock held.
+    void ProcessFrame(uint32_t type, const std::string& content);
+    /// Handle end of worker process. Called with pool lock held.
+    void ProcessExit();
+    /// Detach current owner. Called with pool and owner's locks held.
+    void Detach();
+    /// Read and handle whatever worker sent
+    bool Read();
+
+    /// Thread reading from worker process
+    static void reader(void* arg);
+
+    /// Lock protecting pool and state of all workers
+    static Glib::Mutex lock_;
+    /// All workers
+    static std::list<DataDeliveryLocalWorker*> workers_;
+    static Arc::Logger logger;
+  };
+
+} // namespace DataStaging
+
+#endif /* DATADELIVERYLOCALWORKER_H_ */
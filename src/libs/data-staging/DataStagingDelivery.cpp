@@ -2,7 +2,11 @@
 #include <config.h>
 #endif
 
+#include <cerrno>
 #include <iostream>
+#include <map>
+#include <sstream>
+#include <vector>
 #include <string.h>
 #include <signal.h>
 #include <unistd.h>
@@ -15,12 +19,91 @@
 #include <arc/data/DataBuffer.h>
 
 #include "DataDeliveryComm.h"
+#include "DataDeliveryLocalWorker.h"
 
 using namespace Arc;
 
+typedef DataStaging::DataDeliveryLocalWorker::DataDeliveryFrame DataDeliveryFrame;
+
 static Arc::Logger logger(Arc::Logger::getRootLogger(), "DataDelivery");
 static bool delivery_shutdown = false;
 static Arc::Time start_time;
+// Running as long-lived worker communicating through frames
+static bool delivery_worker = false;
+static Glib::Mutex output_lock;
+
+static bool WriteAll(int h, const char* buf, size_t size) {
+  while(size > 0) {
+    ssize_t l = ::write(h, buf, size);
+    if(l == -1) {
+      if(errno == EINTR) continue;
+      return false;
+    };
+    buf += l;
+    size -= l;
+  };
+  return true;
+}
+
+static bool ReadAll(int h, char* buf, size_t size) {
+  while(size > 0) {
+    ssize_t l = ::read(h, buf, size);
+    if(l == -1) {
+      if(errno == EINTR) continue;
+      return false;
+    };
+    if(l == 0) return false;
+    buf += l;
+    size -= l;
+  };
+  return true;
+}
+
+static bool WriteFrame(uint32_t type, const void* content, uint32_t size) {
+  DataDeliveryFrame frame;
+  frame.type = type;
+  frame.size = size;
+  // Frames are written by transferring and logging threads
+  Glib::Mutex::Lock lock(output_lock);
+  if(!WriteAll(STDOUT_FILENO, (const char*)&frame, sizeof(frame))) return false;
+  return WriteAll(STDOUT_FILENO, (const char*)content, size);
+}
+
+// Passes log messages to parent process in worker mode
+class FrameLogDestination: public Arc::LogDestination {
+ public:
+  FrameLogDestination() {
+    setFormat(Arc::EmptyFormat);
+  }
+  virtual void log(const Arc::LogMessage& message) {
+    std::ostringstream out;
+    out << *this << message;
+    std::string line = out.str();
+    WriteFrame(DataStaging::DataDeliveryLocalWorker::FrameLog, line.c_str(), line.length());
+  }
+};
+
+// Variables set for 3rd party tools and their values at worker start.
+// Worker restores them before every transfer so that credentials of
+// previous transfer are not used.
+static const char* x509_env[] = { "X509_USER_PROXY", "X509_CERT_DIR", "X509_USER_CERT", "X509_USER_KEY", NULL };
+static std::map<std::string, std::string> x509_env_saved;
+
+static void SaveX509Env() {
+  for(const char** var = x509_env; *var; ++var) {
+    bool found = false;
+    std::string value = GetEnv(*var, found);
+    if(found) x509_env_saved[*var] = value;
+  };
+}
+
+static void RestoreX509Env() {
+  for(const char** var = x509_env; *var; ++var) {
+    std::map<std::string, std::string>::iterator saved = x509_env_saved.find(*var);
+    if(saved == x509_env_saved.end()) UnsetEnv(*var);
+    else SetEnv(*var, saved->second);
+  };
+}
 
 static void sig_shutdown(int)
 {
@@ -60,6 +143,10 @@ static void ReportStatus(DataStaging::DTRStatus::DTRStatusType st,
   status.offset = 0;
   status.speed = 0;
   strncpy(status.checksum, checksum.c_str(), sizeof(status.checksum));
+  if(delivery_worker) {
+    WriteFrame(DataStaging::DataDeliveryLocalWorker::FrameStatus, &status, sizeof(status));
+    return;
+  };
   if(status_pos == 0) {
     status_changed=true;
   };
@@ -106,13 +193,10 @@ static unsigned long long int GetFileSize(const DataPoint& source, const DataPoi
   return 0;
 }
 
-int main(int argc,char* argv[]) {
+static int Transfer(int argc, char* argv[], const std::string& proxy_cred) {
 
-  // log to stderr
-  Arc::Logger::getRootLogger().setThreshold(Arc::VERBOSE); //TODO: configurable
-  Arc::LogStream logcerr(std::cerr);
-  logcerr.setFormat(Arc::EmptyFormat);
-  Arc::Logger::getRootLogger().addDestination(logcerr);
+  start_time = Arc::Time();
+  transfer_bytes = 0;
 
   // Collecting parameters
   // --surl: source URL 
@@ -198,6 +282,12 @@ int main(int argc,char* argv[]) {
     };
   };
 
+  // Checksum objects must be destroyed after DataHandles and after
+  // buffer which stops its checksum threads only in destructor
+  CheckSumAny crc;
+  CheckSumAny crc_source;
+  CheckSumAny crc_dest;
+
   DataBuffer buffer;
   buffer.speed.verbose(true);
   unsigned long long int minspeed = 0;
@@ -221,22 +311,13 @@ int main(int argc,char* argv[]) {
           buffer.speed.set_base(value);
         } else {
           logger.msg(ERROR, "Unknown transfer option: %s", name);
-          _exit(-1);
+          return -1;
         }
       };
     };
   }
   buffer.speed.set_min_speed(minspeed,minspeedtime);
 
-  // Checksum objects must be destroyed after DataHandles
-  CheckSumAny crc;
-  CheckSumAny crc_source;
-  CheckSumAny crc_dest;
-
-  // Read credential from stdin if available
-  std::string proxy_cred;
-  std::getline(std::cin, proxy_cred, '\0');
-
   initializeCredentialsType source_cred(initializeCredentialsType::SkipCredentials);
   UserConfig source_cfg(source_cred);
   if(!source_cred_path.empty()) source_cfg.ProxyPath(source_cred_path);
@@ -246,12 +327,11 @@ int main(int argc,char* argv[]) {
   DataHandle source(source_url, source_cfg);
   if(!source) {
     logger.msg(ERROR, "Source URL not supported: %s", source_url.str());
-    _exit(-1);
-    //return -1;
+    return -1;
   };
   if (source->RequiresCredentialsInFile() && source_cred_path.empty()) {
     logger.msg(ERROR, "No credentials supplied");
-    _exit(-1);
+    return -1;
   }
 
   source->SetSecure(false);
@@ -265,17 +345,17 @@ int main(int argc,char* argv[]) {
   DataHandle dest(dest_url,dest_cfg);
   if(!dest) {
     logger.msg(ERROR, "Destination URL not supported: %s", dest_url.str());
-    _exit(-1);
-    //return -1;
+    return -1;
   };
   if (dest->RequiresCredentialsInFile() && dest_cred_path.empty()) {
     logger.msg(ERROR, "No credentials supplied");
-    _exit(-1);
+    return -1;
   }
   dest->SetSecure(false);
   dest->Passive(true);
 
   // set X509* for 3rd party tools which need it (eg GFAL)
+  if (delivery_worker) RestoreX509Env();
   if (!source_cfg.ProxyPath().empty()) {
     SetEnv("X509_USER_PROXY", source_cfg.ProxyPath());
     if (!source_cfg.CACertificatesDirectory().empty()) SetEnv("X509_CERT_DIR", source_cfg.CACertificatesDirectory());
@@ -396,8 +476,7 @@ int main(int argc,char* argv[]) {
                    std::string("Failed reading from source: ")+source->CurrentLocation().str()+
                     " : "+std::string(source_st),
                    0,0,0);
-      _exit(-1);
-      //return -1;
+      return -1;
     };
     dest_st = dest->StartWriting(buffer);
     if(!dest_st) {
@@ -410,8 +489,10 @@ int main(int argc,char* argv[]) {
                    std::string("Failed writing to destination: ")+dest->CurrentLocation().str()+
                     " : "+std::string(dest_st),
                    0,0,0);
-      _exit(-1);
-      //return -1;
+      // Let reading thread stop
+      buffer.error_write(true);
+      source->StopReading();
+      return -1;
     }
     // While transfer is running in another threads
     // here we periodically report status to parent
@@ -438,7 +519,7 @@ int main(int argc,char* argv[]) {
                  buffer.speed.transferred_size(),
                  GetFileSize(*source,*dest),0);
     dest->StopWriting();
-    _exit(-1);
+    return -1;
   }
   ReportStatus(DataStaging::DTRStatus::TRANSFERRING,
                DataStaging::DTRErrorStatus::NONE_ERROR,
@@ -567,7 +648,76 @@ int main(int argc,char* argv[]) {
                  start_time,
                  calc_csum);
   };
-  _exit(eof_reached?0:1);
-  //return eof_reached?0:1;
+  return eof_reached?0:1;
+}
+
+// Performs transfers passed by parent one after another until stdin is closed
+static int Worker() {
+  delivery_worker = true;
+  SaveX509Env();
+  signal(SIGTERM, sig_shutdown);
+  signal(SIGINT, sig_shutdown);
+  while(!delivery_shutdown) {
+    DataDeliveryFrame frame;
+    if(!ReadAll(STDIN_FILENO, (char*)&frame, sizeof(frame))) break; // parent closed channel
+    if(frame.size > DataStaging::DataDeliveryLocalWorker::MaxFrameSize) {
+      logger.msg(ERROR, "Received malformed message");
+      return -1;
+    };
+    std::string content(frame.size, '\0');
+    if((frame.size > 0) && !ReadAll(STDIN_FILENO, &content[0], frame.size)) break;
+    if(frame.type != DataStaging::DataDeliveryLocalWorker::FrameTransfer) {
+      logger.msg(WARNING, "Unexpected message type %u", frame.type);
+      continue;
+    };
+    // Credentials followed by command line options
+    std::vector<std::string> strs;
+    std::string::size_type pos = 0;
+    while(pos + sizeof(uint32_t) <= content.length()) {
+      uint32_t l = 0;
+      memcpy(&l, content.c_str()+pos, sizeof(l));
+      pos += sizeof(l);
+      if(l > content.length() - pos) break;
+      strs.push_back(content.substr(pos, l));
+      pos += l;
+    };
+    int32_t result = -1;
+    if((pos != content.length()) || strs.empty()) {
+      logger.msg(ERROR, "Received malformed message");
+    } else {
+      std::vector<char*> args;
+      args.push_back((char*)"DataStagingDelivery");
+      for(std::vector<std::string>::size_type n = 1; n < strs.size(); ++n) {
+        args.push_back((char*)strs[n].c_str());
+      };
+      args.push_back(NULL);
+      result = Transfer(args.size()-1, &args[0], strs[0]);
+    };
+    if(!WriteFrame(DataStaging::DataDeliveryLocalWorker::FrameDone, &result, sizeof(result))) break;
+  };
+  return 0;
 }
 
+int main(int argc,char* argv[]) {
+
+  if((argc == 2) && (strcmp(argv[1], "--worker") == 0)) {
+    // log through parent
+    Arc::Logger::getRootLogger().setThreshold(Arc::VERBOSE); //TODO: configurable
+    FrameLogDestination logframe;
+    Arc::Logger::getRootLogger().addDestination(logframe);
+    _exit(Worker());
+  };
+
+  // log to stderr
+  Arc::Logger::getRootLogger().setThreshold(Arc::VERBOSE); //TODO: configurable
+  Arc::LogStream logcerr(std::cerr);
+  logcerr.setFormat(Arc::EmptyFormat);
+  Arc::Logger::getRootLogger().addDestination(logcerr);
+
+  // Read credential from stdin if available
+  std::string proxy_cred;
+  std::getline(std::cin, proxy_cred, '\0');
+
+  _exit(Transfer(argc, argv, proxy_cred));
+  //return Transfer(argc, argv, proxy_cred);
+}
@@ -14,6 +14,13 @@
 
 namespace DataStaging {
 
+  // Limits and initial value of number of DTRs in one bulk request
+  static const unsigned int BULK_SIZE_MIN = 10;
+  static const unsigned int BULK_SIZE_INITIAL = 100;
+  static const unsigned int BULK_SIZE_MAX = 1000;
+  // Bulk requests taking longer than this (in seconds) are made smaller
+  static const time_t BULK_DURATION_TARGET = 30;
+
   std::string Processor::hostname;
 
   /** Set up logging. Should be called at the start of each thread method. */
@@ -27,7 +34,70 @@ namespace DataStaging {
     request->get_logger()->removeDestinations();
   }
 
-  Processor::Processor() {
+  /** Set state of DTR according to result of source preparation. */
+  static void sourcePrepared(DTR_ptr request, const Arc::DataStatus& res, unsigned int wait_time) {
+    if (!res.Passed()) {
+      request->get_logger()->msg(Arc::ERROR, std::string(res));
+      request->set_error_status(res.Retryable() ? DTRErrorStatus::TEMPORARY_REMOTE_ERROR : DTRErrorStatus::PERMANENT_REMOTE_ERROR,
+                                DTRErrorStatus::ERROR_SOURCE,
+                                "Failed to prepare source " + request->get_source()->CurrentLocation().str() + ": " + std::string(res));
+    }
+    else if (res == Arc::DataStatus::ReadPrepareWait) {
+      // if timeout then don't wait - scheduler will deal with it immediately
+      if (Arc::Time() < request->get_timeout()) {
+        if (wait_time > 60) wait_time = 60;
+        request->set_process_time(wait_time);
+        request->get_logger()->msg(Arc::VERBOSE, "Source is not ready, will wait %u seconds", wait_time);
+      }
+      request->set_status(DTRStatus::STAGING_PREPARING_WAIT);
+    }
+    else {
+      if (request->get_source()->TransferLocations().empty()) {
+        request->get_logger()->msg(Arc::ERROR, "No physical files found for source");
+        request->set_error_status(DTRErrorStatus::PERMANENT_REMOTE_ERROR,
+                                  DTRErrorStatus::ERROR_SOURCE,
+                                  "No physical files found for source " + request->get_source()->CurrentLocation().str());
+      } else {
+        // TODO order physical files according to eg preferred pattern
+      }
+    }
+  }
+
+  /** Report result of releasing source. */
+  static void sourceReleased(DTR_ptr request, const Arc::DataStatus& res) {
+    if (!res.Passed()) {
+      // an error here is not critical to the transfer
+      request->get_logger()->msg(Arc::WARNING, "There was a problem during post-transfer source handling: %s",
+                                 std::string(res));
+    }
+  }
+
+  /** Report result of removing pre-registered destination. */
+  static void destinationUnregistered(DTR_ptr request, const Arc::DataStatus& res) {
+    if (!res.Passed()) {
+      request->get_logger()->msg(Arc::ERROR, "Failed to unregister pre-registered destination %s: %s."
+                                 " You may need to unregister it manually",
+                                 request->get_destination()->str(), std::string(res));
+    }
+  }
+
+  /** Set state of DTR according to result of destination registration. */
+  static void destinationRegistered(DTR_ptr request, const Arc::DataStatus& res) {
+    if (!res.Passed()) {
+      request->get_logger()->msg(Arc::ERROR, "Failed to register destination replica: %s",
+                                 std::string(res));
+      if (!request->get_destination()->PreUnregister(request->is_replication()).Passed()) {
+        request->get_logger()->msg(Arc::ERROR, "Failed to unregister pre-registered destination %s."
+                                   " You may need to unregister it manually",
+                                   request->get_destination()->str());
+      }
+      request->set_error_status(res.Retryable() ? DTRErrorStatus::TEMPORARY_REMOTE_ERROR : DTRErrorStatus::PERMANENT_REMOTE_ERROR,
+                                DTRErrorStatus::ERROR_DESTINATION,
+                                "Could not post-register destination " + request->get_destination()->str() + ": " + std::string(res));
+    }
+  }
+
+  Processor::Processor(): bulk_size(BULK_SIZE_INITIAL) {
     // Get hostname, needed to exclude ACIX replicas on localhost
     char hostn[256];
     if (gethostname(hostn, sizeof(hostn)) == 0){
@@ -35,6 +105,27 @@ namespace DataStaging {
     }
   }
 
+  unsigned int Processor::get_bulk_size() {
+    bulk_lock.lock();
+    unsigned int size = bulk_size;
+    bulk_lock.unlock();
+    return size;
+  }
+
+  void Processor::adapt_bulk_size(unsigned int size, bool passed, const Arc::Period& duration) {
+    bulk_lock.lock();
+    if (!passed || duration.GetPeriod() >= BULK_DURATION_TARGET) {
+      // Remote service has problems with requests of this size
+      if (size <= bulk_size) bulk_size = size/2;
+    } else if (size >= bulk_size && duration.GetPeriod() < BULK_DURATION_TARGET/2) {
+      // Full request was handled fast enough - try bigger ones
+      bulk_size *= 2;
+    }
+    if (bulk_size < BULK_SIZE_MIN) bulk_size = BULK_SIZE_MIN;
+    if (bulk_size > BULK_SIZE_MAX) bulk_size = BULK_SIZE_MAX;
+    bulk_lock.unlock();
+  }
+
   /* Thread methods for each state of the DTR */
 
   void Processor::DTRCheckCache(void* arg) {
@@ -283,6 +374,7 @@ namespace DataStaging {
     // NOTE only source resolution can be done in bulk
     BulkThreadArgument* targ = (BulkThreadArgument*)arg;
     std::list<DTR_ptr> requests = targ->dtrs;
+    Processor* targ_proc = targ->proc;
     delete targ;
 
     if (requests.empty()) return;
@@ -295,7 +387,9 @@ namespace DataStaging {
     }
 
     // check for source replicas
+    Arc::Time start;
     Arc::DataStatus res = requests.front()->get_source()->Resolve(true, sources);
+    targ_proc->adapt_bulk_size(requests.size(), res.Passed(), Arc::Time() - start);
     for (std::list<DTR_ptr>::iterator i = requests.begin(); i != requests.end(); ++i) {
       DTR_ptr request = *i;
       if (!res.Passed()) {
@@ -381,6 +475,7 @@ namespace DataStaging {
   void Processor::DTRBulkQueryReplica(void* arg) {
     BulkThreadArgument* targ = (BulkThreadArgument*)arg;
     std::list<DTR_ptr> requests = targ->dtrs;
+    Processor* targ_proc = targ->proc;
     delete targ;
 
     if (requests.empty()) return;
@@ -394,7 +489,9 @@ namespace DataStaging {
 
     // Query source
     std::list<Arc::FileInfo> files;
+    Arc::Time start;
     Arc::DataStatus res = sources.front()->Stat(files, sources, Arc::DataPoint::INFO_TYPE_CONTENT);
+    targ_proc->adapt_bulk_size(requests.size(), res.Passed() && (files.size() == requests.size()), Arc::Time() - start);
 
     std::list<Arc::FileInfo>::const_iterator file = files.begin();
     for (std::list<DTR_ptr>::iterator i = requests.begin(); i != requests.end(); ++i, ++file) {
@@ -514,31 +611,7 @@ namespace DataStaging {
       unsigned int source_wait_time = 10;
       request->get_logger()->msg(Arc::VERBOSE, "Preparing to stage source");
       Arc::DataStatus res = request->get_source()->PrepareReading(0, source_wait_time);
-      if (!res.Passed()) {
-        request->get_logger()->msg(Arc::ERROR, std::string(res));
-        request->set_error_status(res.Retryable() ? DTRErrorStatus::TEMPORARY_REMOTE_ERROR : DTRErrorStatus::PERMANENT_REMOTE_ERROR,
-                                  DTRErrorStatus::ERROR_SOURCE,
-                                  "Failed to prepare source " + request->get_source()->CurrentLocation().str() + ": " + std::string(res));
-      }
-      else if (res == Arc::DataStatus::ReadPrepareWait) {
-        // if timeout then don't wait - scheduler will deal with it immediately
-        if (Arc::Time() < request->get_timeout()) {
-          if (source_wait_time > 60) source_wait_time = 60;
-          request->set_process_time(source_wait_time);
-          request->get_logger()->msg(Arc::VERBOSE, "Source is not ready, will wait %u seconds", source_wait_time);
-        }
-        request->set_status(DTRStatus::STAGING_PREPARING_WAIT);
-      }
-      else {
-        if (request->get_source()->TransferLocations().empty()) {
-          request->get_logger()->msg(Arc::ERROR, "No physical files found for source");
-          request->set_error_status(DTRErrorStatus::PERMANENT_REMOTE_ERROR,
-                                    DTRErrorStatus::ERROR_SOURCE,
-                                    "No physical files found for source " + request->get_source()->CurrentLocation().str());
-        } else {
-          // TODO order physical files according to eg preferred pattern
-        }
-      }
+      sourcePrepared(request, res, source_wait_time);
     }
     if (request->error()) {
       request->set_status(DTRStatus::STAGED_PREPARED);
@@ -583,6 +656,46 @@ namespace DataStaging {
     DTR::push(request, SCHEDULER);
   }
 
+  void Processor::DTRBulkStagePrepare(void* arg) {
+    // NOTE only source preparation can be done in bulk
+    BulkThreadArgument* targ = (BulkThreadArgument*)arg;
+    std::list<DTR_ptr> requests = targ->dtrs;
+    Processor* targ_proc = targ->proc;
+    delete targ;
+
+    if (requests.empty()) return;
+
+    std::list<Arc::DataPoint*> sources;
+    for (std::list<DTR_ptr>::iterator i = requests.begin(); i != requests.end(); ++i) {
+      setUpLogger(*i);
+      (*i)->get_logger()->msg(Arc::VERBOSE, "Preparing to stage source in bulk");
+      sources.push_back((*i)->get_source()->CurrentLocationHandle());
+    }
+
+    unsigned int source_wait_time = 0;
+    std::list<Arc::DataStatus> results;
+    Arc::Time start;
+    Arc::DataStatus res = sources.front()->PrepareReading(sources, source_wait_time, results);
+    targ_proc->adapt_bulk_size(requests.size(), res.Passed() && (results.size() == requests.size()), Arc::Time() - start);
+    // give default wait time for cases where no wait time is given by the remote service
+    if (source_wait_time == 0) source_wait_time = 10;
+
+    std::list<Arc::DataStatus>::const_iterator result = results.begin();
+    for (std::list<DTR_ptr>::iterator i = requests.begin(); i != requests.end(); ++i) {
+      DTR_ptr request = *i;
+      if (!res.Passed() || results.size() != requests.size()) {
+        sourcePrepared(request, res.Passed() ? Arc::DataStatus(Arc::DataStatus::ReadPrepareError, EARCLOGIC, "Bad number of results")
+                                             : res, source_wait_time);
+      } else {
+        sourcePrepared(request, *result, source_wait_time);
+        ++result;
+      }
+      if (request->get_status() != DTRStatus::STAGING_PREPARING_WAIT)
+        request->set_status(DTRStatus::STAGED_PREPARED);
+      DTR::push(request, SCHEDULER);
+    }
+  }
+
   void Processor::DTRReleaseRequest(void* arg) {
     // only valid for stageable (SRM-like) protocols. call request->source.FinishReading() and/or
     // request->destination.FinishWriting() to release or abort requests
@@ -596,11 +709,7 @@ namespace DataStaging {
     if (request->get_source()->IsStageable()) {
       request->get_logger()->msg(Arc::VERBOSE, "Releasing source");
       res = request->get_source()->FinishReading(request->error() || request->cancel_requested());
-      if (!res.Passed()) {
-        // an error here is not critical to the transfer
-        request->get_logger()->msg(Arc::WARNING, "There was a problem during post-transfer source handling: %s",
-                                   std::string(res));
-      }
+      sourceReleased(request, res);
     }
     if (request->get_destination()->IsStageable()) {
       request->get_logger()->msg(Arc::VERBOSE, "Releasing destination");
@@ -625,6 +734,47 @@ namespace DataStaging {
     DTR::push(request, SCHEDULER);
   }
 
+  void Processor::DTRBulkReleaseRequest(void* arg) {
+    // NOTE only release of source can be done in bulk
+    BulkThreadArgument* targ = (BulkThreadArgument*)arg;
+    std::list<DTR_ptr> requests = targ->dtrs;
+    Processor* targ_proc = targ->proc;
+    delete targ;
+
+    if (requests.empty()) return;
+
+    // requests which failed or were cancelled are aborted rather than released
+    std::map<bool, std::list<DTR_ptr> > groups;
+    for (std::list<DTR_ptr>::iterator i = requests.begin(); i != requests.end(); ++i) {
+      setUpLogger(*i);
+      (*i)->get_logger()->msg(Arc::VERBOSE, "Releasing source in bulk");
+      groups[(*i)->error() || (*i)->cancel_requested()].push_back(*i);
+    }
+
+    for (std::map<bool, std::list<DTR_ptr> >::iterator g = groups.begin(); g != groups.end(); ++g) {
+      std::list<Arc::DataPoint*> sources;
+      for (std::list<DTR_ptr>::iterator i = g->second.begin(); i != g->second.end(); ++i) {
+        sources.push_back((*i)->get_source()->CurrentLocationHandle());
+      }
+      std::list<Arc::DataStatus> results;
+      Arc::Time start;
+      Arc::DataStatus res = sources.front()->FinishReading(sources, g->first, results);
+      targ_proc->adapt_bulk_size(g->second.size(), res.Passed() && (results.size() == g->second.size()), Arc::Time() - start);
+
+      std::list<Arc::DataStatus>::const_iterator result = results.begin();
+      for (std::list<DTR_ptr>::iterator i = g->second.begin(); i != g->second.end(); ++i) {
+        if (!res.Passed() || results.size() != g->second.size()) {
+          sourceReleased(*i, res);
+        } else {
+          sourceReleased(*i, *result);
+          ++result;
+        }
+        (*i)->set_status(DTRStatus::REQUEST_RELEASED);
+        DTR::push(*i, SCHEDULER);
+      }
+    }
+  }
+
   void Processor::DTRRegisterReplica(void* arg) {
     // call request->destination.Register() to add new replica and metadata for normal workflow
     // call request->destination.PreUnregister() to delete LFN placed during
@@ -639,33 +789,71 @@ namespace DataStaging {
     if (request->error() || request->cancel_requested()) {
       request->get_logger()->msg(Arc::VERBOSE, "Removing pre-registered destination in index service");
       Arc::DataStatus res = request->get_destination()->PreUnregister(request->is_replication());
-      if (!res.Passed()) {
-        request->get_logger()->msg(Arc::ERROR, "Failed to unregister pre-registered destination %s: %s."
-                                   " You may need to unregister it manually",
-                                   request->get_destination()->str(), std::string(res));
-      }
+      destinationUnregistered(request, res);
     }
     else {
       request->get_logger()->msg(Arc::VERBOSE, "Registering destination replica");
       Arc::DataStatus res = request->get_destination()->PostRegister(request->is_replication());
-      if (!res.Passed()) {
-        request->get_logger()->msg(Arc::ERROR, "Failed to register destination replica: %s",
-                                   std::string(res));
-        if (!request->get_destination()->PreUnregister(request->is_replication()).Passed()) {
-          request->get_logger()->msg(Arc::ERROR, "Failed to unregister pre-registered destination %s."
-                                     " You may need to unregister it manually",
-                                     request->get_destination()->str());
-        }
-        request->set_error_status(res.Retryable() ? DTRErrorStatus::TEMPORARY_REMOTE_ERROR : DTRErrorStatus::PERMANENT_REMOTE_ERROR,
-                                  DTRErrorStatus::ERROR_DESTINATION,
-                                  "Could not post-register destination " + request->get_destination()->str() + ": " + std::string(res));
-      }
+      destinationRegistered(request, res);
     }
     // finished with registration - send back to scheduler
     request->set_status(DTRStatus::REPLICA_REGISTERED);
     DTR::push(request, SCHEDULER);
   }
 
+  void Processor::DTRBulkRegisterReplica(void* arg) {
+    BulkThreadArgument* targ = (BulkThreadArgument*)arg;
+    std::list<DTR_ptr> requests = targ->dtrs;
+    Processor* targ_proc = targ->proc;
+    delete targ;
+
+    if (requests.empty()) return;
+
+    // requests are grouped by whether they are unregistered because of
+    // error or cancellation, and by replication flag
+    std::map<std::pair<bool, bool>, std::list<DTR_ptr> > groups;
+    for (std::list<DTR_ptr>::iterator i = requests.begin(); i != requests.end(); ++i) {
+      setUpLogger(*i);
+      bool unregister = (*i)->error() || (*i)->cancel_requested();
+      if (unregister) {
+        (*i)->get_logger()->msg(Arc::VERBOSE, "Removing pre-registered destination in index service in bulk");
+      } else {
+        (*i)->get_logger()->msg(Arc::VERBOSE, "Registering destination replica in bulk");
+      }
+      groups[std::make_pair(unregister, (*i)->is_replication())].push_back(*i);
+    }
+
+    for (std::map<std::pair<bool, bool>, std::list<DTR_ptr> >::iterator g = groups.begin(); g != groups.end(); ++g) {
+      bool unregister = g->first.first;
+      bool replication = g->first.second;
+      std::list<Arc::DataPoint*> destinations;
+      for (std::list<DTR_ptr>::iterator i = g->second.begin(); i != g->second.end(); ++i) {
+        destinations.push_back(&(*((*i)->get_destination())));
+      }
+      std::list<Arc::DataStatus> results;
+      Arc::Time start;
+      Arc::DataStatus res = unregister ? destinations.front()->PreUnregister(destinations, replication, results)
+                                       : destinations.front()->PostRegister(destinations, replication, results);
+      targ_proc->adapt_bulk_size(g->second.size(), res.Passed() && (results.size() == g->second.size()), Arc::Time() - start);
+
+      std::list<Arc::DataStatus>::const_iterator result = results.begin();
+      for (std::list<DTR_ptr>::iterator i = g->second.begin(); i != g->second.end(); ++i) {
+        Arc::DataStatus r = res;
+        if (res.Passed() && results.size() == g->second.size()) {
+          r = *result;
+          ++result;
+        } else if (res.Passed()) {
+          r = Arc::DataStatus(Arc::DataStatus::GenericError, EARCLOGIC, "Bad number of results");
+        }
+        if (unregister) destinationUnregistered(*i, r);
+        else destinationRegistered(*i, r);
+        // finished with registration - send back to scheduler
+        (*i)->set_status(DTRStatus::REPLICA_REGISTERED);
+        DTR::push(*i, SCHEDULER);
+      }
+    }
+  }
+
   void Processor::DTRProcessCache(void* arg) {
     // link or copy cached file to session dir, or release locks in case
     // of error or deciding not to use cache (for example because of a mapped link)
@@ -805,19 +993,22 @@ namespace DataStaging {
 
       case DTRStatus::STAGE_PREPARE: {
         request->set_status(DTRStatus::STAGING_PREPARING);
-        Arc::CreateThreadFunction(&DTRStagePrepare, (void*)arg, &thread_count);
+        if (bulk_arg) Arc::CreateThreadFunction(&DTRBulkStagePrepare, (void*)bulk_arg, &thread_count);
+        else if (arg) Arc::CreateThreadFunction(&DTRStagePrepare, (void*)arg, &thread_count);
       }; break;
 
       // post-processor states
 
       case DTRStatus::RELEASE_REQUEST: {
         request->set_status(DTRStatus::RELEASING_REQUEST);
-        Arc::CreateThreadFunction(&DTRReleaseRequest, (void*)arg, &thread_count);
+        if (bulk_arg) Arc::CreateThreadFunction(&DTRBulkReleaseRequest, (void*)bulk_arg, &thread_count);
+        else if (arg) Arc::CreateThreadFunction(&DTRReleaseRequest, (void*)arg, &thread_count);
       }; break;
 
       case DTRStatus::REGISTER_REPLICA: {
         request->set_status(DTRStatus::REGISTERING_REPLICA);
-        Arc::CreateThreadFunction(&DTRRegisterReplica, (void*)arg, &thread_count);
+        if (bulk_arg) Arc::CreateThreadFunction(&DTRBulkRegisterReplica, (void*)bulk_arg, &thread_count);
+        else if (arg) Arc::CreateThreadFunction(&DTRRegisterReplica, (void*)arg, &thread_count);
       }; break;
 
       case DTRStatus::PROCESS_CACHE: {
@@ -52,6 +52,22 @@ namespace DataStaging {
     /// Our hostname
     static std::string hostname;
 
+    /// Current maximal number of DTRs in one bulk request
+    unsigned int bulk_size;
+
+    /// Lock protecting bulk_size
+    Arc::SimpleCondition bulk_lock;
+
+    /// Adjust bulk_size according to outcome of bulk request.
+    /**
+     * The size is increased while full bulk requests succeed quickly and
+     * decreased when they fail or take too long.
+     * @param size Number of DTRs in the request
+     * @param passed Whether the request succeeded
+     * @param duration Time taken by the request
+     */
+    void adapt_bulk_size(unsigned int size, bool passed, const Arc::Period& duration);
+
     /* Thread methods which deal with each state */
     /// Check the cache to see if the file already exists
     static void DTRCheckCache(void* arg);
@@ -67,10 +83,16 @@ namespace DataStaging {
     static void DTRPreClean(void *arg);
     /// Call external services to prepare physical files for reading/writing
     static void DTRStagePrepare(void* arg);
+    /// Bulk prepare physical source files for reading
+    static void DTRBulkStagePrepare(void* arg);
     /// Release requests made during DTRStagePrepare
     static void DTRReleaseRequest(void* arg);
+    /// Bulk release requests made during DTRBulkStagePrepare
+    static void DTRBulkReleaseRequest(void* arg);
     /// Register destination file in catalog
     static void DTRRegisterReplica(void* arg);
+    /// Bulk register or unregister destination files in catalog
+    static void DTRBulkRegisterReplica(void* arg);
     /// Link cached file to final destination
     static void DTRProcessCache(void* arg);
 
@@ -105,6 +127,12 @@ namespace DataStaging {
      * it is finished.
      */
     virtual void receiveDTR(DTR_ptr dtr);
+
+    /// Maximal number of DTRs which should be put into one bulk request.
+    /**
+     * The value adapts to how remote services handle bulk requests.
+     */
+    unsigned int get_bulk_size();
   };
 
 
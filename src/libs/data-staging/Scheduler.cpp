@@ -128,6 +128,29 @@ namespace DataStaging {
     return dtr1->get_priority() > dtr2->get_priority();
   }
 
+  /* Key identifying DTRs which may be put in the same bulk request. DTRs
+   * of different jobs may be combined as long as they are accessed with
+   * the same identity and go to the same service. Registration goes to
+   * the destination service, all other bulk operations to the source.
+   */
+  static std::string bulk_key(DTR_ptr dtr)
+  {
+    const DTRCredentialInfo& cred = dtr->get_credential_info();
+    Arc::DataHandle& endpoint = (dtr->get_status() == DTRStatus::REGISTER_REPLICA) ?
+                                dtr->get_destination() : dtr->get_source();
+    return endpoint->GetURL().Protocol() + "\n" +
+           endpoint->GetURL().Host() + "\n" +
+           endpoint->CurrentLocation().Protocol() + "\n" +
+           endpoint->CurrentLocation().Host() + "\n" +
+           // This is because we cannot have a mix of LFNs and GUIDs when querying a catalog like LFC
+           (endpoint->GetURL().MetaDataOption("guid").empty() ? "lfn" : "guid") + "\n" +
+           Arc::tostring(dtr->get_local_user().get_uid()) + "\n" +
+           cred.getDN() + "\n" +
+           cred.extractVOMSVO() + "\n" +
+           cred.extractVOMSGroup() + "\n" +
+           cred.extractVOMSRole();
+  }
+
   void Scheduler::next_replica(DTR_ptr request) {
     if (!request->error()) { // bad logic
       request->set_error_status(DTRErrorStatus::INTERNAL_LOGIC_ERROR,
@@ -803,6 +826,7 @@ namespace DataStaging {
     event_lock.lock();
     events.push_back(event);
     event_lock.unlock();
+    wakeup_signal.signal();
   }
 
   void Scheduler::choose_delivery_service(DTR_ptr request) {
@@ -960,6 +984,7 @@ namespace DataStaging {
   void Scheduler::process_events(void){
     
     Arc::Time now;
+    next_event_time = Arc::Time(Arc::Time::UNDEFINED);
     event_lock.lock();
 
     for (std::list<DTR_ptr>::iterator event = events.begin(); event != events.end();) {
@@ -984,6 +1009,12 @@ namespace DataStaging {
           continue;
         }
       }
+      // Remember when the remaining event has to be looked at again. Events
+      // which stay without delay are retried after short pause.
+      Arc::Time process_time(tmp->get_process_time());
+      if (process_time <= now) process_time = now + Arc::Period(0, EventRetryTime*1000000);
+      if (next_event_time == Arc::Time(Arc::Time::UNDEFINED) || process_time < next_event_time)
+        next_event_time = process_time;
       event_lock.lock();
       ++event;
     }
@@ -1039,8 +1070,10 @@ namespace DataStaging {
 
       if (DTRQueue.empty() && ActiveDTRs.empty()) continue;
 
-      // Map of job id to list of DTRs, used for grouping bulk requests
+      // Map of bulk key to list of DTRs, used for grouping bulk requests
       std::map<std::string, std::set<DTR_ptr> > bulk_requests;
+      // Maximal size of bulk request as currently suggested by processor
+      unsigned int bulk_size = processor.get_bulk_size();
 
       // Transfer shares for this queue
       TransferShares transferShares(transferSharesConf);
@@ -1112,26 +1145,11 @@ namespace DataStaging {
         }
 
         // check if bulk operation is possible for this DTR. To keep it simple
-        // there is only one bulk request per job per revise_queues loop
+        // there is only one bulk request per service and identity per
+        // revise_queues loop, possibly combining DTRs of different jobs
         if (tmp->bulk_possible()) {
-          std::string jobid(tmp->get_parent_job_id());
-          if (bulk_requests.find(jobid) == bulk_requests.end()) {
-            std::set<DTR_ptr> bulk_list;
-            bulk_list.insert(tmp);
-            bulk_requests[jobid] = bulk_list;
-          } else {
-            DTR_ptr first_bulk = *bulk_requests[jobid].begin();
-            // Only source bulk operations supported at the moment and limit to 100
-            if (bulk_requests[jobid].size() < 100 &&
-                first_bulk->get_source()->GetURL().Protocol() == tmp->get_source()->GetURL().Protocol() &&
-                first_bulk->get_source()->GetURL().Host() == tmp->get_source()->GetURL().Host() &&
-                first_bulk->get_source()->CurrentLocation().Protocol() == tmp->get_source()->CurrentLocation().Protocol() &&
-                first_bulk->get_source()->CurrentLocation().Host() == tmp->get_source()->CurrentLocation().Host() &&
-                // This is because we cannot have a mix of LFNs and GUIDs when querying a catalog like LFC
-                first_bulk->get_source()->GetURL().MetaDataOption("guid").length() == tmp->get_source()->GetURL().MetaDataOption("guid").length()) {
-              bulk_requests[jobid].insert(tmp);
-            }
-          }
+          std::set<DTR_ptr>& bulk_set = bulk_requests[bulk_key(tmp)];
+          if (bulk_set.size() < bulk_size) bulk_set.insert(tmp);
         }
 
         transferShares.increase_transfer_share(tmp->get_transfer_share());
@@ -1219,10 +1237,11 @@ namespace DataStaging {
           transferShares.decrease_number_of_slots(tmp->get_transfer_share());
 
           // Send to processor/delivery
-          if (tmp->is_destined_for_pre_processor()) {
+          if (tmp->is_destined_for_pre_processor() || tmp->is_destined_for_post_processor()) {
+            StagingProcesses process = tmp->is_destined_for_pre_processor() ? PRE_PROCESSOR : POST_PROCESSOR;
             // Check for bulk
             if (tmp->bulk_possible()) {
-              std::set<DTR_ptr> bulk_set(bulk_requests[tmp->get_parent_job_id()]);
+              std::set<DTR_ptr> bulk_set(bulk_requests[bulk_key(tmp)]);
               if (bulk_set.size() > 1 &&
                   bulk_set.find(tmp) != bulk_set.end()) {
                 tmp->get_logger()->msg(Arc::INFO, "Will use bulk request");
@@ -1230,17 +1249,16 @@ namespace DataStaging {
                 for (std::set<DTR_ptr>::iterator i = bulk_set.begin(); i != bulk_set.end(); ++i) {
                   if (dtr_no == 0) (*i)->set_bulk_start(true);
                   if (dtr_no == bulk_set.size() - 1) (*i)->set_bulk_end(true);
-                  DTR::push(*i, PRE_PROCESSOR);
+                  DTR::push(*i, process);
                   ++dtr_no;
                 }
               } else {
-                DTR::push(tmp, PRE_PROCESSOR);
+                DTR::push(tmp, process);
               }
             } else {
-              DTR::push(tmp, PRE_PROCESSOR);
+              DTR::push(tmp, process);
             }
           }
-          else if (tmp->is_destined_for_post_processor()) DTR::push(tmp, POST_PROCESSOR);
           else if (tmp->is_destined_for_delivery()) {
             choose_delivery_service(tmp);
             if (!tmp->get_delivery_endpoint()) {
@@ -1320,6 +1338,7 @@ namespace DataStaging {
     cancelled_jobs_lock.lock();
     cancelled_jobs.push_back(jobid);
     cancelled_jobs_lock.unlock();
+    wakeup_signal.signal();
     return true;
   }
 
@@ -1351,6 +1370,7 @@ namespace DataStaging {
 
     // signal main loop to stop and wait for completion of all DTRs
     scheduler_state = TO_STOP;
+    wakeup_signal.signal();
     run_signal.wait();
     scheduler_state = STOPPED;
 
@@ -1409,7 +1429,17 @@ namespace DataStaging {
       // Revise all the internal queues and take actions
       revise_queues();
 
-      Glib::usleep(50000);
+      // Sleep until woken up by an incoming DTR or cancellation, or until
+      // the next delayed event is due. Timeouts, priority changes and
+      // availability of delivery services are not signalled, so the
+      // loop runs at least every MaxIdleTime.
+      int wait_time = MaxIdleTime;
+      if (next_event_time != Arc::Time(Arc::Time::UNDEFINED)) {
+        Arc::Period till_next = next_event_time - Arc::Time();
+        int next_ms = (int)(till_next.GetPeriod()*1000 + till_next.GetPeriodNanoseconds()/1000000);
+        if (next_ms < wait_time) wait_time = next_ms;
+      }
+      if (wait_time > 0) wakeup_signal.wait(wait_time);
     }
     // make sure final state is dumped before exit
     dump_signal.signal();
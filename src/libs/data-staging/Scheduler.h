@@ -67,6 +67,18 @@ class Scheduler: public DTRCallback {
     /// Condition to signal end of dump thread
     Arc::SimpleCondition dump_signal;
 
+    /// Maximal time in milliseconds main loop sleeps without being woken up
+    static const int MaxIdleTime = 1000;
+
+    /// Time in milliseconds after which processed but not moved event is retried
+    static const int EventRetryTime = 50;
+
+    /// Condition to wake up main loop when there is something to do
+    Arc::SimpleCondition wakeup_signal;
+
+    /// Earliest time at which a waiting event becomes ready for processing
+    Arc::Time next_event_time;
+
     /// Limit on number of DTRs in pre-processor
     unsigned int PreProcessorSlots;
     /// Limit on number of DTRs in delivery
@@ -186,7 +198,9 @@ class Scheduler: public DTRCallback {
     /// Add a new event for the Scheduler to process. Used in receiveDTR().
     void add_event(DTR_ptr event);
 
-    /// Process the pool of DTRs which have arrived from other processes
+    /// Process the pool of DTRs which have arrived from other processes.
+    /** Also sets next_event_time to the time when the next of the
+     * remaining events should be processed. */
     void process_events(void);
     
     /// Move to the next replica in the DTR.
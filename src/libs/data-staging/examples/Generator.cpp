@@ -5,7 +5,7 @@
 Arc::Logger Generator::logger(Arc::Logger::getRootLogger(), "Generator");
 Arc::SimpleCondition Generator::cond;
 
-Generator::Generator() {
+Generator::Generator(): latency_total(0), latency_max(0), completed(0) {
   // Set up logging
   root_destinations = Arc::Logger::getRootLogger().getDestinations();
   DataStaging::DTR::LOG_LEVEL = Arc::Logger::getRootLogger().getThreshold();
@@ -18,6 +18,18 @@ Generator::~Generator() {
 }
 
 void Generator::receiveDTR(DataStaging::DTR_ptr dtr) {
+  Arc::Time now;
+  latency_lock.lock();
+  std::map<std::string, Arc::Time>::iterator sub = submitted.find(dtr->get_id());
+  if (sub != submitted.end()) {
+    Arc::Period latency = now - sub->second;
+    unsigned long long int latency_ms = latency.GetPeriod()*1000ULL + latency.GetPeriodNanoseconds()/1000000;
+    latency_total += latency_ms;
+    if (latency_ms > latency_max) latency_max = latency_ms;
+    ++completed;
+    submitted.erase(sub);
+  }
+  latency_lock.unlock();
   // root logger is disabled in Scheduler thread so need to add it here
   Arc::Logger::getRootLogger().addDestinations(root_destinations);
   logger.msg(Arc::INFO, "Received DTR %s back from scheduler in state %s", dtr->get_id(), dtr->get_status().str());
@@ -59,6 +71,18 @@ void Generator::run(const std::string& source, const std::string& destination) {
   dtr->registerCallback(this,DataStaging::GENERATOR);
   dtr->registerCallback(&scheduler,DataStaging::SCHEDULER);
   dtr->set_tries_left(5);
-  DataStaging::DTR::push(dtr, DataStaging::SCHEDULER);
+  latency_lock.lock();
+  submitted[dtr->get_id()] = Arc::Time();
+  latency_lock.unlock();
   counter.inc();
+  DataStaging::DTR::push(dtr, DataStaging::SCHEDULER);
+}
+
+void Generator::report_latency() {
+  latency_lock.lock();
+  if (completed > 0) {
+    logger.msg(Arc::INFO, "Processed %u DTRs, average latency %llu ms, maximal latency %llu ms",
+               completed, latency_total/completed, latency_max);
+  }
+  latency_lock.unlock();
 }
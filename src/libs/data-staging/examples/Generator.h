@@ -1,6 +1,9 @@
 #ifndef GENERATOR_H_
 #define GENERATOR_H_
 
+#include <map>
+
+#include <arc/DateTime.h>
 #include <arc/Thread.h>
 #include <arc/Logger.h>
 
@@ -25,6 +28,15 @@ class Generator: public DataStaging::DTRCallback {
   // Root LogDestinations to be used in receiveDTR
   std::list<Arc::LogDestination*> root_destinations;
 
+  // Submission times of DTRs in the system, used to measure latency
+  std::map<std::string, Arc::Time> submitted;
+  // Sum and maximum of latencies of completed DTRs, in milliseconds
+  unsigned long long int latency_total;
+  unsigned long long int latency_max;
+  unsigned int completed;
+  // Lock protecting latency information
+  Arc::SimpleCondition latency_lock;
+
  public:
 
   // Counter for main to know how many DTRs are in the system
@@ -45,6 +57,10 @@ class Generator: public DataStaging::DTRCallback {
 
   // Submit a DTR with given source and destination. Increments counter.
   void run(const std::string& source, const std::string& destination);
+
+  // Print average and maximal time from submission of DTR to its
+  // return from scheduler.
+  void report_latency();
 };
 
 #endif /* GENERATOR_H_ */
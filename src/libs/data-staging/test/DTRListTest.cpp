@@ -0,0 +1,130 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include "../DTRList.h"
+
+using namespace DataStaging;
+
+class DTRListTest
+  : public CppUnit::TestFixture {
+
+  CPPUNIT_TEST_SUITE(DTRListTest);
+  CPPUNIT_TEST(TestDTRListStatus);
+  CPPUNIT_TEST(TestDTRListOwnerAndJob);
+  CPPUNIT_TEST_SUITE_END();
+
+public:
+  void TestDTRListStatus();
+  void TestDTRListOwnerAndJob();
+
+  void setUp();
+  void tearDown();
+
+private:
+  std::list<DTRLogDestination> logs;
+  char const * log_name;
+  Arc::UserConfig cfg;
+};
+
+void DTRListTest::setUp() {
+  logs.clear();
+  const std::list<Arc::LogDestination*>& destinations = Arc::Logger::getRootLogger().getDestinations();
+  for(std::list<Arc::LogDestination*>::const_iterator dest = destinations.begin(); dest != destinations.end(); ++dest) {
+    logs.push_back(*dest);
+  }
+  log_name = "DataStagingTest";
+}
+
+void DTRListTest::tearDown() {
+}
+
+void DTRListTest::TestDTRListStatus() {
+  DTRList list;
+  std::string source("mock://mocksrc/1");
+  std::string destination("mock://mockdest/1");
+  DTR_ptr dtr1(new DTR(source, destination, cfg, "job1", Arc::User().get_uid(), logs, log_name));
+  DTR_ptr dtr2(new DTR(source, destination, cfg, "job1", Arc::User().get_uid(), logs, log_name));
+  CPPUNIT_ASSERT(*dtr1);
+  CPPUNIT_ASSERT(*dtr2);
+  CPPUNIT_ASSERT(list.add_dtr(dtr1));
+  CPPUNIT_ASSERT(list.add_dtr(dtr2));
+  // Same DTR can't be added twice
+  CPPUNIT_ASSERT(!list.add_dtr(dtr1));
+  CPPUNIT_ASSERT_EQUAL(2U, list.size());
+
+  // New DTRs are pending
+  std::list<DTR_ptr> dtrs;
+  list.filter_pending_dtrs(dtrs);
+  CPPUNIT_ASSERT_EQUAL(2, (int)dtrs.size());
+
+  // Index follows change of status
+  dtr1->set_status(DTRStatus::TRANSFER);
+  dtrs.clear();
+  list.filter_dtrs_by_status(DTRStatus::NEW, dtrs);
+  CPPUNIT_ASSERT_EQUAL(1, (int)dtrs.size());
+  CPPUNIT_ASSERT(dtrs.front() == dtr2);
+  dtrs.clear();
+  list.filter_dtrs_by_next_receiver(DELIVERY, dtrs);
+  CPPUNIT_ASSERT_EQUAL(1, (int)dtrs.size());
+  CPPUNIT_ASSERT(dtrs.front() == dtr1);
+
+  std::vector<DTRStatus::DTRStatusType> statuses;
+  statuses.push_back(DTRStatus::NEW);
+  statuses.push_back(DTRStatus::TRANSFER);
+  statuses.push_back(DTRStatus::DONE);
+  std::map<DTRStatus::DTRStatusType, std::list<DTR_ptr> > dtrs_map;
+  list.filter_dtrs_by_statuses(statuses, dtrs_map);
+  CPPUNIT_ASSERT_EQUAL(1, (int)dtrs_map[DTRStatus::NEW].size());
+  CPPUNIT_ASSERT_EQUAL(1, (int)dtrs_map[DTRStatus::TRANSFER].size());
+  CPPUNIT_ASSERT_EQUAL(0, (int)dtrs_map[DTRStatus::DONE].size());
+
+  // Deleted DTR is no longer indexed and its changes do not affect list
+  CPPUNIT_ASSERT(list.delete_dtr(dtr1));
+  CPPUNIT_ASSERT(!list.delete_dtr(dtr1));
+  dtr1->set_status(DTRStatus::NEW);
+  dtrs.clear();
+  list.filter_dtrs_by_status(DTRStatus::NEW, dtrs);
+  CPPUNIT_ASSERT_EQUAL(1, (int)dtrs.size());
+  CPPUNIT_ASSERT_EQUAL(1U, list.size());
+}
+
+void DTRListTest::TestDTRListOwnerAndJob() {
+  DTRList list;
+  std::string source("mock://mocksrc/1");
+  std::string destination("mock://mockdest/1");
+  DTR_ptr dtr1(new DTR(source, destination, cfg, "job1", Arc::User().get_uid(), logs, log_name));
+  DTR_ptr dtr2(new DTR(source, destination, cfg, "job2", Arc::User().get_uid(), logs, log_name));
+  DTR_ptr dtr3(new DTR(source, destination, cfg, "job2", Arc::User().get_uid(), logs, log_name));
+  list.add_dtr(dtr1);
+  list.add_dtr(dtr2);
+  list.add_dtr(dtr3);
+
+  CPPUNIT_ASSERT_EQUAL(3, list.number_of_dtrs_by_owner(GENERATOR));
+  // No callbacks are registered so push only changes owner
+  DTR::push(dtr2, SCHEDULER);
+  CPPUNIT_ASSERT_EQUAL(2, list.number_of_dtrs_by_owner(GENERATOR));
+  std::list<DTR_ptr> dtrs;
+  list.filter_dtrs_by_owner(SCHEDULER, dtrs);
+  CPPUNIT_ASSERT_EQUAL(1, (int)dtrs.size());
+  CPPUNIT_ASSERT(dtrs.front() == dtr2);
+
+  dtrs.clear();
+  list.filter_dtrs_by_job("job2", dtrs);
+  CPPUNIT_ASSERT_EQUAL(2, (int)dtrs.size());
+  dtrs.clear();
+  list.filter_dtrs_by_job("job3", dtrs);
+  CPPUNIT_ASSERT(dtrs.empty());
+  CPPUNIT_ASSERT_EQUAL(2, (int)list.all_jobs().size());
+
+  list.delete_dtr(dtr1);
+  CPPUNIT_ASSERT_EQUAL(1, (int)list.all_jobs().size());
+  CPPUNIT_ASSERT_EQUAL(std::string("job2"), list.all_jobs().front());
+  list.delete_dtr(dtr2);
+  list.delete_dtr(dtr3);
+  CPPUNIT_ASSERT(list.empty());
+}
+
+CPPUNIT_TEST_SUITE_REGISTRATION(DTRListTest);
@@ -14,11 +14,13 @@ class DTRTest
   CPPUNIT_TEST_SUITE(DTRTest);
   CPPUNIT_TEST(TestDTRConstructor);
   CPPUNIT_TEST(TestDTREndpoints);
+  CPPUNIT_TEST(TestDTRBulk);
   CPPUNIT_TEST_SUITE_END();
 
 public:
   void TestDTRConstructor();
   void TestDTREndpoints();
+  void TestDTRBulk();
 
   void setUp();
   void tearDown();
@@ -93,4 +95,32 @@ void DTRTest::TestDTREndpoints() {
   // TODO DTR validity
 }
 
+void DTRTest::TestDTRBulk() {
+  std::string jobid("123456789");
+  std::string source("mock://mocksrc/1");
+  std::string destination("mock://mockdest/1");
+  DataStaging::DTR_ptr dtr(new DataStaging::DTR(source, destination, cfg, jobid, Arc::User().get_uid(), logs, log_name));
+  CPPUNIT_ASSERT(*dtr);
+
+  // mock protocol is neither stageable nor an index so none of the
+  // bulk staging and registration steps apply
+  dtr->set_status(DataStaging::DTRStatus::STAGE_PREPARE);
+  CPPUNIT_ASSERT(!dtr->bulk_possible());
+  dtr->set_status(DataStaging::DTRStatus::RELEASE_REQUEST);
+  CPPUNIT_ASSERT(!dtr->bulk_possible());
+  dtr->set_status(DataStaging::DTRStatus::REGISTER_REPLICA);
+  CPPUNIT_ASSERT(!dtr->bulk_possible());
+
+  // default bulk methods report that they are not supported
+  std::list<Arc::DataPoint*> datapoints;
+  std::list<Arc::DataStatus> results;
+  unsigned int wait_time = 0;
+  CPPUNIT_ASSERT_EQUAL(Arc::DataStatus::UnimplementedError,
+                       dtr->get_source()->PrepareReading(datapoints, wait_time, results).GetStatus());
+  CPPUNIT_ASSERT_EQUAL(Arc::DataStatus::UnimplementedError,
+                       dtr->get_source()->FinishReading(datapoints, false, results).GetStatus());
+  CPPUNIT_ASSERT_EQUAL(Arc::DataStatus::UnimplementedError,
+                       dtr->get_destination()->PostRegister(datapoints, false, results).GetStatus());
+}
+
 CPPUNIT_TEST_SUITE_REGISTRATION(DTRTest);
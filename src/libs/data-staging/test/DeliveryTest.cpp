@@ -8,6 +8,7 @@
 
 #include <arc/ArcLocation.h>
 #include <arc/FileUtils.h>
+#include <arc/StringConv.h>
 #include <arc/UserConfig.h>
 
 #include "../DTRStatus.h"
@@ -20,15 +21,20 @@ class DeliveryTest
   : public CppUnit::TestFixture {
 
   CPPUNIT_TEST_SUITE(DeliveryTest);
+  // Must run first so that no working delivery process is left for reuse
+  CPPUNIT_TEST(TestDeliveryWorkerExit);
   CPPUNIT_TEST(TestDeliverySimple);
   CPPUNIT_TEST(TestDeliveryFailure);
   CPPUNIT_TEST(TestDeliveryUnsupported);
+  CPPUNIT_TEST(TestDeliverySequence);
   CPPUNIT_TEST_SUITE_END();
 
 public:
+  void TestDeliveryWorkerExit();
   void TestDeliverySimple();
   void TestDeliveryFailure();
   void TestDeliveryUnsupported();
+  void TestDeliverySequence();
   void setUp();
   void tearDown();
 
@@ -59,6 +65,36 @@ void DeliveryTest::tearDown() {
   Arc::DirDelete("../tmp");
 }
 
+void DeliveryTest::TestDeliveryWorkerExit() {
+
+  // Replace delivery executable with one exiting as soon as first message
+  // arrives, while transfer is still being passed to it
+  std::string exe(std::string("../tmp/")+std::string(PKGLIBSUBDIR)+std::string("/DataStagingDelivery"));
+  Arc::FileDelete(exe);
+  CPPUNIT_ASSERT(Arc::FileCreate(exe, "#!/bin/sh\nhead -c 1 >/dev/null\nexit 1\n", 0, 0, S_IRWXU));
+
+  std::string source("mock://mocksrc/1");
+  std::string destination("mock://mockdest/1");
+  std::string jobid("1234");
+  DataStaging::DTR_ptr dtr(new DataStaging::DTR(source,destination,cfg,jobid,Arc::User().get_uid(),logs,log_name));
+  CPPUNIT_ASSERT(*dtr);
+
+  DataStaging::DataDelivery delivery;
+  delivery.start();
+  delivery.receiveDTR(dtr);
+  DataStaging::DTRStatus status = dtr->get_status();
+  for(int cnt=0;;++cnt) {
+    status = dtr->get_status();
+    if((status != DataStaging::DTRStatus::TRANSFERRING) &&
+       (status != DataStaging::DTRStatus::NULL_STATE)) break;
+    CPPUNIT_ASSERT(cnt < 300); // 30s limit on transfer time
+    Glib::usleep(100000);
+  }
+  // Transfer must fail and not hang or crash
+  CPPUNIT_ASSERT_EQUAL(DataStaging::DTRStatus::TRANSFERRED, status.GetStatus());
+  CPPUNIT_ASSERT(DataStaging::DTRErrorStatus::NONE_ERROR != dtr->get_error_status().GetErrorStatus());
+}
+
 void DeliveryTest::TestDeliverySimple() {
 
   std::string source("mock://mocksrc/1");
@@ -146,4 +182,35 @@ void DeliveryTest::TestDeliveryUnsupported() {
   CPPUNIT_ASSERT_EQUAL(DataStaging::DTRErrorStatus::INTERNAL_LOGIC_ERROR, dtr->get_error_status().GetErrorStatus());
 }
 
+void DeliveryTest::TestDeliverySequence() {
+
+  // Transfers following each other are done by same delivery process.
+  // Failed transfer must not affect next one.
+  DataStaging::DataDelivery delivery;
+  delivery.start();
+  const char* sources[] = { "mock://mocksrc/1", "fail://mocksrc/2", "mock://mocksrc/3", NULL };
+  for (int n = 0; sources[n]; ++n) {
+    std::string source(sources[n]);
+    std::string destination(std::string(sources[n], 4) + "://mockdest/" + Arc::tostring(n));
+    std::string jobid("1234");
+    DataStaging::DTR_ptr dtr(new DataStaging::DTR(source,destination,cfg,jobid,Arc::User().get_uid(),logs,log_name));
+    CPPUNIT_ASSERT(*dtr);
+    delivery.receiveDTR(dtr);
+    DataStaging::DTRStatus status = dtr->get_status();
+    for(int cnt=0;;++cnt) {
+      status = dtr->get_status();
+      if((status != DataStaging::DTRStatus::TRANSFERRING) &&
+         (status != DataStaging::DTRStatus::NULL_STATE)) break;
+      CPPUNIT_ASSERT(cnt < 300); // 30s limit on transfer time
+      Glib::usleep(100000);
+    }
+    CPPUNIT_ASSERT_EQUAL(DataStaging::DTRStatus::TRANSFERRED, status.GetStatus());
+    if (source.find("fail") == 0) {
+      CPPUNIT_ASSERT_EQUAL(DataStaging::DTRErrorStatus::TEMPORARY_REMOTE_ERROR, dtr->get_error_status().GetErrorStatus());
+    } else {
+      CPPUNIT_ASSERT_EQUAL_MESSAGE(dtr->get_error_status().GetDesc(), DataStaging::DTRErrorStatus::NONE_ERROR, dtr->get_error_status().GetErrorStatus());
+    }
+  }
+}
+
 CPPUNIT_TEST_SUITE_REGISTRATION(DeliveryTest);
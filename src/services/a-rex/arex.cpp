@@ -24,11 +24,13 @@
 #include <arc/otokens/openid_metadata.h>
 #include "grid-manager/log/JobLog.h"
 #include "grid-manager/log/JobsMetrics.h"
+#include "grid-manager/jobs/JobsSnapshot.h"
 #include "grid-manager/log/HeartBeatMetrics.h"
 #include "grid-manager/log/SpaceMetrics.h"
 #include "grid-manager/run/RunPlugin.h"
 #include "grid-manager/jobs/ContinuationPlugins.h"
 #include "grid-manager/files/ControlFileHandling.h"
+#include "grid-manager/files/ControlFileWriter.h"
 #include "arex.h"
 
 namespace ARex {
@@ -1091,6 +1093,7 @@ ARexService::ARexService(Arc::Config *cfg,Arc::PluginArgument *parg):Arc::Servic
   valid = false;
   config_.SetJobLog(new JobLog());
   config_.SetJobsMetrics(new JobsMetrics());
+  config_.SetJobsSnapshot(new JobsSnapshot());
   config_.SetHeartBeatMetrics(new HeartBeatMetrics());
   config_.SetSpaceMetrics(new SpaceMetrics());
   config_.SetJobPerfLog(new Arc::JobPerfLog());
@@ -1130,6 +1133,10 @@ ARexService::ARexService(Arc::Config *cfg,Arc::PluginArgument *parg):Arc::Servic
     logger_.msg(Arc::ERROR, "Failed to create control directory %s", config_.ControlDir());
     return;
   }
+  // Status files may be written in batches
+  if(config_.ControlDirBatch() > 0) {
+    config_.SetControlFileWriter(new ControlFileWriter(config_.ControlDirBatch()));
+  }
 
   // Pass information about delegation db type
   {
@@ -1206,10 +1213,12 @@ ARexService::~ARexService(void) {
   thread_count_.WaitForExit(); // Here A-REX threads are waited for
   // There should be no more threads using resources - can proceed
   if(config_.ConfigIsTemp()) unlink(config_.ConfigFile().c_str());
+  delete config_.GetControlFileWriter(); // This stores remaining status files
   delete config_.GetContPlugins();
   delete config_.GetJobLog();
   delete config_.GetJobPerfLog();
   delete config_.GetJobsMetrics();
+  delete config_.GetJobsSnapshot();
   delete config_.GetHeartBeatMetrics();
   delete config_.GetSpaceMetrics();
 }
@@ -42,7 +42,7 @@ namespace ARex {
 
   FileRecordSQLite::FileRecordSQLite(const std::string& base, bool create):
       FileRecord(base, create),
-      db_(NULL) {
+      db_(NULL), index_enabled_(false), index_version_(0) {
     valid_ = open(create);
   }
 
@@ -67,6 +67,35 @@ namespace ARex {
       return err;
   }
 
+  sqlite3_stmt* FileRecordSQLite::sqlite3_prepare_cached(const char *sql) {
+    if(!db_) return NULL;
+    std::map<std::string,sqlite3_stmt*>::iterator it = statements_.find(sql);
+    if(it != statements_.end()) {
+      (void)sqlite3_reset(it->second);
+      (void)sqlite3_clear_bindings(it->second);
+      return it->second;
+    };
+    sqlite3_stmt* stmt = NULL;
+    int err;
+    while((err = sqlite3_prepare_v2(db_, sql, -1, &stmt, NULL)) == SQLITE_BUSY) {
+      struct timespec delay = { 0, 10000000 }; // 0.01s - should be enough for most cases
+      (void)::nanosleep(&delay, NULL);
+    };
+    if(!dberr("Failed to prepare statement", err)) return NULL;
+    statements_[sql] = stmt;
+    return stmt;
+  }
+
+  int FileRecordSQLite::sqlite3_step_nobusy(sqlite3_stmt* stmt) {
+    int err;
+    while((err = sqlite3_step(stmt)) == SQLITE_BUSY) {
+      // Same as in sqlite3_exec_nobusy
+      struct timespec delay = { 0, 10000000 }; // 0.01s - should be enough for most cases
+      (void)::nanosleep(&delay, NULL);
+    };
+    return err;
+  }
+
   bool FileRecordSQLite::open(bool create) {
     std::string dbpath = basepath_ + G_DIR_SEPARATOR_S + FR_DB_NAME;
     if(db_ != NULL) return true; // already open
@@ -117,24 +146,32 @@ namespace ARex {
         return false;
       };
     };
+    index_enabled_ = index_load();
     return true;
   }
 
   void FileRecordSQLite::close(void) {
     valid_ = false;
+    index_enabled_ = false;
+    index_recs_.clear();
+    index_uids_.clear();
+    index_locks_.clear();
+    index_uid_locks_.clear();
+    for(std::map<std::string,sqlite3_stmt*>::iterator stmt = statements_.begin(); stmt != statements_.end(); ++stmt) {
+      (void)sqlite3_finalize(stmt->second);
+    };
+    statements_.clear();
     if(db_) {
       (void)sqlite3_close(db_); // todo: handle error
       db_ = NULL;
     };
   }
 
+  // Every string is followed by separator
   void store_strings(const std::list<std::string>& strs, std::string& buf) {
-    if(!strs.empty()) {
-      for(std::list<std::string>::const_iterator str = strs.begin(); ; ++str) {
-        buf += sql_escape(*str);
-        if (str == strs.end()) break;
-        buf += '#';
-      };
+    for(std::list<std::string>::const_iterator str = strs.begin(); str != strs.end(); ++str) {
+      buf += sql_escape(*str);
+      buf += '#';
     };
   }
 
@@ -148,6 +185,15 @@ namespace ARex {
     };
   }
 
+  static void bind_text(sqlite3_stmt* stmt, int idx, const std::string& str) {
+    (void)sqlite3_bind_text(stmt, idx, str.c_str(), str.length(), SQLITE_TRANSIENT);
+  }
+
+  static std::string column_text(sqlite3_stmt* stmt, int idx) {
+    const unsigned char* text = sqlite3_column_text(stmt, idx);
+    return text ? std::string((const char*)text) : std::string();
+  }
+
   bool FileRecordSQLite::Recover(void) {
     Glib::Mutex::Lock lock(lock_);
     // Real recovery not implemented yet.
@@ -157,117 +203,162 @@ namespace ARex {
     return false;
   }
 
-  struct FindCallbackRecArg {
-    sqlite3_int64 rowid;
-    std::string id;
-    std::string owner;
-    std::string uid;
-    std::list<std::string> meta;
-    FindCallbackRecArg(): rowid(-1) {};
-  };
-
-  static int FindCallbackRec(void* arg, int colnum, char** texts, char** names) {
-    for(int n = 0; n < colnum; ++n) {
-      if(names[n] && texts[n]) {
-        if((strcmp(names[n], "rowid") == 0) || (strcmp(names[n], "_rowid_") == 0)) {
-          (void)Arc::stringto(texts[n], ((FindCallbackRecArg*)arg)->rowid);
-        } else if(strcmp(names[n], "uid") == 0) {
-          ((FindCallbackRecArg*)arg)->uid = texts[n];
-        } else if(strcmp(names[n], "id") == 0) {
-          ((FindCallbackRecArg*)arg)->id = sql_unescape(texts[n]);
-        } else if(strcmp(names[n], "owner") == 0) {
-          ((FindCallbackRecArg*)arg)->owner = sql_unescape(texts[n]);
-        } else if(strcmp(names[n], "meta") == 0) {
-          parse_strings(((FindCallbackRecArg*)arg)->meta, texts[n]);
-        };
-      };
+  bool FileRecordSQLite::index_load(void) {
+    index_recs_.clear();
+    index_uids_.clear();
+    index_locks_.clear();
+    index_uid_locks_.clear();
+    // Version is obtained before reading content. So if database
+    // changes meanwhile index is reloaded once more next time.
+    sqlite3_stmt* stmt = sqlite3_prepare_cached("PRAGMA data_version");
+    if(!stmt) return false;
+    if(sqlite3_step_nobusy(stmt) != SQLITE_ROW) {
+      // Older SQLite, changes made by others can't be detected
+      (void)sqlite3_reset(stmt);
+      return false;
     };
-    return 0;
+    index_version_ = sqlite3_column_int64(stmt, 0);
+    (void)sqlite3_reset(stmt);
+    int err;
+    stmt = sqlite3_prepare_cached("SELECT uid, id, owner, meta FROM rec");
+    if(!stmt) return false;
+    while((err = sqlite3_step_nobusy(stmt)) == SQLITE_ROW) {
+      std::list<std::string> meta;
+      parse_strings(meta, (const char*)sqlite3_column_text(stmt, 3));
+      index_add(column_text(stmt, 0), sql_unescape(column_text(stmt, 1)), sql_unescape(column_text(stmt, 2)), meta);
+    };
+    (void)sqlite3_reset(stmt);
+    if(!dberr("Failed to read records from database", (err == SQLITE_DONE) ? SQLITE_OK : err)) return false;
+    stmt = sqlite3_prepare_cached("SELECT lockid, uid FROM lock");
+    if(!stmt) return false;
+    while((err = sqlite3_step_nobusy(stmt)) == SQLITE_ROW) {
+      index_add_lock(sql_unescape(column_text(stmt, 0)), column_text(stmt, 1));
+    };
+    (void)sqlite3_reset(stmt);
+    if(!dberr("Failed to read locks from database", (err == SQLITE_DONE) ? SQLITE_OK : err)) return false;
+    return true;
   }
 
-  struct FindCallbackUidMetaArg {
-    std::string& uid;
-    std::list<std::string>& meta;
-    FindCallbackUidMetaArg(std::string& uid, std::list<std::string>& meta): uid(uid), meta(meta) {};
-  };
-
-  static int FindCallbackUidMeta(void* arg, int colnum, char** texts, char** names) {
-    for(int n = 0; n < colnum; ++n) {
-      if(names[n] && texts[n]) {
-        if(strcmp(names[n], "uid") == 0) {
-          ((FindCallbackUidMetaArg*)arg)->uid = texts[n];
-        } else if(strcmp(names[n], "meta") == 0) {
-          parse_strings(((FindCallbackUidMetaArg*)arg)->meta, texts[n]);
-        };
-      };
+  bool FileRecordSQLite::index_sync(void) {
+    if(!index_enabled_) return false;
+    sqlite3_stmt* stmt = sqlite3_prepare_cached("PRAGMA data_version");
+    if(stmt) {
+      int err = sqlite3_step_nobusy(stmt);
+      sqlite3_int64 version = (err == SQLITE_ROW) ? sqlite3_column_int64(stmt, 0) : -1;
+      (void)sqlite3_reset(stmt);
+      if(version == index_version_) return true;
     };
-    return 0;
+    // Database was modified by another connection
+    index_enabled_ = index_load();
+    return index_enabled_;
   }
 
-  struct FindCallbackUidArg {
-    std::string& uid;
-    FindCallbackUidArg(std::string& uid): uid(uid) {};
-  };
-
-  static int FindCallbackUid(void* arg, int colnum, char** texts, char** names) {
-    for(int n = 0; n < colnum; ++n) {
-      if(names[n] && texts[n]) {
-        if(strcmp(names[n], "uid") == 0) {
-          ((FindCallbackUidMetaArg*)arg)->uid = texts[n];
-        };
-      };
-    };
-    return 0;
+  void FileRecordSQLite::index_add(const std::string& uid, const std::string& id, const std::string& owner, const std::list<std::string>& meta) {
+    IndexRecord& rec = index_recs_[std::pair<std::string,std::string>(id,owner)];
+    rec.uid = uid;
+    rec.meta = meta;
+    index_uids_[uid] = std::pair<std::string,std::string>(id,owner);
   }
 
-  struct FindCallbackCountArg {
-    int count;
-    FindCallbackCountArg():count(0) {};
-  };
+  void FileRecordSQLite::index_remove(const std::string& uid) {
+    std::map< std::string, std::pair<std::string,std::string> >::iterator rec = index_uids_.find(uid);
+    if(rec == index_uids_.end()) return;
+    index_recs_.erase(rec->second);
+    index_uids_.erase(rec);
+  }
 
-  static int FindCallbackCount(void* arg, int colnum, char** texts, char** names) {
-    ((FindCallbackCountArg*)arg)->count += 1;
-    return 0;
+  void FileRecordSQLite::index_add_lock(const std::string& lock_id, const std::string& uid) {
+    index_locks_[lock_id].push_back(uid);
+    index_uid_locks_[uid].push_back(lock_id);
   }
 
-  struct FindCallbackIdOwnerArg {
-    std::list< std::pair<std::string,std::string> >& records;
-    FindCallbackIdOwnerArg(std::list< std::pair<std::string,std::string> >& recs): records(recs) {};
-  };
+  void FileRecordSQLite::index_remove_lock(const std::string& lock_id) {
+    std::map< std::string, std::list<std::string> >::iterator lock = index_locks_.find(lock_id);
+    if(lock == index_locks_.end()) return;
+    for(std::list<std::string>::iterator uid = lock->second.begin(); uid != lock->second.end(); ++uid) {
+      std::map< std::string, std::list<std::string> >::iterator locks = index_uid_locks_.find(*uid);
+      if(locks == index_uid_locks_.end()) continue;
+      locks->second.remove(lock_id);
+      if(locks->second.empty()) index_uid_locks_.erase(locks);
+    };
+    index_locks_.erase(lock);
+  }
 
-  static int FindCallbackIdOwner(void* arg, int colnum, char** texts, char** names) {
-    std::pair<std::string,std::string> rec;
-    for(int n = 0; n < colnum; ++n) {
-      if(names[n] && texts[n]) {
-        if(strcmp(names[n], "id") == 0) {
-          rec.first = sql_unescape(texts[n]);
-        } else if(strcmp(names[n], "owner") == 0) {
-          rec.second = sql_unescape(texts[n]);
-        };
+  bool FileRecordSQLite::find_uid(const std::string& id, const std::string& owner, std::string& uid, std::list<std::string>* meta) {
+    if(index_sync()) {
+      std::map< std::pair<std::string,std::string>, IndexRecord >::iterator rec =
+                       index_recs_.find(std::pair<std::string,std::string>(id,owner));
+      if(rec != index_recs_.end()) {
+        uid = rec->second.uid;
+        if(meta) meta->insert(meta->end(), rec->second.meta.begin(), rec->second.meta.end());
       };
+      return true;
+    };
+    sqlite3_stmt* stmt = sqlite3_prepare_cached("SELECT uid, meta FROM rec WHERE ((id = ?) AND (owner = ?))");
+    if(!stmt) return false;
+    bind_text(stmt, 1, sql_escape(id));
+    bind_text(stmt, 2, sql_escape(owner));
+    int err = sqlite3_step_nobusy(stmt);
+    if(err == SQLITE_ROW) {
+      uid = column_text(stmt, 0);
+      if(meta) parse_strings(*meta, (const char*)sqlite3_column_text(stmt, 1));
+      err = SQLITE_OK;
+    } else if(err == SQLITE_DONE) {
+      err = SQLITE_OK;
     };
-    if(!rec.first.empty()) ((FindCallbackIdOwnerArg*)arg)->records.push_back(rec);
-    return 0;
+    (void)sqlite3_reset(stmt);
+    return dberr("Failed to retrieve record from database", err);
   }
 
-  struct FindCallbackLockArg {
-    std::list< std::string >& records;
-    FindCallbackLockArg(std::list< std::string >& recs): records(recs) {};
-  };
-
-  static int FindCallbackLock(void* arg, int colnum, char** texts, char** names) {
-    for(int n = 0; n < colnum; ++n) {
-      if(names[n] && texts[n]) {
-        if(strcmp(names[n], "lockid") == 0) {
-          std::string rec = sql_unescape(texts[n]);
-          if(!rec.empty()) ((FindCallbackLockArg*)arg)->records.push_back(rec);
+  bool FileRecordSQLite::find_locks(const std::string& uid, std::list<std::string>& locks) {
+    if(index_sync()) {
+      std::map< std::string, std::list<std::string> >::iterator rec = index_uid_locks_.find(uid);
+      if(rec != index_uid_locks_.end()) {
+        for(std::list<std::string>::iterator lock = rec->second.begin(); lock != rec->second.end(); ++lock) {
+          if(!lock->empty()) locks.push_back(*lock);
+        };
+      };
+      return true;
+    };
+    sqlite3_stmt* stmt = sqlite3_prepare_cached("SELECT lockid FROM lock WHERE (uid = ?)");
+    if(!stmt) return false;
+    bind_text(stmt, 1, uid);
+    int err;
+    while((err = sqlite3_step_nobusy(stmt)) == SQLITE_ROW) {
+      std::string lock = sql_unescape(column_text(stmt, 0));
+      if(!lock.empty()) locks.push_back(lock);
+    };
+    (void)sqlite3_reset(stmt);
+    return dberr("listlocks:get", (err == SQLITE_DONE) ? SQLITE_OK : err);
+  }
+
+  bool FileRecordSQLite::find_locked(const std::string& lock_id, std::list<std::pair<std::string,std::string> >& ids) {
+    if(index_sync()) {
+      std::map< std::string, std::list<std::string> >::iterator lock = index_locks_.find(lock_id);
+      if(lock != index_locks_.end()) {
+        // Same record may be locked more than once
+        std::list<std::string> uids(lock->second);
+        uids.sort();
+        uids.unique();
+        for(std::list<std::string>::iterator uid = uids.begin(); uid != uids.end(); ++uid) {
+          std::map< std::string, std::pair<std::string,std::string> >::iterator rec = index_uids_.find(*uid);
+          if((rec != index_uids_.end()) && !rec->second.first.empty()) ids.push_back(rec->second);
         };
       };
+      return true;
+    };
+    sqlite3_stmt* stmt = sqlite3_prepare_cached("SELECT id, owner FROM rec WHERE uid IN (SELECT uid FROM lock WHERE (lockid = ?))");
+    if(!stmt) return false;
+    bind_text(stmt, 1, sql_escape(lock_id));
+    int err;
+    while((err = sqlite3_step_nobusy(stmt)) == SQLITE_ROW) {
+      std::pair<std::string,std::string> rec(sql_unescape(column_text(stmt, 0)), sql_unescape(column_text(stmt, 1)));
+      if(!rec.first.empty()) ids.push_back(rec);
     };
-    return 0;
+    (void)sqlite3_reset(stmt);
+    return dberr("listlocked:get", (err == SQLITE_DONE) ? SQLITE_OK : err);
   }
 
-
   std::string FileRecordSQLite::Add(std::string& id, const std::string& owner, const std::list<std::string>& meta) {
     if(!valid_) return "";
     int uidtries = 10; // some sane number
@@ -281,22 +372,27 @@ namespace ARex {
       uid = rand_uid64().substr(4);
       std::string metas;
       store_strings(meta, metas);
-      std::string sqlcmd = "INSERT INTO rec(id, owner, uid, meta) VALUES ('"+
-               sql_escape(id.empty()?uid:id)+"', '"+
-               sql_escape(owner)+"', '"+uid+"', '"+metas+"')";
-      int dbres = sqlite3_exec_nobusy(sqlcmd.c_str(), NULL, NULL, NULL);
+      sqlite3_stmt* stmt = sqlite3_prepare_cached("INSERT INTO rec(id, owner, uid, meta) VALUES (?, ?, ?, ?)");
+      if(!stmt) return "";
+      bind_text(stmt, 1, sql_escape(id.empty()?uid:id));
+      bind_text(stmt, 2, sql_escape(owner));
+      bind_text(stmt, 3, uid);
+      bind_text(stmt, 4, metas);
+      int dbres = sqlite3_step_nobusy(stmt);
+      (void)sqlite3_reset(stmt);
       if(dbres == SQLITE_CONSTRAINT) {
         // retry due to non-unique id
         uid.resize(0);
         continue;
       };
-      if(!dberr("Failed to add record to database", dbres)) {
+      if(!dberr("Failed to add record to database", (dbres == SQLITE_DONE) ? SQLITE_OK : dbres)) {
         return "";
       };
       if(sqlite3_changes(db_) != 1) {
         error_str_ = "Failed to add record to database";
         return "";
       };
+      if(index_enabled_) index_add(uid, id.empty()?uid:id, owner, meta);
       break;
     };
     if(id.empty()) id = uid;
@@ -309,27 +405,30 @@ namespace ARex {
     Glib::Mutex::Lock lock(lock_);
     std::string metas;
     store_strings(meta, metas);
-    std::string sqlcmd = "INSERT INTO rec(id, owner, uid, meta) VALUES ('"+
-             sql_escape(id.empty()?uid:id)+"', '"+
-             sql_escape(owner)+"', '"+uid+"', '"+metas+"')";
-    int dbres = sqlite3_exec_nobusy(sqlcmd.c_str(), NULL, NULL, NULL);
-    if(!dberr("Failed to add record to database", dbres)) {
+    sqlite3_stmt* stmt = sqlite3_prepare_cached("INSERT INTO rec(id, owner, uid, meta) VALUES (?, ?, ?, ?)");
+    if(!stmt) return false;
+    bind_text(stmt, 1, sql_escape(id.empty()?uid:id));
+    bind_text(stmt, 2, sql_escape(owner));
+    bind_text(stmt, 3, uid);
+    bind_text(stmt, 4, metas);
+    int dbres = sqlite3_step_nobusy(stmt);
+    (void)sqlite3_reset(stmt);
+    if(!dberr("Failed to add record to database", (dbres == SQLITE_DONE) ? SQLITE_OK : dbres)) {
       return false;
     };
     if(sqlite3_changes(db_) != 1) {
       error_str_ = "Failed to add record to database";
       return false;
     };
+    if(index_enabled_) index_add(uid, id.empty()?uid:id, owner, meta);
     return true;
   }
 
   std::string FileRecordSQLite::Find(const std::string& id, const std::string& owner, std::list<std::string>& meta) {
     if(!valid_) return "";
     Glib::Mutex::Lock lock(lock_);
-    std::string sqlcmd = "SELECT uid, meta FROM rec WHERE ((id = '"+sql_escape(id)+"') AND (owner = '"+sql_escape(owner)+"'))";
     std::string uid;
-    FindCallbackUidMetaArg arg(uid, meta);
-    if(!dberr("Failed to retrieve record from database",sqlite3_exec_nobusy(sqlcmd.c_str(), &FindCallbackUidMeta, &arg, NULL))) {
+    if(!find_uid(id, owner, uid, &meta)) {
       return "";
     };
     if(uid.empty()) {
@@ -344,14 +443,25 @@ namespace ARex {
     Glib::Mutex::Lock lock(lock_);
     std::string metas;
     store_strings(meta, metas);
-    std::string sqlcmd = "UPDATE rec SET meta = '"+metas+"' WHERE ((id = '"+sql_escape(id)+"') AND (owner = '"+sql_escape(owner)+"'))";
-    if(!dberr("Failed to update record in database",sqlite3_exec_nobusy(sqlcmd.c_str(), NULL, NULL, NULL))) {
+    sqlite3_stmt* stmt = sqlite3_prepare_cached("UPDATE rec SET meta = ? WHERE ((id = ?) AND (owner = ?))");
+    if(!stmt) return false;
+    bind_text(stmt, 1, metas);
+    bind_text(stmt, 2, sql_escape(id));
+    bind_text(stmt, 3, sql_escape(owner));
+    int dbres = sqlite3_step_nobusy(stmt);
+    (void)sqlite3_reset(stmt);
+    if(!dberr("Failed to update record in database", (dbres == SQLITE_DONE) ? SQLITE_OK : dbres)) {
       return false;
     };
     if(sqlite3_changes(db_) < 1) {
       error_str_ = "Failed to find record in database";
       return false;
     };
+    if(index_enabled_) {
+      std::map< std::pair<std::string,std::string>, IndexRecord >::iterator rec =
+                       index_recs_.find(std::pair<std::string,std::string>(id,owner));
+      if(rec != index_recs_.end()) rec->second.meta = meta;
+    };
     return true;
   }
 
@@ -359,31 +469,31 @@ namespace ARex {
     if(!valid_) return false;
     Glib::Mutex::Lock lock(lock_);
     std::string uid;
-    {
-      std::string sqlcmd = "SELECT uid FROM rec WHERE ((id = '"+sql_escape(id)+"') AND (owner = '"+sql_escape(owner)+"'))";
-      FindCallbackUidArg arg(uid);
-      if(!dberr("Failed to retrieve record from database",sqlite3_exec_nobusy(sqlcmd.c_str(), &FindCallbackUid, &arg, NULL))) {
-        return false; // No such record?
-      };
+    if(!find_uid(id, owner, uid, NULL)) {
+      return false; // No such record?
     };
     if(uid.empty()) {
       error_str_ = "Record not found";
       return false; // No such record
     };
     {
-      std::string sqlcmd = "SELECT uid FROM lock WHERE (uid = '"+uid+"')";
-      FindCallbackCountArg arg;
-      if(!dberr("Failed to find locks in database",sqlite3_exec_nobusy(sqlcmd.c_str(), &FindCallbackCount, &arg, NULL))) {
+      std::list<std::string> locks;
+      if(!find_locks(uid, locks)) {
+        error_str_ = "Failed to find locks in database";
         return false;
       };
-      if(arg.count > 0) {
+      if(!locks.empty()) {
         error_str_ = "Record has active locks";
         return false; // have locks
       };
     };
     {
-      std::string sqlcmd = "DELETE FROM rec WHERE (uid = '"+uid+"')";
-      if(!dberr("Failed to delete record in database",sqlite3_exec_nobusy(sqlcmd.c_str(), NULL, NULL, NULL))) {
+      sqlite3_stmt* stmt = sqlite3_prepare_cached("DELETE FROM rec WHERE (uid = ?)");
+      if(!stmt) return false;
+      bind_text(stmt, 1, uid);
+      int dbres = sqlite3_step_nobusy(stmt);
+      (void)sqlite3_reset(stmt);
+      if(!dberr("Failed to delete record in database", (dbres == SQLITE_DONE) ? SQLITE_OK : dbres)) {
         return false;
       };
       if(sqlite3_changes(db_) < 1) {
@@ -391,6 +501,7 @@ namespace ARex {
         return false; // no such record
       };
     };
+    if(index_enabled_) index_remove(uid);
     remove_file(uid);
     return true;
   }
@@ -400,21 +511,23 @@ namespace ARex {
     Glib::Mutex::Lock lock(lock_);
     for(std::list<std::string>::const_iterator id = ids.begin(); id != ids.end(); ++id) {
       std::string uid;
-      {
-        std::string sqlcmd = "SELECT uid FROM rec WHERE ((id = '"+sql_escape(*id)+"') AND (owner = '"+sql_escape(owner)+"'))";
-        FindCallbackUidArg arg(uid);
-        if(!dberr("Failed to retrieve record from database",sqlite3_exec_nobusy(sqlcmd.c_str(), &FindCallbackUid, &arg, NULL))) {
-          return false; // No such record?
-        };
+      if(!find_uid(*id, owner, uid, NULL)) {
+        return false; // No such record?
       };
       if(uid.empty()) {
         // No such record
         continue;
       };
-      std::string sqlcmd = "INSERT INTO lock(lockid, uid) VALUES ('"+sql_escape(lock_id)+"','"+uid+"')";
-      if(!dberr("addlock:put",sqlite3_exec_nobusy(sqlcmd.c_str(), NULL, NULL, NULL))) {
+      sqlite3_stmt* stmt = sqlite3_prepare_cached("INSERT INTO lock(lockid, uid) VALUES (?, ?)");
+      if(!stmt) return false;
+      bind_text(stmt, 1, sql_escape(lock_id));
+      bind_text(stmt, 2, uid);
+      int dbres = sqlite3_step_nobusy(stmt);
+      (void)sqlite3_reset(stmt);
+      if(!dberr("addlock:put", (dbres == SQLITE_DONE) ? SQLITE_OK : dbres)) {
         return false;
       };
+      if(index_enabled_) index_add_lock(lock_id, uid);
     };
     return true;
   }
@@ -424,8 +537,12 @@ namespace ARex {
     Glib::Mutex::Lock lock(lock_);
     // map lock to id,owner 
     {
-      std::string sqlcmd = "DELETE FROM lock WHERE (lockid = '"+sql_escape(lock_id)+"')";
-      if(!dberr("removelock:del",sqlite3_exec_nobusy(sqlcmd.c_str(), NULL, NULL, NULL))) {
+      sqlite3_stmt* stmt = sqlite3_prepare_cached("DELETE FROM lock WHERE (lockid = ?)");
+      if(!stmt) return false;
+      bind_text(stmt, 1, sql_escape(lock_id));
+      int dbres = sqlite3_step_nobusy(stmt);
+      (void)sqlite3_reset(stmt);
+      if(!dberr("removelock:del", (dbres == SQLITE_DONE) ? SQLITE_OK : dbres)) {
         return false;
       };
       if(sqlite3_changes(db_) < 1) {
@@ -433,6 +550,7 @@ namespace ARex {
         return false;
       };
     };
+    if(index_enabled_) index_remove_lock(lock_id);
     return true;
   }
 
@@ -440,16 +558,16 @@ namespace ARex {
     if(!valid_) return false;
     Glib::Mutex::Lock lock(lock_);
     // map lock to id,owner 
-    {
-      std::string sqlcmd = "SELECT id,owner FROM rec WHERE uid IN (SELECT uid FROM lock WHERE (lockid = '"+sql_escape(lock_id)+"'))";
-      FindCallbackIdOwnerArg arg(ids);
-      if(!dberr("removelock:get",sqlite3_exec_nobusy(sqlcmd.c_str(), &FindCallbackIdOwner, &arg, NULL))) {
-        //return false;
-      };
+    if(!find_locked(lock_id, ids)) {
+      //return false;
     };
     {
-      std::string sqlcmd = "DELETE FROM lock WHERE (lockid = '"+sql_escape(lock_id)+"')";
-      if(!dberr("removelock:del",sqlite3_exec_nobusy(sqlcmd.c_str(), NULL, NULL, NULL))) {
+      sqlite3_stmt* stmt = sqlite3_prepare_cached("DELETE FROM lock WHERE (lockid = ?)");
+      if(!stmt) return false;
+      bind_text(stmt, 1, sql_escape(lock_id));
+      int dbres = sqlite3_step_nobusy(stmt);
+      (void)sqlite3_reset(stmt);
+      if(!dberr("removelock:del", (dbres == SQLITE_DONE) ? SQLITE_OK : dbres)) {
         return false;
       };
       if(sqlite3_changes(db_) < 1) {
@@ -457,6 +575,7 @@ namespace ARex {
         return false;
       };
     };
+    if(index_enabled_) index_remove_lock(lock_id);
     return true;
   }
 
@@ -465,12 +584,8 @@ namespace ARex {
     if(!valid_) return false;
     Glib::Mutex::Lock lock(lock_);
     // map lock to id,owner 
-    {
-      std::string sqlcmd = "SELECT id,owner FROM rec WHERE uid IN (SELECT uid FROM lock WHERE (lockid = '"+sql_escape(lock_id)+"'))";
-      FindCallbackIdOwnerArg arg(ids);
-      if(!dberr("listlocked:get",sqlite3_exec_nobusy(sqlcmd.c_str(), &FindCallbackIdOwner, &arg, NULL))) {
-        return false;
-      };
+    if(!find_locked(lock_id, ids)) {
+      return false;
     };
     //if(ids.empty()) return false;
     return true;
@@ -479,85 +594,83 @@ namespace ARex {
   bool FileRecordSQLite::ListLocks(std::list<std::string>& locks) {
     if(!valid_) return false;
     Glib::Mutex::Lock lock(lock_);
-    {
-      std::string sqlcmd = "SELECT lockid FROM lock";
-      FindCallbackLockArg arg(locks);
-      if(!dberr("listlocks:get",sqlite3_exec_nobusy(sqlcmd.c_str(), &FindCallbackLock, &arg, NULL))) {
-        return false;
+    if(index_sync()) {
+      for(std::map< std::string, std::list<std::string> >::iterator lock = index_locks_.begin(); lock != index_locks_.end(); ++lock) {
+        // One entry per locked record same as in database
+        if(!lock->first.empty()) locks.insert(locks.end(), lock->second.size(), lock->first);
       };
+      return true;
     };
-    return true;
+    sqlite3_stmt* stmt = sqlite3_prepare_cached("SELECT lockid FROM lock");
+    if(!stmt) return false;
+    int err;
+    while((err = sqlite3_step_nobusy(stmt)) == SQLITE_ROW) {
+      std::string rec = sql_unescape(column_text(stmt, 0));
+      if(!rec.empty()) locks.push_back(rec);
+    };
+    (void)sqlite3_reset(stmt);
+    return dberr("listlocks:get", (err == SQLITE_DONE) ? SQLITE_OK : err);
   }
 
   bool FileRecordSQLite::ListLocks(const std::string& id, const std::string& owner, std::list<std::string>& locks) {
     if(!valid_) return false;
     Glib::Mutex::Lock lock(lock_);
     std::string uid;
-    {
-      std::string sqlcmd = "SELECT uid FROM rec WHERE ((id = '"+sql_escape(id)+"') AND (owner = '"+sql_escape(owner)+"'))";
-      FindCallbackUidArg arg(uid);
-      if(!dberr("Failed to retrieve record from database",sqlite3_exec_nobusy(sqlcmd.c_str(), &FindCallbackUid, &arg, NULL))) {
-        return false; // No such record?
-      };
+    if(!find_uid(id, owner, uid, NULL)) {
+      return false; // No such record?
     };
     if(uid.empty()) {
       error_str_ = "Record not found";
       return false; // No such record
     };
-    {
-      std::string sqlcmd = "SELECT lockid FROM lock WHERE (uid = '"+uid+"')";
-      FindCallbackLockArg arg(locks);
-      if(!dberr("listlocks:get",sqlite3_exec_nobusy(sqlcmd.c_str(), &FindCallbackLock, &arg, NULL))) {
-        return false;
-      };
-    };
-    return true;
+    return find_locks(uid, locks);
   }
 
   FileRecordSQLite::Iterator::Iterator(FileRecordSQLite& frec):FileRecord::Iterator(frec) {
     rowid_ = -1;
     Glib::Mutex::Lock lock(frec.lock_);
-    {
-      std::string sqlcmd = "SELECT _rowid_,id,owner,uid,meta FROM rec ORDER BY _rowid_ LIMIT 1";
-      FindCallbackRecArg arg;
-      if(!frec.dberr("listlocks:get",frec.sqlite3_exec_nobusy(sqlcmd.c_str(), &FindCallbackRec, &arg, NULL))) {
-        return;
-      };
-      if(arg.uid.empty()) {
-        return;
-      };
-      uid_ = arg.uid;
-      id_ = arg.id;
-      owner_ = arg.owner;
-      meta_ = arg.meta;
-      rowid_ = arg.rowid;
-    };
+    sqlite3_stmt* stmt = frec.sqlite3_prepare_cached("SELECT _rowid_,id,owner,uid,meta FROM rec ORDER BY _rowid_ LIMIT 1");
+    if(stmt) fetch(stmt);
   }
 
   FileRecordSQLite::Iterator::~Iterator(void) {
   }
 
+  void FileRecordSQLite::Iterator::fetch(sqlite3_stmt* stmt) {
+    FileRecordSQLite& frec((FileRecordSQLite&)frec_);
+    int err = frec.sqlite3_step_nobusy(stmt);
+    if(err != SQLITE_ROW) {
+      (void)sqlite3_reset(stmt);
+      (void)frec.dberr("listlocks:get", (err == SQLITE_DONE) ? SQLITE_OK : err);
+      rowid_ = -1;
+      return;
+    };
+    std::string uid = column_text(stmt, 3);
+    if(uid.empty()) {
+      (void)sqlite3_reset(stmt);
+      rowid_ = -1;
+      return;
+    };
+    rowid_ = sqlite3_column_int64(stmt, 0);
+    id_ = sql_unescape(column_text(stmt, 1));
+    owner_ = sql_unescape(column_text(stmt, 2));
+    uid_ = uid;
+    meta_.clear();
+    parse_strings(meta_, (const char*)sqlite3_column_text(stmt, 4));
+    (void)sqlite3_reset(stmt);
+  }
+
   FileRecordSQLite::Iterator& FileRecordSQLite::Iterator::operator++(void) {
     if(rowid_ == -1) return *this;
     FileRecordSQLite& frec((FileRecordSQLite&)frec_);
     Glib::Mutex::Lock lock(frec.lock_);
-    {
-      std::string sqlcmd = "SELECT _rowid_,id,owner,uid,meta FROM rec WHERE (_rowid_ > " + Arc::tostring(rowid_) + ") ORDER BY _rowid_ ASC LIMIT 1";
-      FindCallbackRecArg arg;
-      if(!frec.dberr("listlocks:get",frec.sqlite3_exec_nobusy(sqlcmd.c_str(), &FindCallbackRec, &arg, NULL))) {
-        rowid_ = -1;
-        return *this;
-      };
-      if(arg.uid.empty()) {
-        rowid_ = -1;
-        return *this;
-      };
-      uid_ = arg.uid;
-      id_ = arg.id;
-      owner_ = arg.owner;
-      meta_ = arg.meta;
-      rowid_ = arg.rowid;
+    sqlite3_stmt* stmt = frec.sqlite3_prepare_cached("SELECT _rowid_,id,owner,uid,meta FROM rec WHERE (_rowid_ > ?) ORDER BY _rowid_ ASC LIMIT 1");
+    if(!stmt) {
+      rowid_ = -1;
+      return *this;
     };
+    (void)sqlite3_bind_int64(stmt, 1, rowid_);
+    fetch(stmt);
     return *this;
   }
 
@@ -565,23 +678,13 @@ namespace ARex {
     if(rowid_ == -1) return *this;
     FileRecordSQLite& frec((FileRecordSQLite&)frec_);
     Glib::Mutex::Lock lock(frec.lock_);
-    {
-      std::string sqlcmd = "SELECT _rowid_,id,owner,uid,meta FROM rec WHERE (_rowid_ < " + Arc::tostring(rowid_) + ") ORDER BY _rowid_ DESC LIMIT 1";
-      FindCallbackRecArg arg;
-      if(!frec.dberr("listlocks:get",frec.sqlite3_exec_nobusy(sqlcmd.c_str(), &FindCallbackRec, &arg, NULL))) {
-        rowid_ = -1;
-        return *this;
-      };
-      if(arg.uid.empty()) {
-        rowid_ = -1;
-        return *this;
-      };
-      uid_ = arg.uid;
-      id_ = arg.id;
-      owner_ = arg.owner;
-      meta_ = arg.meta;
-      rowid_ = arg.rowid;
+    sqlite3_stmt* stmt = frec.sqlite3_prepare_cached("SELECT _rowid_,id,owner,uid,meta FROM rec WHERE (_rowid_ < ?) ORDER BY _rowid_ DESC LIMIT 1");
+    if(!stmt) {
+      rowid_ = -1;
+      return *this;
     };
+    (void)sqlite3_bind_int64(stmt, 1, rowid_);
+    fetch(stmt);
     return *this;
   }
 
@@ -593,4 +696,3 @@ namespace ARex {
   }
 
 } // namespace ARex
-
@@ -2,6 +2,7 @@
 #define __ARC_DELEGATION_FILERECORDSQLITE_H__
 
 #include <list>
+#include <map>
 #include <string>
 
 #include <sqlite3.h>
@@ -16,11 +17,41 @@ class FileRecordSQLite: public FileRecord {
  private:
   Glib::Mutex lock_; // TODO: use DB locking
   sqlite3* db_;
+  // Compiled statements, kept till database is closed
+  std::map<std::string,sqlite3_stmt*> statements_;
+  // Copy of database content used for lookups. It is updated along with
+  // every change made through this object and reloaded if database was
+  // changed by another connection (other processes share same database).
+  // If SQLite can't report such changes index is not used.
+  struct IndexRecord {
+    std::string uid;
+    std::list<std::string> meta;
+  };
+  bool index_enabled_;
+  sqlite3_int64 index_version_;
+  std::map< std::pair<std::string,std::string>, IndexRecord > index_recs_; // (id,owner) -> record
+  std::map< std::string, std::pair<std::string,std::string> > index_uids_; // uid -> (id,owner)
+  std::map< std::string, std::list<std::string> > index_locks_; // lockid -> uids
+  std::map< std::string, std::list<std::string> > index_uid_locks_; // uid -> lockids
   int sqlite3_exec_nobusy(const char *sql, int (*callback)(void*,int,char**,char**), void *arg, char **errmsg);
+  // Returns reset statement for sql or NULL
+  sqlite3_stmt* sqlite3_prepare_cached(const char *sql);
+  int sqlite3_step_nobusy(sqlite3_stmt* stmt);
   bool dberr(const char* s, int err);
   bool open(bool create);
   void close(void);
   bool verify(void);
+  // Makes index match database, returns false if index can't be used
+  bool index_sync(void);
+  bool index_load(void);
+  void index_add(const std::string& uid, const std::string& id, const std::string& owner, const std::list<std::string>& meta);
+  void index_remove(const std::string& uid);
+  void index_add_lock(const std::string& lock_id, const std::string& uid);
+  void index_remove_lock(const std::string& lock_id);
+  // Lookups served from index or database
+  bool find_uid(const std::string& id, const std::string& owner, std::string& uid, std::list<std::string>* meta);
+  bool find_locks(const std::string& uid, std::list<std::string>& locks);
+  bool find_locked(const std::string& lock_id, std::list<std::pair<std::string,std::string> >& ids);
  public:
   class Iterator: public FileRecord::Iterator {
    friend class FileRecordSQLite;
@@ -28,6 +59,8 @@ class FileRecordSQLite: public FileRecord {
     Iterator(const Iterator&); // disabled constructor
     Iterator(FileRecordSQLite& frec);
     sqlite3_int64 rowid_;
+    // Takes record from executed statement, resets statement
+    void fetch(sqlite3_stmt* stmt);
    public:
     ~Iterator(void);
     virtual Iterator& operator++(void);
@@ -195,6 +195,19 @@ Arc::MCC_Status ARexService::GetJob(Arc::Message& inmsg,Arc::Message& outmsg,ARe
     Arc::FileAccess::Release(dir);
     return r;
   };
+  // Regular file which service may read itself is passed to network
+  // without going through file access helper process.
+  int fileHandle = job.OpenFileDirect(hpath);
+  if(fileHandle != -1) {
+    off_t range_start;
+    off_t range_end;
+    ExtractRange(inmsg, range_start, range_end);
+    Arc::MessagePayload* h = newFileRead(fileHandle,range_start,range_end);
+    if(!h) return Arc::MCC_Status(Arc::UNKNOWN_SERVICE_ERROR);
+    outmsg.Payload(h);
+    outmsg.Attributes()->set("HTTP:content-type","application/octet-stream");
+    return Arc::MCC_Status(Arc::STATUS_OK);
+  };
   Arc::FileAccess* file = job.OpenFile(hpath,true,false);
   if(file) {
     // File or similar
@@ -12,6 +12,7 @@
 #include <arc/Watchdog.h>
 #include "jobs/JobsList.h"
 #include "jobs/CommFIFO.h"
+#include "jobs/JobsSnapshot.h"
 #include "log/JobLog.h"
 #include "log/JobsMetrics.h"
 #include "log/HeartBeatMetrics.h"
@@ -272,6 +273,14 @@ bool GridManager::thread() {
     return false;
   };  
 
+  // Fill snapshot of job states from control directory. Further
+  // changes are reported by JobsList.
+  JobsSnapshot* snapshot = config_.GetJobsSnapshot();
+  if(snapshot) {
+    logger.msg(Arc::INFO,"Collecting states of jobs");
+    snapshot->Prime(config_);
+  }
+
   // Start jobs processing
   jobs_ = &jobs;
   logger.msg(Arc::INFO,"Picking up left jobs");
@@ -45,6 +45,19 @@ namespace ARex {
          * write record about job state change to accounting log 
          **/
         virtual bool addJobEvent(aar_jobevent_t& events, const std::string& jobid) = 0;
+        /// Start group of operations written to database at once
+        /**
+         * All operations performed till commitBatch() is called are
+         * stored in single transaction. Backends which do not support
+         * that just perform every operation immediately.
+         **/
+        virtual bool beginBatch() { return true; }
+        /// Make operations performed since beginBatch() persistent
+        /**
+         * On failure none of these operations is stored and caller
+         * has to repeat them if needed.
+         **/
+        virtual bool commitBatch() { return true; }
     protected:
         const std::string name;
         bool isValid;
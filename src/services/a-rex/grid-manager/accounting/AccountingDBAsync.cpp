@@ -12,6 +12,8 @@ namespace ARex {
    friend class AccountingDBAsync;
    public:
     static const std::size_t MaxQueueDepth = 10000;
+    // Maximal number of events written in one transaction
+    static const std::size_t MaxBatchSize = 1000;
 
     static AccountingDBThread& Instance();
     bool Push(AccountingDBAsync::Event* event);
@@ -20,7 +22,10 @@ namespace ARex {
     AccountingDBThread();
     virtual ~AccountingDBThread();
     void thread();
+    bool process(AccountingDB& db, AccountingDBAsync::Event& event);
+    void commit(AccountingDB& db, std::list<AccountingDBAsync::Event*>& batch);
 
+    static Arc::Logger logger;
     Arc::SimpleCondition lock_;
     AccountingDBThread* instance_;
 
@@ -29,6 +34,8 @@ namespace ARex {
     bool exited_;
   };
 
+  Arc::Logger AccountingDBThread::logger(Arc::Logger::getRootLogger(), "AccountingDBAsync");
+
   AccountingDBThread& AccountingDBThread::Instance() {
     static AccountingDBThread instance;
     return instance;
@@ -57,37 +64,83 @@ namespace ARex {
     return true;
   }
 
-  void AccountingDBThread::thread() {
-    while(true) {
-      Arc::AutoLock<Arc::SimpleCondition> lock(lock_);
-      if(queue_.empty()) {
-        lock_.wait_nonblock();
-        if(queue_.empty()) continue;
+  bool AccountingDBThread::process(AccountingDB& db, AccountingDBAsync::Event& event) {
+    AccountingDBAsync::EventCreateAAR* eventCreateAAR = dynamic_cast<AccountingDBAsync::EventCreateAAR*>(&event);
+    if(eventCreateAAR) {
+      return db.createAAR(eventCreateAAR->aar);
+    };
+    AccountingDBAsync::EventUpdateAAR* eventUpdateAAR = dynamic_cast<AccountingDBAsync::EventUpdateAAR*>(&event);
+    if(eventUpdateAAR) {
+      return db.updateAAR(eventUpdateAAR->aar);
+    };
+    AccountingDBAsync::EventAddJobEvent* eventAddJobEvent = dynamic_cast<AccountingDBAsync::EventAddJobEvent*>(&event);
+    if(eventAddJobEvent) {
+      return db.addJobEvent(eventAddJobEvent->events, eventAddJobEvent->jobid);
+    };
+    return false;
+  }
+
+  void AccountingDBThread::commit(AccountingDB& db, std::list<AccountingDBAsync::Event*>& batch) {
+    if(!db.commitBatch()) {
+      // Whole transaction is rolled back. Writing events one by one
+      // so that only those which can't be written at all are lost.
+      logger.msg(Arc::WARNING, "Failed to write %u accounting events in single transaction, writing them separately", (unsigned int)batch.size());
+      unsigned int failed = 0;
+      for(std::list<AccountingDBAsync::Event*>::iterator event = batch.begin(); event != batch.end(); ++event) {
+        if(!process(db, **event)) ++failed;
       }
-      Arc::AutoPointer<AccountingDBAsync::Event> event(queue_.front());
-      queue_.pop_front();
-      AccountingDBAsync::EventQuit* eventQuit = dynamic_cast<AccountingDBAsync::EventQuit*>(event.Ptr());
-      if(eventQuit) break;
-      std::map< std::string,Arc::AutoPointer<AccountingDB> >::iterator db = dbs_.find(event->name);
-      if(db == dbs_.end()) continue; // not expected
-      lock.unlock(); // no need to keep lock anymore - db and event are picked up
-
-      AccountingDBAsync::EventCreateAAR* eventCreateAAR = dynamic_cast<AccountingDBAsync::EventCreateAAR*>(event.Ptr());
-      if(eventCreateAAR) {
-        db->second->createAAR(eventCreateAAR->aar);
-        continue;
-      };
-      AccountingDBAsync::EventUpdateAAR* eventUpdateAAR = dynamic_cast<AccountingDBAsync::EventUpdateAAR*>(event.Ptr());
-      if(eventUpdateAAR) {
-        db->second->updateAAR(eventUpdateAAR->aar);
-        continue;
-      };
-      AccountingDBAsync::EventAddJobEvent* eventAddJobEvent = dynamic_cast<AccountingDBAsync::EventAddJobEvent*>(event.Ptr());
-      if(eventAddJobEvent) {
-        db->second->addJobEvent(eventAddJobEvent->events, eventAddJobEvent->jobid);
-        continue;
+      if(failed) logger.msg(Arc::ERROR, "Failed to write %u accounting events, they are dropped", failed);
+    }
+    for(std::list<AccountingDBAsync::Event*>::iterator event = batch.begin(); event != batch.end(); ++event) {
+      delete *event;
+    }
+    batch.clear();
+  }
+
+  void AccountingDBThread::thread() {
+    bool quit = false;
+    while(!quit) {
+      // Events accumulated while previous group was written are taken
+      // all at once and written in single transaction per database.
+      std::list< std::pair<AccountingDBAsync::Event*,AccountingDB*> > events;
+      {
+        Arc::AutoLock<Arc::SimpleCondition> lock(lock_);
+        if(queue_.empty()) {
+          lock_.wait_nonblock();
+          if(queue_.empty()) continue;
+        }
+        while(!queue_.empty() && (events.size() < MaxBatchSize)) {
+          AccountingDBAsync::Event* event = queue_.front();
+          queue_.pop_front();
+          std::map< std::string,Arc::AutoPointer<AccountingDB> >::iterator db = dbs_.find(event->name);
+          events.push_back(std::make_pair(event, (db == dbs_.end()) ? (AccountingDB*)NULL : db->second.Ptr()));
+        }
+      } // no need to keep lock anymore - dbs and events are picked up
+
+      AccountingDB* batchDb = NULL;
+      // Events written in current transaction are kept till it is committed
+      std::list<AccountingDBAsync::Event*> batch;
+      for(std::list< std::pair<AccountingDBAsync::Event*,AccountingDB*> >::iterator it = events.begin();
+                                                                      it != events.end(); ++it) {
+        Arc::AutoPointer<AccountingDBAsync::Event> event(it->first);
+        if(quit) continue; // rest is dropped same way as in destructor
+        if(dynamic_cast<AccountingDBAsync::EventQuit*>(event.Ptr())) {
+          quit = true;
+          continue;
+        }
+        AccountingDB* db = it->second;
+        if(!db) continue; // not expected
+        if(db != batchDb) {
+          if(batchDb) commit(*batchDb, batch);
+          batchDb = db;
+          batchDb->beginBatch();
+        }
+        process(*db, *event);
+        batch.push_back(event.Release());
       };
+      if(batchDb) commit(*batchDb, batch);
     };
+    exited_ = true;
   }
 
 
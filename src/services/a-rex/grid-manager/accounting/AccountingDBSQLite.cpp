@@ -28,6 +28,39 @@ namespace ARex {
         return err;
     }
 
+    sqlite3_stmt* AccountingDBSQLite::SQLiteDB::prepare(const char *sql) {
+        if (!aDB) return NULL;
+        std::map<std::string, sqlite3_stmt*>::iterator it = statements.find(sql);
+        if (it != statements.end()) {
+            (void)sqlite3_reset(it->second);
+            (void)sqlite3_clear_bindings(it->second);
+            return it->second;
+        }
+        sqlite3_stmt* stmt = NULL;
+        int err;
+        while((err = sqlite3_prepare_v2(aDB, sql, -1, &stmt, NULL)) == SQLITE_BUSY) {
+            struct timespec delay = { 0, 10000000 }; // 0.01s - should be enough for most cases
+            (void)::nanosleep(&delay, NULL);
+        };
+        if (err != SQLITE_OK) {
+            logError("Failed to prepare SQL statement", err, Arc::ERROR);
+            AccountingDBSQLite::logger.msg(Arc::DEBUG, "SQL statement used: %s", sql);
+            return NULL;
+        }
+        statements[sql] = stmt;
+        return stmt;
+    }
+
+    int AccountingDBSQLite::SQLiteDB::step(sqlite3_stmt* stmt) {
+        int err;
+        while((err = sqlite3_step(stmt)) == SQLITE_BUSY) {
+            // Same reasoning as in exec()
+            struct timespec delay = { 0, 10000000 }; // 0.01s - should be enough for most cases
+            (void)::nanosleep(&delay, NULL);
+        };
+        return err;
+    }
+
     AccountingDBSQLite::SQLiteDB::SQLiteDB(const std::string& name, bool create): aDB(NULL) {
         if (aDB != NULL) return; // already open
 
@@ -84,6 +117,11 @@ namespace ARex {
     }
 
     void AccountingDBSQLite::SQLiteDB::closeDB(void) {
+        for (std::map<std::string, sqlite3_stmt*>::iterator it = statements.begin();
+                                                 it != statements.end(); ++it) {
+            (void)sqlite3_finalize(it->second);
+        }
+        statements.clear();
         if (aDB) {
             (void)sqlite3_close(aDB); // TODO: handle errors?
             aDB = NULL;
@@ -94,7 +132,7 @@ namespace ARex {
         closeDB();
     }
 
-    AccountingDBSQLite::AccountingDBSQLite(const std::string& name) : AccountingDB(name), db(NULL) {
+    AccountingDBSQLite::AccountingDBSQLite(const std::string& name) : AccountingDB(name), db(NULL), inBatch(false) {
         isValid = false;
         // check database file exists
         if (!Glib::file_test(name, Glib::FILE_TEST_EXISTS)) {
@@ -156,16 +194,29 @@ namespace ARex {
         closeSQLiteDB();
     }
 
+    // Parameters are stored same way as they were when embedded into SQL text
+    static void sql_bind(sqlite3_stmt* stmt, int idx, const std::string& str) {
+        std::string val = sql_escape(str);
+        (void)sqlite3_bind_text(stmt, idx, val.c_str(), val.length(), SQLITE_TRANSIENT);
+    }
+
+    static void sql_bind(sqlite3_stmt* stmt, int idx, sqlite3_int64 num) {
+        (void)sqlite3_bind_int64(stmt, idx, num);
+    }
+
+    static void sql_bind(sqlite3_stmt* stmt, int idx, const Arc::Time& val) {
+        std::string str = sql_escape(val);
+        (void)sqlite3_bind_text(stmt, idx, str.c_str(), str.length(), SQLITE_TRANSIENT);
+    }
+
     // perform insert query and return
     //  0 - failure
     //  id - autoincrement id of the inserted raw
-    unsigned int AccountingDBSQLite::GeneralSQLInsert(const std::string& sql) {
-        if (!isValid) return 0;
-        initSQLiteDB();
-        Glib::Mutex::Lock lock(lock_);
-        int err;
-        err = db->exec(sql.c_str(), NULL, NULL, NULL);
-        if (err != SQLITE_OK) {
+    unsigned int AccountingDBSQLite::GeneralSQLInsert(sqlite3_stmt* stmt) {
+        if (!isValid || !stmt) return 0;
+        int err = db->step(stmt);
+        (void)sqlite3_reset(stmt);
+        if (err != SQLITE_DONE) {
             if (err == SQLITE_CONSTRAINT) {
                 db->logError("It seams record exists already", err, Arc::ERROR);
             } else {
@@ -181,13 +232,11 @@ namespace ARex {
     }
 
     // perform update query
-    bool AccountingDBSQLite::GeneralSQLUpdate(const std::string& sql) {
-        if (!isValid) return false;
-        initSQLiteDB();
-        Glib::Mutex::Lock lock(lock_);
-        int err;
-        err = db->exec(sql.c_str(), NULL, NULL, NULL);
-        if (err != SQLITE_OK ) {
+    bool AccountingDBSQLite::GeneralSQLUpdate(sqlite3_stmt* stmt) {
+        if (!isValid || !stmt) return false;
+        int err = db->step(stmt);
+        (void)sqlite3_reset(stmt);
+        if (err != SQLITE_DONE) {
             db->logError("Failed to update data in the database", err, Arc::ERROR);
             return false;
         }
@@ -197,6 +246,60 @@ namespace ARex {
         return true;
     }
 
+    AccountingDBSQLite::Transaction::Transaction(AccountingDBSQLite& adb): adb(adb), started(false) {
+        if (adb.inBatch || !adb.db) return;
+        int err = adb.db->exec("BEGIN TRANSACTION", NULL, NULL, NULL);
+        if (err != SQLITE_OK) {
+            // Operations still can be performed, just slower
+            adb.db->logError("Failed to start transaction", err, Arc::WARNING);
+            return;
+        }
+        started = true;
+    }
+
+    AccountingDBSQLite::Transaction::~Transaction() {
+        if (started) (void)adb.commitTransaction();
+    }
+
+    bool AccountingDBSQLite::commitTransaction(void) {
+        int err = db->exec("COMMIT", NULL, NULL, NULL);
+        if (err == SQLITE_OK) return true;
+        db->logError("Failed to commit accounting records", err, Arc::ERROR);
+        (void)db->exec("ROLLBACK", NULL, NULL, NULL);
+        resetCaches();
+        return false;
+    }
+
+    void AccountingDBSQLite::resetCaches(void) {
+        db_queue.clear();
+        db_users.clear();
+        db_wlcgvos.clear();
+        db_status.clear();
+        db_endpoints.clear();
+    }
+
+    bool AccountingDBSQLite::beginBatch() {
+        if (!isValid) return false;
+        Glib::Mutex::Lock lock(lock_);
+        initSQLiteDB();
+        if (inBatch) return true;
+        int err = db->exec("BEGIN TRANSACTION", NULL, NULL, NULL);
+        if (err != SQLITE_OK) {
+            db->logError("Failed to start transaction", err, Arc::WARNING);
+            return false;
+        }
+        inBatch = true;
+        return true;
+    }
+
+    bool AccountingDBSQLite::commitBatch() {
+        if (!isValid) return false;
+        Glib::Mutex::Lock lock(lock_);
+        if (!inBatch) return true;
+        inBatch = false;
+        return commitTransaction();
+    }
+
     // callback to build (name,id) map from database table
     static int ReadIdNameCallback(void* arg, int colnum, char** texts, char** names) {
         name_id_map_t* name_id_map = static_cast<name_id_map_t*>(arg);
@@ -246,8 +349,10 @@ namespace ARex {
             return it->second;
         } else {
             // if not found - create the new record in the database
-            std::string sql = "INSERT INTO " + sql_escape(table) + " (Name) VALUES ('" + sql_escape(iname) + "')";
-            unsigned int newid = GeneralSQLInsert(sql);
+            std::string sql = "INSERT INTO " + sql_escape(table) + " (Name) VALUES (?)";
+            sqlite3_stmt* stmt = db->prepare(sql.c_str());
+            if (stmt) sql_bind(stmt, 1, iname);
+            unsigned int newid = GeneralSQLInsert(stmt);
             if ( newid ) {
                 name_id_map->insert(std::pair <std::string, unsigned int>(iname, newid));
                 return newid;
@@ -322,8 +427,12 @@ namespace ARex {
             return it->second;
         } else {
             // if not found - create the new record in the database
-            std::string sql = "INSERT INTO Endpoints (Interface, URL) VALUES ('" + sql_escape(endpoint.interface) + "', '" + sql_escape(endpoint.url) +"')";
-            unsigned int newid = GeneralSQLInsert(sql);
+            sqlite3_stmt* stmt = db->prepare("INSERT INTO Endpoints (Interface, URL) VALUES (?, ?)");
+            if (stmt) {
+                sql_bind(stmt, 1, endpoint.interface);
+                sql_bind(stmt, 2, endpoint.url);
+            }
+            unsigned int newid = GeneralSQLInsert(stmt);
             if ( newid ) {
                 db_endpoints.insert(std::pair <aar_endpoint_t, unsigned int>(endpoint, newid));
                 return newid;
@@ -334,29 +443,25 @@ namespace ARex {
         return 0;
     }
     
-    // callback to get id from database table
-    static int ReadIdCallback(void* arg, int colnum, char** texts, char** names) {
-        unsigned int* dbid = static_cast<unsigned int*>(arg);
-        for (int n = 0; n < colnum; ++n) {
-            if (names[n] && texts[n]) {
-                int id;
-                sql_unescape(texts[n], id);
-                *dbid = id;
-            }
-        }
-        return 0;
-    }
-
     // AAR processing
     unsigned int AccountingDBSQLite::getAARDBId(const AAR& aar) {
         if (!isValid) return 0;
         initSQLiteDB();
-        unsigned int dbid = 0;
-        std::string sql = "SELECT RecordID FROM AAR WHERE JobID = '" + sql_escape(aar.jobid) + "'";
-        if (db->exec(sql.c_str(), &ReadIdCallback, &dbid, NULL) != SQLITE_OK ) {
+        sqlite3_stmt* stmt = db->prepare("SELECT RecordID FROM AAR WHERE JobID = ?");
+        if (!stmt) {
             logger.msg(Arc::ERROR, "Failed to query AAR database ID for job %s", aar.jobid);
             return 0;
         }
+        sql_bind(stmt, 1, aar.jobid);
+        unsigned int dbid = 0;
+        int err = db->step(stmt);
+        if (err == SQLITE_ROW) {
+            dbid = (unsigned int)sqlite3_column_int64(stmt, 0);
+        } else if (err != SQLITE_DONE) {
+            db->logError(NULL, err, Arc::DEBUG);
+            logger.msg(Arc::ERROR, "Failed to query AAR database ID for job %s", aar.jobid);
+        }
+        (void)sqlite3_reset(stmt);
         return dbid;
     }
 
@@ -368,7 +473,9 @@ namespace ARex {
 
     bool AccountingDBSQLite::createAAR(AAR& aar) {
         if (!isValid) return false;
+        Glib::Mutex::Lock lock(lock_);
         initSQLiteDB();
+        Transaction transaction(*this);
         // get the corresponding IDs in connected tables
         unsigned int endpointid = getDBEndpointId(aar.endpoint);
         if (!endpointid) return false;
@@ -380,37 +487,37 @@ namespace ARex {
         if (!wlcgvoid) return false;
         unsigned int statusid = getDBStatusId(aar.status);
         if (!statusid) return false;
-        // construct insert statement
-        std::string sql = "INSERT INTO AAR ("
+        // fill insert statement
+        sqlite3_stmt* stmt = db->prepare("INSERT INTO AAR ("
             "JobID, LocalJobID, EndpointID, QueueID, UserID, VOID, StatusID, ExitCode, "
             "SubmitTime, EndTime, NodeCount, CPUCount, UsedMemory, UsedVirtMem, UsedWalltime, "
             "UsedCPUUserTime, UsedCPUKernelTime, UsedScratch, StageInVolume, StageOutVolume ) "
-            "VALUES ('" +
-                sql_escape(aar.jobid) + "', '" +
-                sql_escape(aar.localid) + "', " +
-                sql_escape(endpointid) + ", " + 
-                sql_escape(queueid) + ", " + 
-                sql_escape(userid) + ", " + 
-                sql_escape(wlcgvoid) + ", " + 
-                sql_escape(statusid) + ", " +
-                sql_escape(aar.exitcode) + ", " +
-                sql_escape(aar.submittime.GetTime()) + ", " + 
-                sql_escape(aar.endtime.GetTime()) + ", " +
-                sql_escape(aar.nodecount) + ", " + 
-                sql_escape(aar.cpucount) + ", " + 
-                sql_escape(aar.usedmemory) + ", " + 
-                sql_escape(aar.usedvirtmemory) + ", " +
-                sql_escape(aar.usedwalltime) + ", " + 
-                sql_escape(aar.usedcpuusertime) + ", " + 
-                sql_escape(aar.usedcpukerneltime) + ", " +
-                sql_escape(aar.usedscratch) + ", " + 
-                sql_escape(aar.stageinvolume) + ", " + 
-                sql_escape(aar.stageoutvolume) +
-            ")";
-        unsigned int recordid = GeneralSQLInsert(sql);
+            "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)");
+        if (stmt) {
+            sql_bind(stmt, 1, aar.jobid);
+            sql_bind(stmt, 2, aar.localid);
+            sql_bind(stmt, 3, endpointid);
+            sql_bind(stmt, 4, queueid);
+            sql_bind(stmt, 5, userid);
+            sql_bind(stmt, 6, wlcgvoid);
+            sql_bind(stmt, 7, statusid);
+            sql_bind(stmt, 8, aar.exitcode);
+            sql_bind(stmt, 9, aar.submittime.GetTime());
+            sql_bind(stmt, 10, aar.endtime.GetTime());
+            sql_bind(stmt, 11, aar.nodecount);
+            sql_bind(stmt, 12, aar.cpucount);
+            sql_bind(stmt, 13, aar.usedmemory);
+            sql_bind(stmt, 14, aar.usedvirtmemory);
+            sql_bind(stmt, 15, aar.usedwalltime);
+            sql_bind(stmt, 16, aar.usedcpuusertime);
+            sql_bind(stmt, 17, aar.usedcpukerneltime);
+            sql_bind(stmt, 18, aar.usedscratch);
+            sql_bind(stmt, 19, aar.stageinvolume);
+            sql_bind(stmt, 20, aar.stageoutvolume);
+        }
+        unsigned int recordid = GeneralSQLInsert(stmt);
         if (!recordid) {
             logger.msg(Arc::ERROR, "Failed to insert AAR into the database for job %s", aar.jobid);
-            logger.msg(Arc::DEBUG, "SQL statement used: %s", sql);
             return false;
         }
         // insert authtoken attributes
@@ -426,7 +533,9 @@ namespace ARex {
 
     bool AccountingDBSQLite::updateAAR(AAR& aar) {
         if (!isValid) return false;
+        Glib::Mutex::Lock lock(lock_);
         initSQLiteDB();
+        Transaction transaction(*this);
         // get AAR ID in the database
         unsigned int recordid = getAARDBId(aar);
         if (!recordid) {
@@ -436,28 +545,34 @@ namespace ARex {
         // get the corresponding IDs in connected tables
         unsigned int statusid = getDBStatusId(aar.status);
         
-        // construct update statement 
+        // fill update statement
         // NOTE: it only make sense update the dynamic information not available on submission time
-        std::string sql = "UPDATE AAR SET "
-            "LocalJobID = '" + sql_escape(aar.localid) + "', " +
-            "StatusID = " + sql_escape(statusid) + ", " +
-            "ExitCode = " + sql_escape(aar.exitcode) + ", " +
-            "EndTime = " + sql_escape(aar.endtime.GetTime()) + ", " +
-            "NodeCount = " + sql_escape(aar.nodecount) + ", " + 
-            "CPUCount = " + sql_escape(aar.cpucount) + ", " + 
-            "UsedMemory = " + sql_escape(aar.usedmemory) + ", " + 
-            "UsedVirtMem = " + sql_escape(aar.usedvirtmemory) + ", " +
-            "UsedWalltime = " + sql_escape(aar.usedwalltime) + ", " + 
-            "UsedCPUUserTime = " + sql_escape(aar.usedcpuusertime) + ", " + 
-            "UsedCPUKernelTime = " + sql_escape(aar.usedcpukerneltime) + ", " +
-            "UsedScratch = " + sql_escape(aar.usedscratch) + ", " + 
-            "StageInVolume = " + sql_escape(aar.stageinvolume) + ", " + 
-            "StageOutVolume = " + sql_escape(aar.stageoutvolume) + " " +
-            "WHERE RecordId = " + sql_escape(recordid);
+        sqlite3_stmt* stmt = db->prepare("UPDATE AAR SET "
+            "LocalJobID = ?, StatusID = ?, ExitCode = ?, EndTime = ?, "
+            "NodeCount = ?, CPUCount = ?, UsedMemory = ?, UsedVirtMem = ?, "
+            "UsedWalltime = ?, UsedCPUUserTime = ?, UsedCPUKernelTime = ?, "
+            "UsedScratch = ?, StageInVolume = ?, StageOutVolume = ? "
+            "WHERE RecordId = ?");
+        if (stmt) {
+            sql_bind(stmt, 1, aar.localid);
+            sql_bind(stmt, 2, statusid);
+            sql_bind(stmt, 3, aar.exitcode);
+            sql_bind(stmt, 4, aar.endtime.GetTime());
+            sql_bind(stmt, 5, aar.nodecount);
+            sql_bind(stmt, 6, aar.cpucount);
+            sql_bind(stmt, 7, aar.usedmemory);
+            sql_bind(stmt, 8, aar.usedvirtmemory);
+            sql_bind(stmt, 9, aar.usedwalltime);
+            sql_bind(stmt, 10, aar.usedcpuusertime);
+            sql_bind(stmt, 11, aar.usedcpukerneltime);
+            sql_bind(stmt, 12, aar.usedscratch);
+            sql_bind(stmt, 13, aar.stageinvolume);
+            sql_bind(stmt, 14, aar.stageoutvolume);
+            sql_bind(stmt, 15, recordid);
+        }
         // run update
-        if (!GeneralSQLUpdate(sql)) {
+        if (!GeneralSQLUpdate(stmt)) {
             logger.msg(Arc::ERROR, "Failed to update AAR in the database for job %s", aar.jobid);
-            logger.msg(Arc::DEBUG, "SQL statement used: %s", sql);
             return false;
         }
         // write RTE info
@@ -479,102 +594,92 @@ namespace ARex {
         return true;
     }
 
+    // Following helpers are called within transaction, so single
+    // statement is used for every record.
+
     bool AccountingDBSQLite::writeRTEs(std::list <std::string>& rtes, unsigned int recordid) {
         if (rtes.empty()) return true;
-        std::string sql = "BEGIN TRANSACTION; ";
-        std::string sql_base = "INSERT INTO RunTimeEnvironments (RecordID, RTEName) VALUES ";
+        sqlite3_stmt* stmt = db->prepare("INSERT INTO RunTimeEnvironments (RecordID, RTEName) VALUES (?, ?)");
+        if (!stmt) return false;
         for (std::list<std::string>::iterator it=rtes.begin(); it != rtes.end(); ++it) {
-            sql += sql_base + "(" + sql_escape(recordid) + ", '" + sql_escape(*it) + "'); ";
-        }
-        sql += "COMMIT;";
-        if(!GeneralSQLInsert(sql)) {
-            logger.msg(Arc::DEBUG, "SQL statement used: %s", sql);
-            return false;
+            sql_bind(stmt, 1, recordid);
+            sql_bind(stmt, 2, *it);
+            if(!GeneralSQLInsert(stmt)) return false;
         }
         return true;
     }
 
     bool AccountingDBSQLite::writeAuthTokenAttrs(std::list <aar_authtoken_t>& attrs, unsigned int recordid) {
         if (attrs.empty()) return true;
-        std::string sql = "BEGIN TRANSACTION; ";
-        std::string sql_base = "INSERT INTO AuthTokenAttributes (RecordID, AttrKey, AttrValue) VALUES ";
+        sqlite3_stmt* stmt = db->prepare("INSERT INTO AuthTokenAttributes (RecordID, AttrKey, AttrValue) VALUES (?, ?, ?)");
+        if (!stmt) return false;
         for (std::list <aar_authtoken_t>::iterator it=attrs.begin(); it!=attrs.end(); ++it) {
-            sql += sql_base + "(" + sql_escape(recordid) + ", '" + sql_escape(it->first) + "', '" +
-                   sql_escape(it->second) + "'); ";
-        }
-        sql += "COMMIT;";
-        if(!GeneralSQLInsert(sql)) {
-            logger.msg(Arc::DEBUG, "SQL statement used: %s", sql);
-            return false;
+            sql_bind(stmt, 1, recordid);
+            sql_bind(stmt, 2, it->first);
+            sql_bind(stmt, 3, it->second);
+            if(!GeneralSQLInsert(stmt)) return false;
         }
         return true;
     }
 
     bool AccountingDBSQLite::writeExtraInfo(std::map <std::string, std::string>& info, unsigned int recordid) {
         if (info.empty()) return true;
-        std::string sql = "BEGIN TRANSACTION; ";
-        std::string sql_base = "INSERT INTO JobExtraInfo (RecordID, InfoKey, InfoValue) VALUES ";
+        sqlite3_stmt* stmt = db->prepare("INSERT INTO JobExtraInfo (RecordID, InfoKey, InfoValue) VALUES (?, ?, ?)");
+        if (!stmt) return false;
         for (std::map<std::string,std::string>::iterator it=info.begin(); it!=info.end(); ++it) {
-            sql += sql_base + "(" + sql_escape(recordid) + ", '" + sql_escape(it->first) + "', '" +
-                   sql_escape(it->second) + "'); ";
-        }
-        sql += "COMMIT;";
-        if(!GeneralSQLInsert(sql)) {
-            logger.msg(Arc::DEBUG, "SQL statement used: %s", sql);
-            return false;
+            sql_bind(stmt, 1, recordid);
+            sql_bind(stmt, 2, it->first);
+            sql_bind(stmt, 3, it->second);
+            if(!GeneralSQLInsert(stmt)) return false;
         }
         return true;
     }
 
     bool AccountingDBSQLite::writeDTRs(std::list <aar_data_transfer_t>& dtrs, unsigned int recordid) {
         if (dtrs.empty()) return true;
-        std::string sql = "BEGIN TRANSACTION; ";
-        std::string sql_base = "INSERT INTO DataTransfers "
-            "(RecordID, URL, FileSize, TransferStart, TransferEnd, TransferType) VALUES ";
+        sqlite3_stmt* stmt = db->prepare("INSERT INTO DataTransfers "
+            "(RecordID, URL, FileSize, TransferStart, TransferEnd, TransferType) VALUES (?, ?, ?, ?, ?, ?)");
+        if (!stmt) return false;
         for (std::list<aar_data_transfer_t>::iterator it=dtrs.begin(); it != dtrs.end(); ++it) {
-            sql += sql_base + "( " + sql_escape(recordid) + ", '" + 
-                   sql_escape(it->url) + "', " +
-                   sql_escape(it->size) + ", " + 
-                   sql_escape(it->transferstart.GetTime()) + ", " + 
-                   sql_escape(it->transferend.GetTime()) + ", " + 
-                   sql_escape(static_cast<int>(it->type)) + "); ";
-        }
-        sql += "COMMIT;";
-        if(!GeneralSQLInsert(sql)) {
-            logger.msg(Arc::DEBUG, "SQL statement used: %s", sql);
-            return false;
+            sql_bind(stmt, 1, recordid);
+            sql_bind(stmt, 2, it->url);
+            sql_bind(stmt, 3, it->size);
+            sql_bind(stmt, 4, it->transferstart.GetTime());
+            sql_bind(stmt, 5, it->transferend.GetTime());
+            sql_bind(stmt, 6, static_cast<int>(it->type));
+            if(!GeneralSQLInsert(stmt)) return false;
         }
         return true;
     }
 
     bool AccountingDBSQLite::writeEvents(std::list <aar_jobevent_t>& events, unsigned int recordid) {
         if (events.empty()) return true;
-        std::string sql = "BEGIN TRANSACTION; ";
-        std::string sql_base = "INSERT INTO JobEvents (RecordID, EventKey, EventTime) VALUES ";
+        sqlite3_stmt* stmt = db->prepare("INSERT INTO JobEvents (RecordID, EventKey, EventTime) VALUES (?, ?, ?)");
+        if (!stmt) return false;
         for (std::list<aar_jobevent_t>::iterator it=events.begin(); it != events.end(); ++it) {
-            sql += sql_base + "( " + sql_escape(recordid) + ", '" + sql_escape(it->first) + "', '" +
-                   sql_escape(it->second) + "'); ";
-        }
-        sql += "COMMIT;";
-        if(!GeneralSQLInsert(sql)) {
-            logger.msg(Arc::DEBUG, "SQL statement used: %s", sql);
-            return false;
+            sql_bind(stmt, 1, recordid);
+            sql_bind(stmt, 2, it->first);
+            sql_bind(stmt, 3, it->second);
+            if(!GeneralSQLInsert(stmt)) return false;
         }
         return true;
     }
 
     bool AccountingDBSQLite::addJobEvent(aar_jobevent_t& event, const std::string& jobid) {
+        if (!isValid) return false;
+        Glib::Mutex::Lock lock(lock_);
+        initSQLiteDB();
         unsigned int recordid = getAARDBId(jobid);
         if (!recordid) {
             logger.msg(Arc::ERROR, "Unable to add event: cannot find AAR for job %s in accounting database.", jobid);
             return false;
         }
-        std::string sql = "INSERT INTO JobEvents (RecordID, EventKey, EventTime) VALUES (" +
-            sql_escape(recordid) + ", '" + sql_escape(event.first) + "', '" + sql_escape(event.second) + "')";
-        if(!GeneralSQLInsert(sql)) {
-            logger.msg(Arc::DEBUG, "SQL statement used: %s", sql);
-            return false;
-        }
+        sqlite3_stmt* stmt = db->prepare("INSERT INTO JobEvents (RecordID, EventKey, EventTime) VALUES (?, ?, ?)");
+        if (!stmt) return false;
+        sql_bind(stmt, 1, recordid);
+        sql_bind(stmt, 2, event.first);
+        sql_bind(stmt, 3, event.second);
+        if(!GeneralSQLInsert(stmt)) return false;
         return true;
     }
 }
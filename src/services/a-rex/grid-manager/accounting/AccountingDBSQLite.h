@@ -24,6 +24,10 @@ namespace ARex {
         bool updateAAR(AAR& aar);
         /// Add job event record to AAR (any other state changes)
         bool addJobEvent(aar_jobevent_t& events, const std::string& jobid);
+        /// Open transaction covering all following operations
+        bool beginBatch();
+        /// Commit transaction opened by beginBatch()
+        bool commitBatch();
       private:
         static Arc::Logger logger;
         Glib::Mutex lock_;
@@ -43,21 +47,50 @@ namespace ARex {
             int changes(void) { return sqlite3_changes(aDB); }
             sqlite3_int64 insertID(void) { return sqlite3_last_insert_rowid(aDB); }
             int exec(const char *sql, int (*callback)(void*,int,char**,char**), void *arg, char **errmsg);
+            /// Returns compiled statement for sql, reset and ready for binding
+            /**
+             * Statements are compiled once and kept till connection is
+             * closed. Returns NULL on failure.
+             **/
+            sqlite3_stmt* prepare(const char *sql);
+            /// Performs one step of statement waiting while database is busy
+            int step(sqlite3_stmt* stmt);
             void logError(const char* errpfx, int err, Arc::LogLevel level = Arc::DEBUG);
         private:
             sqlite3* aDB;
+            std::map<std::string, sqlite3_stmt*> statements;
             void closeDB();
         };
 
         SQLiteDB* db;
+        /// Transaction opened by beginBatch() is active
+        bool inBatch;
         /// Initialize and close connection to SQLite database
         void initSQLiteDB(void);
         void closeSQLiteDB(void);
 
         /// General helper to execute INSERT statement and return the autoincrement ID
-        unsigned int GeneralSQLInsert(const std::string& sql);
+        /**
+         * Statement must be obtained from db->prepare() and have all
+         * parameters bound. Called with lock_ held.
+         **/
+        unsigned int GeneralSQLInsert(sqlite3_stmt* stmt);
         /// General helper to execute UPDATE statement
-        bool GeneralSQLUpdate(const std::string& sql);
+        bool GeneralSQLUpdate(sqlite3_stmt* stmt);
+        /// Keeps write transaction open while exists unless batch is active
+        class Transaction {
+        public:
+            Transaction(AccountingDBSQLite& adb);
+            ~Transaction();
+        private:
+            AccountingDBSQLite& adb;
+            bool started;
+        };
+        friend class Transaction;
+        /// Commit transaction, on failure roll it back
+        bool commitTransaction(void);
+        /// Forget cached IDs which may refer to rolled back records
+        void resetCaches(void);
 
         /// General helper that return accounting database ID for requested iname 
         /** 
@@ -0,0 +1,116 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+// Measures rate of writing synthetic AARs into accounting database.
+// Every job is created, gets number of events and is finally updated
+// with completion information - same sequence as A-REX produces.
+// Operations are grouped into transactions of specified size same
+// way as AccountingDBAsync does. Group size 1 corresponds to writing
+// every operation separately.
+
+#include <cstdlib>
+#include <iostream>
+
+#include <unistd.h>
+#include <sys/time.h>
+
+#include <arc/StringConv.h>
+
+#include "AccountingDBSQLite.h"
+#include "AAR.h"
+
+static double now(void) {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+static void usage(const char* name) {
+    std::cerr << "Usage: " << name << " [-n jobs] [-e events per job] [-b operations per transaction] database" << std::endl;
+}
+
+int main(int argc, char **argv) {
+    int jobs = 1000;
+    int events = 5;
+    int batch = 1;
+    int opt;
+    while ((opt = getopt(argc, argv, "n:e:b:h")) != -1) {
+        switch (opt) {
+            case 'n': jobs = atoi(optarg); break;
+            case 'e': events = atoi(optarg); break;
+            case 'b': batch = atoi(optarg); break;
+            default: usage(argv[0]); return EXIT_FAILURE;
+        }
+    }
+    if ((argc - optind) != 1 || jobs <= 0 || events < 0 || batch <= 0) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    Arc::LogStream logcerr(std::cerr);
+    Arc::Logger::getRootLogger().addDestination(logcerr);
+    Arc::Logger::getRootLogger().setThreshold(Arc::WARNING);
+
+    ARex::AccountingDBSQLite adb(argv[optind]);
+    if (!adb.IsValid()) {
+       std::cerr << "Database connection was not successfull" << std::endl;
+       return EXIT_FAILURE;
+    }
+
+    // Unique prefix allows running benchmark repeatedly on same database
+    std::string prefix = Arc::tostring(getpid()) + "-" + Arc::tostring(time(NULL)) + "-";
+    int operations = 0;
+    int failed = 0;
+    double start = now();
+    for (int n = 0; n < jobs; ++n) {
+        ARex::AAR aar;
+        aar.jobid = prefix + Arc::tostring(n);
+        aar.endpoint.interface = "org.ogf.glue.emies.activitycreation";
+        aar.endpoint.url = "https://arc.example.org:443/arex";
+        aar.queue = "queue" + Arc::tostring(n % 4);
+        aar.userdn = "/DC=org/DC=example/CN=User " + Arc::tostring(n % 50);
+        aar.wlcgvo = "vo" + Arc::tostring(n % 5);
+        aar.status = "in-progress";
+        aar.submittime = Arc::Time();
+        aar.authtokenattrs.push_back(ARex::aar_authtoken_t("vomsfqan", "/" + aar.wlcgvo));
+        aar.jobevents.push_back(ARex::aar_jobevent_t("ACCEPTED", Arc::Time()));
+
+        if ((operations % batch) == 0) adb.beginBatch();
+        if (!adb.createAAR(aar)) ++failed;
+        if ((++operations % batch) == 0) adb.commitBatch();
+        for (int e = 0; e < events; ++e) {
+            ARex::aar_jobevent_t event("EVENT" + Arc::tostring(e), Arc::Time());
+            if ((operations % batch) == 0) adb.beginBatch();
+            if (!adb.addJobEvent(event, aar.jobid)) ++failed;
+            if ((++operations % batch) == 0) adb.commitBatch();
+        }
+
+        aar.localid = Arc::tostring(n);
+        aar.status = "completed";
+        aar.exitcode = 0;
+        aar.endtime = Arc::Time();
+        aar.usedwalltime = 3600;
+        aar.usedcpuusertime = 3500;
+        aar.rtes.push_back("ENV/PROXY");
+        aar.transfers.push_back(ARex::aar_data_transfer_t());
+        aar.transfers.back().url = "https://data.example.org/file" + Arc::tostring(n);
+        aar.transfers.back().size = 1024*1024;
+        aar.transfers.back().type = ARex::dtr_input;
+        aar.extrainfo["jobname"] = "bench";
+        aar.extrainfo["lrms"] = "fork";
+        aar.jobevents.clear();
+        aar.jobevents.push_back(ARex::aar_jobevent_t("FINISHED", Arc::Time()));
+        if ((operations % batch) == 0) adb.beginBatch();
+        if (!adb.updateAAR(aar)) ++failed;
+        if ((++operations % batch) == 0) adb.commitBatch();
+    }
+    adb.commitBatch();
+    double elapsed = now() - start;
+
+    std::cout << "Jobs: " << jobs << ", operations: " << operations << " in " << elapsed << " s";
+    if (elapsed > 0) std::cout << " (" << (operations / elapsed) << " per second)";
+    std::cout << std::endl;
+    std::cout << "Failed operations: " << failed << std::endl;
+    return (failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
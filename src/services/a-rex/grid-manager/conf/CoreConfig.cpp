@@ -235,6 +235,20 @@ bool CoreConfig::ParseConfINI(GMConfig& config, Arc::ConfigFile& cfile) {
           }
           if (config.max_scripts < 0) config.max_scripts = -1;
         }
+        else if (command == "processingthreads") { // number of threads processing jobs
+          std::string threads_s = Arc::ConfigIni::NextArg(rest);
+          if (!Arc::stringto(threads_s, config.processing_threads)) {
+            logger.msg(Arc::ERROR, "Wrong number in processingthreads: %s", threads_s); return false;
+          }
+          if (config.processing_threads < 1) config.processing_threads = 1;
+        }
+        else if (command == "controldirbatch") { // number of status updates written together
+          std::string batch_s = Arc::ConfigIni::NextArg(rest);
+          if (!Arc::stringto(batch_s, config.control_dir_batch)) {
+            logger.msg(Arc::ERROR, "Wrong number in controldirbatch: %s", batch_s); return false;
+          }
+          if (config.control_dir_batch < 0) config.control_dir_batch = 0;
+        }
         else if(command == "norootpower") {
           if (!CheckYesNoCommand(config.strict_session, command, rest)) return false;
         }
@@ -75,11 +75,13 @@ void GMConfig::SetDefaults() {
   conffile_is_temp = false;
   job_log = NULL;
   jobs_metrics = NULL;
+  jobs_snapshot = NULL;
   heartbeat_metrics = NULL;
   space_metrics = NULL;
   job_perf_log = NULL;
   cont_plugins = NULL;
   delegations = NULL;
+  control_writer = NULL;
 
   share_uid = 0;
   keep_finished = DEFAULT_KEEP_FINISHED;
@@ -96,6 +98,8 @@ void GMConfig::SetDefaults() {
   max_jobs = -1;
   max_jobs_per_dn = -1;
   max_scripts = -1;
+  processing_threads = 1;
+  control_dir_batch = 0;
 
   deleg_db = deleg_db_sqlite;
 
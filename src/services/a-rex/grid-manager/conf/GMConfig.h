@@ -15,11 +15,13 @@ namespace ARex {
 // Forward declarations for classes for which this is just a container
 class JobLog;
 class JobsMetrics;
+class JobsSnapshot;
 class HeartBeatMetrics;
 class SpaceMetrics;
 class ContinuationPlugins;
 class RunPlugin;
 class DelegationStores;
+class ControlFileWriter;
 
 /// Configuration information related to the grid manager part of A-REX.
 /**
@@ -142,6 +144,8 @@ public:
   void SetJobPerfLog(Arc::JobPerfLog* log) { job_perf_log = log; }
   /// Set JobsMetrics object
   void SetJobsMetrics(JobsMetrics* metrics) { jobs_metrics = metrics; }
+  /// Set JobsSnapshot object
+  void SetJobsSnapshot(JobsSnapshot* snapshot) { jobs_snapshot = snapshot; }
   /// Set HeartBeatMetrics object
   void SetHeartBeatMetrics(HeartBeatMetrics* metrics) { heartbeat_metrics = metrics; }
   /// Set HeartBeatMetrics object
@@ -150,10 +154,14 @@ public:
   void SetContPlugins(ContinuationPlugins* plugins) { cont_plugins = plugins; }
   /// Set DelegationStores object
   void SetDelegations(ARex::DelegationStores* stores) { delegations = stores; }
+  /// Set ControlFileWriter object (write-behind queue for job status files)
+  void SetControlFileWriter(ControlFileWriter* writer) { control_writer = writer; }
   /// JobLog object
   JobLog* GetJobLog() const { return job_log; }
   /// JobsMetrics object
   JobsMetrics* GetJobsMetrics() const { return jobs_metrics; }
+  /// JobsSnapshot object or NULL if states of jobs are not collected in memory
+  JobsSnapshot* GetJobsSnapshot() const { return jobs_snapshot; }
   /// HeartBeatMetrics object
   HeartBeatMetrics* GetHeartBeatMetrics() const { return heartbeat_metrics; }
   /// SpaceMetrics object
@@ -164,6 +172,8 @@ public:
   ContinuationPlugins* GetContPlugins() const { return cont_plugins; }
   /// DelegationsStores object
   ARex::DelegationStores* GetDelegations() const { return delegations; }
+  /// ControlFileWriter object or NULL if status files are written immediately
+  ControlFileWriter* GetControlFileWriter() const { return control_writer; }
 
   /// Control directory
   const std::string & ControlDir() const { return control_dir; }
@@ -242,6 +252,10 @@ public:
   int MaxTotal() const { return max_jobs_total; }
   /// Max submit/cancel scripts 
   int MaxScripts() const { return max_scripts; }
+  /// Number of threads processing jobs through state machine
+  int ProcessingThreads() const { return processing_threads; }
+  /// Max number of status file updates collected before writing them together
+  int ControlDirBatch() const { return control_dir_batch; }
 
   /// Returns true if the shared uid matches the given uid
   bool MatchShareUid(uid_t suid) const { return ((share_uid==0) || (share_uid==suid)); };
@@ -273,6 +287,8 @@ private:
   JobLog* job_log;
   /// For reporting jobs metric to ganglia
   JobsMetrics* jobs_metrics;
+  /// In-memory states of all jobs for bulk queries
+  JobsSnapshot* jobs_snapshot;
   /// For reporting heartbeat metric to ganglia
   HeartBeatMetrics* heartbeat_metrics;
   /// For reporting free space metric to ganglia
@@ -284,6 +300,8 @@ private:
   /// Delegated credentials stored by A-REX
   // TODO: this should go away after proper locking in DelegationStore is implemented
   ARex::DelegationStores* delegations;
+  /// Write-behind queue for job status files
+  ControlFileWriter* control_writer;
 
   /// Certificates directory
   std::string cert_dir;
@@ -350,6 +368,10 @@ private:
   int max_jobs_per_dn;
   /// Maximum submit/cancel scripts running
   int max_scripts;
+  /// Number of threads processing jobs through state machine
+  int processing_threads;
+  /// Max number of status file updates collected before writing them together
+  int control_dir_batch;
 
   /// Whether WS-interface is enabled
   bool enable_arc_interface;
@@ -15,6 +15,8 @@
 #include "../jobs/GMJob.h"
 
 #include "ControlFileHandling.h"
+#include "ControlFileJournal.h"
+#include "ControlFileWriter.h"
 
 namespace ARex {
 
@@ -50,6 +52,8 @@ static Arc::Logger& logger = Arc::Logger::getRootLogger();
 
 static job_state_t job_state_read_file(const std::string &fname,bool &pending);
 static bool job_state_write_file(const std::string &fname,job_state_t state,bool pending);
+static job_state_t job_state_parse(std::string data,bool &pending);
+static std::string job_state_content(job_state_t state,bool pending);
 static bool job_mark_put(Arc::FileAccess& fa, const std::string &fname);
 static bool job_mark_remove(Arc::FileAccess& fa,const std::string &fname);
 
@@ -152,6 +156,7 @@ LRMSResult job_lrms_mark_read(const JobId &id,const GMConfig &config) {
 
 bool job_cancel_mark_put(const GMJob &job,const GMConfig &config) {
   std::string fname = config.ControlDir() + "/" + subdir_new + "/job." + job.get_id() + sfx_cancel;
+  (void)job_journal_append(config,journal_rec_mark,job.get_id(),sfx_cancel);
   return job_mark_put(fname) && fix_file_owner(fname,job) && fix_file_permissions(fname);
 }
 
@@ -167,6 +172,7 @@ bool job_cancel_mark_remove(const JobId &id,const GMConfig &config) {
 
 bool job_restart_mark_put(const GMJob &job,const GMConfig &config) {
   std::string fname = config.ControlDir() + "/" + subdir_new + "/job." + job.get_id() + sfx_restart;
+  (void)job_journal_append(config,journal_rec_mark,job.get_id(),sfx_restart);
   return job_mark_put(fname) && fix_file_owner(fname,job) && fix_file_permissions(fname);
 }
 
@@ -182,6 +188,7 @@ bool job_restart_mark_remove(const JobId &id,const GMConfig &config) {
 
 bool job_clean_mark_put(const GMJob &job,const GMConfig &config) {
   std::string fname = config.ControlDir() + "/" + subdir_new + "/job." + job.get_id() + sfx_clean;
+  (void)job_journal_append(config,journal_rec_mark,job.get_id(),sfx_clean);
   return job_mark_put(fname) && fix_file_owner(fname,job) && fix_file_permissions(fname);
 }
 
@@ -379,6 +386,12 @@ std::string job_errors_filename(const JobId &id, const GMConfig &config) {
 
 
 time_t job_state_time(const JobId &id,const GMConfig &config) {
+  ControlFileWriter* writer = config.GetControlFileWriter();
+  if(writer) {
+    std::string data;
+    time_t t = 0;
+    if(writer->Get(id, data, &t)) return t;
+  };
   std::string fname = config.ControlDir() + "/job." + id + sfx_status;
   time_t t = job_mark_time(fname);
   if(t != 0) return t;
@@ -401,6 +414,12 @@ job_state_t job_state_read_file(const JobId &id,const GMConfig &config) {
 }
 
 job_state_t job_state_read_file(const JobId &id,const GMConfig &config,bool& pending) {
+  ControlFileWriter* writer = config.GetControlFileWriter();
+  if(writer) {
+    // Queued state is newer than one stored in file
+    std::string data;
+    if(writer->Get(id, data)) return job_state_parse(data, pending);
+  };
   std::string fname = config.ControlDir() + "/job." + id + sfx_status;
   job_state_t st = job_state_read_file(fname,pending);
   if(st != JOB_STATE_DELETED) return st;
@@ -418,25 +437,41 @@ job_state_t job_state_read_file(const JobId &id,const GMConfig &config,bool& pen
 }
 
 bool job_state_write_file(const GMJob &job,const GMConfig &config,job_state_t state,bool pending) {
-  std::string fname;
-  if(state == JOB_STATE_ACCEPTED) { 
-    fname = config.ControlDir() + "/" + subdir_old + "/job." + job.get_id() + sfx_status; remove(fname.c_str());
-    fname = config.ControlDir() + "/" + subdir_cur + "/job." + job.get_id() + sfx_status; remove(fname.c_str());
-    fname = config.ControlDir() + "/" + subdir_rew + "/job." + job.get_id() + sfx_status; remove(fname.c_str());
-    fname = config.ControlDir() + "/job." + job.get_id() + sfx_status; remove(fname.c_str());
-    fname = config.ControlDir() + "/" + subdir_new + "/job." + job.get_id() + sfx_status;
+  const char* subdir = subdir_cur;
+  if(state == JOB_STATE_ACCEPTED) {
+    subdir = subdir_new;
   } else if((state == JOB_STATE_FINISHED) || (state == JOB_STATE_DELETED)) {
-    fname = config.ControlDir() + "/" + subdir_new + "/job." + job.get_id() + sfx_status; remove(fname.c_str());
-    fname = config.ControlDir() + "/" + subdir_cur + "/job." + job.get_id() + sfx_status; remove(fname.c_str());
-    fname = config.ControlDir() + "/" + subdir_rew + "/job." + job.get_id() + sfx_status; remove(fname.c_str());
-    fname = config.ControlDir() + "/job." + job.get_id() + sfx_status; remove(fname.c_str());
-    fname = config.ControlDir() + "/" + subdir_old + "/job." + job.get_id() + sfx_status;
-  } else {
-    fname = config.ControlDir() + "/" + subdir_new + "/job." + job.get_id() + sfx_status; remove(fname.c_str());
-    fname = config.ControlDir() + "/" + subdir_old + "/job." + job.get_id() + sfx_status; remove(fname.c_str());
-    fname = config.ControlDir() + "/" + subdir_rew + "/job." + job.get_id() + sfx_status; remove(fname.c_str());
-    fname = config.ControlDir() + "/job." + job.get_id() + sfx_status; remove(fname.c_str());
-    fname = config.ControlDir() + "/" + subdir_cur + "/job." + job.get_id() + sfx_status;
+    subdir = subdir_old;
+  };
+  // Record new location before it is changed so that journal never misses existing file
+  (void)job_journal_append(config,journal_rec_state,job.get_id(),subdir);
+  std::string fname = config.ControlDir() + "/" + subdir + "/job." + job.get_id() + sfx_status;
+  std::list<std::string> obsolete;
+  obsolete.push_back(config.ControlDir() + "/job." + job.get_id() + sfx_status);
+  const char* const subdirs[] = { subdir_new, subdir_cur, subdir_old, subdir_rew, NULL };
+  for(const char* const * sd = subdirs; *sd; ++sd) {
+    if(*sd != subdir) obsolete.push_back(config.ControlDir() + "/" + *sd + "/job." + job.get_id() + sfx_status);
+  };
+  ControlFileWriter* writer = config.GetControlFileWriter();
+  // New jobs are written immediately because they are picked up by scanning
+  if(writer && (state != JOB_STATE_ACCEPTED)) {
+    mode_t mode = S_IRUSR | S_IWUSR;
+    uid_t uid = job.get_user().get_uid();
+    gid_t gid = job.get_user().get_gid();
+    if(!config.MatchShareUid(uid)) {
+      mode |= S_IRGRP;
+      if(!config.MatchShareGid(gid)) mode |= S_IROTH;
+    };
+    // Job submitted to LRMS must not be submitted again after restart
+    bool sync = (state == JOB_STATE_INLRMS);
+    return writer->Put(job.get_id(), fname, job_state_content(state,pending),
+                       uid, gid, mode, obsolete, sync);
+  };
+  // Update still waiting in queue (like from before job was restarted) must
+  // not overwrite file written now and remove it as obsolete later.
+  if(writer) writer->Discard(job.get_id());
+  for(std::list<std::string>::iterator ofname = obsolete.begin(); ofname != obsolete.end(); ++ofname) {
+    remove(ofname->c_str());
   };
   return job_state_write_file(fname,state,pending) && fix_file_owner(fname,job) && fix_file_permissions(fname,job,config);
 }
@@ -448,6 +483,10 @@ static job_state_t job_state_read_file(const std::string &fname,bool &pending) {
     if(!job_mark_check(fname)) return JOB_STATE_DELETED; /* job does not exist */
     return JOB_STATE_UNDEFINED; /* can't open file */
   };
+  return job_state_parse(data, pending);
+}
+
+static job_state_t job_state_parse(std::string data,bool &pending) {
   data = data.substr(0, data.find('\n'));
   /* interpret information */
   if(data.substr(0, 8) == "PENDING:") {
@@ -458,11 +497,15 @@ static job_state_t job_state_read_file(const std::string &fname,bool &pending) {
   return GMJob::get_state(data.c_str());
 }
 
-static bool job_state_write_file(const std::string &fname,job_state_t state,bool pending) {
+static std::string job_state_content(job_state_t state,bool pending) {
   std::string data;
   if (pending) data += "PENDING:";
   data += GMJob::get_state_name(state);
-  return Arc::FileCreate(fname, data);
+  return data;
+}
+
+static bool job_state_write_file(const std::string &fname,job_state_t state,bool pending) {
+  return Arc::FileCreate(fname, job_state_content(state,pending));
 }
 
 time_t job_description_time(const JobId &id,const GMConfig &config) {
@@ -736,6 +779,8 @@ bool job_clean_deleted(const GMJob &job,const GMConfig &config,std::list<std::st
 
 bool job_clean_final(const GMJob &job,const GMConfig &config) {
   std::string id = job.get_id();
+  (void)job_journal_append(config,journal_rec_state,id,"-");
+  if(config.GetControlFileWriter()) config.GetControlFileWriter()->Discard(id);
   job_clean_finished(id,config);
   job_clean_deleted(job,config);
   std::string fname;
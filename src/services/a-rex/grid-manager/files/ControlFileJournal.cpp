@@ -0,0 +1,282 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <cstdio>
+
+#include <arc/Logger.h>
+#include <arc/StringConv.h>
+#include <arc/Utils.h>
+
+#include "../conf/GMConfig.h"
+#include "ControlFileHandling.h"
+
+#include "ControlFileJournal.h"
+
+namespace ARex {
+
+const char * const journal_file_name = "jobs.journal";
+
+// How many times to retry if journal is being replaced
+#define JOURNAL_APPEND_ATTEMPTS (10)
+// Size of journal which is never compacted
+#define JOURNAL_COMPACT_MIN (1024*1024)
+// Estimated size of one record
+#define JOURNAL_RECORD_SIZE (64)
+
+static Arc::Logger& logger = Arc::Logger::getRootLogger();
+
+static std::string journal_checksum(const std::string& data) {
+  // FNV-1a 32 bit
+  unsigned int hash = 2166136261U;
+  for(std::string::size_type n = 0; n < data.length(); ++n) {
+    hash ^= (unsigned char)data[n];
+    hash *= 16777619U;
+  };
+  char buf[9];
+  ::snprintf(buf, sizeof(buf), "%08x", hash & 0xffffffffU);
+  return buf;
+}
+
+static std::string journal_record(char type,const JobId &id,const std::string &value) {
+  std::string rec;
+  rec += type; rec += ' '; rec += id; rec += ' ';
+  rec += value.empty() ? std::string(".") : value;
+  rec += ' '; rec += journal_checksum(rec);
+  rec += '\n';
+  return rec;
+}
+
+static bool same_file(int h, const std::string& fname, struct stat& hst) {
+  struct stat fst;
+  if(::fstat(h,&hst) != 0) return false;
+  if(::stat(fname.c_str(),&fst) != 0) return false;
+  return (hst.st_dev == fst.st_dev) && (hst.st_ino == fst.st_ino);
+}
+
+bool job_journal_append(const GMConfig &config,char type,const JobId &id,const std::string &value) {
+  std::string fname = config.ControlDir() + "/" + journal_file_name;
+  std::string rec = journal_record(type, id, value);
+  for(int attempt = 0; attempt < JOURNAL_APPEND_ATTEMPTS; ++attempt) {
+    int h = ::open(fname.c_str(), O_WRONLY | O_CREAT | O_APPEND, S_IRUSR | S_IWUSR);
+    if(h == -1) return false;
+    // Appending records is shared operation. Exclusive lock is only
+    // taken while journal is compacted and replaced.
+    if(::flock(h, LOCK_SH) != 0) { ::close(h); return false; };
+    struct stat hst;
+    if(same_file(h, fname, hst)) {
+      ssize_t l = ::write(h, rec.c_str(), rec.length());
+      // Record must be on disk before file it describes is changed
+      bool r = (l == (ssize_t)rec.length()) && (::fdatasync(h) == 0);
+      ::close(h);
+      return r;
+    };
+    // Journal was replaced while waiting for lock
+    ::close(h);
+  };
+  return false;
+}
+
+ControlFileJournal::ControlFileJournal(const GMConfig& gmconfig):
+    config(gmconfig), valid(false), offset(0), file_dev(0), file_ino(0) {
+  fname = config.ControlDir() + "/" + journal_file_name;
+}
+
+ControlFileJournal::~ControlFileJournal() {
+}
+
+void ControlFileJournal::Apply(const Record& rec) {
+  if(rec.type != journal_rec_state) return;
+  if((rec.value == subdir_old) || (rec.value == "-")) {
+    locations.erase(rec.id);
+  } else {
+    locations[rec.id] = rec.value;
+  };
+}
+
+void ControlFileJournal::SetLocation(const JobId& id, const std::string& subdir) {
+  Record rec;
+  rec.type = journal_rec_state;
+  rec.id = id;
+  rec.value = subdir;
+  Apply(rec);
+}
+
+bool ControlFileJournal::ReadRecords(int h, std::list<Record>& records) {
+  if(::lseek(h, offset, SEEK_SET) != offset) return false;
+  std::string buf;
+  char chunk[16384];
+  for(;;) {
+    ssize_t l = ::read(h, chunk, sizeof(chunk));
+    if(l < 0) {
+      if(errno == EINTR) continue;
+      return false;
+    };
+    if(l == 0) break;
+    buf.append(chunk, l);
+    std::string::size_type start = 0;
+    for(;;) {
+      std::string::size_type end = buf.find('\n', start);
+      // Incomplete record is left for next reading
+      if(end == std::string::npos) break;
+      std::string line = buf.substr(start, end-start);
+      std::string::size_type p3 = line.rfind(' ');
+      if((p3 == std::string::npos) || (line.substr(p3+1) != journal_checksum(line.substr(0, p3)))) {
+        // Records following broken one may be lost too
+        logger.msg(Arc::ERROR, "Broken record in control directory journal: %s", line);
+        return false;
+      };
+      line.resize(p3);
+      offset += (end - start) + 1;
+      start = end + 1;
+      std::string::size_type p1 = line.find(' ');
+      std::string::size_type p2 = (p1 == std::string::npos) ? p1 : line.find(' ', p1+1);
+      if((p1 != 1) || (p2 == std::string::npos) || (p2 == p1+1)) {
+        logger.msg(Arc::WARNING, "Skipping malformed record in control directory journal: %s", line);
+        continue;
+      };
+      Record rec;
+      rec.type = line[0];
+      rec.id = line.substr(p1+1, p2-p1-1);
+      rec.value = line.substr(p2+1);
+      Apply(rec);
+      records.push_back(rec);
+    };
+    buf.erase(0, start);
+  };
+  return true;
+}
+
+bool ControlFileJournal::Load() {
+  valid = false;
+  offset = 0;
+  locations.clear();
+  int h = ::open(fname.c_str(), O_RDWR);
+  if(h == -1) return false;
+  // Exclusive lock ensures no append is in progress
+  if(::flock(h, LOCK_EX) != 0) { ::close(h); return false; };
+  struct stat st;
+  if(!same_file(h, fname, st)) { ::close(h); return false; };
+  file_dev = st.st_dev;
+  file_ino = st.st_ino;
+  std::list<Record> records;
+  bool r = ReadRecords(h, records);
+  if(r && (st.st_size > offset)) {
+    // Incomplete record left by interrupted append. If kept it would be
+    // joined with next appended record.
+    logger.msg(Arc::WARNING, "Removing incomplete record at end of control directory journal %s", fname);
+    if(::ftruncate(h, offset) != 0) r = false;
+  };
+  ::close(h);
+  if(!r) {
+    logger.msg(Arc::ERROR, "Failed reading control directory journal %s", fname);
+    return false;
+  };
+  valid = true;
+  return true;
+}
+
+bool ControlFileJournal::ReadNew(std::list<Record>& records) {
+  if(!valid) return false;
+  int h = ::open(fname.c_str(), O_RDONLY);
+  if(h == -1) { valid = false; return false; };
+  struct stat st;
+  if(::fstat(h, &st) != 0) { ::close(h); valid = false; return false; };
+  if((st.st_dev != file_dev) || (st.st_ino != file_ino)) {
+    // Journal replaced by someone else - start from scratch. All records
+    // are reported as new. That is safe because readers verify them.
+    logger.msg(Arc::WARNING, "Control directory journal %s was replaced - reloading", fname);
+    file_dev = st.st_dev;
+    file_ino = st.st_ino;
+    offset = 0;
+    locations.clear();
+  };
+  if(st.st_size < offset) {
+    // Truncated - most probably broken
+    ::close(h);
+    valid = false;
+    return false;
+  };
+  bool r = ReadRecords(h, records);
+  ::close(h);
+  if(!r) valid = false;
+  return r;
+}
+
+bool ControlFileJournal::NeedsCompact() const {
+  if(offset < JOURNAL_COMPACT_MIN) return false;
+  return (offset > (off_t)(locations.size() * JOURNAL_RECORD_SIZE * 8));
+}
+
+bool ControlFileJournal::Compact(std::list<Record>& records) {
+  int h = ::open(fname.c_str(), O_RDWR | O_CREAT, S_IRUSR | S_IWUSR);
+  if(h == -1) {
+    logger.msg(Arc::ERROR, "Failed to open control directory journal %s: %s", fname, Arc::StrError(errno));
+    return false;
+  };
+  if(::flock(h, LOCK_EX) != 0) { ::close(h); return false; };
+  struct stat st;
+  if(!same_file(h, fname, st)) {
+    // Replaced while waiting for lock. Other instance is compacting.
+    ::close(h);
+    return false;
+  };
+  if(valid) {
+    // Pick up records written since last reading
+    if((st.st_dev != file_dev) || (st.st_ino != file_ino)) {
+      offset = 0;
+      locations.clear();
+    };
+    if(!ReadRecords(h, records)) { ::close(h); return false; };
+  };
+  std::string tmpname = fname + ".tmp";
+  int th = ::open(tmpname.c_str(), O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+  if(th == -1) {
+    logger.msg(Arc::ERROR, "Failed to create control directory journal %s: %s", tmpname, Arc::StrError(errno));
+    ::close(h);
+    return false;
+  };
+  std::string buf;
+  off_t written = 0;
+  bool r = true;
+  for(std::map<JobId,std::string>::iterator loc = locations.begin(); ; ++loc) {
+    if(loc != locations.end()) {
+      buf += journal_record(journal_rec_state, loc->first, loc->second);
+    };
+    if((buf.length() >= 65536) || ((loc == locations.end()) && !buf.empty())) {
+      ssize_t l = ::write(th, buf.c_str(), buf.length());
+      if(l != (ssize_t)buf.length()) { r = false; break; };
+      written += l;
+      buf.clear();
+    };
+    if(loc == locations.end()) break;
+  };
+  if(r && (::fsync(th) != 0)) r = false;
+  if(r) {
+    struct stat tst;
+    if(::fstat(th, &tst) != 0) r = false;
+    if(r && (::rename(tmpname.c_str(), fname.c_str()) != 0)) r = false;
+    if(r) {
+      file_dev = tst.st_dev;
+      file_ino = tst.st_ino;
+      offset = written;
+      valid = true;
+    };
+  };
+  ::close(th);
+  if(!r) {
+    logger.msg(Arc::ERROR, "Failed to write control directory journal %s: %s", tmpname, Arc::StrError(errno));
+    ::unlink(tmpname.c_str());
+  };
+  // Releasing lock on old file lets appenders detect replacement
+  ::close(h);
+  return r;
+}
+
+} // namespace ARex
@@ -0,0 +1,107 @@
+#ifndef GRID_MANAGER_CONTROL_FILE_JOURNAL_H
+#define GRID_MANAGER_CONTROL_FILE_JOURNAL_H
+
+#include <string>
+#include <list>
+#include <map>
+#include <set>
+
+#include <sys/types.h>
+
+#include "../jobs/GMJob.h"
+
+namespace ARex {
+
+class GMConfig;
+
+/*
+  Append-only journal of changes made to job status files and to
+  marks in control directory. Every record is one line
+    <type> <job id> <value> <checksum>
+  where type is 'S' for status file with value being name of subdirectory
+  holding it ('.' for control directory itself, '-' for removed job) and
+  'M' for mark with value being suffix of mark file. Checksum is 8 hex
+  digits of FNV-1a hash of preceding part of line.
+  Records are appended and flushed to disk before corresponding file is
+  modified. Hence journal may mention files which were never created but
+  never misses existing ones. Readers must verify files mentioned in
+  records. Record which fails checksum (e.g. partially written one joined
+  with following record) makes journal unusable and control directory is
+  scanned instead.
+  Journal is shared among all processes using control directory and
+  protected by flock() for compaction.
+*/
+
+extern const char * const journal_file_name;
+
+const char journal_rec_state = 'S';
+const char journal_rec_mark = 'M';
+
+// Append record to journal in control directory. Returns false if
+// journal could not be written. Failure is not fatal - journal will be
+// rebuilt by directory scanning on next A-REX start.
+bool job_journal_append(const GMConfig &config,char type,const JobId &id,const std::string &value);
+
+/// Reader of control directory journal. Keeps position of last processed
+/// record and latest known location of every job which is not finished.
+class ControlFileJournal {
+ public:
+  struct Record {
+    char type;
+    JobId id;
+    std::string value;
+  };
+
+  ControlFileJournal(const GMConfig& config);
+  ~ControlFileJournal();
+
+  /// Returns true if journal was successfully loaded and can be used
+  /// instead of scanning control directory.
+  operator bool() const { return valid; };
+  bool operator!() const { return !valid; };
+
+  /// Read all records from beginning of journal and fill location of jobs.
+  /// Incomplete record at end of journal left by interrupted append is
+  /// removed. Returns false if journal does not exist, can't be read or
+  /// contains broken records.
+  bool Load();
+
+  /// Read records appended since last call. Locations of jobs are updated
+  /// and records are also passed to caller. Returns false and makes
+  /// journal unusable if broken record is found.
+  bool ReadNew(std::list<Record>& records);
+
+  /// Set location of job explicitly. Used while rebuilding journal from
+  /// directory scan and while moving files on restart.
+  void SetLocation(const JobId& id, const std::string& subdir);
+
+  /// Latest known locations of jobs which are not finished.
+  const std::map<JobId,std::string>& Locations() const { return locations; };
+
+  /// Rewrite journal to contain only state records for jobs which are not
+  /// finished. Records appended concurrently by other processes are
+  /// processed first and returned in records.
+  bool Compact(std::list<Record>& records);
+
+  /// Returns true if journal grew enough to be worth compacting.
+  bool NeedsCompact() const;
+
+ private:
+  const GMConfig& config;
+  std::string fname;
+  bool valid;
+  // Offset of first unprocessed byte
+  off_t offset;
+  // Identifier of journal file to detect replacement by other process
+  dev_t file_dev;
+  ino_t file_ino;
+  // Latest known location of jobs which are not finished
+  std::map<JobId,std::string> locations;
+
+  bool ReadRecords(int h, std::list<Record>& records);
+  void Apply(const Record& rec);
+};
+
+} // namespace ARex
+
+#endif
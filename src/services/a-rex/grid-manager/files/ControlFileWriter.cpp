@@ -0,0 +1,181 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <set>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <cstdio>
+
+#include <glibmm/fileutils.h>
+#include <glibmm/miscutils.h>
+
+#include <arc/Logger.h>
+#include <arc/Utils.h>
+
+#include "ControlFileWriter.h"
+
+namespace ARex {
+
+static Arc::Logger& logger = Arc::Logger::getRootLogger();
+
+static bool write_all(int h, const std::string& content) {
+  std::string::size_type p = 0;
+  while(p < content.length()) {
+    ssize_t l = ::write(h, content.c_str()+p, content.length()-p);
+    if(l < 0) {
+      if(errno == EINTR) continue;
+      return false;
+    };
+    p += l;
+  };
+  return true;
+}
+
+ControlFileWriter::ControlFileWriter(unsigned int max):batch_max(max) {
+  if(batch_max < 1) batch_max = 1;
+}
+
+ControlFileWriter::~ControlFileWriter() {
+  Flush();
+}
+
+bool ControlFileWriter::Put(const JobId& id, const std::string& fname, const std::string& content,
+                            uid_t uid, gid_t gid, mode_t mode,
+                            const std::list<std::string>& obsolete, bool sync) {
+  unsigned int size = 0;
+  {
+    Glib::Mutex::Lock lock_(lock);
+    // Newer update replaces queued one. Obsolete files of replaced update
+    // are either still obsolete or are new file itself.
+    Update& update = queued[id];
+    update.fname = fname;
+    update.content = content;
+    update.uid = uid;
+    update.gid = gid;
+    update.mode = mode;
+    update.t = time(NULL);
+    update.obsolete = obsolete;
+    size = queued.size();
+  };
+  if(sync || (size >= batch_max)) return Flush();
+  return true;
+}
+
+bool ControlFileWriter::Get(const JobId& id, std::string& content, time_t* t) const {
+  Glib::Mutex::Lock lock_(lock);
+  std::map<JobId,Update>::const_iterator update = queued.find(id);
+  if(update == queued.end()) {
+    update = flushing.find(id);
+    if(update == flushing.end()) return false;
+  };
+  content = update->second.content;
+  if(t) *t = update->second.t;
+  return true;
+}
+
+void ControlFileWriter::Discard(const JobId& id) {
+  // Waiting for running flush ensures discarded file is not stored afterwards
+  Glib::Mutex::Lock flock(flush_lock);
+  Glib::Mutex::Lock lock_(lock);
+  queued.erase(id);
+}
+
+unsigned int ControlFileWriter::Size() const {
+  Glib::Mutex::Lock lock_(lock);
+  return queued.size();
+}
+
+bool ControlFileWriter::Flush(unsigned int& count) {
+  count = 0;
+  Glib::Mutex::Lock flock(flush_lock);
+  {
+    Glib::Mutex::Lock lock_(lock);
+    if(queued.empty()) return true;
+    flushing.swap(queued);
+  };
+  bool result = true;
+  // Stage 1 - write content into temporary files
+  std::map<JobId,std::string> tmpnames;
+  int synch = -1;
+  for(std::map<JobId,Update>::iterator update = flushing.begin(); update != flushing.end(); ++update) {
+    std::string tmpname = update->second.fname + ".XXXXXX";
+    int h = Glib::mkstemp(tmpname);
+    if(h == -1) {
+      logger.msg(Arc::ERROR, "Failed to create file %s: %s", tmpname, Arc::StrError(errno));
+      result = false;
+      continue;
+    };
+    bool r = write_all(h, update->second.content);
+    if(r && (getuid() == 0)) r = (::fchown(h, update->second.uid, update->second.gid) == 0);
+    if(r) r = (::fchmod(h, update->second.mode) == 0);
+#ifndef __linux__
+    if(r) r = (::fsync(h) == 0);
+#endif
+    if(!r) {
+      logger.msg(Arc::ERROR, "Failed to write file %s: %s", tmpname, Arc::StrError(errno));
+      ::close(h);
+      ::unlink(tmpname.c_str());
+      result = false;
+      continue;
+    };
+    // One descriptor is kept open for synchronizing whole filesystem
+    if(synch == -1) { synch = h; } else { ::close(h); };
+    tmpnames[update->first] = tmpname;
+  };
+  // Stage 2 - make all new files durable at once
+#ifdef __linux__
+  if(synch != -1) {
+    if(::syncfs(synch) != 0) {
+      logger.msg(Arc::WARNING, "Failed to synchronize control directory: %s", Arc::StrError(errno));
+    };
+  };
+#endif
+  if(synch != -1) ::close(synch);
+  // Stage 3 - replace files and make renames durable
+  std::set<std::string> dirs;
+  std::list<JobId> failed;
+  for(std::map<JobId,std::string>::iterator tmpname = tmpnames.begin(); tmpname != tmpnames.end(); ++tmpname) {
+    Update& update = flushing[tmpname->first];
+    if(::rename(tmpname->second.c_str(), update.fname.c_str()) != 0) {
+      logger.msg(Arc::ERROR, "Failed to rename file %s: %s", tmpname->second, Arc::StrError(errno));
+      ::unlink(tmpname->second.c_str());
+      result = false;
+      failed.push_back(tmpname->first);
+      continue;
+    };
+    dirs.insert(Glib::path_get_dirname(update.fname));
+    ++count;
+  };
+  for(std::list<JobId>::iterator id = failed.begin(); id != failed.end(); ++id) tmpnames.erase(*id);
+  for(std::set<std::string>::iterator dir = dirs.begin(); dir != dirs.end(); ++dir) {
+    int h = ::open(dir->c_str(), O_RDONLY);
+    if(h == -1) continue;
+    (void)::fsync(h);
+    ::close(h);
+  };
+  // Stage 4 - only now old copies can be removed
+  for(std::map<JobId,std::string>::iterator tmpname = tmpnames.begin(); tmpname != tmpnames.end(); ++tmpname) {
+    Update& update = flushing[tmpname->first];
+    for(std::list<std::string>::iterator fname = update.obsolete.begin(); fname != update.obsolete.end(); ++fname) {
+      if(*fname != update.fname) ::remove(fname->c_str());
+    };
+  };
+  Glib::Mutex::Lock lock_(lock);
+  if(!result) {
+    // Failed updates are retried on next flush unless superseded
+    for(std::map<JobId,Update>::iterator update = flushing.begin(); update != flushing.end(); ++update) {
+      if(tmpnames.find(update->first) != tmpnames.end()) continue;
+      if(queued.find(update->first) != queued.end()) continue;
+      queued[update->first] = update->second;
+    };
+  };
+  flushing.clear();
+  return result;
+}
+
+} // namespace ARex
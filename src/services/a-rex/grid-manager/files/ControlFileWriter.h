@@ -0,0 +1,86 @@
+#ifndef GRID_MANAGER_CONTROL_FILE_WRITER_H
+#define GRID_MANAGER_CONTROL_FILE_WRITER_H
+
+#include <string>
+#include <list>
+#include <map>
+
+#include <sys/types.h>
+
+#include <arc/Thread.h>
+
+#include "../jobs/GMJob.h"
+
+namespace ARex {
+
+/*
+  Write-behind queue for job status files in control directory.
+  Updates are kept in memory and coalesced per job - only latest content
+  of status file of every job is written. Queued files are written by
+  Flush() as one group: all new files are created under temporary names,
+  made durable with single filesystem synchronization, renamed into place
+  and only after that copies in other subdirectories are removed. Hence
+  after crash status file of job is either previous or new one but never
+  missing or partially written.
+  Readers of status files must consult queue first because it holds
+  content newer than that on disk.
+*/
+class ControlFileWriter {
+ public:
+  /// Creates queue which is flushed automatically once it holds
+  /// batch_max updates.
+  ControlFileWriter(unsigned int batch_max);
+  /// Flushes remaining updates.
+  ~ControlFileWriter();
+
+  /// Queue new content of file fname belonging to job id. Files listed in
+  /// obsolete are removed after new file is stored. If sync is true the
+  /// queue is flushed immediately and result of flushing is returned.
+  bool Put(const JobId& id, const std::string& fname, const std::string& content,
+           uid_t uid, gid_t gid, mode_t mode,
+           const std::list<std::string>& obsolete, bool sync = false);
+
+  /// Fetch content of file queued for job id. Returns false if nothing is
+  /// queued. If t is not NULL it is filled with time of update.
+  bool Get(const JobId& id, std::string& content, time_t* t = NULL) const;
+
+  /// Drop queued update for job id. Used when job files are removed.
+  void Discard(const JobId& id);
+
+  /// Write all queued updates to disk. Returns false if any of files
+  /// failed to be stored. Number of stored files is returned in count.
+  bool Flush(unsigned int& count);
+  bool Flush() { unsigned int count; return Flush(count); };
+
+  /// Number of updates waiting in queue.
+  unsigned int Size() const;
+
+ private:
+  struct Update {
+    std::string fname;
+    std::string content;
+    uid_t uid;
+    gid_t gid;
+    mode_t mode;
+    time_t t;
+    std::list<std::string> obsolete;
+  };
+
+  unsigned int batch_max;
+  // Protects queued and flushing
+  mutable Glib::Mutex lock;
+  // Serializes flushes so that older content never overwrites newer one
+  Glib::Mutex flush_lock;
+  // Updates waiting for next flush
+  std::map<JobId,Update> queued;
+  // Updates being written by current flush. Kept for readers until
+  // files are renamed into place.
+  std::map<JobId,Update> flushing;
+
+  ControlFileWriter(ControlFileWriter const&);
+  ControlFileWriter& operator=(ControlFileWriter const&);
+};
+
+} // namespace ARex
+
+#endif
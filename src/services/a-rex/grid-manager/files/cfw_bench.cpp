@@ -0,0 +1,101 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+// Measures rate of job status file updates in control directory.
+// Every pass changes state of every job once, same as one processing
+// pass of A-REX under burst of state transitions. Last pass moves jobs
+// into finished subdirectory. With batch size 0 files are written
+// directly one by one, otherwise through ControlFileWriter which is
+// flushed at end of every pass like A-REX does.
+
+#include <cstdlib>
+#include <cstdio>
+#include <iostream>
+#include <list>
+#include <string>
+
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+
+#include <arc/FileUtils.h>
+#include <arc/Logger.h>
+#include <arc/StringConv.h>
+
+#include "ControlFileWriter.h"
+
+static double now(void) {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+static void usage(const char* name) {
+  std::cerr << "Usage: " << name << " [-n jobs] [-p passes] [-b batch size] directory" << std::endl;
+}
+
+int main(int argc, char **argv) {
+  int jobs = 1000;
+  int passes = 5;
+  int batch = 0;
+  int opt;
+  while ((opt = getopt(argc, argv, "n:p:b:h")) != -1) {
+    switch (opt) {
+      case 'n': jobs = atoi(optarg); break;
+      case 'p': passes = atoi(optarg); break;
+      case 'b': batch = atoi(optarg); break;
+      default: usage(argv[0]); return EXIT_FAILURE;
+    }
+  }
+  if ((argc - optind) != 1 || jobs <= 0 || passes <= 0 || batch < 0) {
+    usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  Arc::LogStream logcerr(std::cerr);
+  Arc::Logger::getRootLogger().addDestination(logcerr);
+  Arc::Logger::getRootLogger().setThreshold(Arc::WARNING);
+
+  std::string cur_dir = std::string(argv[optind]) + "/processing";
+  std::string old_dir = std::string(argv[optind]) + "/finished";
+  if (!Arc::DirCreate(cur_dir, S_IRWXU, true) || !Arc::DirCreate(old_dir, S_IRWXU, true)) {
+    std::cerr << "Failed to create subdirectories in " << argv[optind] << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  ARex::ControlFileWriter* writer = NULL;
+  if (batch > 0) writer = new ARex::ControlFileWriter(batch);
+
+  // Unique prefix allows running benchmark repeatedly in same directory
+  std::string prefix = Arc::tostring(getpid()) + "-" + Arc::tostring(time(NULL)) + "-";
+  int updates = 0;
+  int failed = 0;
+  double start = now();
+  for (int p = 0; p < passes; ++p) {
+    bool last = (p == (passes - 1));
+    std::string content = last ? "FINISHED" : ("STATE" + Arc::tostring(p));
+    for (int n = 0; n < jobs; ++n) {
+      std::string id = prefix + Arc::tostring(n);
+      std::string fname = (last ? old_dir : cur_dir) + "/job." + id + ".status";
+      std::list<std::string> obsolete;
+      if (last) obsolete.push_back(cur_dir + "/job." + id + ".status");
+      if (writer) {
+        if (!writer->Put(id, fname, content, getuid(), getgid(), S_IRUSR | S_IWUSR, obsolete)) ++failed;
+      } else {
+        for (std::list<std::string>::iterator o = obsolete.begin(); o != obsolete.end(); ++o) remove(o->c_str());
+        if (!Arc::FileCreate(fname, content)) ++failed;
+      }
+      ++updates;
+    }
+    if (writer && !writer->Flush()) ++failed;
+  }
+  double elapsed = now() - start;
+  delete writer;
+
+  std::cout << "Jobs: " << jobs << ", updates: " << updates << " in " << elapsed << " s";
+  if (elapsed > 0) std::cout << " (" << (updates / elapsed) << " per second)";
+  std::cout << std::endl;
+  std::cout << "Failed updates: " << failed << std::endl;
+  return (failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -71,6 +71,9 @@ GMJob::GMJob(void) {
   child=NULL;
   local=NULL;
   start_time=time(NULL);
+  reserved_accepted=false;
+  reserved_running=false;
+  reserved_dn=false;
   ref_count = 0;
   queue = NULL;
 }
@@ -87,6 +90,9 @@ GMJob::GMJob(const JobId &id,const Arc::User& u,const std::string &dir,job_state
   user=u;
   transfer_share=JobLocalDescription::transfersharedefault;
   start_time=time(NULL);
+  reserved_accepted=false;
+  reserved_running=false;
+  reserved_dn=false;
   ref_count = 0;
   queue = NULL;
 }
@@ -69,6 +69,12 @@ class GMJob {
   std::string transfer_share;
   // Start time of job i.e. when it first moves to PREPARING
   time_t start_time;
+  // Slots of job limits taken by JobsList while job changes state.
+  // Given back after job is accounted in counters.
+  bool reserved_accepted;
+  bool reserved_running;
+  bool reserved_dn;
+  std::string reserved_dn_name;
 
   struct job_state_rec_t {
     const char* name;
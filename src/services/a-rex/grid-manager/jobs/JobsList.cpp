@@ -10,6 +10,7 @@
 #include <arc/credential/VOMSUtil.h>
 
 #include "../files/ControlFileHandling.h"
+#include "../files/ControlFileWriter.h"
 #include "../run/RunParallel.h"
 #include "../mail/send_mail.h"
 #include "../log/JobLog.h"
@@ -22,6 +23,7 @@
 #include "ContinuationPlugins.h"
 #include "DTRGenerator.h"
 #include "JobsList.h"
+#include "JobsSnapshot.h"
 
 namespace ARex {
 
@@ -69,21 +71,22 @@ void JobsList::ExternalHelpers::thread(void) {
 
 JobsList::JobsList(const GMConfig& gmconfig) :
     valid(false),
+    journal(gmconfig), marks_scanned(false),
     jobs_processing(ProcessingQueuePriority, "processing"),
     jobs_attention(AttentionQueuePriority, "attention"),
     jobs_polling(0, "polling"),
     jobs_wait_for_running(WaitQueuePriority, "wait for running"),
     config(gmconfig), staging_config(gmconfig),
     dtr_generator(config, *this),
-    job_desc_handler(config), jobs_pending(0),
-    helpers(config.Helpers(), *this) {
+    job_desc_handler(config),
+    helpers(config.Helpers(), *this), workers(NULL) {
 
   job_slow_polling_last = time(NULL);
   job_slow_polling_dir = NULL;
 
-  for(int n = 0;n<JOB_STATE_NUM;n++) jobs_num[n]=0;
   jobs_scripts = 0;
-  jobs.clear();
+  accepted_reserved = 0;
+  running_reserved = 0;
 
   if(!dtr_generator) {
     logger.msg(Arc::ERROR, "Failed to start data staging threads");
@@ -92,23 +95,28 @@ JobsList::JobsList(const GMConfig& gmconfig) :
 
   helpers.start();
 
+  if(config.ProcessingThreads() > 1) {
+    workers = new ProcessingWorkers(*this, config.ProcessingThreads());
+    if(!workers->start()) {
+      logger.msg(Arc::WARNING, "Failed to start jobs processing threads - processing jobs sequentially");
+      delete workers;
+      workers = NULL;
+    };
+  };
+
   valid = true;
 }
 
 JobsList::~JobsList(void) {
+  delete workers;
 }
 
 GMJobRef JobsList::FindJob(const JobId &id) {
-  Glib::RecMutex::Lock lock(jobs_lock);
-  std::map<JobId,GMJobRef>::iterator ji = jobs.find(id);
-  if(ji == jobs.end()) return GMJobRef();
-  return ji->second;
+  return jobs.Find(id);
 }
 
 bool JobsList::HasJob(const JobId &id) const {
-  Glib::RecMutex::Lock lock(jobs_lock);
-  std::map<JobId,GMJobRef>::const_iterator ji = jobs.find(id);
-  return (ji != jobs.end());
+  return jobs.Has(id);
 }
 
 void JobsList::UpdateJobCredentials(GMJobRef i) {
@@ -128,6 +136,29 @@ void JobsList::UpdateJobCredentials(GMJobRef i) {
   };
 }
 
+void JobsList::UpdateJobSnapshot(GMJobRef i) {
+  JobsSnapshot* snapshot = config.GetJobsSnapshot();
+  if(!snapshot) return;
+  // Job is being cleaned
+  if(i->job_state == JOB_STATE_UNDEFINED) {
+    snapshot->Remove(i->job_id);
+    return;
+  };
+  std::string owner;
+  std::string sessiondir = i->session_dir;
+  std::string failed_state;
+  std::string failed_cause;
+  if(GetLocalDescription(i)) {
+    owner = i->local->DN;
+    if(!i->local->sessiondir.empty()) sessiondir = i->local->sessiondir;
+    failed_state = i->local->failedstate;
+    failed_cause = i->local->failedcause;
+  };
+  // Failure only matters for finished jobs
+  bool failed = (i->job_state == JOB_STATE_FINISHED) && job_failed_mark_check(i->job_id,config);
+  snapshot->Update(i->job_id, owner, sessiondir, i->job_state, i->job_pending, failed, failed_state, failed_cause);
+}
+
 void JobsList::SetJobState(GMJobRef i, job_state_t new_state, const char* reason) {
   if(i) {
     if((i->job_state != new_state) || (i->job_pending)) {
@@ -146,6 +177,7 @@ void JobsList::SetJobState(GMJobRef i, job_state_t new_state, const char* reason
       i->job_state = new_state;
       i->job_pending = false;
       job_errors_mark_add(*i,config,msg);
+      UpdateJobSnapshot(i);
       // During intermediate period job.proxy file must contain full delegated proxy.
       // To ensure its content is up to date even if proxy was updated in store here
       // we update content of that file on every active job state change.
@@ -171,6 +203,7 @@ void JobsList::SetJobPending(GMJobRef i, const char* reason) {
       msg += "\n";
       i->job_pending = true;
       job_errors_mark_add(*i,config,msg);
+      UpdateJobSnapshot(i);
     };
   };
 }
@@ -190,47 +223,44 @@ bool JobsList::AddJob(const JobId &id,uid_t uid,gid_t gid,job_state_t state,cons
       logger.msg(Arc::ERROR, "%s: Failed reading .local and changing state, job and "
                              "A-REX may be left in an inconsistent state", id);
     }
-    Glib::RecMutex::Lock lock(jobs_lock);
-    if(jobs.find(id) != jobs.end()) {
+    if(!jobs.Add(i, i->job_state, i->job_pending)) {
       logger.msg(Arc::ERROR, "%s: unexpected failed job add request: %s", i->job_id, reason?reason:"");
     } else {
-      jobs[id] = i;
       RequestReprocess(i); // To make job being properly thrown from system
     }
     return false;
   }
   i->session_dir = i->local->sessiondir;
   if (i->session_dir.empty()) i->session_dir = config.SessionRoot(id)+'/'+id;
-  Glib::RecMutex::Lock lock(jobs_lock);
-  if(jobs.find(id) != jobs.end()) {
+  if(!jobs.Add(i, i->job_state, i->job_pending)) {
     logger.msg(Arc::ERROR, "%s: unexpected job add request: %s", i->job_id, reason?reason:"");
   } else {
-    jobs[id] = i;
     RequestAttention(i);
   }
   return true;
 }
 
 int JobsList::AcceptedJobs() const {
-  return jobs_num[JOB_STATE_ACCEPTED] +
-         jobs_num[JOB_STATE_PREPARING] +
-         jobs_num[JOB_STATE_SUBMITTING] +
-         jobs_num[JOB_STATE_INLRMS] +
-         jobs_num[JOB_STATE_FINISHING] +
-         jobs_pending;
+  return jobs.StateCount(JOB_STATE_ACCEPTED) +
+         jobs.StateCount(JOB_STATE_PREPARING) +
+         jobs.StateCount(JOB_STATE_SUBMITTING) +
+         jobs.StateCount(JOB_STATE_INLRMS) +
+         jobs.StateCount(JOB_STATE_FINISHING) +
+         jobs.PendingCount();
 }
 
 bool JobsList::RunningJobsLimitReached() const {
   if(config.MaxRunning()==-1) return false;
-  int num = jobs_num[JOB_STATE_SUBMITTING] +
-            jobs_num[JOB_STATE_INLRMS];
+  int num = jobs.StateCount(JOB_STATE_SUBMITTING) +
+            jobs.StateCount(JOB_STATE_INLRMS);
   return num >= config.MaxRunning();
 }
 
 void JobsList::PrepareToDestroy(void) {
-  Glib::RecMutex::Lock lock(jobs_lock);
-  for(std::map<JobId,GMJobRef>::iterator i=jobs.begin();i!=jobs.end();++i) {
-    i->second->PrepareToDestroy();
+  std::list<GMJobRef> alljobs;
+  jobs.List(alljobs);
+  for(std::list<GMJobRef>::iterator i=alljobs.begin();i!=alljobs.end();++i) {
+    (*i)->PrepareToDestroy();
   }
 }
 
@@ -343,11 +373,46 @@ bool JobsList::RequestReprocess(GMJobRef i) {
 }
 
 bool JobsList::ActJobsProcessing(void) {
-  while(true) {
-    GMJobRef i = jobs_processing.Pop();
-    if(!i) break;
-    logger.msg(Arc::DEBUG, "%s: job being processed", i->job_id);
-    ActJob(i);
+  timespec start_time;
+  clock_gettime(CLOCK_MONOTONIC, &start_time);
+  unsigned int processed = 0;
+  if(workers) {
+    processed = workers->process();
+  } else {
+    while(true) {
+      GMJobRef i = jobs_processing.Pop();
+      if(!i) break;
+      logger.msg(Arc::DEBUG, "%s: job being processed", i->job_id);
+      ActJob(i);
+      ++processed;
+    };
+  };
+  if(processed > 0) {
+    Arc::JobPerfLog* perflog = config.GetJobPerfLog();
+    if(perflog && perflog->GetEnabled()) {
+      // Record throughput of processing pass as "jobs/threads"
+      timespec end_time;
+      clock_gettime(CLOCK_MONOTONIC, &end_time);
+      perflog->Log("jobs-processing",
+                   Arc::tostring(processed)+"/"+Arc::tostring(workers?config.ProcessingThreads():1),
+                   start_time, end_time);
+    };
+  };
+  // Store status files changed during this pass together
+  ControlFileWriter* writer = config.GetControlFileWriter();
+  if(writer) {
+    timespec flush_start;
+    clock_gettime(CLOCK_MONOTONIC, &flush_start);
+    unsigned int stored = 0;
+    if(!writer->Flush(stored)) {
+      logger.msg(Arc::ERROR, "Failed to store some job status files");
+    };
+    Arc::JobPerfLog* perflog = config.GetJobPerfLog();
+    if((stored > 0) && perflog && perflog->GetEnabled()) {
+      timespec flush_end;
+      clock_gettime(CLOCK_MONOTONIC, &flush_end);
+      perflog->Log("control-flush", Arc::tostring(stored), flush_start, flush_end);
+    };
   };
   // Check limit on number of running jobs and activate some of them if possible
   if(!RunningJobsLimitReached()) {
@@ -380,10 +445,11 @@ bool JobsList::ActJobsPolling(void) {
   ActJobsProcessing();
   // debug info on jobs per DN
   {
-    Glib::RecMutex::Lock lock(jobs_lock);
+    std::map<std::string, unsigned int> jobs_dn;
+    jobs.ListDN(jobs_dn);
     logger.msg(Arc::VERBOSE, "Current jobs in system (PREPARING to FINISHING) per-DN (%i entries)", jobs_dn.size());
-    for (std::map<std::string, ZeroUInt>::iterator it = jobs_dn.begin(); it != jobs_dn.end(); ++it)
-      logger.msg(Arc::VERBOSE, "%s: %i", it->first, (unsigned int)(it->second));
+    for (std::map<std::string, unsigned int>::iterator it = jobs_dn.begin(); it != jobs_dn.end(); ++it)
+      logger.msg(Arc::VERBOSE, "%s: %i", it->first, it->second);
   };
   return true;
 }
@@ -404,6 +470,9 @@ bool JobsList::FailedJob(GMJobRef i,bool cancel) {
     logger.msg(Arc::ERROR,"%s: Failed reading job description: %s",i->job_id,Arc::StrError(errno));
     r=false;
   }
+  // Job may have been already moved to FINISHED and put into snapshot
+  // before failure mark was written
+  if(i->job_state == JOB_STATE_FINISHED) UpdateJobSnapshot(i);
   // If the job failed during FINISHING then DTR deals with .output
   if (i->get_state() == JOB_STATE_FINISHING) {
     if (i->local) job_local_write_file(*i,config,*(i->local));
@@ -465,8 +534,71 @@ bool JobsList::GetLocalDescription(GMJobRef i) const {
 void JobsList::CleanChildProcess(GMJobRef i) {
   if(i->child) {
     delete i->child; i->child=NULL;
-    if((i->job_state == JOB_STATE_SUBMITTING) || (i->job_state == JOB_STATE_CANCELING)) --jobs_scripts;
+    if((i->job_state == JOB_STATE_SUBMITTING) || (i->job_state == JOB_STATE_CANCELING)) ReleaseScript();
+  }
+}
+
+bool JobsList::ReserveScript(void) {
+  int max_scripts = config.MaxScripts();
+  // Jobs are processed by multiple threads - check and increment must be one operation
+  while(true) {
+    gint scripts = g_atomic_int_get(&jobs_scripts);
+    if((max_scripts != -1) && (scripts >= max_scripts)) return false;
+    if(g_atomic_int_compare_and_exchange(&jobs_scripts, scripts, scripts+1)) return true;
+  }
+}
+
+void JobsList::ReleaseScript(void) {
+  g_atomic_int_add(&jobs_scripts, -1);
+}
+
+bool JobsList::ReserveAccepted(GMJobRef i) {
+  if(config.MaxJobs() == -1) return true;
+  Glib::Mutex::Lock lock(limits_lock);
+  if((AcceptedJobs() + accepted_reserved) >= config.MaxJobs()) return false;
+  ++accepted_reserved;
+  i->reserved_accepted = true;
+  return true;
+}
+
+bool JobsList::ReserveRunning(GMJobRef i) {
+  if(config.MaxRunning() == -1) return true;
+  Glib::Mutex::Lock lock(limits_lock);
+  int num = jobs.StateCount(JOB_STATE_SUBMITTING) +
+            jobs.StateCount(JOB_STATE_INLRMS) + running_reserved;
+  if(num >= config.MaxRunning()) return false;
+  ++running_reserved;
+  i->reserved_running = true;
+  return true;
+}
+
+bool JobsList::ReserveDN(GMJobRef i, const std::string& dn) {
+  if(config.MaxPerDN() <= 0) return true;
+  Glib::Mutex::Lock lock(limits_lock);
+  int& reserved = dn_reserved[dn];
+  if((jobs.CountDN(dn) + reserved) >= (unsigned int)config.MaxPerDN()) {
+    if(reserved == 0) dn_reserved.erase(dn);
+    return false;
+  }
+  ++reserved;
+  i->reserved_dn = true;
+  i->reserved_dn_name = dn;
+  return true;
+}
+
+void JobsList::ReleaseLimits(GMJobRef i) {
+  if(!(i->reserved_accepted || i->reserved_running || i->reserved_dn)) return;
+  Glib::Mutex::Lock lock(limits_lock);
+  if(i->reserved_accepted) --accepted_reserved;
+  if(i->reserved_running) --running_reserved;
+  if(i->reserved_dn) {
+    std::map<std::string,int>::iterator reserved = dn_reserved.find(i->reserved_dn_name);
+    if((reserved != dn_reserved.end()) && (--(reserved->second) <= 0)) dn_reserved.erase(reserved);
   }
+  i->reserved_accepted = false;
+  i->reserved_running = false;
+  i->reserved_dn = false;
+  i->reserved_dn_name.clear();
 }
 
 bool JobsList::state_submitting_success(GMJobRef i,bool &state_changed,std::string local_id) {
@@ -499,7 +631,7 @@ bool JobsList::state_submitting_success(GMJobRef i,bool &state_changed,std::stri
 bool JobsList::state_submitting(GMJobRef i,bool &state_changed) {
   if(i->child == NULL) {
     // no child was running yet, or recovering from fault
-    if((config.MaxScripts()!=-1) && (jobs_scripts>=config.MaxScripts())) {
+    if((config.MaxScripts()!=-1) && (g_atomic_int_get(&jobs_scripts)>=config.MaxScripts())) {
       //logger.msg(Arc::WARNING,"%s: Too many LRMS scripts running - limit is %u",
       //                     i->job_id,config.MaxScripts());
       // returning true but not advancing to next state should cause retry
@@ -536,13 +668,17 @@ bool JobsList::state_submitting(GMJobRef i,bool &state_changed) {
     std::string grami = config.ControlDir()+"/job."+(*i).job_id+".grami";
     cmd += " --config " + config.ConfigFile() + " " + grami;
     job_errors_mark_put(*i,config);
+    if(!ReserveScript()) {
+      // limit was reached by other thread meanwhile - retry later
+      return true;
+    }
     if(!RunParallel::run(config,*i,*this,cmd,&(i->child))) {
+      ReleaseScript();
       i->AddFailure("Failed initiating job submission to LRMS");
       logger.msg(Arc::ERROR,"%s: Failed running submission process",i->job_id);
       return false;
     }
-    ++jobs_scripts;
-    if((config.MaxScripts()!=-1) && (jobs_scripts>=config.MaxScripts())) {
+    if((config.MaxScripts()!=-1) && (g_atomic_int_get(&jobs_scripts)>=config.MaxScripts())) {
       logger.msg(Arc::WARNING,"%s: LRMS scripts limit of %u is reached - suspending submit/cancel",
                               i->job_id,config.MaxScripts());
     }
@@ -615,7 +751,7 @@ bool JobsList::state_canceling_success(GMJobRef i,bool &state_changed) {
 bool JobsList::state_canceling(GMJobRef i,bool &state_changed) {
   if(i->child == NULL) {
     // no child was running yet, or recovering from fault
-    if((config.MaxScripts()!=-1) && (jobs_scripts>=config.MaxScripts())) {
+    if((config.MaxScripts()!=-1) && (g_atomic_int_get(&jobs_scripts)>=config.MaxScripts())) {
       //logger.msg(Arc::WARNING,"%s: Too many LRMS scripts running - limit is %u",
       //                     i->job_id,config.MaxScripts());
       // returning true but not advancing to next state should cause retry
@@ -640,12 +776,16 @@ bool JobsList::state_canceling(GMJobRef i,bool &state_changed) {
     std::string grami = config.ControlDir()+"/job."+(*i).job_id+".grami";
     cmd += " --config " + config.ConfigFile() + " " + grami;
     job_errors_mark_put(*i,config);
+    if(!ReserveScript()) {
+      // limit was reached by other thread meanwhile - retry later
+      return true;
+    }
     if(!RunParallel::run(config,*i,*this,cmd,&(i->child))) {
+      ReleaseScript();
       logger.msg(Arc::ERROR,"%s: Failed running cancellation process",i->job_id);
       return false;
     }
-    ++jobs_scripts;
-    if((config.MaxScripts()!=-1) && (jobs_scripts>=config.MaxScripts())) {
+    if((config.MaxScripts()!=-1) && (g_atomic_int_get(&jobs_scripts)>=config.MaxScripts())) {
       logger.msg(Arc::WARNING,"%s: LRMS scripts limit of %u is reached - suspending submit/cancel",
                            i->job_id,config.MaxScripts());
     }
@@ -871,7 +1011,7 @@ JobsList::ActJobResult JobsList::ActJobUndefined(GMJobRef i) {
   ActJobResult job_result = JobDropped;
   // new job - read its status from status file, but first check if it is
   // under the limit of maximum jobs allowed in the system
-  if((AcceptedJobs() < config.MaxJobs()) || (config.MaxJobs() == -1)) {
+  if(ReserveAccepted(i)) {
     bool new_pending = false;
     job_state_t new_state=job_state_read_file(i->job_id,config,new_pending);
     if(new_state == JOB_STATE_UNDEFINED) { // something failed
@@ -971,11 +1111,7 @@ JobsList::ActJobResult JobsList::ActJobAccepted(GMJobRef i) {
 
 
   if (config.MaxPerDN() > 0) {
-    bool limited = false;
-    {
-      Glib::RecMutex::Lock lock(jobs_lock);
-      limited = (jobs_dn[i->local->DN] >= config.MaxPerDN());
-    }
+    bool limited = !ReserveDN(i, i->local->DN);
     if (limited) {
       SetJobPending(i,"Jobs per DN limit is reached");
       // Because we have no event for per-DN limit just do polling
@@ -1042,7 +1178,7 @@ JobsList::ActJobResult JobsList::ActJobPreparing(GMJobRef i) {
         // RequestPolling(i);
       } else if(i->local->exec.size() > 0 && !i->local->exec.front().empty()) {
         // Job has executable
-        if(!RunningJobsLimitReached()) {
+        if(ReserveRunning(i)) {
           // And limit of running jobs is not reached
           SetJobState(i, JOB_STATE_SUBMITTING, "Pre-staging finished, passing job to LRMS");
           RequestReprocess(i); // act on new state immediately
@@ -1364,16 +1500,7 @@ bool JobsList::CheckJobContinuePlugins(GMJobRef i) {
 bool JobsList::NextJob(GMJobRef i, job_state_t old_state, bool old_pending) {
   bool at_limit = RunningJobsLimitReached();
   // update counters
-  if(!old_pending) {
-    jobs_num[old_state]--;
-  } else {
-    jobs_pending--;
-  }
-  if(!i->job_pending) {
-    jobs_num[i->job_state]++;
-  } else {
-    jobs_pending++;
-  }
+  jobs.Update(i->job_id, i->job_state, i->job_pending);
   if(at_limit && !RunningJobsLimitReached()) {
     // Report about change in conditions
     //RequestAttention();
@@ -1383,20 +1510,12 @@ bool JobsList::NextJob(GMJobRef i, job_state_t old_state, bool old_pending) {
 
 bool JobsList::DropJob(GMJobRef& i, job_state_t old_state, bool old_pending) {
   bool at_limit = RunningJobsLimitReached();
-  // update counters
-  if(!old_pending) {
-    jobs_num[old_state]--;
-  } else {
-    jobs_pending--;
-  }
+  // update counters and forget job
+  jobs.Remove(i->job_id);
   if(at_limit && !RunningJobsLimitReached()) {
     // Report about change in conditions
     RequestAttention(); // TODO: Check if really needed
   };
-  {
-    Glib::RecMutex::Lock lock(jobs_lock);
-    jobs.erase(i->job_id);
-  };
   i.Destroy();
   return true;
 }
@@ -1509,15 +1628,13 @@ bool JobsList::ActJob(GMJobRef& i) {
           if (i->local->DN.empty()) {
              logger.msg(Arc::WARNING, "Failed to get DN information from .local file for job %s", i->job_id);
           }
-          Glib::RecMutex::Lock lock(jobs_lock);
-          ++(jobs_dn[i->local->DN]);
+          jobs.IncreaseDN(i->local->DN);
         };
       };
     } else if(IS_ACTIVE_STATE(old_state)) {
       if(!IS_ACTIVE_STATE(i->job_state)) {
         if(i->GetLocalDescription(config)) {
-          Glib::RecMutex::Lock lock(jobs_lock);
-          if (--(jobs_dn[i->local->DN]) == 0) jobs_dn.erase(i->local->DN);
+          jobs.DecreaseDN(i->local->DN);
         };
       };
     };
@@ -1557,10 +1674,13 @@ bool JobsList::ActJob(GMJobRef& i) {
      (i->job_state == JOB_STATE_UNDEFINED)) {
     // Such jobs are not kept in memory
     // this is the ONLY place where jobs are removed from memory
+    ReleaseLimits(i);
     DropJob(i, old_state, old_pending);
   }
   else {
     NextJob(i, old_state, old_pending);
+    // Now job is accounted in counters according to its new state
+    ReleaseLimits(i);
   }
 
   return true;
@@ -1639,13 +1759,119 @@ bool JobsList::RestartJobs(const std::string& cdir,const std::string& odir) {
 // This code is run at service restart
 bool JobsList::RestartJobs(void) {
   std::string cdir=config.ControlDir();
+  if(journal.Load()) {
+    logger.msg(Arc::INFO, "Using control directory journal to restart jobs");
+    return RestartJournalJobs();
+  };
+  logger.msg(Arc::INFO, "No usable control directory journal found - scanning control directory");
+  std::list<ControlFileJournal::Record> records;
+  // Start new journal before scanning so that no changes are lost
+  if(!journal.Compact(records)) {
+    logger.msg(Arc::WARNING, "Failed to create control directory journal - control directory will be scanned");
+  };
   // Jobs from old version
   bool res1 = RestartJobs(cdir,cdir+"/"+subdir_rew);
   // Jobs after service restart
   bool res2 = RestartJobs(cdir+"/"+subdir_cur,cdir+"/"+subdir_rew);
+  if(journal) {
+    class JobFilterNoSkip: public JobFilter {
+    public:
+      JobFilterNoSkip() {};
+      virtual ~JobFilterNoSkip() {};
+      virtual bool accept(JobId const& id) const { return true; };
+    };
+    // Fill journal with jobs which are not finished
+    std::list<JobFDesc> ids;
+    ScanAllJobs(cdir+"/"+subdir_rew,ids,JobFilterNoSkip());
+    for(std::list<JobFDesc>::iterator id=ids.begin();id!=ids.end();++id) journal.SetLocation(id->id,subdir_rew);
+    ids.clear();
+    ScanAllJobs(cdir+"/"+subdir_new,ids,JobFilterNoSkip());
+    for(std::list<JobFDesc>::iterator id=ids.begin();id!=ids.end();++id) journal.SetLocation(id->id,subdir_new);
+    if(!journal.Compact(records)) {
+      logger.msg(Arc::WARNING, "Failed to write control directory journal - control directory will be scanned");
+    };
+    ProcessJournalRecords(records);
+    time_t now = time(NULL);
+    for(std::map<JobId,std::string>::const_iterator loc = journal.Locations().begin();
+                                      loc != journal.Locations().end(); ++loc) {
+      if((loc->second == subdir_new) || (loc->second == subdir_rew)) journal_new_jobs[loc->first] = now;
+    };
+  };
   return res1 && res2;
 }
 
+bool JobsList::RestartJournalJobs(void) {
+  std::string cdir=config.ControlDir();
+  bool res = true;
+  // Copy because journal is modified while moving files
+  std::map<JobId,std::string> locations = journal.Locations();
+  for(std::map<JobId,std::string>::iterator loc = locations.begin(); loc != locations.end(); ++loc) {
+    std::string fname = cdir + ((loc->second == ".") ? std::string("") : ("/"+loc->second)) + "/job." + loc->first + ".status";
+    uid_t uid;
+    gid_t gid;
+    time_t t;
+    if(!check_file_owner(fname,uid,gid,t)) {
+      // Journal is ahead of files if A-REX stopped while changing state. Find real location.
+      std::string subdirs[] = { subdir_new, subdir_cur, subdir_rew, subdir_old };
+      loc->second = "-";
+      for(unsigned int n = 0; n < sizeof(subdirs)/sizeof(subdirs[0]); ++n) {
+        fname = cdir + "/" + subdirs[n] + "/job." + loc->first + ".status";
+        if(check_file_owner(fname,uid,gid,t)) { loc->second = subdirs[n]; break; };
+      };
+      journal.SetLocation(loc->first, loc->second);
+    };
+    if((loc->second != subdir_cur) && (loc->second != ".")) continue;
+    std::string oname = cdir + "/" + subdir_rew + "/job." + loc->first + ".status";
+    (void)job_journal_append(config,journal_rec_state,loc->first,subdir_rew);
+    if(::rename(fname.c_str(),oname.c_str()) != 0) {
+      logger.msg(Arc::ERROR,"Failed to move file %s to %s",fname,oname);
+      res=false;
+      continue;
+    };
+    loc->second = subdir_rew;
+    journal.SetLocation(loc->first, subdir_rew);
+  };
+  std::list<ControlFileJournal::Record> records;
+  if(!journal.Compact(records)) {
+    logger.msg(Arc::WARNING, "Failed to compact control directory journal");
+  };
+  ProcessJournalRecords(records);
+  // All jobs waiting in accepting and restarting are candidates for picking up
+  time_t now = time(NULL);
+  for(std::map<JobId,std::string>::const_iterator loc = journal.Locations().begin();
+                                    loc != journal.Locations().end(); ++loc) {
+    if((loc->second == subdir_new) || (loc->second == subdir_rew)) journal_new_jobs[loc->first] = now;
+  };
+  return res;
+}
+
+void JobsList::ProcessJournalRecords(std::list<ControlFileJournal::Record> const& records) {
+  time_t now = time(NULL);
+  for(std::list<ControlFileJournal::Record>::const_iterator rec = records.begin(); rec != records.end(); ++rec) {
+    if(rec->type == journal_rec_state) {
+      if((rec->value == subdir_new) || (rec->value == subdir_rew)) {
+        if(journal_new_jobs.find(rec->id) == journal_new_jobs.end()) journal_new_jobs[rec->id] = now;
+      };
+    } else if(rec->type == journal_rec_mark) {
+      if(journal_marks.find(rec->id) == journal_marks.end()) journal_marks[rec->id] = now;
+    };
+  };
+}
+
+void JobsList::ProcessJournal(void) {
+  if(!journal) return;
+  std::list<ControlFileJournal::Record> records;
+  if(!journal.ReadNew(records)) {
+    logger.msg(Arc::WARNING, "Control directory journal is not usable anymore - scanning control directory");
+    return;
+  };
+  ProcessJournalRecords(records);
+  if(journal.NeedsCompact()) {
+    records.clear();
+    if(journal.Compact(records)) ProcessJournalRecords(records);
+  };
+}
+
 bool JobsList::ScanJobDesc(const std::string& cdir, JobFDesc& id) {
   if(!FindJob(id.id)) {
     std::string fname=cdir+'/'+"job."+id.id+".status";
@@ -1772,8 +1998,52 @@ bool JobsList::ScanOldJob(const JobId& id) {
   return false;
 }
 
+// Journal may be updated before corresponding file is created.
+// So missing files are not dropped immediately.
+#define JOURNAL_MISSING_FILE_GRACE (60)
+
+bool JobsList::ScanNewJournalJobs(void) {
+  Arc::JobPerfRecord perfrecord(*config.GetJobPerfLog(), "*");
+  std::string cdir=config.ControlDir();
+  time_t now = time(NULL);
+  std::list<JobFDesc> rew_ids;
+  std::list<JobFDesc> new_ids;
+  for(std::map<JobId,time_t>::iterator id = journal_new_jobs.begin(); id != journal_new_jobs.end();) {
+    std::map<JobId,std::string>::const_iterator loc = journal.Locations().find(id->first);
+    if((loc == journal.Locations().end()) || HasJob(id->first) ||
+       ((loc->second != subdir_rew) && (loc->second != subdir_new))) {
+      // Not new anymore or already being handled
+      journal_new_jobs.erase(id++);
+      continue;
+    };
+    JobFDesc fid(id->first);
+    if(ScanJobDesc(cdir+"/"+loc->second,fid)) {
+      if(loc->second == subdir_rew) rew_ids.push_back(fid); else new_ids.push_back(fid);
+    } else if((now - id->second) > JOURNAL_MISSING_FILE_GRACE) {
+      journal_new_jobs.erase(id++);
+      continue;
+    };
+    ++id;
+  };
+  // Restarting jobs first, then new, sorted by date
+  rew_ids.sort();
+  new_ids.sort();
+  rew_ids.splice(rew_ids.end(), new_ids);
+  for(std::list<JobFDesc>::iterator id=rew_ids.begin();id!=rew_ids.end();++id) {
+    if((config.MaxJobs() != -1) && (AcceptedJobs() >= config.MaxJobs())) break;
+    AddJob(id->id,id->uid,id->gid,"scan for new jobs in journal");
+    journal_new_jobs.erase(id->id);
+  };
+  perfrecord.End("SCAN-JOBS-NEW");
+  return true;
+}
+
 // find new jobs - sort by date to implement FIFO
 bool JobsList::ScanNewJobs(void) {
+  if(journal) {
+    ProcessJournal();
+    if(journal) return ScanNewJournalJobs();
+  };
   Arc::JobPerfRecord perfrecord(*config.GetJobPerfLog(), "*");
   // New jobs will be accepted only if number of jobs being processed
   // does not exceed allowed. So avoid scanning if no jobs will be allowed.
@@ -1807,7 +2077,53 @@ bool JobsList::ScanNewJobs(void) {
   return true;
 }
 
+bool JobsList::ScanNewJournalMarks(void) {
+  Arc::JobPerfRecord perfrecord(*config.GetJobPerfLog(), "*");
+
+  std::string ndir=config.ControlDir()+"/"+subdir_new;
+  time_t now = time(NULL);
+  std::list<JobFDesc> ids;
+  for(std::map<JobId,time_t>::iterator id = journal_marks.begin(); id != journal_marks.end();) {
+    if(HasJob(id->first)) {
+      // Jobs in memory check for marks themselves
+      journal_marks.erase(id++);
+      continue;
+    };
+    bool found = false;
+    const char* sfxs[] = { sfx_clean, sfx_restart, sfx_cancel };
+    for(unsigned int n = 0; n < sizeof(sfxs)/sizeof(sfxs[0]); ++n) {
+      JobFDesc fid(id->first);
+      uid_t uid;
+      gid_t gid;
+      time_t t;
+      if(check_file_owner(ndir+"/job."+id->first+sfxs[n],uid,gid,t)) {
+        fid.uid=uid; fid.gid=gid; fid.t=t;
+        ids.push_back(fid);
+        found = true;
+        break;
+      };
+    };
+    if(found || ((now - id->second) > JOURNAL_MISSING_FILE_GRACE)) {
+      journal_marks.erase(id++);
+      continue;
+    };
+    ++id;
+  };
+  ids.sort();
+  ProcessMarkedJobs(ids);
+
+  perfrecord.End("SCAN-MARKS-NEW");
+  return true;
+}
+
 bool JobsList::ScanNewMarks(void) {
+  // Control directory is scanned at least once because marks could
+  // be created before journal was started.
+  if(journal && marks_scanned) {
+    ProcessJournal();
+    if(journal) return ScanNewJournalMarks();
+  };
+
   Arc::JobPerfRecord perfrecord(*config.GetJobPerfLog(), "*");
 
   std::string cdir=config.ControlDir();
@@ -1818,7 +2134,15 @@ bool JobsList::ScanNewMarks(void) {
   sfx.push_back(sfx_restart);
   sfx.push_back(sfx_cancel);
   if(!ScanMarks(ndir,sfx,ids)) return false;
+  marks_scanned = true;
   ids.sort();
+  ProcessMarkedJobs(ids);
+
+  perfrecord.End("SCAN-MARKS-NEW");
+  return true;
+}
+
+void JobsList::ProcessMarkedJobs(std::list<JobFDesc>& ids) {
   std::string last_id;
   for(std::list<JobFDesc>::iterator id=ids.begin();id!=ids.end();++id) {
     if(id->id == last_id) continue; // already processed
@@ -1836,9 +2160,6 @@ bool JobsList::ScanNewMarks(void) {
       AddJob(id->id,id->uid,id->gid,st,"scan for new jobs in marks");
     }
   }
-
-  perfrecord.End("SCAN-MARKS-NEW");
-  return true;
 }
 
 // For simply collecting all jobs. Only used by gm-jobs.
@@ -2029,4 +2350,87 @@ void JobsList::ExternalHelper::stop() {
 }
 
 
+JobsList::ProcessingWorkers::ProcessingWorkers(JobsList& jobs, int num):
+    jobs_list(jobs), workers_num(num), processing(false), stop_request(false), busy(0), processed(0) {
+}
+
+JobsList::ProcessingWorkers::~ProcessingWorkers() {
+  {
+    Glib::Mutex::Lock lock_(lock);
+    stop_request = true;
+    cond.broadcast();
+  };
+  workers_count.wait();
+}
+
+bool JobsList::ProcessingWorkers::start() {
+  int started = 0;
+  for(int n = 0; n < workers_num; ++n) {
+    if(!Arc::CreateThreadFunction(&worker, this, &workers_count)) {
+      logger.msg(Arc::ERROR, "Failed to start jobs processing thread");
+      break;
+    };
+    ++started;
+  };
+  if(started <= 0) return false;
+  logger.msg(Arc::INFO, "Started %i jobs processing threads", started);
+  return true;
+}
+
+void JobsList::ProcessingWorkers::worker(void* arg) {
+  reinterpret_cast<ProcessingWorkers*>(arg)->work();
+}
+
+unsigned int JobsList::ProcessingWorkers::process() {
+  Glib::Mutex::Lock lock_(lock);
+  processed = 0;
+  processing = true;
+  cond.broadcast();
+  while(!stop_request) {
+    if((busy == 0) && deferred.empty() && jobs_list.jobs_processing.IsEmpty()) break;
+    cond.wait(lock);
+  };
+  processing = false;
+  return processed;
+}
+
+void JobsList::ProcessingWorkers::work() {
+  Glib::Mutex::Lock lock_(lock);
+  while(!stop_request) {
+    if(!processing) {
+      cond.wait(lock);
+      continue;
+    };
+    GMJobRef i = jobs_list.jobs_processing.Pop();
+    if(!i) {
+      // Let controlling thread know queue is exhausted
+      cond.broadcast();
+      cond.wait(lock);
+      continue;
+    };
+    JobId id = i->get_id();
+    if(active.find(id) != active.end()) {
+      // Same job is being processed by other thread. It will pick it up later.
+      deferred[id] = i;
+      continue;
+    };
+    active.insert(id);
+    ++busy;
+    lock_.release();
+    logger.msg(Arc::DEBUG, "%s: job being processed", id);
+    jobs_list.ActJob(i);
+    lock_.acquire();
+    --busy;
+    ++processed;
+    active.erase(id);
+    std::map<JobId,GMJobRef>::iterator d = deferred.find(id);
+    if(d != deferred.end()) {
+      GMJobRef di = d->second;
+      deferred.erase(d);
+      jobs_list.jobs_processing.Push(di);
+    };
+    cond.broadcast();
+  };
+}
+
 } // namespace ARex
@@ -3,42 +3,24 @@
 
 #include <sys/types.h>
 #include <list>
+#include <set>
 #include <glib.h>
 
 #include <arc/Thread.h>
 
 #include "../conf/StagingConfig.h"
+#include "../files/ControlFileJournal.h"
 
 #include "GMJob.h"
 #include "JobDescriptionHandler.h"
 #include "DTRGenerator.h"
+#include "JobsRegistry.h"
 
 namespace ARex {
 
 class JobFDesc;
 class GMConfig;
 
-/// ZeroUInt is a wrapper around unsigned int. It provides a consistent default
-/// value, as int type variables have no predefined value assigned upon
-/// creation. It also protects from potential counter underflow, to stop
-/// counter jumping to MAX_INT. TODO: move to common lib?
-class ZeroUInt {
-private:
- unsigned int value_;
-public:
- ZeroUInt(void):value_(0) { };
- ZeroUInt(unsigned int v):value_(v) { };
- ZeroUInt(const ZeroUInt& v):value_(v.value_) { };
- ZeroUInt& operator=(unsigned int v) { value_=v; return *this; };
- ZeroUInt& operator=(const ZeroUInt& v) { value_=v.value_; return *this; };
- ZeroUInt& operator++(void) { ++value_; return *this; };
- ZeroUInt operator++(int) { ZeroUInt temp(value_); ++value_; return temp; };
- ZeroUInt& operator--(void) { if(value_) --value_; return *this; };
- ZeroUInt operator--(int) { ZeroUInt temp(value_); if(value_) --value_; return temp; };
- operator unsigned int(void) const { return value_; };
-};
-
-
 /// List of jobs. This class contains the main job management logic which moves
 /// jobs through the state machine. New jobs found through Scan methods are
 /// held in memory until reaching FINISHED state.
@@ -46,12 +28,21 @@ class JobsList {
  private:
   bool valid;
 
-  // List of jobs currently tracked in memory conveniently indexed by identifier.
-  // TODO: It would be nice to remove it and use status files distribution among
-  // subfolders in controldir.
-  std::map<JobId,GMJobRef> jobs;         
-
-  mutable Glib::RecMutex jobs_lock;
+  // Jobs currently tracked in memory conveniently indexed by identifier,
+  // state and owner's DN. Also holds counters of jobs per state.
+  JobsRegistry jobs;
+
+  // Journal of changes in control directory. If valid it is used to
+  // detect new jobs and marks instead of scanning control directory.
+  ControlFileJournal journal;
+  // Jobs found in journal to be in accepting or restarting subdirectory
+  // but not yet picked up
+  // (with time when first noticed)
+  std::map<JobId,time_t> journal_new_jobs;
+  // Jobs found in journal to have marks (with time when first noticed)
+  std::map<JobId,time_t> journal_marks;
+  // Set after control directory was scanned for marks once
+  bool marks_scanned;
 
   GMJobQueue jobs_processing;   // List of jobs currently scheduled for processing
 
@@ -75,13 +66,8 @@ class JobsList {
   DTRGenerator dtr_generator;
   // Job description handler
   JobDescriptionHandler job_desc_handler;
-  // number of jobs for every state
-  int jobs_num[JOB_STATE_NUM];
-  int jobs_scripts;
-  // map of number of active jobs for each DN
-  std::map<std::string, ZeroUInt> jobs_dn;
-  // number of jobs currently in pending state
-  int jobs_pending;
+  // number of running submit/cancel scripts (modified atomically)
+  volatile gint jobs_scripts;
 
   // Add job into list. It is supposed to be called only for jobs which are not in main list.
   bool AddJob(const JobId &id,uid_t uid,gid_t gid,job_state_t state,const char* reason = NULL);
@@ -95,6 +81,25 @@ class JobsList {
 
   // Cleaning reference to running child process
   void CleanChildProcess(GMJobRef i);
+  // Takes one slot for submit/cancel script. Returns false if MaxScripts
+  // limit is reached. Slot is given back by CleanChildProcess or
+  // ReleaseScript if script could not be started.
+  bool ReserveScript(void);
+  void ReleaseScript(void);
+  // Slots of MaxJobs, MaxRunning and MaxPerDN limits taken by jobs which
+  // passed limit check but are not accounted in counters yet. Protected
+  // by limits_lock.
+  Glib::Mutex limits_lock;
+  int accepted_reserved;
+  int running_reserved;
+  std::map<std::string,int> dn_reserved;
+  // Check limit and take one slot for job in one operation. Return false
+  // if limit is reached. Slots are given back by ReleaseLimits after job's
+  // new state is accounted in counters.
+  bool ReserveAccepted(GMJobRef i);
+  bool ReserveRunning(GMJobRef i);
+  bool ReserveDN(GMJobRef i, const std::string& dn);
+  void ReleaseLimits(GMJobRef i);
   // Remove Job from list. All corresponding files are deleted and pointer is
   // advanced. If finished is false - job is not destroyed if it is FINISHED
   // If active is false - job is not destroyed if it is not UNDEFINED. Returns
@@ -125,6 +130,19 @@ class JobsList {
   // Called after service restart to move jobs that were processing to a
   // restarting state
   bool RestartJobs(const std::string& cdir,const std::string& odir);
+  // Called after service restart to move jobs that were processing to a
+  // restarting state using information from journal
+  bool RestartJournalJobs(void);
+  // Fetch new records from journal and remember jobs which need attention
+  void ProcessJournal(void);
+  // Remember jobs which need attention from journal records
+  void ProcessJournalRecords(std::list<ControlFileJournal::Record> const& records);
+  // Pick up jobs known from journal to be new or restarting
+  bool ScanNewJournalJobs(void);
+  // Pick up jobs known from journal to be marked
+  bool ScanNewJournalMarks(void);
+  // Process marked jobs found by scanning or from journal
+  void ProcessMarkedJobs(std::list<JobFDesc>& ids);
   // Release delegation after job finishes
   void UnlockDelegation(GMJobRef i);
   // Calculate job expiration time from last state change and configured lifetime
@@ -138,6 +156,8 @@ class JobsList {
   void SetJobPending(GMJobRef i, const char* reason);
   // Update content of job proxy file with one stored in delegations store
   void UpdateJobCredentials(GMJobRef i);
+  // Pass current state of job to in-memory snapshot if one is configured
+  void UpdateJobSnapshot(GMJobRef i);
 
   // Main job processing method. Analyze current state of job, perform
   // necessary actions and advance state or remove job if needed. Iterator 'i'
@@ -260,6 +280,39 @@ class JobsList {
   /// Associated external processes
   ExternalHelpers helpers;
 
+  /// Pool of threads processing jobs from jobs_processing queue concurrently.
+  /// Each job is processed by one thread at a time. If job is requested for
+  /// processing while being processed it is deferred till processing ends.
+  class ProcessingWorkers {
+   public:
+    ProcessingWorkers(JobsList& jobs, int num);
+    /// Stop threads and destroy this instance.
+    ~ProcessingWorkers();
+    /// Start worker threads. Returns false if none could be started.
+    bool start();
+    /// Process all jobs in processing queue. Returns when queue is
+    /// empty and all workers are idle. Returns number of processed jobs.
+    unsigned int process();
+   private:
+    static void worker(void* arg);
+    void work();
+    JobsList& jobs_list;
+    int workers_num;
+    Arc::SimpleCounter workers_count;
+    Glib::Mutex lock;
+    Glib::Cond cond;
+    bool processing;
+    bool stop_request;
+    int busy;
+    unsigned int processed;
+    std::set<JobId> active;
+    std::map<JobId,GMJobRef> deferred;
+  };
+
+  /// Workers for concurrent jobs processing. NULL if processing is done
+  /// by calling thread.
+  ProcessingWorkers* workers;
+
   // Return iterator to object matching given id or null if not found
   GMJobRef FindJob(const JobId &id);
 
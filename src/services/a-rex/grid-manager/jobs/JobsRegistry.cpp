@@ -0,0 +1,168 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "JobsRegistry.h"
+
+namespace ARex {
+
+JobsRegistry::JobsRegistry(void): jobs_pending(0), jobs_total(0) {
+  for(int n = 0; n < JOB_STATE_NUM; ++n) jobs_num[n] = 0;
+}
+
+JobsRegistry::~JobsRegistry(void) {
+}
+
+unsigned int JobsRegistry::Hash(std::string const& str) {
+  // FNV-1a
+  unsigned int h = 2166136261U;
+  for(std::string::size_type n = 0; n < str.length(); ++n) {
+    h ^= (unsigned char)(str[n]);
+    h *= 16777619U;
+  }
+  return h;
+}
+
+void JobsRegistry::Account(JobsShard& shard, JobId const& id, job_state_t state, bool pending, int delta) {
+  if((state < 0) || (state >= JOB_STATE_NUM)) state = JOB_STATE_UNDEFINED;
+  if(pending) {
+    g_atomic_int_add(&jobs_pending, delta);
+  } else {
+    g_atomic_int_add(&(jobs_num[state]), delta);
+    if(delta > 0) {
+      shard.states[state].insert(id);
+    } else {
+      shard.states[state].erase(id);
+    }
+  }
+}
+
+bool JobsRegistry::Add(GMJobRef const& ref, job_state_t state, bool pending) {
+  if(!ref) return false;
+  JobId const& id = ref->get_id();
+  JobsShard& shard = JobShard(id);
+  Glib::Mutex::Lock lock(shard.lock);
+  std::map<JobId,JobRecord>::iterator rec = shard.jobs.find(id);
+  if(rec != shard.jobs.end()) return false;
+  JobRecord& newrec = shard.jobs[id];
+  newrec.ref = ref;
+  newrec.state = state;
+  newrec.pending = pending;
+  Account(shard, id, state, pending, 1);
+  g_atomic_int_inc(&jobs_total);
+  return true;
+}
+
+bool JobsRegistry::Remove(JobId const& id) {
+  JobsShard& shard = JobShard(id);
+  GMJobRef ref; // release reference outside of lock
+  {
+    Glib::Mutex::Lock lock(shard.lock);
+    std::map<JobId,JobRecord>::iterator rec = shard.jobs.find(id);
+    if(rec == shard.jobs.end()) return false;
+    Account(shard, id, rec->second.state, rec->second.pending, -1);
+    ref = rec->second.ref;
+    shard.jobs.erase(rec);
+  }
+  (void)g_atomic_int_dec_and_test(&jobs_total);
+  return true;
+}
+
+GMJobRef JobsRegistry::Find(JobId const& id) const {
+  JobsShard const& shard = JobShard(id);
+  Glib::Mutex::Lock lock(shard.lock);
+  std::map<JobId,JobRecord>::const_iterator rec = shard.jobs.find(id);
+  if(rec == shard.jobs.end()) return GMJobRef();
+  return rec->second.ref;
+}
+
+bool JobsRegistry::Has(JobId const& id) const {
+  JobsShard const& shard = JobShard(id);
+  Glib::Mutex::Lock lock(shard.lock);
+  return (shard.jobs.find(id) != shard.jobs.end());
+}
+
+bool JobsRegistry::Update(JobId const& id, job_state_t state, bool pending) {
+  JobsShard& shard = JobShard(id);
+  Glib::Mutex::Lock lock(shard.lock);
+  std::map<JobId,JobRecord>::iterator rec = shard.jobs.find(id);
+  if(rec == shard.jobs.end()) return false;
+  if((rec->second.state == state) && (rec->second.pending == pending)) return true;
+  Account(shard, id, rec->second.state, rec->second.pending, -1);
+  rec->second.state = state;
+  rec->second.pending = pending;
+  Account(shard, id, state, pending, 1);
+  return true;
+}
+
+void JobsRegistry::List(std::list<GMJobRef>& jobs) const {
+  for(unsigned int n = 0; n < ShardsNum; ++n) {
+    JobsShard const& shard = jobs_shards[n];
+    Glib::Mutex::Lock lock(shard.lock);
+    for(std::map<JobId,JobRecord>::const_iterator rec = shard.jobs.begin();
+                                    rec != shard.jobs.end(); ++rec) {
+      jobs.push_back(rec->second.ref);
+    }
+  }
+}
+
+void JobsRegistry::List(job_state_t state, std::list<GMJobRef>& jobs) const {
+  if((state < 0) || (state >= JOB_STATE_NUM)) return;
+  for(unsigned int n = 0; n < ShardsNum; ++n) {
+    JobsShard const& shard = jobs_shards[n];
+    Glib::Mutex::Lock lock(shard.lock);
+    for(std::set<JobId>::const_iterator id = shard.states[state].begin();
+                                    id != shard.states[state].end(); ++id) {
+      std::map<JobId,JobRecord>::const_iterator rec = shard.jobs.find(*id);
+      if(rec != shard.jobs.end()) jobs.push_back(rec->second.ref);
+    }
+  }
+}
+
+int JobsRegistry::StateCount(job_state_t state) const {
+  if((state < 0) || (state >= JOB_STATE_NUM)) return 0;
+  return g_atomic_int_get(&(jobs_num[state]));
+}
+
+int JobsRegistry::PendingCount(void) const {
+  return g_atomic_int_get(&jobs_pending);
+}
+
+int JobsRegistry::Count(void) const {
+  return g_atomic_int_get(&jobs_total);
+}
+
+void JobsRegistry::IncreaseDN(std::string const& dn) {
+  DNShard& shard = DNShardFor(dn);
+  Glib::Mutex::Lock lock(shard.lock);
+  ++(shard.dns[dn]);
+}
+
+void JobsRegistry::DecreaseDN(std::string const& dn) {
+  DNShard& shard = DNShardFor(dn);
+  Glib::Mutex::Lock lock(shard.lock);
+  std::map<std::string, ZeroUInt>::iterator rec = shard.dns.find(dn);
+  if(rec == shard.dns.end()) return;
+  if(--(rec->second) == 0) shard.dns.erase(rec);
+}
+
+unsigned int JobsRegistry::CountDN(std::string const& dn) const {
+  DNShard const& shard = DNShardFor(dn);
+  Glib::Mutex::Lock lock(shard.lock);
+  std::map<std::string, ZeroUInt>::const_iterator rec = shard.dns.find(dn);
+  if(rec == shard.dns.end()) return 0;
+  return rec->second;
+}
+
+void JobsRegistry::ListDN(std::map<std::string, unsigned int>& dns) const {
+  for(unsigned int n = 0; n < ShardsNum; ++n) {
+    DNShard const& shard = dn_shards[n];
+    Glib::Mutex::Lock lock(shard.lock);
+    for(std::map<std::string, ZeroUInt>::const_iterator rec = shard.dns.begin();
+                                    rec != shard.dns.end(); ++rec) {
+      dns[rec->first] = rec->second;
+    }
+  }
+}
+
+} // namespace ARex
@@ -0,0 +1,140 @@
+#ifndef GRID_MANAGER_JOBS_REGISTRY_H
+#define GRID_MANAGER_JOBS_REGISTRY_H
+
+#include <string>
+#include <list>
+#include <map>
+#include <set>
+#include <glib.h>
+
+#include <arc/Thread.h>
+
+#include "GMJob.h"
+
+namespace ARex {
+
+/// ZeroUInt is a wrapper around unsigned int. It provides a consistent default
+/// value, as int type variables have no predefined value assigned upon
+/// creation. It also protects from potential counter underflow, to stop
+/// counter jumping to MAX_INT. TODO: move to common lib?
+class ZeroUInt {
+private:
+ unsigned int value_;
+public:
+ ZeroUInt(void):value_(0) { };
+ ZeroUInt(unsigned int v):value_(v) { };
+ ZeroUInt(const ZeroUInt& v):value_(v.value_) { };
+ ZeroUInt& operator=(unsigned int v) { value_=v; return *this; };
+ ZeroUInt& operator=(const ZeroUInt& v) { value_=v.value_; return *this; };
+ ZeroUInt& operator++(void) { ++value_; return *this; };
+ ZeroUInt operator++(int) { ZeroUInt temp(value_); ++value_; return temp; };
+ ZeroUInt& operator--(void) { if(value_) --value_; return *this; };
+ ZeroUInt operator--(int) { ZeroUInt temp(value_); if(value_) --value_; return temp; };
+ operator unsigned int(void) const { return value_; };
+};
+
+/// Registry of jobs currently tracked in memory by JobsList.
+/// Jobs are distributed among independently locked shards selected by hash
+/// of job identifier. Hence lookups for different jobs do not contend with
+/// each other and there is no global lock. Each shard also keeps secondary
+/// per-state index of its jobs. Counters of jobs per state and pending jobs
+/// are maintained using atomic operations. Counters of active jobs per DN
+/// are kept in separate set of shards selected by hash of DN.
+class JobsRegistry {
+ public:
+  /// Number of shards used for jobs and for DNs. Must be power of 2.
+  static const unsigned int ShardsNum = 64;
+
+  JobsRegistry(void);
+  ~JobsRegistry(void);
+
+  /// Add job to registry with specified state. Returns false if job with
+  /// same identifier is already registered.
+  bool Add(GMJobRef const& ref, job_state_t state, bool pending);
+
+  /// Remove job from registry and from its state counters.
+  /// Returns false if there was no such job.
+  bool Remove(JobId const& id);
+
+  /// Returns reference to job or null reference if not found.
+  GMJobRef Find(JobId const& id) const;
+
+  /// Returns true if job is registered.
+  bool Has(JobId const& id) const;
+
+  /// Register new state of job and adjust counters and state index.
+  /// Returns false if job is not registered.
+  bool Update(JobId const& id, job_state_t state, bool pending);
+
+  /// Collect references to all registered jobs.
+  void List(std::list<GMJobRef>& jobs) const;
+
+  /// Collect references to all registered non-pending jobs in specified state.
+  void List(job_state_t state, std::list<GMJobRef>& jobs) const;
+
+  /// Number of registered non-pending jobs in specified state.
+  int StateCount(job_state_t state) const;
+
+  /// Number of registered jobs in pending state.
+  int PendingCount(void) const;
+
+  /// Total number of registered jobs.
+  int Count(void) const;
+
+  /// Increase counter of active jobs for specified DN.
+  void IncreaseDN(std::string const& dn);
+
+  /// Decrease counter of active jobs for specified DN. Counter is
+  /// removed when it reaches 0.
+  void DecreaseDN(std::string const& dn);
+
+  /// Current number of active jobs for specified DN.
+  unsigned int CountDN(std::string const& dn) const;
+
+  /// Snapshot of counters of active jobs for all DNs.
+  void ListDN(std::map<std::string, unsigned int>& dns) const;
+
+ private:
+  struct JobRecord {
+    GMJobRef ref;
+    job_state_t state;
+    bool pending;
+  };
+
+  struct JobsShard {
+    mutable Glib::Mutex lock;
+    std::map<JobId,JobRecord> jobs;
+    // Secondary index of non-pending jobs by state
+    std::set<JobId> states[JOB_STATE_NUM];
+  };
+
+  struct DNShard {
+    mutable Glib::Mutex lock;
+    std::map<std::string, ZeroUInt> dns;
+  };
+
+  JobsShard jobs_shards[ShardsNum];
+  DNShard dn_shards[ShardsNum];
+
+  // Counters are modified only by atomic operations
+  mutable volatile gint jobs_num[JOB_STATE_NUM];
+  mutable volatile gint jobs_pending;
+  mutable volatile gint jobs_total;
+
+  static unsigned int Hash(std::string const& str);
+
+  JobsShard& JobShard(JobId const& id) { return jobs_shards[Hash(id) & (ShardsNum-1)]; };
+  JobsShard const& JobShard(JobId const& id) const { return jobs_shards[Hash(id) & (ShardsNum-1)]; };
+  DNShard& DNShardFor(std::string const& dn) { return dn_shards[Hash(dn) & (ShardsNum-1)]; };
+  DNShard const& DNShardFor(std::string const& dn) const { return dn_shards[Hash(dn) & (ShardsNum-1)]; };
+
+  // Account job in counters and index. Must be called with shard lock held.
+  void Account(JobsShard& shard, JobId const& id, job_state_t state, bool pending, int delta);
+
+  JobsRegistry(JobsRegistry const&);
+  JobsRegistry& operator=(JobsRegistry const&);
+};
+
+} // namespace ARex
+
+#endif
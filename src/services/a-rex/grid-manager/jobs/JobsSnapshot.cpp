@@ -0,0 +1,142 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <ctime>
+#include <sys/stat.h>
+
+#include "../files/ControlFileHandling.h"
+#include "../conf/GMConfig.h"
+#include "JobsList.h"
+#include "JobsSnapshot.h"
+
+namespace ARex {
+
+static Arc::Logger& logger = Arc::Logger::getRootLogger();
+
+bool JobsSnapshot::Job::SessionExists(void) const {
+  if(sessiondir.empty()) return false;
+  struct stat st;
+  return (::stat(sessiondir.c_str(), &st) == 0);
+}
+
+JobsSnapshot::JobsSnapshot(void): sequence_(0), ready_(false) {
+}
+
+JobsSnapshot::~JobsSnapshot(void) {
+}
+
+bool JobsSnapshot::Prime(GMConfig const& config) {
+  std::list<JobId> ids;
+  bool result = JobsList::GetAllJobIds(config, ids);
+  if(!result) logger.msg(Arc::WARNING, "Failed to scan control directory, list of jobs is incomplete");
+  // Control files are read without holding lock. Meanwhile jobs may be
+  // changed or removed by JobsList. Those changes are newer and hence
+  // Insert() does not override them.
+  for(std::list<JobId>::iterator id = ids.begin(); id != ids.end(); ++id) {
+    JobLocalDescription local;
+    if(!job_local_read_file(*id, config, local)) continue;
+    bool pending = false;
+    job_state_t state = job_state_read_file(*id, config, pending);
+    if(state == JOB_STATE_UNDEFINED) continue;
+    bool failed = (state == JOB_STATE_FINISHED) && job_failed_mark_check(*id, config);
+    Glib::Mutex::Lock lock(lock_);
+    if(jobs_.find(*id) != jobs_.end()) continue;
+    Job& job = jobs_[*id];
+    job.id = *id;
+    job.owner = local.DN;
+    job.sessiondir = local.sessiondir;
+    job.state = state;
+    job.pending = pending;
+    job.failed = failed;
+    job.failed_state = local.failedstate;
+    job.failed_cause = local.failedcause;
+    job.changed = ++sequence_;
+  }
+  Glib::Mutex::Lock lock(lock_);
+  ready_ = true;
+  logger.msg(Arc::INFO, "Snapshot of job states contains %u jobs", (unsigned int)jobs_.size());
+  return result;
+}
+
+bool JobsSnapshot::Ready(void) const {
+  Glib::Mutex::Lock lock(lock_);
+  return ready_;
+}
+
+void JobsSnapshot::Update(JobId const& id, std::string const& owner, std::string const& sessiondir,
+                          job_state_t state, bool pending,
+                          bool failed, std::string const& failed_state, std::string const& failed_cause) {
+  Glib::Mutex::Lock lock(lock_);
+  Job& job = jobs_[id];
+  job.id = id;
+  if(!owner.empty()) job.owner = owner;
+  if(!sessiondir.empty()) job.sessiondir = sessiondir;
+  job.state = state;
+  job.pending = pending;
+  job.failed = failed;
+  job.failed_state = failed_state;
+  job.failed_cause = failed_cause;
+  job.removed = false;
+  job.changed = ++sequence_;
+}
+
+void JobsSnapshot::Insert(JobId const& id, std::string const& owner, std::string const& sessiondir,
+                          job_state_t state, bool pending) {
+  Glib::Mutex::Lock lock(lock_);
+  if(jobs_.find(id) != jobs_.end()) return;
+  Job& job = jobs_[id];
+  job.id = id;
+  job.owner = owner;
+  job.sessiondir = sessiondir;
+  job.state = state;
+  job.pending = pending;
+  job.changed = ++sequence_;
+}
+
+void JobsSnapshot::Remove(JobId const& id) {
+  Glib::Mutex::Lock lock(lock_);
+  Purge();
+  Job& job = jobs_[id];
+  if(job.removed) return;
+  job.id = id;
+  job.state = JOB_STATE_UNDEFINED;
+  job.pending = false;
+  job.failed = false;
+  job.failed_state.clear();
+  job.failed_cause.clear();
+  job.removed = true;
+  job.changed = ++sequence_;
+  removed_.push_back(std::pair<time_t,JobId>(::time(NULL), id));
+}
+
+void JobsSnapshot::Purge(void) {
+  time_t limit = ::time(NULL) - RemovedLifetime;
+  while((!removed_.empty()) && (removed_.front().first < limit)) {
+    std::map<JobId,Job>::iterator job = jobs_.find(removed_.front().second);
+    // Job could have been recreated meanwhile
+    if((job != jobs_.end()) && (job->second.removed)) jobs_.erase(job);
+    removed_.pop_front();
+  }
+}
+
+bool JobsSnapshot::Find(JobId const& id, Job& job) const {
+  Glib::Mutex::Lock lock(lock_);
+  std::map<JobId,Job>::const_iterator rec = jobs_.find(id);
+  if((rec == jobs_.end()) || (rec->second.removed)) return false;
+  job = rec->second;
+  return true;
+}
+
+unsigned long long JobsSnapshot::List(std::string const& owner, unsigned long long since, std::list<Job>& jobs) const {
+  Glib::Mutex::Lock lock(lock_);
+  for(std::map<JobId,Job>::const_iterator rec = jobs_.begin(); rec != jobs_.end(); ++rec) {
+    if(rec->second.changed <= since) continue;
+    if(rec->second.removed && (since == 0)) continue;
+    if(rec->second.owner != owner) continue;
+    jobs.push_back(rec->second);
+  }
+  return sequence_;
+}
+
+} // namespace ARex
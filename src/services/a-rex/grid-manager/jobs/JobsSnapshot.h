@@ -0,0 +1,97 @@
+#ifndef GRID_MANAGER_JOBS_SNAPSHOT_H
+#define GRID_MANAGER_JOBS_SNAPSHOT_H
+
+#include <string>
+#include <list>
+#include <map>
+
+#include <arc/Thread.h>
+
+#include "GMJob.h"
+
+namespace ARex {
+
+class GMConfig;
+
+/// In-memory copy of states of all jobs in control directory. Unlike
+/// JobsRegistry it also holds jobs which are not processed anymore
+/// (FINISHED, DELETED), so that services can answer bulk state queries
+/// without reading control files of every job. It is fed by JobsList on
+/// every state change. Every change is assigned increasing sequence
+/// number, which allows clients to ask only for jobs changed since
+/// previous query.
+class JobsSnapshot {
+ public:
+  /// Removed jobs are remembered for this time (seconds) so that
+  /// incremental queries can report them.
+  static const time_t RemovedLifetime = 24*60*60;
+
+  struct Job {
+    JobId id;
+    std::string owner;
+    job_state_t state;
+    bool pending;
+    bool failed;
+    std::string failed_state;
+    std::string failed_cause;
+    /// Session directory. Job is not usable once it is gone even if
+    /// JobsList did not process removal yet.
+    std::string sessiondir;
+    /// Sequence number of last change
+    unsigned long long changed;
+    /// Job does not exist anymore
+    bool removed;
+    Job(void):state(JOB_STATE_UNDEFINED),pending(false),failed(false),changed(0),removed(false) {};
+    /// Check if session directory of job still exists.
+    bool SessionExists(void) const;
+  };
+
+  JobsSnapshot(void);
+  ~JobsSnapshot(void);
+
+  /// Fill snapshot from control directory. Jobs already registered by
+  /// Update(), Insert() or Remove() are not touched. Snapshot becomes
+  /// ready after this call even if scanning failed partially.
+  bool Prime(GMConfig const& config);
+
+  /// True once Prime() was called. Before that snapshot is incomplete.
+  bool Ready(void) const;
+
+  /// Register new state of job. Empty owner or sessiondir keeps previously known one.
+  void Update(JobId const& id, std::string const& owner, std::string const& sessiondir,
+              job_state_t state, bool pending,
+              bool failed, std::string const& failed_state, std::string const& failed_cause);
+
+  /// Register job only if it is not known yet.
+  void Insert(JobId const& id, std::string const& owner, std::string const& sessiondir,
+              job_state_t state, bool pending);
+
+  /// Mark job as removed.
+  void Remove(JobId const& id);
+
+  /// Get state of existing job. Returns false if job is unknown or removed.
+  bool Find(JobId const& id, Job& job) const;
+
+  /// Collect jobs of specified owner changed after sequence
+  /// number since. Removed jobs are reported only if since is not 0.
+  /// Returns sequence number of last change to be used in next query.
+  unsigned long long List(std::string const& owner, unsigned long long since, std::list<Job>& jobs) const;
+
+ private:
+  mutable Glib::Mutex lock_;
+  std::map<JobId,Job> jobs_;
+  // Removed jobs in order of removal with time of removal
+  std::list< std::pair<time_t,JobId> > removed_;
+  unsigned long long sequence_;
+  bool ready_;
+
+  // Forget removed jobs which are too old. Must be called with lock held.
+  void Purge(void);
+
+  JobsSnapshot(JobsSnapshot const&);
+  JobsSnapshot& operator=(JobsSnapshot const&);
+};
+
+} // namespace ARex
+
+#endif
@@ -34,6 +34,7 @@
 #include "grid-manager/jobs/JobDescriptionHandler.h"
 #include "grid-manager/jobs/CommFIFO.h"
 #include "grid-manager/jobs/JobsList.h"
+#include "grid-manager/jobs/JobsSnapshot.h"
 #include "grid-manager/run/RunPlugin.h"
 #include "grid-manager/files/ControlFileHandling.h"
 #include "delegation/DelegationStores.h"
@@ -879,6 +880,9 @@ void ARexJob::make_new_job(std::string const& job_desc_str,const std::string& de
   deleg_ids.sort();
   deleg_ids.unique();
   deleg.LockCred(id_,deleg_ids,config_.GridName());
+  // Make job visible in bulk queries before GM picks it up
+  JobsSnapshot* snapshot = config_.GmConfig().GetJobsSnapshot();
+  if(snapshot) snapshot->Insert(id_,job_.DN,job_.sessiondir,JOB_STATE_ACCEPTED,false);
 
   CommFIFO::Signal(config_.GmConfig().ControlDir(),id_);
   return;
@@ -1048,9 +1052,20 @@ int ARexJob::TotalJobs(ARexGMConfig& config,Arc::Logger& /* logger */) {
   return JobsList::CountAllJobs(config.GmConfig());
 }
 
-// TODO: optimize
 std::list<std::string> ARexJob::Jobs(ARexGMConfig& config,Arc::Logger& logger) {
   std::list<std::string> jlist;
+  JobsSnapshot* snapshot = config.GmConfig().GetJobsSnapshot();
+  if(snapshot && snapshot->Ready()) {
+    // Same as fast authorization check below - only own jobs
+    // which still have session directory
+    std::list<JobsSnapshot::Job> jobs;
+    snapshot->List(config.GridName(),0,jobs);
+    for(std::list<JobsSnapshot::Job>::iterator job = jobs.begin(); job != jobs.end(); ++job) {
+      if(!job->SessionExists()) continue;
+      jlist.push_back(job->id);
+    };
+    return jlist;
+  };
   JobsList::GetAllJobIds(config.GmConfig(),jlist);
   std::list<std::string>::iterator i = jlist.begin();
   while(i!=jlist.end()) {
@@ -1169,6 +1184,41 @@ Arc::FileAccess* ARexJob::OpenFile(const std::string& filename,bool for_read,boo
   return NULL;
 }
 
+int ARexJob::OpenFileDirect(const std::string& filename) {
+  if(id_.empty()) return -1;
+  std::string fname = filename;
+  if((!normalize_filename(fname)) || (fname.empty())) return -1;
+  // File is opened by service itself which may have more privileges
+  // than owner of job. To make sure owner could read it anyway every
+  // element of path must belong to owner and no symbolic link is
+  // followed. Files with more than one hard link may be shared with
+  // someone else and are not accepted either.
+  int h = ::open(job_.sessiondir.c_str(),O_RDONLY | O_DIRECTORY | O_NOFOLLOW);
+  if(h == -1) return -1;
+  std::string::size_type start = 0;
+  for(;;) {
+    std::string::size_type end = fname.find(G_DIR_SEPARATOR,start);
+    bool last = (end == std::string::npos);
+    std::string name = fname.substr(start,last?std::string::npos:(end-start));
+    // O_NONBLOCK protects against hanging on FIFO
+    int nh = ::openat(h,name.c_str(),O_RDONLY | O_NOFOLLOW | O_NONBLOCK | (last?0:O_DIRECTORY));
+    ::close(h);
+    h = nh;
+    if(h == -1) return -1;
+    struct stat st;
+    if((::fstat(h,&st) != 0) || (st.st_uid != uid_) ||
+       (last && ((!S_ISREG(st.st_mode)) || (st.st_nlink != 1)))) {
+      ::close(h);
+      return -1;
+    };
+    if(last) break;
+    start = end+1;
+  };
+  int flags = ::fcntl(h,F_GETFL);
+  if(flags != -1) ::fcntl(h,F_SETFL,flags & ~O_NONBLOCK);
+  return h;
+}
+
 Arc::FileAccess* ARexJob::OpenDir(const std::string& dirname) {
   if(id_.empty()) return NULL;
   std::string dname = dirname;
@@ -148,6 +148,10 @@ class ARexJob {
   Arc::FileAccess* CreateFile(const std::string& filename);
   /** Opens file in job's session directory and returns handler */
   Arc::FileAccess* OpenFile(const std::string& filename,bool for_read,bool for_write);
+  /** Opens file in job's session directory for reading by service itself.
+      Returns -1 if file can't be safely accessed that way. Then OpenFile()
+      must be used. */
+  int OpenFileDirect(const std::string& filename);
   std::string GetFilePath(const std::string& filename);
   bool ReportFileComplete(const std::string& filename);
   bool ReportFilesComplete();
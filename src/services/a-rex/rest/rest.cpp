@@ -3,6 +3,9 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <unistd.h>
+#include <string.h>
+#include <stdlib.h>
+#include <zlib.h>
 #include <algorithm>
 
 #include <arc/message/PayloadRaw.h>
@@ -10,12 +13,14 @@
 #include <arc/URL.h>
 #include <arc/FileUtils.h>
 #include <arc/Utils.h>
+#include <arc/Thread.h>
 
 #include "../job.h"
 #include "../PayloadFile.h"
 #include "../FileChunks.h"
 #include "../delegation/DelegationStores.h"
 #include "../grid-manager/files/ControlFileHandling.h"
+#include "../grid-manager/jobs/JobsSnapshot.h"
 
 #include "rest.h"
 
@@ -254,13 +259,331 @@ static void RenderResponse(Arc::XMLNode xml, ResponseFormat format, std::string&
     }
 }
 
-static void ExtractRange(Arc::Message& inmsg, off_t& range_start, off_t& range_end) {
+// Escaping same as done by libxml2 while saving document
+static void EscapeXml(std::string const& val, std::string& output, bool attribute) {
+    for(std::string::size_type n = 0; n < val.length(); ++n) {
+        char c = val[n];
+        switch(c) {
+            case '&': output += "&amp;"; break;
+            case '<': output += "&lt;"; break;
+            case '>': output += "&gt;"; break;
+            case '\r': output += "&#13;"; break;
+            case '"': output += attribute ? "&quot;" : "\""; break;
+            case '\n': output += attribute ? "&#10;" : "\n"; break;
+            case '\t': output += attribute ? "&#9;" : "\t"; break;
+            default: output += c; break;
+        }
+    }
+}
+
+// Render element without namespace definitions of its parents. Such
+// element is only usable as part of bigger document.
+static void RenderItemToXml(Arc::XMLNode xml, std::string& output) {
+    std::string name = xml.Prefix();
+    if(!name.empty()) name += ":";
+    name += xml.Name();
+    output += "<";
+    output += name;
+    for(int n = 0; ; ++n) {
+        XMLNode attr = xml.Attribute(n);
+        if(!attr) break;
+        output += " ";
+        output += attr.Name();
+        output += "=\"";
+        EscapeXml((std::string)attr, output, true);
+        output += "\"";
+    }
+    if(xml.Size() == 0) {
+        std::string val = (std::string)xml;
+        if(val.empty()) {
+            output += "/>";
+            return;
+        }
+        output += ">";
+        EscapeXml(val, output, false);
+    } else {
+        output += ">";
+        for(int n = 0; ; ++n) {
+            XMLNode child = xml.Child(n);
+            if(!child) break;
+            RenderItemToXml(child, output);
+        }
+    }
+    output += "</";
+    output += name;
+    output += ">";
+}
+
+// Source of elements for ResponsePayload. Elements are produced one by one
+// while response is being sent.
+class ResponseItems {
+ public:
+    virtual ~ResponseItems(void) {}
+    // Add next element to parent. Returns false if there are no more elements.
+    virtual bool Next(Arc::XMLNode& parent) = 0;
+};
+
+// Response consisting of root element with few optional header elements
+// followed by arbitrary number of elements with same name. Output is
+// same as produced by RenderResponse for equivalent XML document but is
+// rendered incrementally as HTTP layer reads it. So neither whole XML
+// tree nor whole rendered response ever exist in memory. Size of content
+// is not known in advance and hence it is sent with chunked encoding.
+class ResponsePayload: public Arc::PayloadStreamInterface {
+ public:
+    // Amount of rendered content collected before passing it further
+    static const std::string::size_type PortionSize = 64*1024;
+
+    // Takes ownership of items. If document is set XML declaration is
+    // added same way as XMLNode::GetDoc does.
+    ResponsePayload(ResponseFormat format, Arc::NS const& ns, std::string const& root,
+                    ResponseItems* items, bool document = false):
+        format_(format), ns_(ns), root_(ns, root.c_str()), items_(items), document_(document),
+        started_(false), finished_(false), opened_(false), items_num_(0), pos_(0) {
+    }
+    virtual ~ResponsePayload(void) {
+        delete items_;
+    }
+    // Elements to be put before items. Must be filled before content is read.
+    Arc::XMLNode Header(void) { return root_; }
+
+    virtual bool Get(char* buf, int& size) {
+        while(((output_.length()-pos_) < PortionSize) && !finished_) Produce();
+        if(pos_ >= output_.length()) {
+            size = 0;
+            return false;
+        }
+        if(size > (int)(output_.length()-pos_)) size = output_.length()-pos_;
+        memcpy(buf, output_.c_str()+pos_, size);
+        pos_ += size;
+        if(pos_ >= output_.length()) {
+            output_.resize(0);
+            pos_ = 0;
+        }
+        return true;
+    }
+    virtual bool Get(std::string& buf) {
+        char cbuf[1024];
+        int size = sizeof(cbuf);
+        if(!Get(cbuf,size)) return false;
+        buf.assign(cbuf,size);
+        return true;
+    }
+    virtual std::string Get(void) { std::string buf; Get(buf); return buf; }
+    virtual bool Put(const char* buf, Size_t size) { return false; }
+    virtual bool Put(const std::string& buf) { return Put(buf.c_str(),buf.length()); }
+    virtual bool Put(const char* buf) { return Put(buf,buf?strlen(buf):0); }
+    virtual operator bool(void) { return true; }
+    virtual bool operator!(void) { return false; }
+    virtual int Timeout(void) const { return 0; }
+    virtual void Timeout(int to) { }
+    // Size is not known in advance
+    virtual Size_t Pos(void) const { return 0; }
+    virtual Size_t Size(void) const { return 0; }
+    virtual Size_t Limit(void) const { return 0; }
+
+    // Render whole content only to find its size. Needed for HEAD.
+    Size_t Length(void) {
+        Size_t length = 0;
+        char buf[16*1024];
+        for(;;) {
+            int size = sizeof(buf);
+            if(!Get(buf,size)) break;
+            length += size;
+        }
+        return length;
+    }
+
+ private:
+    ResponseFormat format_;
+    Arc::NS ns_;
+    Arc::XMLNode root_;
+    ResponseItems* items_;
+    bool document_;
+    bool started_;
+    bool finished_;
+    // Root element has children
+    bool opened_;
+    int items_num_;
+    std::string items_name_;
+    // JSON representation of first item is kept till it is known if there are more
+    std::string first_item_;
+    std::string output_;
+    std::string::size_type pos_;
+
+    void Produce(void);
+    void Open(void);
+    void Member(Arc::XMLNode xml);
+    void Item(Arc::XMLNode xml);
+    void Close(void);
+
+    ResponsePayload(ResponsePayload const&);
+    ResponsePayload& operator=(ResponsePayload const&);
+};
+
+void ResponsePayload::Produce(void) {
+    if(!started_) {
+        started_ = true;
+        if(format_ == ResponseFormatXml) {
+            if(document_) output_ += "<?xml version=\"1.0\"?>\n";
+        } else if(format_ == ResponseFormatHtml) {
+            output_ += "<HTML><HEAD>";
+            output_ += root_.Name();
+            output_ += "</HEAD><BODY>";
+        }
+        for(XMLNode header = root_.Child(0); (bool)header; header = root_.Child(0)) {
+            Member(header);
+            header.Destroy();
+        }
+        return;
+    }
+    if(items_ && items_->Next(root_)) {
+        for(XMLNode item = root_.Child(0); (bool)item; item = root_.Child(0)) {
+            Item(item);
+            item.Destroy();
+        }
+        return;
+    }
+    Close();
+    finished_ = true;
+}
+
+void ResponsePayload::Open(void) {
+    if(opened_) return;
+    opened_ = true;
+    switch(format_) {
+        case ResponseFormatXml: {
+            output_ += "<";
+            output_ += root_.Prefix().empty() ? root_.Name() : (root_.Prefix() + ":" + root_.Name());
+            for(Arc::NS::iterator ns = ns_.begin(); ns != ns_.end(); ++ns) {
+                output_ += " xmlns";
+                if(!ns->first.empty()) {
+                    output_ += ":";
+                    output_ += ns->first;
+                }
+                output_ += "=\"";
+                EscapeXml(ns->second, output_, true);
+                output_ += "\"";
+            }
+            output_ += ">";
+        }; break;
+        case ResponseFormatHtml:
+            output_ += "<table border=\"1\">";
+            break;
+        case ResponseFormatJson:
+            output_ += "{";
+            break;
+        default:
+            break;
+    }
+}
+
+void ResponsePayload::Member(Arc::XMLNode xml) {
+    switch(format_) {
+        case ResponseFormatXml:
+            Open();
+            RenderItemToXml(xml, output_);
+            break;
+        case ResponseFormatHtml:
+            Open();
+            output_ += "<tr><td>";
+            output_ += xml.Name();
+            output_ += "</td><td>";
+            RenderToHtml(xml, output_, 1);
+            output_ += "</td></tr>";
+            break;
+        case ResponseFormatJson:
+            if(opened_) output_ += ",";
+            Open();
+            output_ += "\"";
+            output_ += xml.Name();
+            output_ += "\":";
+            RenderToJson(xml, output_, 1);
+            break;
+        default:
+            break;
+    }
+}
+
+void ResponsePayload::Item(Arc::XMLNode xml) {
+    if(format_ != ResponseFormatJson) {
+        Member(xml);
+        return;
+    }
+    // Elements with same name are turned into array unless there is only one
+    ++items_num_;
+    if(items_num_ == 1) {
+        items_name_ = xml.Name();
+        RenderToJson(xml, first_item_, 1);
+        return;
+    }
+    if(items_num_ == 2) {
+        if(opened_) output_ += ",";
+        Open();
+        output_ += "\"";
+        output_ += items_name_;
+        output_ += "\":[";
+        output_ += first_item_;
+        first_item_.clear();
+    }
+    output_ += ",";
+    RenderToJson(xml, output_, 1);
+}
+
+void ResponsePayload::Close(void) {
+    switch(format_) {
+        case ResponseFormatXml: {
+            std::string name = root_.Prefix().empty() ? root_.Name() : (root_.Prefix() + ":" + root_.Name());
+            if(opened_) {
+                output_ += "</";
+                output_ += name;
+                output_ += ">";
+            } else {
+                Open();
+                output_.resize(output_.length()-1);
+                output_ += "/>";
+            }
+            if(document_) output_ += "\n";
+        }; break;
+        case ResponseFormatHtml:
+            if(opened_) output_ += "</table>";
+            output_ += "</BODY></HTML>";
+            break;
+        case ResponseFormatJson:
+            if(items_num_ == 1) {
+                if(opened_) output_ += ",";
+                Open();
+                output_ += "\"";
+                output_ += items_name_;
+                output_ += "\":";
+                output_ += first_item_;
+                first_item_.clear();
+            } else if(items_num_ > 1) {
+                output_ += "]";
+            }
+            if(opened_) output_ += "}";
+            break;
+        default:
+            break;
+    }
+}
+
+// Size is needed for ranges counted from end of file. If it is not known
+// such ranges are ignored.
+static void ExtractRange(Arc::Message& inmsg, off_t& range_start, off_t& range_end, off_t size = (off_t)(-1)) {
   range_start = 0;
   range_end = (off_t)(-1);
   {
     std::string val;
     val=inmsg.Attributes()->get("HTTP:RANGESTART");
-    if(!val.empty()) {
+    if(val.empty()) {
+      // Suffix range - last bytes of file
+      val=inmsg.Attributes()->get("HTTP:RANGEEND");
+      off_t suffix = 0;
+      if((!val.empty()) && (size != (off_t)(-1)) && Arc::stringto<off_t>(val,suffix) && (suffix > 0)) {
+        range_start = (suffix < size)?(size-suffix):0;
+      };
+    } else {
       // Negative ranges not supported
       if(!Arc::stringto<off_t>(val,range_start)) {
         range_start=0;
@@ -368,15 +691,16 @@ static Arc::MCC_Status HTTPResponse(Arc::Message& inmsg, Arc::Message& outmsg,
 
 static Arc::MCC_Status HTTPResponseFile(Arc::Message& inmsg, Arc::Message& outmsg,
                                         int& fileHandle, std::string const& mime) {
+  struct stat st;
+  off_t size = (::fstat(fileHandle,&st) == 0) ? st.st_size : (off_t)(-1);
   if(inmsg.Attributes()->get("HTTP:METHOD") == "HEAD") {
     Arc::PayloadRaw* outpayload = new Arc::PayloadRaw();
-    struct stat st;
-    if(outpayload && (::fstat(fileHandle,&st) == 0)) outpayload->Truncate(st.st_size);
+    if(outpayload && (size != (off_t)(-1))) outpayload->Truncate(size);
     delete outmsg.Payload(outpayload);
   } else {
     off_t range_start = 0;
     off_t range_end = 0;
-    ExtractRange(inmsg, range_start, range_end);
+    ExtractRange(inmsg, range_start, range_end, size);
     Arc::MessagePayload* outpayload = newFileRead(fileHandle,range_start,range_end);
     delete outmsg.Payload(outpayload);
     fileHandle = -1;
@@ -384,20 +708,22 @@ static Arc::MCC_Status HTTPResponseFile(Arc::Message& inmsg, Arc::Message& outms
   outmsg.Attributes()->set("HTTP:CODE","200");
   outmsg.Attributes()->set("HTTP:REASON","OK");
   outmsg.Attributes()->set("HTTP:content-type",mime);
+  outmsg.Attributes()->set("HTTP:accept-ranges","bytes");
   return Arc::MCC_Status(Arc::STATUS_OK);
 }
 
 static Arc::MCC_Status HTTPResponseFile(Arc::Message& inmsg, Arc::Message& outmsg,
                                         Arc::FileAccess*& fileHandle, std::string const& mime) {
+  struct stat st;
+  off_t size = fileHandle->fa_fstat(st) ? st.st_size : (off_t)(-1);
   if(inmsg.Attributes()->get("HTTP:METHOD") == "HEAD") {
     Arc::PayloadRaw* outpayload = new Arc::PayloadRaw();
-    struct stat st;
-    if(outpayload && fileHandle->fa_fstat(st)) outpayload->Truncate(st.st_size);
+    if(outpayload && (size != (off_t)(-1))) outpayload->Truncate(size);
     delete outmsg.Payload(outpayload);
   } else {
     off_t range_start;
     off_t range_end;
-    ExtractRange(inmsg, range_start, range_end);
+    ExtractRange(inmsg, range_start, range_end, size);
     Arc::MessagePayload* outpayload = newFileRead(fileHandle,range_start,range_end);
     delete outmsg.Payload(outpayload);
     fileHandle = NULL;
@@ -405,6 +731,7 @@ static Arc::MCC_Status HTTPResponseFile(Arc::Message& inmsg, Arc::Message& outms
   outmsg.Attributes()->set("HTTP:CODE","200");
   outmsg.Attributes()->set("HTTP:REASON","OK");
   outmsg.Attributes()->set("HTTP:content-type",mime);
+  outmsg.Attributes()->set("HTTP:accept-ranges","bytes");
   return Arc::MCC_Status(Arc::STATUS_OK);
 }
 
@@ -470,6 +797,62 @@ static ResponseFormat ProcessAcceptedFormat(Arc::Message& inmsg, Arc::Message& o
   return outFormat;
 }
 
+// Check if client accepts gzip content coding
+static bool ProcessAcceptedEncoding(Arc::Message& inmsg) {
+  std::list<std::string> encodings;
+  tokenize(inmsg.Attributes()->get("HTTP:accept-encoding"), encodings, ",");
+  for(std::list<std::string>::iterator enc = encodings.begin(); enc != encodings.end(); ++enc) {
+    std::string name = *enc;
+    double q = 1;
+    std::string::size_type pos = name.find(';');
+    if(pos != std::string::npos) {
+      std::string::size_type qpos = name.find("q=", pos);
+      if(qpos != std::string::npos) q = strtod(name.c_str()+qpos+2, NULL);
+      name.erase(pos);
+    }
+    name = Arc::trim(name, " ");
+    if(((name == "gzip") || (name == "x-gzip")) && (q > 0)) return true;
+  }
+  return false;
+}
+
+// Check if any of entity tags in If-None-Match matches etag
+static bool MatchETag(Arc::Message& inmsg, std::string const& etag) {
+  if(etag.empty()) return false;
+  std::list<std::string> tags;
+  tokenize(inmsg.Attributes()->get("HTTP:if-none-match"), tags, ",");
+  for(std::list<std::string>::iterator tag = tags.begin(); tag != tags.end(); ++tag) {
+    *tag = Arc::trim(*tag, " ");
+    if(*tag == "*") return true;
+    // Weak comparison as required for If-None-Match
+    if(strncmp(tag->c_str(), "W/", 2) == 0) tag->erase(0, 2);
+    if(*tag == etag) return true;
+  }
+  return false;
+}
+
+// Produce gzip formatted output
+static bool GzipContent(std::string const& input, std::string& output) {
+  z_stream strm;
+  memset(&strm, 0, sizeof(strm));
+  if(deflateInit2(&strm, Z_DEFAULT_COMPRESSION, Z_DEFLATED, MAX_WBITS+16, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+    return false;
+  // Some space for gzip header which older zlib does not count
+  output.resize(deflateBound(&strm, input.length())+32);
+  strm.next_in = (Bytef*)input.c_str();
+  strm.avail_in = input.length();
+  strm.next_out = (Bytef*)&output[0];
+  strm.avail_out = output.length();
+  int err = deflate(&strm, Z_FINISH);
+  (void)deflateEnd(&strm);
+  if(err != Z_STREAM_END) {
+    output.resize(0);
+    return false;
+  }
+  output.resize(strm.total_out);
+  return true;
+}
+
 // Insert structured positive response into outmsg.
 static Arc::MCC_Status HTTPResponse(Arc::Message& inmsg, Arc::Message& outmsg, Arc::XMLNode& resp) {
   ResponseFormat outFormat = ProcessAcceptedFormat(inmsg,outmsg);
@@ -503,6 +886,28 @@ static Arc::MCC_Status HTTPPOSTResponse(Arc::Message& inmsg, Arc::Message& outms
   return Arc::MCC_Status(Arc::STATUS_OK);
 }
 
+// Insert streamed structured positive response into outmsg. Takes ownership of payload.
+static Arc::MCC_Status HTTPResponse(Arc::Message& inmsg, Arc::Message& outmsg, ResponsePayload* payload) {
+  if(inmsg.Attributes()->get("HTTP:METHOD") == "HEAD") {
+    Arc::PayloadRaw* outpayload = new Arc::PayloadRaw();
+    if(outpayload) outpayload->Truncate(payload->Length());
+    delete payload;
+    delete outmsg.Payload(outpayload);
+  } else {
+    delete outmsg.Payload(payload);
+  }
+  outmsg.Attributes()->set("HTTP:CODE","200");
+  outmsg.Attributes()->set("HTTP:REASON","OK");
+  return Arc::MCC_Status(Arc::STATUS_OK);
+}
+
+static Arc::MCC_Status HTTPPOSTResponse(Arc::Message& inmsg, Arc::Message& outmsg, ResponsePayload* payload) {
+  delete outmsg.Payload(payload);
+  outmsg.Attributes()->set("HTTP:CODE","201");
+  outmsg.Attributes()->set("HTTP:REASON","Created");
+  return Arc::MCC_Status(Arc::STATUS_OK);
+}
+
 static std::string GetPath(Arc::Message &inmsg,std::string &base,std::multimap<std::string,std::string>& query) {
   base = inmsg.Attributes()->get("HTTP:ENDPOINT");
   Arc::AttributeIterator iterator = inmsg.Attributes()->getAll("PLEXER:EXTENSION");
@@ -631,15 +1036,97 @@ static void convertActivityStatusREST(const std::string& gm_state,std::string& r
   }
 }
 
+static void convertActivityStatusREST(JobsSnapshot::Job const& job,std::string& rest_state) {
+  if(job.removed) {
+    rest_state = "None";
+    return;
+  }
+  convertActivityStatusREST(GMJob::get_state_name(job.state),rest_state,
+                            job.failed,job.pending,job.failed_state,job.failed_cause);
+}
+
+// Info document is regenerated by infoprovider once in a while but may be
+// requested very often. So it is rendered once per update of info.xml
+// and then served from memory.
+class ARexRest::InfoCache {
+ public:
+  // Do not compress small documents
+  static const std::string::size_type GzipMinSize = 1024;
+
+  InfoCache(void): dev_(0), ino_(0), size_(0), mtime_(0) {};
+  // Check if file was changed and drop outdated content. Returns false
+  // if file is not accessible.
+  bool Update(std::string const& path);
+  // Rendered document in requested format, optionally compressed
+  std::string const& Content(ResponseFormat format, bool gzip);
+  // Entity tag of Content(format, gzip)
+  std::string ETag(ResponseFormat format, bool gzip) const;
+
+  Glib::Mutex lock;
+
+ private:
+  dev_t dev_;
+  ino_t ino_;
+  off_t size_;
+  time_t mtime_;
+  std::string document_;
+  std::map<int,std::string> rendered_;
+  std::map<int,std::string> compressed_;
+};
+
+bool ARexRest::InfoCache::Update(std::string const& path) {
+  struct stat st;
+  if(::stat(path.c_str(), &st) != 0) {
+    dev_ = 0; ino_ = 0; size_ = 0; mtime_ = 0;
+    document_.clear();
+    rendered_.clear();
+    compressed_.clear();
+    return false;
+  }
+  if((st.st_dev == dev_) && (st.st_ino == ino_) && (st.st_size == size_) && (st.st_mtime == mtime_))
+    return true;
+  // File may be changed while being read. Then it will be read once more on next request.
+  dev_ = st.st_dev; ino_ = st.st_ino; size_ = st.st_size; mtime_ = st.st_mtime;
+  document_.clear();
+  rendered_.clear();
+  compressed_.clear();
+  (void)Arc::FileRead(path, document_);
+  return true;
+}
+
+std::string const& ARexRest::InfoCache::Content(ResponseFormat format, bool gzip) {
+  std::map<int,std::string>::iterator rendered = rendered_.find(format);
+  if(rendered == rendered_.end()) {
+    XMLNode infoXml(document_);
+    rendered = rendered_.insert(std::pair<int,std::string>(format,std::string())).first;
+    RenderResponse(infoXml, format, rendered->second);
+  }
+  if(!gzip) return rendered->second;
+  std::map<int,std::string>::iterator compressed = compressed_.find(format);
+  if(compressed == compressed_.end()) {
+    compressed = compressed_.insert(std::pair<int,std::string>(format,std::string())).first;
+    if(!GzipContent(rendered->second, compressed->second)) compressed->second.clear();
+  }
+  return compressed->second;
+}
+
+std::string ARexRest::InfoCache::ETag(ResponseFormat format, bool gzip) const {
+  if(!ino_) return "";
+  return "\""+Arc::tostring(ino_)+"-"+Arc::tostring(size_)+"-"+Arc::tostring(mtime_)+"-"+
+         Arc::tostring((int)format)+(gzip?"-gz":"")+"\"";
+}
+
 ARexRest::ARexRest(Arc::Config *cfg, Arc::PluginArgument *parg, GMConfig& config,
                    ARex::DelegationStores& delegation_stores,unsigned int& all_jobs_count):
        logger_(Arc::Logger::rootLogger, "A-REX REST"),
-       config_(config),delegation_stores_(delegation_stores),all_jobs_count_(all_jobs_count) {
+       config_(config),delegation_stores_(delegation_stores),all_jobs_count_(all_jobs_count),
+       info_cache_(new InfoCache) {
   endpoint_=(std::string)((*cfg)["endpoint"]);
   uname_=(std::string)((*cfg)["usermap"]["defaultLocalName"]);
 }
 
 ARexRest::~ARexRest(void)  {
+  delete info_cache_;
 }
 
 // Main request processor of REST interface
@@ -728,10 +1215,40 @@ Arc::MCC_Status ARexRest::processInfo(Arc::Message& inmsg,Arc::Message& outmsg,
     return HTTPFault(inmsg,outmsg,501,"Schema not implemented");
   }
 
-  std::string infoStr;
-  Arc::FileRead(config_.ControlDir()+G_DIR_SEPARATOR_S+"info.xml", infoStr);
-  XMLNode infoXml(infoStr);
-  return HTTPResponse(inmsg, outmsg, infoXml);
+  ResponseFormat outFormat = ProcessAcceptedFormat(inmsg,outmsg);
+  bool gzip = ProcessAcceptedEncoding(inmsg);
+  Glib::Mutex::Lock lock(info_cache_->lock);
+  bool cached = info_cache_->Update(config_.ControlDir()+G_DIR_SEPARATOR_S+"info.xml");
+  std::string const* content = &(info_cache_->Content(outFormat, false));
+  if(gzip) {
+    if(content->length() >= InfoCache::GzipMinSize) {
+      std::string const& compressed = info_cache_->Content(outFormat, true);
+      if(compressed.empty()) gzip = false; else content = &compressed;
+    } else {
+      gzip = false;
+    }
+  }
+  std::string etag = cached ? info_cache_->ETag(outFormat, gzip) : std::string();
+  outmsg.Attributes()->set("HTTP:vary","Accept, Accept-Encoding");
+  if(!etag.empty()) outmsg.Attributes()->set("HTTP:etag",etag);
+  if(MatchETag(inmsg, etag)) {
+    Arc::PayloadRaw* outpayload = new Arc::PayloadRaw();
+    delete outmsg.Payload(outpayload);
+    outmsg.Attributes()->set("HTTP:CODE","304");
+    outmsg.Attributes()->set("HTTP:REASON","Not Modified");
+    return Arc::MCC_Status(Arc::STATUS_OK);
+  }
+  if(gzip) outmsg.Attributes()->set("HTTP:content-encoding","gzip");
+  Arc::PayloadRaw* outpayload = new Arc::PayloadRaw();
+  if(inmsg.Attributes()->get("HTTP:METHOD") == "HEAD") {
+    if(outpayload) outpayload->Truncate(content->length());
+  } else {
+    if(outpayload) outpayload->Insert(content->c_str(),0,content->length());
+  }
+  delete outmsg.Payload(outpayload);
+  outmsg.Attributes()->set("HTTP:CODE","200");
+  outmsg.Attributes()->set("HTTP:REASON","OK");
+  return Arc::MCC_Status(Arc::STATUS_OK);
 }
 
 // ---------------------------- DELEGATIONS ---------------------------------
@@ -859,14 +1376,90 @@ Arc::MCC_Status ARexRest::processDelegation(Arc::Message& inmsg,Arc::Message& ou
 // ---------------------------- JOBS ---------------------------------
 
 static bool processJobInfo(Arc::Message& inmsg,ARexConfigContext& config, Arc::Logger& logger, std::string const & id, XMLNode jobXml);
+static bool processJobStatus(JobsSnapshot* snapshot, std::string const& grid_name, std::string const & id, XMLNode jobXml);
 static bool processJobStatus(Arc::Message& inmsg,ARexConfigContext& config, Arc::Logger& logger, std::string const & id, XMLNode jobXml);
 static bool processJobKill(Arc::Message& inmsg,ARexConfigContext& config, Arc::Logger& logger, std::string const & id, XMLNode jobXml);
 static bool processJobClean(Arc::Message& inmsg,ARexConfigContext& config, Arc::Logger& logger, std::string const & id, XMLNode jobXml);
 static bool processJobRestart(Arc::Message& inmsg,ARexConfigContext& config, Arc::Logger& logger, std::string const & id, XMLNode jobXml);
 static bool processJobDelegations(Arc::Message& inmsg,ARexConfigContext& config, Arc::Logger& logger, std::string const & id, XMLNode jobXml, ARex::DelegationStores& delegation_stores);
 
+// Jobs of GET <base URL>/jobs taken from snapshot
+class SnapshotJobsItems: public ResponseItems {
+ public:
+  SnapshotJobsItems(std::list<std::string> const& states, bool report_state):
+      states_(states), report_state_(report_state) {
+  }
+  std::list<JobsSnapshot::Job>& Jobs(void) { return jobs_; }
+  virtual bool Next(Arc::XMLNode& parent) {
+    for(; !jobs_.empty(); jobs_.pop_front()) {
+      JobsSnapshot::Job const& job = jobs_.front();
+      // Session directory may be already cleaned
+      if(!job.removed && !job.SessionExists()) continue;
+      std::string rest_state;
+      if(report_state_) {
+        convertActivityStatusREST(job,rest_state);
+        if(!states_.empty() && !job.removed) {
+          if(std::find(states_.begin(),states_.end(),rest_state) == states_.end()) continue;
+        }
+      }
+      XMLNode jobXml = parent.NewChild("job");
+      jobXml.NewChild("id") = job.id;
+      if(!rest_state.empty())
+        jobXml.NewChild("state") = rest_state;
+      jobs_.pop_front();
+      return true;
+    }
+    return false;
+  }
+ private:
+  std::list<JobsSnapshot::Job> jobs_;
+  std::list<std::string> states_;
+  bool report_state_;
+};
+
+// Jobs of POST <base URL>/jobs?action=status. Own jobs are taken from
+// snapshot while response is sent. Other jobs need authorization context
+// of request and are processed in advance.
+class StatusJobsItems: public ResponseItems {
+ public:
+  StatusJobsItems(Arc::Message& inmsg, ARexConfigContext& config, Arc::Logger& logger, std::list<std::string> const& ids):
+      ids_(ids), snapshot_(config.GmConfig().GetJobsSnapshot()), grid_name_(config.GridName()) {
+    for(std::list<std::string>::iterator id = ids_.begin(); id != ids_.end(); ++id) {
+      if(processed_.find(*id) != processed_.end()) continue;
+      XMLNode jobXml("<job/>");
+      if(processJobStatus(snapshot_,grid_name_,*id,jobXml)) continue;
+      (void)processJobStatus(inmsg,config,logger,*id,jobXml);
+      jobXml.GetXML(processed_[*id]);
+    }
+  }
+  virtual bool Next(Arc::XMLNode& parent) {
+    if(ids_.empty()) return false;
+    std::string id = ids_.front();
+    ids_.pop_front();
+    std::map<std::string,std::string>::iterator processed = processed_.find(id);
+    if(processed != processed_.end()) {
+      parent.NewChild(XMLNode(processed->second));
+      return true;
+    }
+    XMLNode jobXml = parent.NewChild("job");
+    if(!processJobStatus(snapshot_,grid_name_,id,jobXml)) {
+      // Job disappeared meanwhile
+      jobXml.NewChild("status-code") = "404";
+      jobXml.NewChild("reason") = "Job not found";
+      jobXml.NewChild("id") = id;
+      jobXml.NewChild("State") = "None";
+    }
+    return true;
+  }
+ private:
+  std::list<std::string> ids_;
+  JobsSnapshot* snapshot_;
+  std::string grid_name_;
+  std::map<std::string,std::string> processed_;
+};
+
 Arc::MCC_Status ARexRest::processJobs(Arc::Message& inmsg,Arc::Message& outmsg,ProcessingContext& context) {
-  // GET <base URL>/jobs[?state=<state1[,state2[...]]>]
+  // GET <base URL>/jobs[?state=<state1[,state2[...]]>][&since=<cursor>]
   // HEAD - supported.
   // POST <base URL>/jobs?action=new initiates creation of a new job instance or multiple jobs.
   // POST <base URL>/jobs?action={info|status|kill|clean|restart|delegations} - job management operations supporting arrays of jobs.
@@ -887,6 +1480,24 @@ Arc::MCC_Status ARexRest::processJobs(Arc::Message& inmsg,Arc::Message& outmsg,P
   if((context.method == "GET") || (context.method == "HEAD")) {
     std::list<std::string> states;
     tokenize(context["state"], states, ",");
+    JobsSnapshot* snapshot = config->GmConfig().GetJobsSnapshot();
+    if(snapshot && snapshot->Ready()) {
+      // With since=<cursor> only jobs changed after previous request are
+      // reported, including removed ones with state None. Cursor for next
+      // request is returned in response.
+      std::string since_str = context["since"];
+      unsigned long long since = 0;
+      if(!since_str.empty() && !Arc::stringto(since_str,since))
+        return HTTPFault(inmsg,outmsg,400,"Wrong since value");
+      SnapshotJobsItems* items = new SnapshotJobsItems(states,!states.empty() || !since_str.empty());
+      unsigned long long cursor = snapshot->List(config->GridName(),since,items->Jobs());
+      ResponsePayload* payload = new ResponsePayload(ProcessAcceptedFormat(inmsg,outmsg),Arc::NS(),"jobs",items);
+      if(!since_str.empty())
+        payload->Header().NewChild("cursor") = Arc::tostring(cursor);
+      return HTTPResponse(inmsg, outmsg, payload);
+    }
+    // Snapshot is not filled yet. Cursor is not reported, so client knows
+    // that since was ignored.
     XMLNode listXml("<jobs/>");
     std::list<std::string> ids = ARexJob::Jobs(*config,logger_);
     for(std::list<std::string>::iterator itId = ids.begin(); itId != ids.end(); ++itId) {
@@ -1034,12 +1645,9 @@ Arc::MCC_Status ARexRest::processJobs(Arc::Message& inmsg,Arc::Message& outmsg,P
     } else if(action == "status") {
       std::list<std::string> ids;
       ParseJobIds(inmsg,outmsg,ids);
-      XMLNode listXml("<jobs/>");
-      for(std::list<std::string>::iterator id = ids.begin(); id != ids.end(); ++id) {
-        XMLNode jobXml = listXml.NewChild("job");
-        (void)processJobStatus(inmsg,*config,logger_,*id,jobXml);
-      }
-      return HTTPPOSTResponse(inmsg, outmsg, listXml);
+      StatusJobsItems* items = new StatusJobsItems(inmsg,*config,logger_,ids);
+      return HTTPPOSTResponse(inmsg, outmsg,
+               new ResponsePayload(ProcessAcceptedFormat(inmsg,outmsg),Arc::NS(),"jobs",items));
     } else if(action == "kill") {
       std::list<std::string> ids;
       ParseJobIds(inmsg,outmsg,ids);
@@ -1153,7 +1761,28 @@ static bool processJobInfo(Arc::Message& inmsg,ARexConfigContext& config, Arc::L
   return true;
 }
 
+// State of own jobs is available in memory. Other jobs need authorization
+// against job's ACL and hence are processed through ARexJob. Returns false
+// if job can't be processed here.
+static bool processJobStatus(JobsSnapshot* snapshot, std::string const& grid_name, std::string const & id, XMLNode jobXml) {
+  JobsSnapshot::Job snapshot_job;
+  if(!snapshot || !snapshot->Find(id,snapshot_job) || (snapshot_job.owner != grid_name))
+    return false;
+  // Without session directory job is handled like in full check
+  if(!snapshot_job.SessionExists())
+    return false;
+  std::string rest_state;
+  convertActivityStatusREST(snapshot_job,rest_state);
+  jobXml.NewChild("status-code") = "200";
+  jobXml.NewChild("reason") = "OK";
+  jobXml.NewChild("id") = id;
+  jobXml.NewChild("state") = rest_state;
+  return true;
+}
+
 static bool processJobStatus(Arc::Message& inmsg,ARexConfigContext& config, Arc::Logger& logger, std::string const & id, XMLNode jobXml) {
+  if(processJobStatus(config.GmConfig().GetJobsSnapshot(),config.GridName(),id,jobXml))
+    return true;
   ARexJob job(id,config,logger);
   if(!job) {
     // There is no such job
@@ -1412,7 +2041,16 @@ static void STATtoPROP(std::string const& name, struct stat& st,
   prop.NewChild("d:creationdate") = Arc::Time(st.st_ctime).str(Arc::ISOTime);
 }
 
-static void ProcessPROPFIND(Arc::FileAccess* fa, Arc::XMLNode& multistatus,URL const& url,std::string const& path,uid_t uid,gid_t gid,int depth) {
+struct PROPFINDEntry {
+  URL url;
+  std::string path;
+  int depth;
+  PROPFINDEntry(URL const& url, std::string const& path, int depth):url(url),path(path),depth(depth) {};
+};
+
+// Adds response for single entry. Entries in directory which must be
+// reported too are returned in subentries.
+static void ProcessPROPFIND(Arc::FileAccess* fa, Arc::XMLNode& multistatus,URL const& url,std::string const& path,int depth,std::list<PROPFINDEntry>& subentries) {
   std::string name;
   std::size_t pos = path.rfind('/');
   if(pos == std::string::npos)
@@ -1437,20 +2075,15 @@ static void ProcessPROPFIND(Arc::FileAccess* fa, Arc::XMLNode& multistatus,URL c
     STATtoPROP(name, st, std::list<std::string>(), response);
     if(depth > 0) {
       if (fa->fa_opendir(path)) {
-        std::list<std::string> names;
         std::string name;
         while(fa->fa_readdir(name)) {
           if(name == ".") continue;
           if(name == "..") continue;
-          names.push_back(name);
-        }
-        fa->fa_closedir();
-        for(std::list<std::string>::iterator name = names.begin(); name != names.end(); ++name) {
           URL subUrl(url);
-          subUrl.ChangePath(subUrl.Path() + "/" + *name);
-          std::string subPath = path + "/" + *name;
-          ProcessPROPFIND(fa,multistatus,subUrl,subPath,uid,gid,depth-1);
+          subUrl.ChangePath(subUrl.Path() + "/" + name);
+          subentries.push_back(PROPFINDEntry(subUrl, path + "/" + name, depth-1));
         }
+        fa->fa_closedir();
       }
     }
   } else {
@@ -1460,6 +2093,31 @@ static void ProcessPROPFIND(Arc::FileAccess* fa, Arc::XMLNode& multistatus,URL c
   }
 }
 
+// Responses of PROPFIND produced while directory tree is traversed.
+// Order is same as for recursive traversal.
+class PROPFINDItems: public ResponseItems {
+ public:
+  // Takes ownership of fa
+  PROPFINDItems(Arc::FileAccess* fa, URL const& url, std::string const& path, int depth):fa_(fa) {
+    entries_.push_back(PROPFINDEntry(url, path, depth));
+  }
+  virtual ~PROPFINDItems(void) {
+    if(fa_) Arc::FileAccess::Release(fa_);
+  }
+  virtual bool Next(Arc::XMLNode& multistatus) {
+    if(!fa_ || entries_.empty()) return false;
+    PROPFINDEntry entry = entries_.front();
+    entries_.pop_front();
+    std::list<PROPFINDEntry> subentries;
+    ProcessPROPFIND(fa_, multistatus, entry.url, entry.path, entry.depth, subentries);
+    entries_.splice(entries_.begin(), subentries);
+    return true;
+  }
+ private:
+  Arc::FileAccess* fa_;
+  std::list<PROPFINDEntry> entries_;
+};
+
 Arc::MCC_Status ARexRest::processJobSessionDir(Arc::Message& inmsg,Arc::Message& outmsg,
                                             ProcessingContext& context,std::string const & id) {
   class FileAccessRef {
@@ -1476,7 +2134,7 @@ Arc::MCC_Status ARexRest::processJobSessionDir(Arc::Message& inmsg,Arc::Message&
     }
   
     operator bool() const {
-      return (obj_ == NULL);
+      return (obj_ != NULL);
     }
   
     bool operator !() const {
@@ -1550,6 +2208,14 @@ Arc::MCC_Status ARexRest::processJobSessionDir(Arc::Message& inmsg,Arc::Message&
       };
       return HTTPResponse(inmsg,outmsg,listXml);
     };
+    // Regular file which service may read itself is passed to network
+    // without going through file access helper process.
+    int fileHandle = job.OpenFileDirect(context.subpath);
+    if(fileHandle != -1) {
+      Arc::MCC_Status r = HTTPResponseFile(inmsg,outmsg,fileHandle,"application/octet-stream");
+      if(fileHandle != -1) ::close(fileHandle);
+      return r;
+    }
     FileAccessRef file(job.OpenFile(context.subpath,true,false));
     if(file) {
       // File or similar
@@ -1606,12 +2272,18 @@ Arc::MCC_Status ARexRest::processJobSessionDir(Arc::Message& inmsg,Arc::Message&
       depth = 1;
     std::string fpath = job.GetFilePath(context.subpath);
     URL url(inmsg.Attributes()->get("HTTP:ENDPOINT"));
-    Arc::XMLNode multistatus("<d:multistatus xmlns:d=\"DAV:\"/>");
-    FileAccessRef fa(Arc::FileAccess::Acquire());
-    if(fa) ProcessPROPFIND(fa,multistatus,url,fpath,job.UID(),job.GID(),depth);
-    std::string payload;
-    multistatus.GetDoc(payload);
-    return HTTPResponse(inmsg,outmsg,payload,"application/xml");
+    Arc::FileAccess* fa = Arc::FileAccess::Acquire();
+    if(fa && !fa->fa_setuid(job.UID(),job.GID())) {
+      Arc::FileAccess::Release(fa);
+      fa = NULL;
+    }
+    Arc::NS ns;
+    ns["d"] = "DAV:";
+    ResponsePayload* payload = new ResponsePayload(ResponseFormatXml,ns,"d:multistatus",
+                                                   new PROPFINDItems(fa,url,fpath,depth),true);
+    Arc::MCC_Status r = HTTPResponse(inmsg,outmsg,payload);
+    outmsg.Attributes()->set("HTTP:content-type","application/xml");
+    return r;
   };
   return HTTPFault(inmsg,outmsg,501,"Not Implemented");
 }
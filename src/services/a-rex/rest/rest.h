@@ -26,6 +26,9 @@ namespace ARex {
       std::string operator[](char const * key) const;
     };
 
+    // Rendered content of info.xml
+    class InfoCache;
+
     Arc::Logger logger_;
     std::string uname_;
     std::string endpoint_;
@@ -34,6 +37,7 @@ namespace ARex {
     ARex::GMConfig& config_;
     ARex::DelegationStores& delegation_stores_;
     unsigned int& all_jobs_count_;
+    InfoCache* info_cache_;
 
     Arc::MCC_Status processVersions(Arc::Message& inmsg,Arc::Message& outmsg,ProcessingContext& context);
 